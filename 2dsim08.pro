@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -8,12 +8,73 @@ CONFIG += c++11
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Creature kinematics precision (see simprecision.h); default is double.
+#DEFINES += SIM_PRECISION_FLOAT
+#DEFINES += SIM_PRECISION_FIXED
+
+# Heap allocation counter for --check-allocations (see alloccheck.h). Replaces glibc's malloc for
+# the whole process, so keep it out of builds that ship or run under another allocator.
+#DEFINES += SIM_COUNT_ALLOCATIONS
+
 SOURCES += \
+    alloccheck.cpp \
+    autotuner.cpp \
+    cputopology.cpp \
+    determinism.cpp \
+    ensemble.cpp \
+    frameexport.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    memorystats.cpp \
+    metrics.cpp \
+    scenario.cpp \
+    shardlink.cpp \
+    shardnode.cpp \
+    simarena.cpp \
+    simtrace.cpp \
+    simworld.cpp \
+    snapshotviews.cpp \
+    soaktest.cpp \
+    terrainchunks.cpp \
+    tilerenderer.cpp \
+    trajectoryformat.cpp \
+    trajectoryreader.cpp \
+    trajectoryrecorder.cpp \
+    worldcommands.cpp \
+    worldfeed.cpp \
+    worldfeedreader.cpp
 
 HEADERS += \
-    mainwindow.h
+    alloccheck.h \
+    autotuner.h \
+    cputopology.h \
+    determinism.h \
+    ensemble.h \
+    frameexport.h \
+    mainwindow.h \
+    memorystats.h \
+    metrics.h \
+    scenario.h \
+    shardlink.h \
+    shardnode.h \
+    simarena.h \
+    simprecision.h \
+    simtrace.h \
+    simworld.h \
+    snapshotviews.h \
+    soaktest.h \
+    terrainchunks.h \
+    tilerenderer.h \
+    trajectoryformat.h \
+    trajectoryreader.h \
+    trajectoryrecorder.h \
+    worldcommands.h \
+    worldfeed.h \
+    worldfeedformat.h \
+    worldfeedreader.h
+
+# shm_open lives in librt before glibc 2.34
+unix:!macx: LIBS += -lrt
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -0,0 +1,213 @@
+// 2dsim08/alloccheck.cpp - Heap allocation counter, the steady-state tick allocation check and the memory report
+#include "alloccheck.h"
+#include "simworld.h"
+#include "mainwindow.h"
+#include "memorystats.h"
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+// === Allocation Counter ===
+// Constant-initialized, so they are usable by the very first malloc of the process
+static std::atomic<bool> sCounting(false);
+static std::atomic<quint64> sAllocations(0);
+static std::atomic<quint64> sBytes(0);
+
+static inline void countAllocation(size_t bytes) {
+    if (sCounting.load(std::memory_order_relaxed)) {
+        sAllocations.fetch_add(1, std::memory_order_relaxed);
+        sBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+#if defined(__GLIBC__) && defined(SIM_COUNT_ALLOCATIONS)
+// glibc keeps its allocator under these names too; the definitions below take precedence over
+// libc's malloc for the whole process, Qt libraries included. free() is left alone, which only
+// matches while glibc's allocator is the one in use - so this is an opt-in check build (see the
+// .pro file), never the shipped binary, and must not be run under an LD_PRELOADed allocator.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    countAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) {
+    countAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) {
+    countAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** pointer, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) return EINVAL;
+    countAllocation(size);
+    void* memory = __libc_memalign(alignment, size);
+    if (!memory && size != 0) return ENOMEM;
+    *pointer = memory;
+    return 0;
+}
+
+bool AllocationCounter::supported() {
+    return true;
+}
+#else
+bool AllocationCounter::supported() {
+    return false;
+}
+#endif
+
+void AllocationCounter::setCounting(bool enabled) {
+    sCounting.store(enabled, std::memory_order_relaxed);
+}
+
+quint64 AllocationCounter::count() {
+    return sAllocations.load(std::memory_order_relaxed);
+}
+
+quint64 AllocationCounter::bytes() {
+    return sBytes.load(std::memory_order_relaxed);
+}
+
+// === Allocation Check ===
+int AllocationCheck::run(const AllocationCheckConfig& config) {
+    if (!AllocationCounter::supported()) {
+        std::fprintf(stderr, "Allocations: counting needs glibc (Linux) and a build with DEFINES += SIM_COUNT_ALLOCATIONS\n");
+        return 2;
+    }
+    const qint64 ticks = config.ticks > 0 ? config.ticks : ALLOCATION_DEFAULT_TICKS;
+
+    // Declared before the world, so the world is gone before its pool
+    QScopedPointer<QThreadPool> pool(config.threads > 1 ? new QThreadPool : nullptr);
+    if (pool) {
+        pool->setMaxThreadCount(config.threads);
+    }
+    SimWorld world(pool.data());
+    world.setDeterministic(true);
+    world.setSimulatedCoreLoad(false);
+    world.setCommitBatchSize(MainWindow::CREATURES_UPDATED_PER_TICK);   // Same batching as the GUI
+    world.setParams(config.params);
+    world.setupTerrain(config.seed);
+    world.setupCreatures(config.creatures, config.seed);
+    // Terrain chunks are generated on first lookup; have them all before counting starts
+    world.terrain().prefetch(QRect(0, 0, world.terrain().chunkCols(), world.terrain().chunkRows()), false);
+
+    qint64 warmup = 0;
+    while (warmup < ALLOCATION_WARMUP_TICKS || world.housekeepingStats().passes < 2) {
+        world.tick();
+        warmup++;
+    }
+    std::printf("Allocations: %d creatures, %d threads, seed %u, %lld warm-up ticks, counting %lld ticks\n",
+                config.creatures, qMax(1, config.threads), config.seed,
+                static_cast<long long>(warmup), static_cast<long long>(ticks));
+    std::fflush(stdout);
+
+    quint64 total = 0;
+    quint64 worst = 0;
+    qint64 allocatingTicks = 0;
+    qint64 firstTick = -1;
+    for (qint64 tick = 0; tick < ticks; tick++) {
+        quint64 before = AllocationCounter::count();
+        AllocationCounter::setCounting(true);
+        world.tick();
+        AllocationCounter::setCounting(false);
+        quint64 allocations = AllocationCounter::count() - before;
+
+        total += allocations;
+        worst = qMax(worst, allocations);
+        if (allocations > 0) {
+            allocatingTicks++;
+            if (firstTick < 0) firstTick = world.tickCount();
+        }
+    }
+
+    if (total == 0) {
+        std::printf("Allocations: PASS - no heap allocations in %lld ticks\n", static_cast<long long>(ticks));
+    } else {
+        std::printf("Allocations: FAIL - %llu allocations in %lld of %lld ticks (first at tick %lld, at most %llu per tick)\n",
+                    static_cast<unsigned long long>(total), static_cast<long long>(allocatingTicks),
+                    static_cast<long long>(ticks), static_cast<long long>(firstTick),
+                    static_cast<unsigned long long>(worst));
+    }
+    std::fflush(stdout);
+    return total == 0 ? 0 : 1;
+}
+
+// === Memory Report ===
+static void printMemory(const char* stage, int creatures) {
+    std::printf("Memory %s:\n", stage);
+    for (const QString& line : MemoryStats::report(creatures)) {
+        std::printf("  %s\n", qPrintable(line));
+    }
+    std::fflush(stdout);
+}
+
+int MemoryReport::run(const MemoryReportConfig& config) {
+    const qint64 ticks = config.ticks > 0 ? config.ticks : MEMORY_DEFAULT_TICKS;
+    const qint64 baseline = MemoryStats::residentBytes();
+    if (baseline == 0) {
+        std::fprintf(stderr, "Memory: resident size is only known on Linux; reporting tags only\n");
+    }
+    std::printf("Memory: %d creatures, %d threads, seed %u, process resident %s before the world\n",
+                config.creatures, qMax(1, config.threads), config.seed,
+                qPrintable(MemoryStats::formatBytes(baseline)));
+
+    QScopedPointer<QThreadPool> pool(config.threads > 1 ? new QThreadPool : nullptr);
+    if (pool) {
+        pool->setMaxThreadCount(config.threads);
+    }
+    SimWorld world(pool.data());
+    world.setDeterministic(true);
+    world.setSimulatedCoreLoad(false);
+    world.setCommitBatchSize(MainWindow::CREATURES_UPDATED_PER_TICK);
+    world.setParams(config.params);
+    world.setupTerrain(config.seed);
+    world.setupCreatures(config.creatures, config.seed);
+    printMemory("after setup", config.creatures);
+
+    qint64 warmup = 0;
+    while (warmup < MEMORY_WARMUP_TICKS || world.housekeepingStats().passes < 2) {
+        world.tick();
+        warmup++;
+    }
+    for (qint64 tick = 0; tick < ticks; tick++) {
+        world.tick();
+    }
+    const int creatures = world.creatures().size();
+    printMemory(qPrintable(QString("after %1 warm-up and %2 steady-state ticks").arg(warmup).arg(ticks)), creatures);
+
+    // What the world added to the process, per creature - the number a budget is checked against
+    const qint64 perCreature = creatures > 0 ? (MemoryStats::residentBytes() - baseline) / creatures : 0;
+    std::printf("Memory: world adds %s resident per creature\n", qPrintable(MemoryStats::formatBytes(perCreature)));
+    if (config.budgetPerCreature > 0) {
+        if (baseline > 0 && perCreature > config.budgetPerCreature) {
+            std::printf("Memory: FAIL - %lld bytes per creature, budget %lld\n",
+                        static_cast<long long>(perCreature), static_cast<long long>(config.budgetPerCreature));
+            std::fflush(stdout);
+            return 1;
+        }
+        std::printf("Memory: PASS - %lld bytes per creature, budget %lld\n",
+                    static_cast<long long>(perCreature), static_cast<long long>(config.budgetPerCreature));
+    }
+    std::fflush(stdout);
+    return 0;
+}
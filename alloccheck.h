@@ -0,0 +1,69 @@
+// 2dsim08/alloccheck.h - Heap allocation counter, the steady-state tick allocation check and the memory report
+#ifndef ALLOCCHECK_H
+#define ALLOCCHECK_H
+
+#include "simworld.h"
+#include <QtGlobal>
+
+// Counts malloc/calloc/realloc and aligned allocation calls, and the bytes they ask for, from
+// every thread - Qt containers and operator new included - while counting is on. Only in builds
+// with SIM_COUNT_ALLOCATIONS on Linux/glibc (the process's malloc is wrapped); elsewhere
+// supported() is false and nothing is counted. Off, a call costs one relaxed load.
+class AllocationCounter
+{
+public:
+    static bool supported();
+    static void setCounting(bool enabled);
+    static quint64 count();
+    static quint64 bytes();      // Requested; frees are not subtracted
+};
+
+struct AllocationCheckConfig {
+    int creatures;
+    quint32 seed;
+    qint64 ticks;        // Counted ticks, after warm-up
+    int threads;         // 1 = tasks run inline on the tick thread
+    SimParams params;    // Scenario
+
+    AllocationCheckConfig() : creatures(0), seed(1), ticks(0), threads(1) {}
+};
+
+// Warms a deterministic world up (arenas, buckets and housekeeping lists reach their sizes),
+// then counts heap allocations across ticks. The tick pipeline's scratch data lives in tick
+// arenas, so a steady-state tick should allocate nothing.
+class AllocationCheck
+{
+public:
+    static const int ALLOCATION_WARMUP_TICKS = 200;     // At least; also two full housekeeping passes
+    static const int ALLOCATION_DEFAULT_TICKS = 500;
+
+    int run(const AllocationCheckConfig& config);   // 0 = no allocations, 1 = some tick allocated
+};
+
+// === Memory Report ===
+struct MemoryReportConfig {
+    int creatures;
+    quint32 seed;
+    qint64 ticks;                 // Steady-state ticks, after warm-up
+    int threads;
+    qint64 budgetPerCreature;     // Resident bytes per creature; 0 = report only
+    SimParams params;             // Scenario
+
+    MemoryReportConfig() : creatures(0), seed(1), ticks(0), threads(1), budgetPerCreature(0) {}
+};
+
+// Builds one deterministic world headless and reports what it costs: each tag and the process
+// RSS after setup, at the setup peak and after warm-up plus the steady-state ticks, all per
+// creature too. With a budget it fails when steady-state RSS per creature exceeds it, so a
+// footprint regression breaks the run that introduced it.
+class MemoryReport
+{
+public:
+    static const int MEMORY_WARMUP_TICKS = 200;
+    static const int MEMORY_DEFAULT_TICKS = 1000;
+
+    int run(const MemoryReportConfig& config);   // 0 = within budget, 1 = over budget
+};
+
+
+#endif // ALLOCCHECK_H
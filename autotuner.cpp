@@ -0,0 +1,111 @@
+// 2dsim08/autotuner.cpp - Picks the update phase's worker count and slice grain from measured tick times
+#include "autotuner.h"
+#include <algorithm>
+#include <cmath>
+
+AutoTuner::AutoTuner(int maxWorkers)
+    : mMaxWorkers(qMax(1, maxWorkers))
+    , mSettled(false)
+    , mSlicePhase(false)
+    , mCandidate(0)
+    , mSkip(0)
+    , mBestMicros(-1)
+    , mTunings(0)
+    , mSinceCheck(0)
+{
+    mSamples.reserve(AUTOTUNE_TRIAL_TICKS);
+    mBaseline.total = -1;   // Nothing tuned yet: the first observe() starts a search
+}
+
+UpdatePlan AutoTuner::observe(qint64 updateMicros, const UpdateMix& mix) {
+    if (mBaseline.total < 0) {
+        start(mix);
+        return mPlan;
+    }
+
+    if (mSettled) {
+        if (++mSinceCheck >= AUTOTUNE_CHECK_INTERVAL) {
+            mSinceCheck = 0;
+            if (drifted(mix)) start(mix);
+        }
+        return mPlan;
+    }
+
+    if (mSkip > 0) {
+        mSkip--;
+        return mPlan;
+    }
+    mSamples.push_back(updateMicros);
+    if (mSamples.size() < AUTOTUNE_TRIAL_TICKS) return mPlan;
+
+    // Median, so one descheduled tick does not decide the trial
+    std::nth_element(mSamples.begin(), mSamples.begin() + mSamples.size() / 2, mSamples.end());
+    qint64 median = mSamples[mSamples.size() / 2];
+    mSamples.clear();
+    if (mBestMicros < 0 || median < mBestMicros) {
+        mBest = mPlan;
+        mBestMicros = median;
+    }
+
+    if (++mCandidate >= mCandidates.size()) {
+        if (mSlicePhase || mBest.workers == 1) {
+            settle();
+            return mPlan;
+        }
+        // Step 2: finer grain at the winning worker count
+        mSlicePhase = true;
+        mCandidates.clear();
+        for (int perWorker = 2; perWorker <= AUTOTUNE_MAX_SLICES_PER_WORKER; perWorker *= 2) {
+            mCandidates.push_back(UpdatePlan(mBest.workers, mBest.workers * perWorker));
+        }
+        mCandidate = 0;
+    }
+    mPlan = mCandidates[mCandidate];
+    mSkip = AUTOTUNE_SETTLE_TICKS;
+    return mPlan;
+}
+
+void AutoTuner::start(const UpdateMix& mix) {
+    mBaseline = mix;
+    mSettled = false;
+    mSlicePhase = false;
+    mCandidates.clear();
+    for (int workers = 1; workers < mMaxWorkers; workers *= 2) {
+        mCandidates.push_back(UpdatePlan(workers, workers));
+    }
+    mCandidates.push_back(UpdatePlan(mMaxWorkers, mMaxWorkers));
+    mCandidate = 0;
+    mPlan = mCandidates[0];
+    mSkip = AUTOTUNE_SETTLE_TICKS;
+    mSamples.clear();
+    mBestMicros = -1;
+}
+
+void AutoTuner::settle() {
+    mPlan = mBest;
+    mSettled = true;
+    mSinceCheck = 0;
+    mTunings++;
+}
+
+bool AutoTuner::drifted(const UpdateMix& mix) const {
+    if (mBaseline.total <= 0 || mix.total <= 0) return mBaseline.total != mix.total;
+    if (std::abs(mix.total - mBaseline.total) > AUTOTUNE_POPULATION_DRIFT * mBaseline.total) return true;
+
+    // Total variation distance between the two bucket shares
+    double moved = 0;
+    for (int b = 0; b < BUCKET_COUNT; b++) {
+        moved += std::abs(static_cast<double>(mix.counts[b]) / mix.total -
+                          static_cast<double>(mBaseline.counts[b]) / mBaseline.total);
+    }
+    return moved / 2 > AUTOTUNE_MIX_DRIFT;
+}
+
+QString AutoTuner::describe() const {
+    if (!mSettled) {
+        return QString("tuning: trying %1 workers x %2 slices").arg(mPlan.workers).arg(mPlan.slices);
+    }
+    return QString("%1 worker%2 x %3 slices, update %4 us (tuning #%5, %6 creatures)")
+           .arg(mPlan.workers).arg(mPlan.workers == 1 ? " (inline)" : "s").arg(mPlan.slices)
+           .arg(mBestMicros).arg(mTunings).arg(mBaseline.total);
+}
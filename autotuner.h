@@ -0,0 +1,56 @@
+// 2dsim08/autotuner.h - Picks the update phase's worker count and slice grain from measured tick times
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#include "simworld.h"
+#include <QString>
+#include <QVector>
+
+// Coordinate search over UpdatePlans, one trial per candidate:
+//   1. worker counts 1, 2, 4, ... up to the pool size, one slice each;
+//   2. at the best worker count, 2 and 4 slices per worker.
+// A trial discards AUTOTUNE_SETTLE_TICKS (bucket rebuilds, cold caches) and scores the median
+// update time of the next AUTOTUNE_TRIAL_TICKS. Settled, it checks every AUTOTUNE_CHECK_INTERVAL
+// ticks whether the population or the behavior mix moved enough to tune again.
+class AutoTuner
+{
+public:
+    static const int AUTOTUNE_SETTLE_TICKS = 2;
+    static const int AUTOTUNE_TRIAL_TICKS = 15;
+    static const int AUTOTUNE_CHECK_INTERVAL = 100;
+    static const int AUTOTUNE_MAX_SLICES_PER_WORKER = 4;
+    static constexpr double AUTOTUNE_POPULATION_DRIFT = 0.25;   // Relative change in creatures
+    static constexpr double AUTOTUNE_MIX_DRIFT = 0.20;          // Share of creatures that changed bucket
+
+    explicit AutoTuner(int maxWorkers);
+
+    // After every tick; returns the plan for the next one
+    UpdatePlan observe(qint64 updateMicros, const UpdateMix& mix);
+
+    bool isSettled() const { return mSettled; }
+    UpdatePlan plan() const { return mPlan; }        // Being tried, or chosen when settled
+    qint64 bestMicros() const { return mBestMicros; }
+    int tunings() const { return mTunings; }          // Completed searches
+    QString describe() const;
+
+private:
+    void start(const UpdateMix& mix);
+    void settle();
+    bool drifted(const UpdateMix& mix) const;
+
+    int mMaxWorkers;
+    bool mSettled;
+    bool mSlicePhase;                  // Step 2 of the search
+    QVector<UpdatePlan> mCandidates;
+    int mCandidate;
+    UpdatePlan mPlan;
+    int mSkip;
+    QVector<qint64> mSamples;
+    UpdatePlan mBest;
+    qint64 mBestMicros;
+    int mTunings;
+    int mSinceCheck;
+    UpdateMix mBaseline;               // Mix the current choice was tuned for
+};
+
+#endif // AUTOTUNER_H
@@ -0,0 +1,235 @@
+// 2dsim08/cputopology.cpp - CPU/NUMA topology detection and worker thread pinning
+#include "cputopology.h"
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QPair>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static const char SYSFS_CPU_PATH[] = "/sys/devices/system/cpu";
+static const char SYSFS_NODE_PATH[] = "/sys/devices/system/node";
+
+static QString readSysfs(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QString();
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
+
+static int readSysfsInt(const QString& path, int fallback) {
+    bool ok = false;
+    int value = readSysfs(path).toInt(&ok);
+    return ok ? value : fallback;
+}
+
+CpuTopology::CpuTopology()
+    : mPackageCount(1)
+    , mNodeCount(1)
+    , mPhysicalCoreCount(0)
+    , mDetailed(false)
+{
+}
+
+CpuTopology CpuTopology::detect() {
+    CpuTopology topology;
+
+    QVector<int> online = parseCpuList(readSysfs(QString("%1/online").arg(SYSFS_CPU_PATH)));
+    topology.mDetailed = !online.isEmpty();
+    if (online.isEmpty()) {
+        for (int cpu = 0; cpu < QThread::idealThreadCount(); cpu++) {
+            online.push_back(cpu);
+        }
+    }
+
+    // CPU -> NUMA node from each node's cpulist (no node directories = single node)
+    QMap<int, int> nodeOfCpu;
+    QDir nodeDir(SYSFS_NODE_PATH);
+    for (const QString& entry : nodeDir.entryList(QStringList() << "node*", QDir::Dirs)) {
+        bool ok = false;
+        int node = entry.mid(4).toInt(&ok);
+        if (!ok) continue;
+        for (int cpu : parseCpuList(readSysfs(nodeDir.filePath(entry + "/cpulist")))) {
+            nodeOfCpu.insert(cpu, node);
+        }
+    }
+
+    QMap<QPair<int, int>, int> threadsPerCore;   // (package, core) -> hardware threads seen so far
+    QMap<int, int> packages;
+    QMap<int, int> nodes;
+    for (int cpu : online) {
+        QString base = QString("%1/cpu%2/topology/").arg(SYSFS_CPU_PATH).arg(cpu);
+        CpuInfo info;
+        info.cpu = cpu;
+        info.package = topology.mDetailed ? readSysfsInt(base + "physical_package_id", 0) : 0;
+        info.core = topology.mDetailed ? readSysfsInt(base + "core_id", cpu) : cpu;
+        info.node = nodeOfCpu.value(cpu, 0);
+
+        // Online list is ascending, so the lowest-numbered thread of each core gets index 0
+        QPair<int, int> coreKey(info.package, info.core);
+        info.siblingIndex = threadsPerCore.value(coreKey, 0);
+        threadsPerCore.insert(coreKey, info.siblingIndex + 1);
+
+        packages.insert(info.package, 1);
+        nodes.insert(info.node, 1);
+        topology.mCpus.push_back(info);
+    }
+
+    topology.mPackageCount = qMax(1, packages.size());
+    topology.mNodeCount = qMax(1, nodes.size());
+    topology.mPhysicalCoreCount = threadsPerCore.size();
+    return topology;
+}
+
+QStringList CpuTopology::report() const {
+    QStringList lines;
+    int logical = mCpus.size();
+    lines << QString("CPU topology%1: %2 package(s), %3 NUMA node(s), %4 cores, %5 logical CPUs (SMT %6)")
+             .arg(mDetailed ? "" : " (not available, assuming flat)")
+             .arg(mPackageCount).arg(mNodeCount).arg(mPhysicalCoreCount).arg(logical)
+             .arg(mPhysicalCoreCount > 0 ? logical / mPhysicalCoreCount : 1);
+
+    QMap<int, QVector<int>> cpusOfNode;
+    for (const CpuInfo& info : mCpus) {
+        cpusOfNode[info.node].push_back(info.cpu);
+    }
+    for (auto it = cpusOfNode.constBegin(); it != cpusOfNode.constEnd(); ++it) {
+        lines << QString("  node %1: cpus %2").arg(it.key()).arg(formatCpuList(it.value()));
+    }
+    return lines;
+}
+
+QVector<int> CpuTopology::selectCpus(const QString& policy, int count, int partition, int partitions, QString* error) const {
+    QVector<int> order;
+
+    if (policy.isEmpty() || policy == "none") {
+        return order;
+    } else if (policy == "compact" || policy == "scatter") {
+        QVector<CpuInfo> sorted = mCpus;
+
+        // Rank of each core within its node, so scatter can interleave nodes core by core
+        QMap<QPair<int, int>, int> coreRank;
+        QMap<int, int> coresInNode;
+        for (const CpuInfo& info : sorted) {
+            QPair<int, int> key(info.package, info.core);
+            if (info.siblingIndex == 0 && !coreRank.contains(key)) {
+                coreRank.insert(key, coresInNode[info.node]++);
+            }
+        }
+
+        bool scatter = (policy == "scatter");
+        std::stable_sort(sorted.begin(), sorted.end(), [&](const CpuInfo& a, const CpuInfo& b) {
+            if (a.siblingIndex != b.siblingIndex) return a.siblingIndex < b.siblingIndex;
+            if (scatter) {
+                int rankA = coreRank.value(qMakePair(a.package, a.core));
+                int rankB = coreRank.value(qMakePair(b.package, b.core));
+                if (rankA != rankB) return rankA < rankB;
+            }
+            if (a.node != b.node) return a.node < b.node;
+            return a.cpu < b.cpu;
+        });
+        for (const CpuInfo& info : sorted) {
+            order.push_back(info.cpu);
+        }
+    } else {
+        order = parseCpuList(policy);
+        for (int cpu : order) {
+            bool known = std::any_of(mCpus.begin(), mCpus.end(), [cpu](const CpuInfo& info) { return info.cpu == cpu; });
+            if (!known) {
+                if (error) *error = QString("CPU %1 is not online").arg(cpu);
+                return QVector<int>();
+            }
+        }
+    }
+
+    if (order.isEmpty()) {
+        if (error) *error = QString("Unknown pinning policy '%1' (use none, compact, scatter or a CPU list)").arg(policy);
+        return order;
+    }
+
+    // Each partition takes the next `count` CPUs of the order, wrapping when oversubscribed
+    QVector<int> selected;
+    int first = qMax(0, partition) * count;
+    for (int i = 0; i < count; i++) {
+        selected.push_back(order[(first + i) % order.size()]);
+    }
+    if (error && partitions * count > order.size()) {
+        *error = QString("%1 workers x %2 partitions oversubscribe %3 CPUs").arg(count).arg(partitions).arg(order.size());
+    }
+    return selected;
+}
+
+QVector<int> CpuTopology::parseCpuList(const QString& list) {
+    QVector<int> cpus;
+    for (const QString& part : list.split(',', Qt::SkipEmptyParts)) {
+        QStringList range = part.trimmed().split('-');
+        bool okFirst = false, okLast = true;
+        int first = range[0].toInt(&okFirst);
+        int last = range.size() > 1 ? range[1].toInt(&okLast) : first;
+        if (!okFirst || !okLast || last < first) return QVector<int>();
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+QString CpuTopology::formatCpuList(const QVector<int>& cpus) {
+    QStringList parts;
+    for (int i = 0; i < cpus.size();) {
+        int j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) j++;
+        parts << (j > i ? QString("%1-%2").arg(cpus[i]).arg(cpus[j]) : QString::number(cpus[i]));
+        i = j + 1;
+    }
+    return parts.join(',');
+}
+
+// === Worker Pinning ===
+static QString sWorkerPinPolicy;
+static QVector<int> sWorkerCpus;            // Set once at startup, before any worker runs
+static std::atomic<int> sNextWorkerSlot(0);
+
+void setWorkerPinPolicy(const QString& policy) {
+    sWorkerPinPolicy = policy;
+}
+
+QString workerPinPolicy() {
+    return sWorkerPinPolicy;
+}
+
+void setWorkerCpus(const QVector<int>& cpus) {
+    sWorkerCpus = cpus;
+}
+
+QVector<int> workerCpus() {
+    return sWorkerCpus;
+}
+
+int currentWorkerSlot() {
+    thread_local int slot = -1;
+    if (slot < 0) {
+        slot = sNextWorkerSlot.fetch_add(1, std::memory_order_relaxed);
+        if (!sWorkerCpus.isEmpty()) {
+            pinCurrentThread(sWorkerCpus[slot % sWorkerCpus.size()]);
+        }
+    }
+    return slot;
+}
+
+bool pinCurrentThread(int cpu) {
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    Q_UNUSED(cpu);
+    return false;   // Other platforms: slots still give stable work placement
+#endif
+}
@@ -0,0 +1,64 @@
+// 2dsim08/cputopology.h - CPU/NUMA topology detection and worker thread pinning
+#ifndef CPUTOPOLOGY_H
+#define CPUTOPOLOGY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct CpuInfo {
+    int cpu;             // Logical CPU number
+    int core;            // core_id (unique only within a package)
+    int package;         // Socket
+    int node;            // NUMA node
+    int siblingIndex;    // 0 = first hardware thread of its core, 1+ = SMT siblings
+};
+
+// Read from /sys/devices/system/{cpu,node} on Linux. Elsewhere (or when sysfs is not
+// readable) every logical CPU is reported as its own core on one package and node.
+class CpuTopology
+{
+public:
+    static CpuTopology detect();
+
+    const QVector<CpuInfo>& cpus() const { return mCpus; }
+    int packageCount() const { return mPackageCount; }
+    int nodeCount() const { return mNodeCount; }
+    int physicalCoreCount() const { return mPhysicalCoreCount; }
+    bool isDetailed() const { return mDetailed; }
+
+    QStringList report() const;
+
+    // Picks `count` CPUs for workers. Policies:
+    //   none     - no pinning (empty result)
+    //   compact  - physical cores node by node, SMT siblings only after every core is used
+    //   scatter  - physical cores alternating between nodes, then SMT siblings
+    //   <list>   - explicit CPU list such as "0-7,16-23"
+    // partition/partitions hand disjoint slices of the same order to several processes (shards).
+    QVector<int> selectCpus(const QString& policy, int count, int partition, int partitions, QString* error) const;
+
+    static QVector<int> parseCpuList(const QString& list);     // "0-3,8" -> 0,1,2,3,8
+    static QString formatCpuList(const QVector<int>& cpus);    // Inverse, ranges collapsed
+
+private:
+    CpuTopology();
+
+    QVector<CpuInfo> mCpus;
+    int mPackageCount;
+    int mNodeCount;
+    int mPhysicalCoreCount;
+    bool mDetailed;
+};
+
+// === Worker Pinning ===
+// Pool threads claim a stable slot the first time they run placed work; with CPUs set, the
+// thread is also pinned to cpus[slot] then. Memory a pinned worker touches first is placed
+// on its NUMA node by the kernel, so data it allocates and keeps updating stays local.
+void setWorkerPinPolicy(const QString& policy);
+QString workerPinPolicy();
+void setWorkerCpus(const QVector<int>& cpus);      // Empty = slots only, no pinning
+QVector<int> workerCpus();
+int currentWorkerSlot();
+bool pinCurrentThread(int cpu);
+
+#endif // CPUTOPOLOGY_H
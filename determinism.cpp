@@ -0,0 +1,84 @@
+// 2dsim08/determinism.cpp - Runs one seeded scenario on several thread counts and compares state hashes
+#include "determinism.h"
+#include "simworld.h"
+#include "mainwindow.h"
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <cstdio>
+
+int DeterminismVerifier::run(const DeterminismConfig& config) {
+    if (config.threadCounts.size() < 2) {
+        std::fprintf(stderr, "Determinism: need at least two thread counts, e.g. 1,4,64\n");
+        return 2;
+    }
+    const qint64 ticks = config.ticks > 0 ? config.ticks : DETERMINISM_DEFAULT_TICKS;
+    DeterminismConfig scenario = config;
+    scenario.ticks = ticks;
+
+    std::printf("Determinism: %d creatures, seed %u, %lld ticks\n",
+                config.creatures, config.seed, static_cast<long long>(ticks));
+    std::fflush(stdout);
+
+    qint64 referenceMs = 0;
+    QVector<quint64> reference = runWorld(scenario, config.threadCounts[0], &referenceMs);
+    std::printf("Determinism: %3d threads  %7lld ms  final hash %016llx (reference)\n", config.threadCounts[0],
+                static_cast<long long>(referenceMs), static_cast<unsigned long long>(reference.last()));
+    std::fflush(stdout);
+
+    bool identical = true;
+    for (int i = 1; i < config.threadCounts.size(); i++) {
+        const int threads = config.threadCounts[i];
+        qint64 elapsedMs = 0;
+        QVector<quint64> hashes = runWorld(scenario, threads, &elapsedMs);
+
+        int diverged = -1;
+        for (int tick = 0; tick < hashes.size(); tick++) {
+            if (hashes[tick] != reference[tick]) {
+                diverged = tick;
+                break;
+            }
+        }
+        if (diverged < 0) {
+            std::printf("Determinism: %3d threads  %7lld ms  final hash %016llx  identical\n", threads,
+                        static_cast<long long>(elapsedMs), static_cast<unsigned long long>(hashes.last()));
+        } else {
+            identical = false;
+            std::printf("Determinism: %3d threads  %7lld ms  DIVERGED at %s %d (hash %016llx, reference %016llx)\n",
+                        threads, static_cast<long long>(elapsedMs), diverged == 0 ? "setup, tick" : "tick", diverged,
+                        static_cast<unsigned long long>(hashes[diverged]), static_cast<unsigned long long>(reference[diverged]));
+        }
+        std::fflush(stdout);
+    }
+
+    std::printf("Determinism: %s\n", identical ? "PASS - bit-identical on every thread count" : "FAIL");
+    std::fflush(stdout);
+    return identical ? 0 : 1;
+}
+
+QVector<quint64> DeterminismVerifier::runWorld(const DeterminismConfig& config, int threads, qint64* elapsedMs) {
+    // Declared before the world, so the world is gone before its pool
+    QScopedPointer<QThreadPool> pool(new QThreadPool);
+    pool->setMaxThreadCount(qMax(1, threads));
+
+    SimWorld world(pool.data());
+    world.setDeterministic(true);
+    world.setSimulatedCoreLoad(false);
+    world.setCommitBatchSize(MainWindow::CREATURES_UPDATED_PER_TICK);   // Same batching as the GUI
+    world.setParams(config.params);
+
+    QElapsedTimer timer;
+    timer.start();
+    world.setupTerrain(config.seed);
+    world.setupCreatures(config.creatures, config.seed);
+
+    QVector<quint64> hashes;
+    hashes.reserve(static_cast<int>(config.ticks) + 1);
+    hashes.push_back(world.stateHash());   // [0] = after setup
+    for (qint64 tick = 0; tick < config.ticks; tick++) {
+        world.tick();
+        hashes.push_back(world.stateHash());
+    }
+    *elapsedMs = timer.elapsed();
+    return hashes;
+}
@@ -0,0 +1,34 @@
+// 2dsim08/determinism.h - Runs one seeded scenario on several thread counts and compares state hashes
+#ifndef DETERMINISM_H
+#define DETERMINISM_H
+
+#include "simworld.h"
+#include <QVector>
+#include <QtGlobal>
+
+struct DeterminismConfig {
+    int creatures;
+    quint32 seed;
+    qint64 ticks;
+    SimParams params;            // Scenario
+    QVector<int> threadCounts;   // First one is the reference
+
+    DeterminismConfig() : creatures(0), seed(1), ticks(0) {}
+};
+
+// Each thread count gets a fresh deterministic world (SimWorld::setDeterministic) with the
+// GUI's commit batching. The state hash is recorded after setup and after every tick, and
+// every run is compared with the reference run, tick by tick. Runs are sequential, so their
+// timings are comparable too.
+class DeterminismVerifier
+{
+public:
+    static const int DETERMINISM_DEFAULT_TICKS = 1000;
+
+    int run(const DeterminismConfig& config);   // 0 = identical on every thread count, 1 = diverged
+
+private:
+    QVector<quint64> runWorld(const DeterminismConfig& config, int threads, qint64* elapsedMs);
+};
+
+#endif // DETERMINISM_H
@@ -0,0 +1,335 @@
+// 2dsim08/ensemble.cpp - Headless batch runner: parameter sweeps over many independent small worlds
+#include "ensemble.h"
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <cstdio>
+
+// === Sweep Spec ===
+bool EnsembleSpec::load(const QString& path, const SimParams& scenario, EnsembleSpec* spec, QString* error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("cannot read %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        *error = QString("%1: %2").arg(path, parseError.errorString());
+        return false;
+    }
+    QJsonObject root = document.object();
+    spec->creatures = root.value("creatures").toInt(spec->creatures);
+    spec->ticks = static_cast<qint64>(root.value("ticks").toDouble(spec->ticks));
+    if (spec->creatures < 1 || spec->ticks < 1) {
+        *error = "creatures and ticks must be positive";
+        return false;
+    }
+
+    // Seeds: an explicit list, or a count starting at "seed"
+    QVector<quint32> seeds;
+    QJsonValue seedsValue = root.value("seeds");
+    if (seedsValue.isArray()) {
+        for (const QJsonValue& seed : seedsValue.toArray()) {
+            seeds.push_back(static_cast<quint32>(seed.toDouble()));
+        }
+    } else {
+        quint32 first = static_cast<quint32>(root.value("seed").toDouble(1));
+        for (int i = 0; i < seedsValue.toInt(1); i++) {
+            seeds.push_back(first + i);
+        }
+    }
+    if (seeds.isEmpty()) {
+        *error = "no seeds";
+        return false;
+    }
+    spec->seedCount = seeds.size();
+
+    const QStringList known = SimParams::names();
+    SimParams base = scenario;
+    QJsonObject fixed = root.value("fixed").toObject();
+    for (const QString& name : fixed.keys()) {
+        if (!base.set(name, fixed.value(name).toInt())) {
+            *error = QString("unknown parameter %1 (known: %2)").arg(name, known.join(", "));
+            return false;
+        }
+    }
+
+    QVector<QVector<int>> axes;
+    QJsonObject sweep = root.value("sweep").toObject();
+    for (const QString& name : sweep.keys()) {
+        if (!known.contains(name)) {
+            *error = QString("unknown parameter %1 (known: %2)").arg(name, known.join(", "));
+            return false;
+        }
+        QVector<int> values;
+        for (const QJsonValue& value : sweep.value(name).toArray()) {
+            values.push_back(value.toInt());
+        }
+        if (values.isEmpty()) {
+            *error = QString("sweep %1 needs a non-empty list of values").arg(name);
+            return false;
+        }
+        spec->sweptNames << name;
+        axes.push_back(values);
+    }
+
+    // Every grid point (odometer order, last axis fastest), once per seed
+    QVector<int> position(axes.size(), 0);
+    while (true) {
+        SimParams params = base;
+        for (int axis = 0; axis < axes.size(); axis++) {
+            params.set(spec->sweptNames[axis], axes[axis][position[axis]]);
+        }
+        QString invalid;
+        if (!params.isValid(&invalid)) {
+            *error = invalid;
+            return false;
+        }
+        for (quint32 seed : seeds) {
+            EnsembleRun run;
+            run.index = spec->runs.size();
+            run.seed = seed;
+            run.params = params;
+            spec->runs.push_back(run);
+        }
+
+        int axis = axes.size() - 1;
+        while (axis >= 0 && ++position[axis] == axes[axis].size()) {
+            position[axis] = 0;
+            axis--;
+        }
+        if (axis < 0) break;
+    }
+    return true;
+}
+
+// === Behavior Sampling ===
+struct BehaviorSample {
+    int herds;
+    double meanHerdSize;
+    int maxHerdSize;
+    int orphans;
+    double meanAlphaDistance;
+    double outsideFootprint;
+    double restingShare;
+};
+
+static BehaviorSample sampleBehavior(const SimWorld& world) {
+    QHash<const SimpleCreature*, int> herdSizes;
+    int members = 0;
+    int orphans = 0;
+    int resting = 0;
+    int outside = 0;
+    double distanceSum = 0;
+    const qreal footprint = world.params().herdFootprint;
+
+    for (const SimpleCreature* creature : world.creatures()) {
+        if (!creature || !creature->exists || creature->isAlpha) continue;
+        members++;
+        if (creature->state == STATE_RESTING) {
+            resting++;
+        }
+        if (!creature->myAlpha) {
+            orphans++;
+            continue;
+        }
+        herdSizes[creature->myAlpha]++;
+        qreal distance = SimWorld::distanceBetween(creature->posX, creature->posY,
+                                                   creature->myAlpha->posX, creature->myAlpha->posY);
+        distanceSum += distance;
+        if (distance > footprint) {
+            outside++;
+        }
+    }
+
+    BehaviorSample sample;
+    const int followers = members - orphans;
+    sample.herds = herdSizes.size();
+    sample.meanHerdSize = sample.herds > 0 ? static_cast<double>(followers) / sample.herds : 0;
+    sample.maxHerdSize = 0;
+    for (int size : herdSizes) {
+        sample.maxHerdSize = qMax(sample.maxHerdSize, size);
+    }
+    sample.orphans = orphans;
+    sample.meanAlphaDistance = followers > 0 ? distanceSum / followers : 0;
+    sample.outsideFootprint = followers > 0 ? static_cast<double>(outside) / followers : 0;
+    sample.restingShare = members > 0 ? static_cast<double>(resting) / members : 0;
+    return sample;
+}
+
+// === Worker Task ===
+// One per concurrently running world; pulls runs until the batch is exhausted
+class EnsembleWorkerTask : public QRunnable {
+private:
+    EnsembleRunner* mRunner;
+    int mThreadsPerWorld;
+
+public:
+    EnsembleWorkerTask(EnsembleRunner* runner, int threadsPerWorld)
+        : mRunner(runner), mThreadsPerWorld(threadsPerWorld) {
+        setAutoDelete(true);
+    }
+
+    void run() override {
+        mRunner->runWorlds(mThreadsPerWorld);
+    }
+};
+
+// === Ensemble Runner ===
+EnsembleRunner::EnsembleRunner()
+    : mNextRun(0)
+    , mFinishedRuns(0)
+{
+}
+
+int EnsembleRunner::run(const EnsembleConfig& config) {
+    QString error;
+    if (!EnsembleSpec::load(config.specPath, config.params, &mSpec, &error)) {
+        std::fprintf(stderr, "Ensemble: %s\n", qPrintable(error));
+        return 2;
+    }
+
+    mResults.setFileName(config.resultsPath);
+    if (!mResults.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        std::fprintf(stderr, "Ensemble: cannot write %s: %s\n", qPrintable(config.resultsPath), qPrintable(mResults.errorString()));
+        return 1;
+    }
+    writeHeader();
+
+    // Pack the cores: one inline world per worker, unless a world is big enough to need several
+    const int threads = qMax(1, config.threads);
+    int threadsPerWorld = config.threadsPerWorld > 0
+                        ? config.threadsPerWorld
+                        : (mSpec.creatures + ENSEMBLE_CREATURES_PER_THREAD - 1) / ENSEMBLE_CREATURES_PER_THREAD;
+    threadsPerWorld = qBound(1, threadsPerWorld, threads);
+    const int concurrentWorlds = qMin(mSpec.runs.size(), qMax(1, threads / threadsPerWorld));
+
+    std::printf("Ensemble: %d runs (%d combinations x %d seeds), %d creatures, %lld ticks each; "
+                "%d worlds at a time, %d thread%s per world\n",
+                mSpec.runs.size(), mSpec.runs.size() / mSpec.seedCount, mSpec.seedCount, mSpec.creatures,
+                static_cast<long long>(mSpec.ticks), concurrentWorlds, threadsPerWorld, threadsPerWorld == 1 ? "" : "s");
+    std::fflush(stdout);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(concurrentWorlds);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < concurrentWorlds; i++) {
+        pool.start(new EnsembleWorkerTask(this, threadsPerWorld));
+    }
+    while (!pool.waitForDone(ENSEMBLE_PROGRESS_MS)) {
+        printProgress(timer.elapsed());
+    }
+    printProgress(timer.elapsed());
+
+    mResults.close();
+    std::printf("Ensemble: results written to %s\n", qPrintable(config.resultsPath));
+    std::fflush(stdout);
+    return 0;
+}
+
+void EnsembleRunner::runWorlds(int threadsPerWorld) {
+    while (true) {
+        int index = mNextRun.fetch_add(1, std::memory_order_relaxed);
+        if (index >= mSpec.runs.size()) return;
+
+        const EnsembleRun& run = mSpec.runs[index];
+        EnsembleResult result = runWorld(run, threadsPerWorld);
+        writeResult(run, result);
+        mFinishedRuns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+EnsembleResult EnsembleRunner::runWorld(const EnsembleRun& run, int threadsPerWorld) {
+    QElapsedTimer timer;
+    timer.start();
+
+    // Declared before the world, so the world is gone before its pool
+    QScopedPointer<QThreadPool> pool;
+    if (threadsPerWorld > 1) {
+        pool.reset(new QThreadPool);
+        pool->setMaxThreadCount(threadsPerWorld);
+    }
+
+    SimWorld world(pool.data());
+    world.setParams(run.params);
+    world.setSimulatedCoreLoad(false);   // Throughput run: no per-tick sleep
+    world.setDeterministic(true);        // Any row can be re-run exactly
+    world.setupTerrain(run.seed);
+    world.setupCreatures(mSpec.creatures, run.seed);
+
+    EnsembleResult result;
+    int samples = 0;
+    for (qint64 tick = 1; tick <= mSpec.ticks; tick++) {
+        world.tick();
+        if (tick % ENSEMBLE_SAMPLE_INTERVAL != 0 && tick != mSpec.ticks) continue;
+
+        BehaviorSample sample = sampleBehavior(world);
+        result.herds += sample.herds;
+        result.meanHerdSize += sample.meanHerdSize;
+        result.maxHerdSize = qMax(result.maxHerdSize, sample.maxHerdSize);
+        result.orphans += sample.orphans;
+        result.meanAlphaDistance += sample.meanAlphaDistance;
+        result.outsideFootprint += sample.outsideFootprint;
+        result.restingShare += sample.restingShare;
+        samples++;
+    }
+
+    result.herds /= samples;
+    result.meanHerdSize /= samples;
+    result.orphans /= samples;
+    result.meanAlphaDistance /= samples;
+    result.outsideFootprint /= samples;
+    result.restingShare /= samples;
+    result.wallSeconds = timer.nsecsElapsed() / 1e9;
+    return result;
+}
+
+void EnsembleRunner::writeHeader() {
+    QStringList columns;
+    columns << "run" << "seed";
+    for (const QString& name : mSpec.sweptNames) {
+        columns << name;
+    }
+    columns << "creatures" << "ticks" << "herds" << "mean_herd_size" << "max_herd_size" << "orphans"
+            << "mean_alpha_distance" << "outside_footprint" << "resting_share" << "wall_seconds";
+    mResults.write(columns.join(',').toUtf8() + '\n');
+    mResults.flush();
+}
+
+void EnsembleRunner::writeResult(const EnsembleRun& run, const EnsembleResult& result) {
+    QStringList fields;
+    fields << QString::number(run.index) << QString::number(run.seed);
+    for (const QString& name : mSpec.sweptNames) {
+        fields << QString::number(run.params.value(name));
+    }
+    fields << QString::number(mSpec.creatures) << QString::number(mSpec.ticks)
+           << QString::number(result.herds, 'f', 2) << QString::number(result.meanHerdSize, 'f', 2)
+           << QString::number(result.maxHerdSize) << QString::number(result.orphans, 'f', 2)
+           << QString::number(result.meanAlphaDistance, 'f', 1) << QString::number(result.outsideFootprint, 'f', 4)
+           << QString::number(result.restingShare, 'f', 4) << QString::number(result.wallSeconds, 'f', 3);
+
+    // Rows land in completion order; flushed each time so an interrupted batch keeps its results
+    QMutexLocker locker(&mResultsMutex);
+    mResults.write(fields.join(',').toUtf8() + '\n');
+    mResults.flush();
+}
+
+void EnsembleRunner::printProgress(qint64 elapsedMs) const {
+    const int finished = mFinishedRuns.load(std::memory_order_relaxed);
+    const int total = mSpec.runs.size();
+    const double hours = qMax<qint64>(1, elapsedMs) / 3600000.0;
+    const double worldsPerHour = finished / hours;
+    QString eta = finished > 0 && finished < total
+                ? QString(", about %1 min left").arg((total - finished) / worldsPerHour * 60, 0, 'f', 1)
+                : QString();
+    std::printf("Ensemble: %d/%d worlds in %.1f s, %.0f worlds/hour%s\n",
+                finished, total, elapsedMs / 1000.0, worldsPerHour, qPrintable(eta));
+    std::fflush(stdout);
+}
@@ -0,0 +1,93 @@
+// 2dsim08/ensemble.h - Headless batch runner: parameter sweeps over many independent small worlds
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "simworld.h"
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+// === Sweep Spec ===
+// JSON, e.g.
+//   { "creatures": 1000, "ticks": 3000, "seeds": 4, "seed": 1,
+//     "fixed": { "HERD_MAX_SIZE": 200 },
+//     "sweep": { "ALPHA_RATIO": [10, 25, 50], "HERD_GROUP_FOOTPRINT_SIZE": [1000, 2000, 4000] } }
+// Every combination of the "sweep" values runs once per seed ("seeds" is a count starting at
+// "seed", or an explicit list). Parameter names are those of SimParams::names(); "fixed" and
+// "sweep" apply on top of the --scenario parameters.
+struct EnsembleRun {
+    int index;
+    quint32 seed;
+    SimParams params;
+};
+
+struct EnsembleSpec {
+    int creatures;
+    qint64 ticks;
+    int seedCount;
+    QStringList sweptNames;          // Grid axes, written as result columns
+    QVector<EnsembleRun> runs;       // Grid x seeds
+
+    EnsembleSpec() : creatures(1000), ticks(3000), seedCount(1) {}
+    static bool load(const QString& path, const SimParams& scenario, EnsembleSpec* spec, QString* error);
+};
+
+// Herd behavior of one run, averaged over samples taken every ENSEMBLE_SAMPLE_INTERVAL ticks
+struct EnsembleResult {
+    double herds;               // Alphas with at least one member
+    double meanHerdSize;
+    int maxHerdSize;            // Largest seen in any sample
+    double orphans;             // Members without an alpha
+    double meanAlphaDistance;   // Member to own alpha
+    double outsideFootprint;    // Share of members farther than HERD_GROUP_FOOTPRINT_SIZE from their alpha
+    double restingShare;        // Share of members resting
+    double wallSeconds;
+
+    EnsembleResult() : herds(0), meanHerdSize(0), maxHerdSize(0), orphans(0), meanAlphaDistance(0),
+                       outsideFootprint(0), restingShare(0), wallSeconds(0) {}
+};
+
+struct EnsembleConfig {
+    QString specPath;
+    QString resultsPath;
+    int threads;                // Total workers
+    int threadsPerWorld;        // 0 = auto (1, or more for worlds above ENSEMBLE_CREATURES_PER_THREAD)
+    SimParams params;           // Scenario the spec starts from
+
+    EnsembleConfig() : threads(1), threadsPerWorld(0) {}
+};
+
+// Packs the runs onto the cores for throughput (worlds per hour), not single-world latency.
+// Small worlds run inline on one worker each, with no pool and no simulated core load, and
+// every worker pulls the next run as soon as its world finishes. Worlds too big for one
+// worker get a small pool of their own, and fewer of them run at once.
+class EnsembleRunner
+{
+public:
+    static const int ENSEMBLE_SAMPLE_INTERVAL = 50;             // Ticks between behavior samples
+    static const int ENSEMBLE_CREATURES_PER_THREAD = 50000;     // Above this a world gets more workers
+    static const int ENSEMBLE_PROGRESS_MS = 5000;               // Between progress lines
+
+    EnsembleRunner();
+
+    int run(const EnsembleConfig& config);   // Blocks until every run finished; returns the exit code
+
+private:
+    friend class EnsembleWorkerTask;
+    void runWorlds(int threadsPerWorld);
+    EnsembleResult runWorld(const EnsembleRun& run, int threadsPerWorld);
+    void writeHeader();
+    void writeResult(const EnsembleRun& run, const EnsembleResult& result);
+    void printProgress(qint64 elapsedMs) const;
+
+    EnsembleSpec mSpec;
+    std::atomic<int> mNextRun;
+    std::atomic<int> mFinishedRuns;
+    QMutex mResultsMutex;
+    QFile mResults;
+};
+
+#endif // ENSEMBLE_H
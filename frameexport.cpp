@@ -0,0 +1,253 @@
+// 2dsim08/frameexport.cpp - Headless frame export: sim -> render workers -> encoders, bounded at every stage
+#include "frameexport.h"
+#include "simworld.h"
+#include "mainwindow.h"
+#include "simtrace.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <QTransform>
+#include <cstdio>
+
+static const int EXPORT_REAL_TIME_TICKS_PER_SECOND = 50;   // The GUI's 20 ms tick
+
+// === Stage Thread ===
+class ExportStageThread : public QThread {
+private:
+    std::function<void()> mBody;
+
+public:
+    explicit ExportStageThread(const std::function<void()>& body) : mBody(body) {}
+
+protected:
+    void run() override {
+        mBody();
+    }
+};
+
+FrameExporter::FrameExporter()
+    : mSnapshots(nullptr)
+    , mImages(nullptr)
+    , mFramesRendered(0)
+    , mFramesWritten(0)
+    , mBytesWritten(0)
+    , mRenderNanos(0)
+    , mEncodeNanos(0)
+    , mWriteErrors(0)
+{
+}
+
+int FrameExporter::run(const FrameExportConfig& config) {
+    if (config.size.isEmpty() || config.every < 1 || config.ticks < 1) {
+        std::fprintf(stderr, "Export: needs a size, --ticks >= 1 and --export-every >= 1\n");
+        return 2;
+    }
+    if (!QDir().mkpath(config.directory)) {
+        std::fprintf(stderr, "Export: cannot create %s\n", qPrintable(config.directory));
+        return 1;
+    }
+
+    // Split the cores between the stages unless told otherwise; rendering is the heavy one
+    const int cores = qMax(1, QThread::idealThreadCount());
+    const int encodeThreads = config.encodeThreads > 0 ? config.encodeThreads : qMax(1, cores / 4);
+    const int renderThreads = config.renderThreads > 0 ? config.renderThreads : qMax(1, cores / 2);
+    const int simThreads = config.simThreads > 0 ? config.simThreads : qMax(1, cores - renderThreads - encodeThreads);
+
+    // Declared before the world, so the world is gone before its pool
+    QScopedPointer<QThreadPool> pool(simThreads > 1 ? new QThreadPool : nullptr);
+    if (pool) {
+        pool->setMaxThreadCount(simThreads);
+    }
+    SimWorld world(pool.data());
+    world.setSimulatedCoreLoad(false);
+    world.setDeterministic(true);        // The same seed exports the same film on any machine
+    world.setCommitBatchSize(MainWindow::CREATURES_UPDATED_PER_TICK);   // Same motion as the GUI
+    world.setParams(config.params);
+    world.setupTerrain(config.seed);
+    world.setupCreatures(config.creatures, config.seed);
+
+    // Fit the region into the frame, centered, like the view's KeepAspectRatio
+    const QRectF region = config.region.isEmpty() ? config.params.worldRect() : config.region;
+    const qreal scale = qMin(config.size.width() / region.width(), config.size.height() / region.height());
+    const QTransform sceneToImage(scale, 0, 0, scale,
+                                  (config.size.width() - region.width() * scale) / 2 - region.left() * scale,
+                                  (config.size.height() - region.height() * scale) / 2 - region.top() * scale);
+    // The view never moves, so every chunk it needs is generated once, up front
+    world.terrain().prefetchView(region, world.terrain().cellSize() * scale);
+
+    const qint64 frames = config.ticks / config.every;
+    std::printf("Export: %d creatures, seed %u, %lld ticks, every %d -> %lld frames of %dx%d %s into %s\n",
+                config.creatures, config.seed, static_cast<long long>(config.ticks), config.every,
+                static_cast<long long>(frames), config.size.width(), config.size.height(),
+                config.raw ? "raw BGRA" : "PNG", qPrintable(config.directory));
+    std::printf("Export: %d sim, %d render, %d encode threads\n", simThreads, renderThreads, encodeThreads);
+    std::fflush(stdout);
+
+    BoundedQueue<ExportFrame> snapshots(renderThreads * EXPORT_QUEUE_PER_WORKER);
+    BoundedQueue<ExportFrame> images(encodeThreads * EXPORT_QUEUE_PER_WORKER);
+    mSnapshots = &snapshots;
+    mImages = &images;
+
+    QVector<QThread*> renderers;
+    QVector<QThread*> encoders;
+    const TerrainChunks* terrain = &world.terrain();
+    for (int i = 0; i < renderThreads; i++) {
+        renderers.push_back(new ExportStageThread([this, &config, terrain, &sceneToImage]() {
+            renderLoop(config, terrain, sceneToImage);
+        }));
+        renderers.last()->start();
+    }
+    for (int i = 0; i < encodeThreads; i++) {
+        encoders.push_back(new ExportStageThread([this, &config]() {
+            encodeLoop(config);
+        }));
+        encoders.last()->start();
+    }
+
+    // === Sim stage: this thread; blocks whenever the renderers fall behind ===
+    QElapsedTimer timer;
+    timer.start();
+    qint64 lastProgress = 0;
+    qint64 simNanos = 0;
+    qint64 index = 0;
+    for (qint64 tick = 1; tick <= config.ticks; tick++) {
+        QElapsedTimer tickTimer;
+        tickTimer.start();
+        world.tick();
+        if (tick % config.every == 0) {
+            ExportFrame frame;
+            frame.tick = tick;
+            frame.index = index++;
+            const QVector<SimpleCreature*>& creatures = world.creatures();
+            frame.sprites.resize(creatures.size());
+            RenderSprite* out = frame.sprites.data();
+            world.parallelFor(creatures.size(), [&creatures, out](int start, int end, int) {
+                for (int i = start; i < end; i++) {
+                    const SimpleCreature* creature = creatures[i];
+                    RenderSprite& sprite = out[i];
+                    sprite.x = creature->posX;
+                    sprite.y = creature->posY;
+                    sprite.size = creature->size;
+                    sprite.opacity = creature->exists ? 1.0f : 0.0f;
+                    sprite.fill = creature->color.rgb();
+                    sprite.isAlpha = creature->isAlpha;
+                }
+            });
+            simNanos += tickTimer.nsecsElapsed();
+            if (!snapshots.push(std::move(frame))) break;
+        } else {
+            simNanos += tickTimer.nsecsElapsed();
+        }
+
+        if (timer.elapsed() - lastProgress >= EXPORT_PROGRESS_MS) {
+            lastProgress = timer.elapsed();
+            printProgress(lastProgress, tick);
+        }
+    }
+
+    // Drain stage by stage
+    snapshots.close();
+    for (QThread* thread : renderers) {
+        thread->wait();
+        delete thread;
+    }
+    images.close();
+    for (QThread* thread : encoders) {
+        thread->wait();
+        delete thread;
+    }
+    mSnapshots = nullptr;
+    mImages = nullptr;
+
+    const double seconds = qMax<qint64>(1, timer.elapsed()) / 1000.0;
+    const qint64 written = mFramesWritten.load();
+    std::printf("Export: %lld frames, %.1f MB in %.1f s - %.1f frames/s, %.1fx real time\n",
+                static_cast<long long>(written), mBytesWritten.load() / 1048576.0, seconds, written / seconds,
+                config.ticks / seconds / EXPORT_REAL_TIME_TICKS_PER_SECOND);
+    std::printf("Export: busy sim %.1f s, render %.1f s, encode %.1f s; waits: sim on renderers %lld, renderers on encoders %lld\n",
+                simNanos / 1e9, mRenderNanos.load() / 1e9, mEncodeNanos.load() / 1e9,
+                static_cast<long long>(snapshots.stalls()), static_cast<long long>(images.stalls()));
+    const int frameRate = qMax(1, EXPORT_REAL_TIME_TICKS_PER_SECOND / config.every);   // Plays back at real time
+    if (config.raw) {
+        std::printf("Export: encode with cat %s/frame_*.raw | ffmpeg -f rawvideo -pix_fmt bgra -s %dx%d -framerate %d -i - out.mp4\n",
+                    qPrintable(config.directory), config.size.width(), config.size.height(), frameRate);
+    } else {
+        std::printf("Export: encode with ffmpeg -framerate %d -i %s/frame_%%06d.png out.mp4\n",
+                    frameRate, qPrintable(config.directory));
+    }
+    if (mWriteErrors.load() > 0) {
+        std::printf("Export: FAILED - %d frames not written (%s)\n", mWriteErrors.load(), qPrintable(mFirstError));
+    }
+    std::fflush(stdout);
+    return mWriteErrors.load() > 0 ? 1 : 0;
+}
+
+// === Render Stage ===
+void FrameExporter::renderLoop(const FrameExportConfig& config, const TerrainChunks* terrain, const QTransform& sceneToImage) {
+    // No pool: this worker rasterizes its whole frame itself, other workers take the next frames
+    TileRenderer renderer(nullptr);
+    renderer.setTerrain(terrain);
+    renderer.setRingWidth(MainWindow::CREATURE_RING_WIDTH);
+    renderer.setBackground(Qt::white);
+
+    ExportFrame frame;
+    while (mSnapshots->pop(&frame)) {
+        TraceScope trace("export render", static_cast<int>(frame.index));
+        QElapsedTimer timer;
+        timer.start();
+        renderer.setSprites(std::move(frame.sprites));
+        frame.image = renderer.render(sceneToImage, config.size);   // Shared; the next render detaches
+        frame.sprites = QVector<RenderSprite>();
+        mRenderNanos.fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+        mFramesRendered.fetch_add(1, std::memory_order_relaxed);
+        if (!mImages->push(std::move(frame))) break;
+        frame = ExportFrame();
+    }
+}
+
+// === Encode Stage ===
+void FrameExporter::encodeLoop(const FrameExportConfig& config) {
+    const QDir directory(config.directory);
+    ExportFrame frame;
+    while (mImages->pop(&frame)) {
+        TraceScope trace("export encode", static_cast<int>(frame.index));
+        QElapsedTimer timer;
+        timer.start();
+        const QString name = QString("frame_%1.%2").arg(frame.index, 6, 10, QChar('0')).arg(config.raw ? "raw" : "png");
+        const QString path = directory.filePath(name);
+
+        bool ok;
+        qint64 bytes = 0;
+        if (config.raw) {
+            QFile file(path);
+            const qint64 size = static_cast<qint64>(frame.image.bytesPerLine()) * frame.image.height();
+            ok = file.open(QIODevice::WriteOnly) &&
+                 file.write(reinterpret_cast<const char*>(frame.image.constBits()), size) == size;
+            bytes = size;
+        } else {
+            // QImage quality for PNG: 100 = no compression, 0 = smallest
+            ok = frame.image.save(path, "PNG", 100 - qBound(0, config.pngCompression, 9) * 11);
+            bytes = QFile(path).size();
+        }
+
+        if (ok) {
+            mFramesWritten.fetch_add(1, std::memory_order_relaxed);
+            mBytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+        } else if (mWriteErrors.fetch_add(1) == 0) {
+            QMutexLocker locker(&mErrorMutex);
+            mFirstError = QString("cannot write %1").arg(path);
+        }
+        mEncodeNanos.fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+        frame = ExportFrame();
+    }
+}
+
+void FrameExporter::printProgress(qint64 elapsedMs, qint64 ticks) const {
+    const double seconds = qMax<qint64>(1, elapsedMs) / 1000.0;
+    std::printf("Export: tick %lld, %lld rendered, %lld written (%.1f frames/s)\n",
+                static_cast<long long>(ticks), static_cast<long long>(mFramesRendered.load()),
+                static_cast<long long>(mFramesWritten.load()), mFramesWritten.load() / seconds);
+    std::fflush(stdout);
+}
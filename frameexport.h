@@ -0,0 +1,135 @@
+// 2dsim08/frameexport.h - Headless frame export: sim -> render workers -> encoders, bounded at every stage
+#ifndef FRAMEEXPORT_H
+#define FRAMEEXPORT_H
+
+#include "simworld.h"
+#include "tilerenderer.h"
+#include <QImage>
+#include <QMutex>
+#include <QQueue>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+
+// === Bounded Queue ===
+// Blocking FIFO between two pipeline stages. A full queue blocks the producer (back-pressure),
+// so no stage can run ahead of the slowest one by more than `capacity` items.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(int capacity) : mCapacity(qMax(1, capacity)), mClosed(false), mStalls(0) {}
+
+    // Blocks while full; false if the queue was closed
+    bool push(T&& item) {
+        QMutexLocker locker(&mMutex);
+        if (mItems.size() >= mCapacity && !mClosed) {
+            mStalls++;
+            while (mItems.size() >= mCapacity && !mClosed) {
+                mNotFull.wait(&mMutex);
+            }
+        }
+        if (mClosed) return false;
+        mItems.enqueue(std::move(item));
+        mNotEmpty.wakeOne();
+        return true;
+    }
+
+    // Blocks while empty; false once the queue is closed and drained
+    bool pop(T* item) {
+        QMutexLocker locker(&mMutex);
+        while (mItems.isEmpty() && !mClosed) {
+            mNotEmpty.wait(&mMutex);
+        }
+        if (mItems.isEmpty()) return false;
+        *item = mItems.dequeue();
+        mNotFull.wakeOne();
+        return true;
+    }
+
+    // No more pushes; consumers drain what is queued, then pop() returns false
+    void close() {
+        QMutexLocker locker(&mMutex);
+        mClosed = true;
+        mNotEmpty.wakeAll();
+        mNotFull.wakeAll();
+    }
+
+    qint64 stalls() const { QMutexLocker locker(&mMutex); return mStalls; }   // Pushes that had to wait
+
+private:
+    const int mCapacity;
+    mutable QMutex mMutex;
+    QWaitCondition mNotEmpty;
+    QWaitCondition mNotFull;
+    QQueue<T> mItems;
+    bool mClosed;
+    qint64 mStalls;
+};
+
+// One exported tick on its way through the pipeline
+struct ExportFrame {
+    qint64 tick;
+    qint64 index;                    // Frame number; names the file
+    QVector<RenderSprite> sprites;   // Filled by the sim stage
+    QImage image;                    // Filled by a render worker
+
+    ExportFrame() : tick(0), index(0) {}
+};
+
+struct FrameExportConfig {
+    QString directory;
+    int creatures;
+    quint32 seed;
+    qint64 ticks;
+    int every;                  // Export every Nth tick
+    QSize size;                 // Output resolution
+    QRectF region;              // World area to frame (empty = whole world)
+    SimParams params;           // Scenario
+    bool raw;                   // Raw BGRA frames instead of PNG
+    int pngCompression;         // 0 (fastest) - 9 (smallest)
+    int simThreads;             // 0 = automatic split of the cores
+    int renderThreads;
+    int encodeThreads;
+
+    FrameExportConfig() : creatures(3001), seed(1), ticks(1000), every(1), size(1920, 1080), raw(false),
+                          pngCompression(1), simThreads(0), renderThreads(0), encodeThreads(0) {}
+};
+
+// Runs one seeded world headless and writes frames as fast as the cores allow:
+//   sim (calling thread + its pool) -> snapshot queue -> render workers -> image queue -> encoders
+// Every render worker owns a TileRenderer running inline, so frames rasterize side by side
+// instead of one frame spreading over the pool. Output is frame_NNNNNN.png or .raw in the directory.
+class FrameExporter
+{
+public:
+    static const int EXPORT_QUEUE_PER_WORKER = 2;   // Queue capacity per consumer thread
+    static const int EXPORT_PROGRESS_MS = 5000;     // Between progress lines
+
+    FrameExporter();
+
+    int run(const FrameExportConfig& config);   // Blocks until every frame is written; returns the exit code
+
+private:
+    void renderLoop(const FrameExportConfig& config, const TerrainChunks* terrain, const QTransform& sceneToImage);
+    void encodeLoop(const FrameExportConfig& config);
+    void printProgress(qint64 elapsedMs, qint64 ticks) const;
+
+    BoundedQueue<ExportFrame>* mSnapshots;
+    BoundedQueue<ExportFrame>* mImages;
+    std::atomic<qint64> mFramesRendered;
+    std::atomic<qint64> mFramesWritten;
+    std::atomic<qint64> mBytesWritten;
+    std::atomic<qint64> mRenderNanos;
+    std::atomic<qint64> mEncodeNanos;
+    std::atomic<int> mWriteErrors;
+    QMutex mErrorMutex;
+    QString mFirstError;
+};
+
+#endif // FRAMEEXPORT_H
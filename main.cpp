@@ -1,11 +1,378 @@
 // === main.cpp ===
 #include "mainwindow.h"
+#include "shardnode.h"
+#include "cputopology.h"
+#include "ensemble.h"
+#include "determinism.h"
+#include "alloccheck.h"
+#include "soaktest.h"
+#include "frameexport.h"
+#include "worldfeed.h"
+#include "scenario.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QRandomGenerator>
+#include <QThread>
+#include <cstdio>
+#include <cstring>
+
+// Shard processes, the coordinator, ensemble batches, frame export, feed monitoring, the determinism and allocation checks, the memory report, the soak test and the topology report run without a display
+static const char* const HEADLESS_OPTIONS[] = {
+    "shards", "shard-node", "topology", "ensemble", "verify-determinism", "check-allocations",
+    "export-frames", "read-feed", "memory-report", "soak"
+};
+
+// --name or --name=value, the two forms QCommandLineParser accepts
+static bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--") == 0) break;   // Positional arguments follow
+        if (std::strncmp(argv[i], "--", 2) != 0) continue;
+        const char* name = argv[i] + 2;
+        for (const char* option : HEADLESS_OPTIONS) {
+            const size_t length = std::strlen(option);
+            if (std::strncmp(name, option, length) == 0 && (name[length] == '\0' || name[length] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// --scenario, then each --set on top; the error goes to stderr
+static bool loadScenario(const QCommandLineParser& parser, const QCommandLineOption& scenarioOption,
+                         const QCommandLineOption& setOption, Scenario* scenario)
+{
+    QString error;
+    if (parser.isSet(scenarioOption) && !scenario->load(parser.value(scenarioOption), &error)) {
+        std::fprintf(stderr, "--scenario: %s\n", qPrintable(error));
+        return false;
+    }
+    if (!scenario->applyOverrides(parser.values(setOption), &error)) {
+        std::fprintf(stderr, "--set: %s\n", qPrintable(error));
+        return false;
+    }
+    return true;
+}
+
+static int runHeadless(QCoreApplication& app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("2dsim08 headless modes (shard coordinator / shard process / ensemble batch / "
+                                     "frame export / feed monitor / determinism check / allocation check / memory report / soak test / topology report)");
+    parser.addHelpOption();
+    QCommandLineOption shardsOption("shards", "Split the world into <cols>x<rows> shard processes.", "layout");
+    QCommandLineOption shardNodeOption("shard-node", "Run as shard <index> (spawned by the coordinator).", "index");
+    QCommandLineOption runOption("run", "Run id shared by every process of one sharded world.", "id");
+    QCommandLineOption creaturesOption("creatures", "Creatures in the whole world (default: the scenario's).", "count");
+    QCommandLineOption scenarioOption("scenario", "World tuning: a preset (default, large, huge) or a JSON scenario file.", "preset|file");
+    QCommandLineOption setOption("set", "Override one tuning constant, e.g. ALPHA_RATIO=50 (repeatable).", "NAME=VALUE");
+    QCommandLineOption seedOption("seed", "World seed (random when omitted).", "seed");
+    QCommandLineOption ticksOption("ticks", "Stop after this many ticks (0 = run until stopped).", "ticks", "0");
+    QCommandLineOption tickMsOption("tick-ms", "Tick interval in ms (0 = unthrottled).", "ms", "20");
+    QCommandLineOption threadsOption("threads", "Worker threads per shard (ensemble: in total).", "count");
+    QCommandLineOption pinOption("pin-workers", "Pin workers: none, compact, scatter or a CPU list.", "policy", "none");
+    QCommandLineOption topologyOption("topology", "Print the CPU/NUMA topology and exit.");
+    QCommandLineOption precisionOption("validate-precision", "Check the kinematics build against double precision.");
+    QCommandLineOption ensembleOption("ensemble", "Run the parameter sweep in <spec> (JSON) as a batch of small worlds.", "spec");
+    QCommandLineOption resultsOption("results", "Ensemble results file (CSV).", "file", "ensemble_results.csv");
+    QCommandLineOption threadsPerWorldOption("threads-per-world", "Ensemble workers per world (default: by world size).", "count", "0");
+    QCommandLineOption verifyOption("verify-determinism", "Run one seeded world on each thread count in <list> (e.g. 1,4,64) and compare per-tick state hashes.", "list");
+    QCommandLineOption metricsOption("metrics", "Serve Prometheus metrics on <port> (shard N: port + N) or a Unix socket path (path.N).", "address");
+    QCommandLineOption traceOption("trace", "Trace ticks and worker tasks; each shard writes its last seconds to traces/ on exit.");
+    QCommandLineOption noAutoTuneOption("no-autotune", "Keep one update slice per worker thread instead of auto-tuning.");
+    QCommandLineOption allocationsOption("check-allocations", "Count heap allocations in steady-state ticks of one seeded world (fails if any).");
+    QCommandLineOption memoryReportOption("memory-report", "Report one seeded world's memory by subsystem and per creature.");
+    QCommandLineOption memoryBudgetOption("memory-budget", "With --memory-report: fail above this many resident bytes per creature.", "bytes", "0");
+    QCommandLineOption soakOption("soak", "Run one world for <duration> (e.g. 90m, 12h, 3d) and fail if tick time, memory or herds drift from the early baseline.", "duration");
+    QCommandLineOption soakIntervalOption("soak-interval", "With --soak: sample every <duration>.", "duration", "60s");
+    QCommandLineOption soakTickDriftOption("soak-tick-drift", "With --soak: fail when p99 tick time grows more than this (0 = report only).", "percent", "50");
+    QCommandLineOption soakRssDriftOption("soak-rss-drift", "With --soak: fail when resident memory grows more than this (0 = report only).", "percent", "20");
+    QCommandLineOption soakHerdDriftOption("soak-herd-drift", "With --soak: fail when the p95 herd size grows more than this (0 = report only).", "percent", "100");
+    QCommandLineOption exportOption("export-frames", "Render one seeded world's ticks to image files in <dir>, faster than real time.", "dir");
+    QCommandLineOption exportEveryOption("export-every", "Export every Nth tick.", "n", "1");
+    QCommandLineOption exportSizeOption("export-size", "Exported frame size.", "WxH", "1920x1080");
+    QCommandLineOption exportRegionOption("export-region", "World area to frame (default: the whole world).", "x,y,w,h");
+    QCommandLineOption exportRawOption("export-raw", "Write raw BGRA frames instead of PNG.");
+    QCommandLineOption pngCompressionOption("png-compression", "PNG compression level, 0 (fastest) - 9 (smallest).", "level", "1");
+    QCommandLineOption renderThreadsOption("render-threads", "Export render workers (default: half the cores).", "count", "0");
+    QCommandLineOption encodeThreadsOption("encode-threads", "Export encoder threads (default: a quarter of the cores).", "count", "0");
+    QCommandLineOption publishOption("publish", "Publish every tick to the shared-memory feed <name> (shard N: name_N).", "name");
+    QCommandLineOption readFeedOption("read-feed", "Follow the shared-memory feed <name> and report what it carries (--ticks: stop after that many frames).", "name");
+    parser.addOption(shardsOption);
+    parser.addOption(shardNodeOption);
+    parser.addOption(runOption);
+    parser.addOption(creaturesOption);
+    parser.addOption(scenarioOption);
+    parser.addOption(setOption);
+    parser.addOption(seedOption);
+    parser.addOption(ticksOption);
+    parser.addOption(tickMsOption);
+    parser.addOption(threadsOption);
+    parser.addOption(pinOption);
+    parser.addOption(topologyOption);
+    parser.addOption(precisionOption);
+    parser.addOption(ensembleOption);
+    parser.addOption(resultsOption);
+    parser.addOption(threadsPerWorldOption);
+    parser.addOption(verifyOption);
+    parser.addOption(metricsOption);
+    parser.addOption(traceOption);
+    parser.addOption(allocationsOption);
+    parser.addOption(memoryReportOption);
+    parser.addOption(memoryBudgetOption);
+    parser.addOption(soakOption);
+    parser.addOption(soakIntervalOption);
+    parser.addOption(soakTickDriftOption);
+    parser.addOption(soakRssDriftOption);
+    parser.addOption(soakHerdDriftOption);
+    parser.addOption(noAutoTuneOption);
+    parser.addOption(exportOption);
+    parser.addOption(exportEveryOption);
+    parser.addOption(exportSizeOption);
+    parser.addOption(exportRegionOption);
+    parser.addOption(exportRawOption);
+    parser.addOption(pngCompressionOption);
+    parser.addOption(renderThreadsOption);
+    parser.addOption(encodeThreadsOption);
+    parser.addOption(publishOption);
+    parser.addOption(readFeedOption);
+    parser.process(app);
+
+    if (parser.isSet(topologyOption)) {
+        for (const QString& line : CpuTopology::detect().report()) {
+            std::printf("%s\n", qPrintable(line));
+        }
+        return 0;
+    }
+
+    if (parser.isSet(readFeedOption)) {
+        return WorldFeed::monitor(parser.value(readFeedOption), parser.value(ticksOption).toLongLong());
+    }
+
+    Scenario scenario;
+    if (!loadScenario(parser, scenarioOption, setOption, &scenario)) return 2;
+    const int creatures = parser.isSet(creaturesOption) ? parser.value(creaturesOption).toInt() : scenario.creatures;
+    if (!parser.isSet(shardNodeOption)) {
+        std::printf("%s\n", qPrintable(scenario.describe()));
+        std::fflush(stdout);
+    }
+
+    if (parser.isSet(verifyOption)) {
+        DeterminismConfig determinism;
+        for (const QString& count : parser.value(verifyOption).split(',', Qt::SkipEmptyParts)) {
+            determinism.threadCounts.push_back(count.toInt());
+        }
+        determinism.creatures = creatures;
+        determinism.params = scenario.params;
+        determinism.seed = parser.isSet(seedOption) ? parser.value(seedOption).toUInt() : 1;
+        determinism.ticks = parser.value(ticksOption).toLongLong();
+        DeterminismVerifier verifier;
+        return verifier.run(determinism);
+    }
+
+    if (parser.isSet(allocationsOption)) {
+        AllocationCheckConfig allocations;
+        allocations.creatures = creatures;
+        allocations.params = scenario.params;
+        allocations.seed = parser.isSet(seedOption) ? parser.value(seedOption).toUInt() : 1;
+        allocations.ticks = parser.value(ticksOption).toLongLong();
+        allocations.threads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : 1;
+        AllocationCheck check;
+        return check.run(allocations);
+    }
+
+    if (parser.isSet(memoryReportOption)) {
+        MemoryReportConfig memory;
+        memory.creatures = creatures;
+        memory.params = scenario.params;
+        memory.seed = parser.isSet(seedOption) ? parser.value(seedOption).toUInt() : 1;
+        memory.ticks = parser.value(ticksOption).toLongLong();
+        memory.threads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : 1;
+        memory.budgetPerCreature = parser.value(memoryBudgetOption).toLongLong();
+        MemoryReport report;
+        return report.run(memory);
+    }
+
+    if (parser.isSet(soakOption)) {
+        SoakConfig soak;
+        if (!SoakTest::parseDuration(parser.value(soakOption), &soak.durationSeconds) ||
+            !SoakTest::parseDuration(parser.value(soakIntervalOption), &soak.sampleSeconds)) {
+            std::fprintf(stderr, "--soak and --soak-interval expect a duration such as 90s, 45m, 12h or 3d\n");
+            return 2;
+        }
+        soak.creatures = creatures;
+        soak.params = scenario.params;
+        soak.seed = parser.isSet(seedOption) ? parser.value(seedOption).toUInt() : 1;
+        soak.tickIntervalMs = parser.value(tickMsOption).toInt();
+        soak.threads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : QThread::idealThreadCount();
+        soak.autoTune = !parser.isSet(noAutoTuneOption);
+        soak.maxTickDrift = parser.value(soakTickDriftOption).toInt();
+        soak.maxResidentDrift = parser.value(soakRssDriftOption).toInt();
+        soak.maxHerdDrift = parser.value(soakHerdDriftOption).toInt();
+        SoakTest test;
+        return test.run(soak);
+    }
+
+    if (parser.isSet(exportOption)) {
+        FrameExportConfig exportConfig;
+        exportConfig.directory = parser.value(exportOption);
+        exportConfig.creatures = creatures;
+        exportConfig.params = scenario.params;
+        exportConfig.seed = parser.isSet(seedOption) ? parser.value(seedOption).toUInt() : 1;
+        if (parser.value(ticksOption).toLongLong() > 0) {
+            exportConfig.ticks = parser.value(ticksOption).toLongLong();
+        }
+        exportConfig.every = parser.value(exportEveryOption).toInt();
+        const QStringList size = parser.value(exportSizeOption).split('x');
+        exportConfig.size = size.size() == 2 ? QSize(size[0].toInt(), size[1].toInt()) : QSize();
+        if (parser.isSet(exportRegionOption)) {
+            const QStringList region = parser.value(exportRegionOption).split(',');
+            if (region.size() != 4) {
+                std::fprintf(stderr, "--export-region expects x,y,w,h in world units\n");
+                return 2;
+            }
+            exportConfig.region = QRectF(region[0].toDouble(), region[1].toDouble(), region[2].toDouble(), region[3].toDouble());
+        }
+        exportConfig.raw = parser.isSet(exportRawOption);
+        exportConfig.pngCompression = parser.value(pngCompressionOption).toInt();
+        exportConfig.simThreads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : 0;
+        exportConfig.renderThreads = parser.value(renderThreadsOption).toInt();
+        exportConfig.encodeThreads = parser.value(encodeThreadsOption).toInt();
+        FrameExporter exporter;
+        return exporter.run(exportConfig);
+    }
+
+    if (parser.isSet(ensembleOption)) {
+        EnsembleConfig ensemble;
+        ensemble.specPath = parser.value(ensembleOption);
+        ensemble.resultsPath = parser.value(resultsOption);
+        ensemble.threads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : QThread::idealThreadCount();
+        ensemble.threadsPerWorld = parser.value(threadsPerWorldOption).toInt();
+        ensemble.params = scenario.params;
+        EnsembleRunner runner;
+        return runner.run(ensemble);
+    }
+
+    ShardNodeConfig config;
+    if (!ShardLayout::parse(parser.value(shardsOption), &config.layout)) {
+        std::fprintf(stderr, "--shards expects <cols>x<rows> with at most %d shards, e.g. 2x2\n", ShardLayout::maxCount());
+        return 2;
+    }
+    config.runId = parser.isSet(runOption) ? parser.value(runOption)
+                                           : QString::number(QCoreApplication::applicationPid());
+    config.creatures = creatures;
+    config.params = scenario.params;
+    config.layout.worldWidth = scenario.params.worldWidth;
+    config.layout.worldHeight = scenario.params.worldHeight;
+    config.seed = parser.isSet(seedOption) ? parser.value(seedOption).toUInt()
+                                           : QRandomGenerator::global()->generate();
+    config.ticks = parser.value(ticksOption).toLongLong();
+    config.tickIntervalMs = parser.value(tickMsOption).toInt();
+    config.threads = parser.isSet(threadsOption)
+                   ? parser.value(threadsOption).toInt()
+                   : qMax(1, QThread::idealThreadCount() / config.layout.count());
+    config.pinPolicy = parser.value(pinOption);
+    config.validatePrecision = parser.isSet(precisionOption);
+    config.metrics = parser.value(metricsOption);
+    config.feed = parser.value(publishOption);
+    config.trace = parser.isSet(traceOption);
+    config.autoTune = !parser.isSet(noAutoTuneOption);
+
+    if (parser.isSet(shardNodeOption)) {
+        config.shard = parser.value(shardNodeOption).toInt();
+        if (config.shard < 0 || config.shard >= config.layout.count()) {
+            std::fprintf(stderr, "--shard-node must be between 0 and %d\n", config.layout.count() - 1);
+            return 2;
+        }
+        ShardNode node;
+        if (!node.start(config)) return 1;
+        return app.exec();
+    }
+
+    ShardCoordinator coordinator;
+    if (!coordinator.start(config)) return 1;
+    return app.exec();
+}
 
 int main(int argc, char *argv[])
 {
+    if (isHeadless(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        return runHeadless(app);
+    }
+
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption attachOption("attach-shard", "View shard <index> of a running sharded world.", "index");
+    QCommandLineOption runOption("run", "Run id printed by the shard coordinator.", "id");
+    QCommandLineOption pinOption("pin-workers", "Pin workers: none, compact, scatter or a CPU list.", "policy", "none");
+    QCommandLineOption precisionOption("validate-precision", "Check the kinematics build against double precision.");
+    QCommandLineOption rendererOption("renderer", "Renderer: scene (QGraphicsScene items) or tiles (multithreaded rasterizer).", "backend", "scene");
+    QCommandLineOption metricsOption("metrics", "Serve Prometheus metrics on 127.0.0.1:<port> or a Unix socket path.", "address");
+    QCommandLineOption seedOption("seed", "Seed the world and make it deterministic (same state on any thread count).", "seed");
+    QCommandLineOption traceOption("trace", "Start with tracing on (Save Trace writes the last seconds as Chrome trace JSON).");
+    QCommandLineOption noAutoTuneOption("no-autotune", "Keep one update slice per worker thread instead of auto-tuning.");
+    QCommandLineOption lodOption("lod", "Simulate herds out of view as aggregates that follow their alpha.");
+    QCommandLineOption publishOption("publish", "Publish every tick to the shared-memory feed <name>.", "name");
+    QCommandLineOption herdStatsOption("herd-stats", "Measure every herd each tick and draw the results over the view.");
+    QCommandLineOption scenarioOption("scenario", "World tuning: a preset (default, large, huge) or a JSON scenario file.", "preset|file");
+    QCommandLineOption setOption("set", "Override one tuning constant, e.g. ALPHA_RATIO=50 (repeatable).", "NAME=VALUE");
+    parser.addOption(attachOption);
+    parser.addOption(runOption);
+    parser.addOption(pinOption);
+    parser.addOption(precisionOption);
+    parser.addOption(rendererOption);
+    parser.addOption(metricsOption);
+    parser.addOption(seedOption);
+    parser.addOption(traceOption);
+    parser.addOption(noAutoTuneOption);
+    parser.addOption(lodOption);
+    parser.addOption(herdStatsOption);
+    parser.addOption(publishOption);
+    parser.addOption(scenarioOption);
+    parser.addOption(setOption);
+    parser.process(a);
+
+    Scenario scenario;
+    if (!loadScenario(parser, scenarioOption, setOption, &scenario)) return 2;
+    MainWindow::setScenario(scenario);
+    setWorkerPinPolicy(parser.value(pinOption));
+    if (parser.isSet(seedOption)) {
+        MainWindow::setDeterministicSeed(parser.value(seedOption).toUInt());
+    }
+
     MainWindow w;
     w.show();
+    if (parser.isSet(precisionOption)) {
+        w.setPrecisionCheck(true);
+    }
+    if (parser.value(rendererOption) == "tiles") {
+        w.setSoftwareRendering(true);
+    }
+    if (parser.isSet(metricsOption)) {
+        w.startMetrics(parser.value(metricsOption));
+    }
+    if (parser.isSet(publishOption)) {
+        w.startPublishing(parser.value(publishOption));
+    }
+    if (parser.isSet(traceOption)) {
+        w.setTracing(true);
+    }
+    if (parser.isSet(noAutoTuneOption)) {
+        w.setAutoTune(false);
+    }
+    if (parser.isSet(lodOption)) {
+        w.setLevelOfDetail(true);
+    }
+    if (parser.isSet(herdStatsOption)) {
+        w.setHerdStatistics(true);
+    }
+    if (parser.isSet(attachOption)) {
+        w.attachToShard(parser.value(runOption), parser.value(attachOption).toInt());
+    }
     return a.exec();
 }
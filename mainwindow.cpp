@@ -1,21 +1,54 @@
 // 2dsim08/mainwindow.cpp V202506070700 - Alpha-Led Multi-Herd System with Housekeeping
 #include "mainwindow.h"
+#include "simtrace.h"
+#include "autotuner.h"
+#include "cputopology.h"
+#include "scenario.h"
+#include "memorystats.h"
+#include "snapshotviews.h"
 #include <QApplication>
 #include <QFont>
 #include <QBrush>
 #include <QPen>
+#include <QPainter>
 #include <QRunnable>
 #include <QThread>
 #include <QElapsedTimer>
 #include <QMetaObject>
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QDir>
+#include <QFileDialog>
 #include <algorithm>
+#include <limits>
 #include <random>
 #include <chrono>
 #include <cmath>
 
+// Creature graphics items, counted under MEMORY_SCENE_ITEMS
+class CreatureItem : public QGraphicsEllipseItem, public MemoryTagged<MEMORY_SCENE_ITEMS>
+{
+public:
+    CreatureItem(qreal x, qreal y, qreal width, qreal height) : QGraphicsEllipseItem(x, y, width, height) {}
+};
+
 // Make mDebugOutputEnabled accessible to the global function
 MainWindow* g_mainWindow = nullptr;
 
+// --seed: set before the window is constructed; -1 = random, non-deterministic world
+static qint64 sDeterministicSeed = -1;
+
+void MainWindow::setDeterministicSeed(quint32 seed) {
+    sDeterministicSeed = seed;
+}
+
+// --scenario / --set: set before the window is constructed
+static Scenario sScenario;
+
+void MainWindow::setScenario(const Scenario& scenario) {
+    sScenario = scenario;
+}
+
 // Helper function for thread-safe output
 void appendToOutput(const QString& text) {
     if (g_mainWindow && g_mainWindow->mDebugOutputEnabled) {
@@ -23,192 +56,13 @@ void appendToOutput(const QString& text) {
     }
 }
 
-// === Creature Update Task (Alpha-Led Herding System) ===
-class CreatureUpdateTask : public QRunnable {
-private:
-    QVector<SimpleCreature*>* mCreatures;
-    int mStartIndex;
-    int mEndIndex;
-    int mTaskId;
-
-public:
-    CreatureUpdateTask(QVector<SimpleCreature*>* creatures, int start, int end, int taskId)
-        : mCreatures(creatures), mStartIndex(start), mEndIndex(end), mTaskId(taskId) {
-        setAutoDelete(true);
-    }
-
-    void run() override {
-        QString startMsg = QString("[Thread %1] Alpha Herd Task %2 processing creatures [%3-%4)")
-                          .arg((quintptr)QThread::currentThreadId())
-                          .arg(mTaskId)
-                          .arg(mStartIndex)
-                          .arg(mEndIndex);
-        appendToOutput(startMsg);
-
-        // Process creatures - ALPHA-LED HERDING BEHAVIOR
-        for (int i = mStartIndex; i < mEndIndex && i < mCreatures->size(); i++) {
-            SimpleCreature* creature = (*mCreatures)[i];
-            if (creature && creature->exists) {
-
-                if (creature->isAlpha) {
-                    // === ALPHA BEHAVIOR ===
-                    switch (creature->state) {
-                        case STATE_ALPHA_TRAVELING:
-                            {
-                                // Move toward alpha destination
-                                qreal dx = creature->alphaTargetX - creature->posX;
-                                qreal dy = creature->alphaTargetY - creature->posY;
-                                qreal distance = sqrt(dx * dx + dy * dy);
-
-                                if (distance > creature->speed) {
-                                    // Keep moving toward destination
-                                    qreal moveX = (dx / distance) * creature->speed;
-                                    qreal moveY = (dy / distance) * creature->speed;
-                                    creature->newX = creature->posX + moveX;
-                                    creature->newY = creature->posY + moveY;
-                                } else {
-                                    // Reached destination, start resting
-                                    creature->newX = creature->alphaTargetX;
-                                    creature->newY = creature->alphaTargetY;
-                                    creature->state = STATE_ALPHA_RESTING;
-                                    creature->alphaRestingTime = MainWindow::ALPHA_MIN_REST_DURATION +
-                                        QRandomGenerator::global()->bounded(MainWindow::ALPHA_MAX_REST_DURATION - MainWindow::ALPHA_MIN_REST_DURATION);
-                                }
-                            }
-                            break;
-
-                    case STATE_ALPHA_RESTING:
-                        // Stay put and count down resting time
-                        creature->newX = creature->posX;
-                        creature->newY = creature->posY;
-                        creature->alphaRestingTime--;
-
-                        if (creature->alphaRestingTime <= 0) {
-                            // Pick small random offset from current position for normal wandering
-                            qreal offsetX = QRandomGenerator::global()->bounded(MainWindow::ALPHA_NORMAL_WANDER_DISTANCE * 2 + 1) - MainWindow::ALPHA_NORMAL_WANDER_DISTANCE;
-                            qreal offsetY = QRandomGenerator::global()->bounded(MainWindow::ALPHA_NORMAL_WANDER_DISTANCE * 2 + 1) - MainWindow::ALPHA_NORMAL_WANDER_DISTANCE;
-
-                            qreal targetX = creature->posX + offsetX;
-                            qreal targetY = creature->posY + offsetY;
-
-                            // Keep target within world bounds
-                            targetX = qMax(0.0, qMin(static_cast<qreal>(MainWindow::WORLD_SCENE_WIDTH), targetX));
-                            targetY = qMax(0.0, qMin(static_cast<qreal>(MainWindow::WORLD_SCENE_HEIGHT), targetY));
-
-                            creature->alphaTargetX = targetX;
-                            creature->alphaTargetY = targetY;
-                            creature->state = STATE_ALPHA_TRAVELING;
-                        }
-                        break;
-
-                        default:
-                            // Default alpha state - pick initial destination
-                            creature->alphaTargetX = QRandomGenerator::global()->bounded(MainWindow::WORLD_SCENE_WIDTH);
-                            creature->alphaTargetY = QRandomGenerator::global()->bounded(MainWindow::WORLD_SCENE_HEIGHT);
-                            creature->state = STATE_ALPHA_TRAVELING;
-                            break;
-                    }
-                } else {
-                    // === HERD MEMBER BEHAVIOR ===
-                    // Simple behavior: Rest -> Pick position around alpha -> Move to position -> Rest
-                    switch (creature->state) {
-                        case STATE_SEEKING_HERD:
-                        case STATE_MOVING_TO_HERD:
-                        case STATE_FINDING_SPACE:
-                            // Simplify: all these states now just go to resting
-                            creature->state = STATE_RESTING;
-                            creature->restingTimeLeft = MainWindow::CREATURE_MIN_REST_TICKS +
-                                QRandomGenerator::global()->bounded(MainWindow::CREATURE_MAX_REST_TICKS - MainWindow::CREATURE_MIN_REST_TICKS);
-                            creature->newX = creature->posX;
-                            creature->newY = creature->posY;
-                            break;
-
-                        case STATE_RESTING:
-                            // Stay put and count down resting time
-                            creature->newX = creature->posX;
-                            creature->newY = creature->posY;
-                            creature->restingTimeLeft--;
-
-                            if (creature->restingTimeLeft <= 0) {
-                                // Done resting, pick random position around alpha
-                                if (creature->myAlpha) {
-                                    // Pick random point within HERD_MAX_DIAMETER of alpha
-                                    qreal offsetX = QRandomGenerator::global()->bounded(MainWindow::HERD_GROUP_FOOTPRINT_SIZE * 2 + 1) - MainWindow::HERD_GROUP_FOOTPRINT_SIZE; // -300 to +300
-                                    qreal offsetY = QRandomGenerator::global()->bounded(MainWindow::HERD_GROUP_FOOTPRINT_SIZE * 2 + 1) - MainWindow::HERD_GROUP_FOOTPRINT_SIZE; // -300 to +300
-
-                                    qreal targetX = creature->myAlpha->posX + offsetX;
-                                    qreal targetY = creature->myAlpha->posY + offsetY;
-
-                                    // Keep target within world bounds
-                                    targetX = qMax(0.0, qMin(static_cast<qreal>(MainWindow::WORLD_SCENE_WIDTH), targetX));
-                                    targetY = qMax(0.0, qMin(static_cast<qreal>(MainWindow::WORLD_SCENE_HEIGHT), targetY));
-
-                                    creature->wanderTargetX = targetX;
-                                    creature->wanderTargetY = targetY;
-                                    creature->state = STATE_WANDERING;
-                                } else {
-                                    // No alpha, just pick random point nearby
-                                    creature->wanderTargetX = creature->posX + (QRandomGenerator::global()->bounded(2001) - 1000); // -1000 to +1000
-                                    creature->wanderTargetY = creature->posY + (QRandomGenerator::global()->bounded(2001) - 1000);
-                                    creature->state = STATE_WANDERING;
-                                }
-                            }
-                            break;
-
-                        case STATE_WANDERING:
-                            // Move toward wander target (position around alpha)
-                            {
-                                qreal dx = creature->wanderTargetX - creature->posX;
-                                qreal dy = creature->wanderTargetY - creature->posY;
-                                qreal distance = sqrt(dx * dx + dy * dy);
-
-                                if (distance > creature->speed) {
-                                    // Keep moving toward target position
-                                    qreal moveX = (dx / distance) * creature->speed;
-                                    qreal moveY = (dy / distance) * creature->speed;
-                                    creature->newX = creature->posX + moveX;
-                                    creature->newY = creature->posY + moveY;
-                                } else {
-                                    // Reached target position, start resting again
-                                    creature->newX = creature->wanderTargetX;
-                                    creature->newY = creature->wanderTargetY;
-                                    creature->state = STATE_RESTING;
-                                    creature->restingTimeLeft = MainWindow::CREATURE_MIN_REST_TICKS +
-                                        QRandomGenerator::global()->bounded(MainWindow::CREATURE_MAX_REST_TICKS - MainWindow::CREATURE_MIN_REST_TICKS);
-                                }
-                            }
-                            break;
-
-                        default:
-                            creature->state = STATE_RESTING;
-                            break;
-                    }
-                }
-
-                // Keep creatures in bounds
-                if (creature->newX < 0) creature->newX = 0;
-                if (creature->newX > MainWindow::WORLD_SCENE_WIDTH) creature->newX = MainWindow::WORLD_SCENE_WIDTH;
-                if (creature->newY < 0) creature->newY = 0;
-                if (creature->newY > MainWindow::WORLD_SCENE_HEIGHT) creature->newY = MainWindow::WORLD_SCENE_HEIGHT;
-            }
-        }
-
-        // Simulate some processing time based on core utilization (from 2dsim08)
-        if (MainWindow::USE_PCT_CORE < 100) {
-            int delayMs = (100 - MainWindow::USE_PCT_CORE) * 0.5;  // Reduced delay multiplier
-            QThread::msleep(delayMs);
-        }
-
-        QString endMsg = QString("[Thread %1] Alpha Herd Task %2 completed")
-                        .arg((quintptr)QThread::currentThreadId())
-                        .arg(mTaskId);
-        appendToOutput(endMsg);
-    }
-};
+bool debugOutputEnabled() {
+    return g_mainWindow && g_mainWindow->mDebugOutputEnabled;
+}
 
 // === Custom GraphicsView Implementation (from 2dsim07) ===
 CustomGraphicsView::CustomGraphicsView(QGraphicsScene *scene, QWidget *parent)
-    : QGraphicsView(scene, parent), mCurrentScaleFactor(1.0), mWASDdelta(100.0)
+    : QGraphicsView(scene, parent), mCurrentScaleFactor(1.0), mWASDdelta(100.0), mReplayMode(false), mEditMode(false), mTileRenderer(nullptr), mTerrain(nullptr), mHerdOverlay(nullptr)
 {
     setViewportUpdateMode(QGraphicsView::BoundingRectViewportUpdate);
     setDragMode(QGraphicsView::ScrollHandDrag);
@@ -235,6 +89,7 @@ void CustomGraphicsView::zoom(int inOrOut) {
         scene()->sceneRect().height() * transform().m22() < height()) {
         fitInView(scene()->sceneRect(), Qt::KeepAspectRatio);
     }
+    emit viewChanged();
 }
 
 void CustomGraphicsView::zoomOverMouse(int inOrOut, QPoint mousePos) {
@@ -256,12 +111,35 @@ void CustomGraphicsView::zoomOverMouse(int inOrOut, QPoint mousePos) {
     QPointF deltaViewportPos = targetViewportPos - QPointF(viewport()->width() / 2.0, viewport()->height() / 2.0);
     QPointF viewportCenter = mapFromScene(targetScenePos) - deltaViewportPos;
     centerOn(mapToScene(viewportCenter.toPoint()));
+    emit viewChanged();
+}
+
+void CustomGraphicsView::setEditMode(bool enabled) {
+    mEditMode = enabled;
+    setDragMode(enabled ? QGraphicsView::NoDrag : QGraphicsView::ScrollHandDrag);   // Which also sets the hand cursor
+    if (enabled) {
+        viewport()->setCursor(Qt::CrossCursor);
+    }
 }
 
 void CustomGraphicsView::mousePressEvent(QMouseEvent *event) {
+    if (mEditMode && !mReplayMode && event->button() == Qt::LeftButton) {
+        emit editPressed(mapToScene(event->pos()));
+        event->accept();
+        return;
+    }
     QGraphicsView::mousePressEvent(event);
 }
 
+void CustomGraphicsView::mouseMoveEvent(QMouseEvent *event) {
+    if (mEditMode && !mReplayMode && (event->buttons() & Qt::LeftButton)) {
+        emit editDragged(mapToScene(event->pos()));
+        event->accept();
+        return;
+    }
+    QGraphicsView::mouseMoveEvent(event);
+}
+
 void CustomGraphicsView::wheelEvent(QWheelEvent *event) {
     int inOrOut = ZOOM_IN;
     if (event->delta() < 0) {
@@ -276,6 +154,22 @@ void CustomGraphicsView::keyPressEvent(QKeyEvent *event) {
     QPointF scenePointAtViewCenter = mapToScene(viewportCenter.x(), viewportCenter.y());
     QPointF newCenter = scenePointAtViewCenter;
 
+    if (mReplayMode) {
+        switch(key) {
+            case Qt::Key_Space:
+                emit replayTogglePlayRequested();
+                return;
+            case Qt::Key_Comma:
+                emit replayStepRequested(-1);
+                return;
+            case Qt::Key_Period:
+                emit replayStepRequested(1);
+                return;
+            default:
+                break;
+        }
+    }
+
     switch(key) {
         case Qt::Key_W:
         case Qt::Key_Up:
@@ -304,18 +198,135 @@ void CustomGraphicsView::keyPressEvent(QKeyEvent *event) {
 
 void CustomGraphicsView::resizeEvent(QResizeEvent *event) {
     QGraphicsView::resizeEvent(event);
+    emit viewChanged();
+}
+
+void CustomGraphicsView::scrollContentsBy(int dx, int dy) {
+    QGraphicsView::scrollContentsBy(dx, dy);
+    emit viewChanged();
+}
+
+void CustomGraphicsView::setTileRenderer(TileRenderer* renderer) {
+    mTileRenderer = renderer;
+    updateViewportMode();
+}
+
+void CustomGraphicsView::setHerdOverlay(const SimWorld* world) {
+    mHerdOverlay = world;
+    updateViewportMode();
+}
+
+void CustomGraphicsView::updateViewportMode() {
+    // The tiled frame and the herd overlay cover the whole viewport, so partial (bounding rect)
+    // updates buy nothing - and would leave stale overlay behind
+    setViewportUpdateMode((mTileRenderer || mHerdOverlay) ? QGraphicsView::FullViewportUpdate
+                                                          : QGraphicsView::BoundingRectViewportUpdate);
+    viewport()->update();
+}
+
+void CustomGraphicsView::paintEvent(QPaintEvent *event) {
+    TraceScope trace("paint");
+    QGraphicsView::paintEvent(event);
+}
+
+void CustomGraphicsView::drawBackground(QPainter *painter, const QRectF &rect) {
+    if (!mTileRenderer) {
+        QGraphicsView::drawBackground(painter, rect);
+        if (mTerrain) {
+            // Only the chunks under the exposed rect; the painter is already in scene units
+            TraceScope trace("terrain");
+            const qreal cellPixels = mTerrain->cellSize() * transform().m11();
+            mTerrain->prefetchView(rect, cellPixels);
+            mTerrain->draw(painter, rect, cellPixels);
+        }
+        return;
+    }
+
+    // Rendered in viewport pixels (re-rendered only if the view or the sprites changed);
+    // visible scene items such as the metronome are still drawn on top by the scene
+    const QImage& frame = mTileRenderer->render(viewportTransform(), viewport()->size());
+    painter->save();
+    painter->resetTransform();
+    painter->drawImage(0, 0, frame);
+    painter->restore();
+}
+
+void CustomGraphicsView::drawForeground(QPainter *painter, const QRectF &rect) {
+    if (!mHerdOverlay || mReplayMode) return;
+    TraceScope trace("herd overlay");
+
+    // Looked up per herd slot; nothing here walks the creatures
+    const qreal scale = transform().m11();
+    painter->save();
+    painter->setBrush(Qt::NoBrush);
+    for (const HerdStatistics& herd : mHerdOverlay->herdStatistics()) {
+        if (!herd.alpha || herd.members == 0) continue;
+        const qreal radius = qMax<qreal>(herd.spread, MainWindow::DEFAULT_CREATURE_SIZE);
+        const QRectF extent(herd.centroidX - radius, herd.centroidY - radius, 2 * radius, 2 * radius);
+        if (!rect.intersects(extent.united(QRectF(herd.alpha->posX, herd.alpha->posY, 1, 1)))) continue;
+
+        QPen pen(herd.alpha->color, 2, herd.estimated ? Qt::DashLine : Qt::SolidLine);
+        pen.setCosmetic(true);
+        painter->setPen(pen);
+        painter->drawEllipse(extent);
+        painter->drawLine(QPointF(herd.centroidX, herd.centroidY),
+                          QPointF(herd.alpha->posX + herd.alpha->size / 2, herd.alpha->posY + herd.alpha->size / 2));
+
+        if (2 * radius * scale >= HERD_LABEL_MIN_PIXELS) {
+            const QPoint at = mapFromScene(QPointF(herd.centroidX, herd.centroidY));
+            painter->save();
+            painter->resetTransform();
+            painter->setPen(Qt::black);
+            painter->drawText(at, QString("%1 members, %2% resting, %3 from alpha")
+                                      .arg(herd.members)
+                                      .arg(qRound(100 * herd.restingShare()))
+                                      .arg(herd.meanAlphaDistance, 0, 'f', 0));
+            painter->restore();
+        }
+    }
+
+    // World totals in the top-left corner of the viewport
+    const HerdSummary& summary = mHerdOverlay->herdSummary();
+    const QString text = QString("%1 herds, %2 members (largest %3), %4% resting, mean spread %5, mean alpha distance %6")
+                             .arg(summary.herds).arg(summary.members).arg(summary.largest)
+                             .arg(qRound(100 * summary.restingShare))
+                             .arg(summary.meanSpread, 0, 'f', 0).arg(summary.meanAlphaDistance, 0, 'f', 0);
+    painter->resetTransform();
+    const QRect box = painter->fontMetrics().boundingRect(text).adjusted(-4, -2, 4, 2).translated(8, 8 + painter->fontMetrics().ascent());
+    painter->fillRect(box, QColor(255, 255, 255, 200));
+    painter->setPen(Qt::black);
+    painter->drawText(box, Qt::AlignCenter, text);
+    painter->restore();
 }
 
 // === MainWindow Implementation ===
 MainWindow::MainWindow(QWidget* parent)
     : QWidget(parent)
     , mDebugOutputEnabled(false)
+    , mMiniMap(nullptr)
+    , mViewsOpened(0)
+    , mTileRenderer(nullptr)
+    , mSoftwareRendering(false)
+    , mTileRenderFrames(0)
     , mSimulationRunning(false)
-    , mCurrentCreatureIndex(0)
-    , mMetronomeRotation(0)
+    , mInTick(false)
+    , mEditsQueued(false)
+    , mWorld(nullptr)
+    , mReportedTunings(0)
+    , mEditTool(EDIT_NONE)
+    , mEditAlphaID(0)
+    , mTerrainRevision(0)
+    , mLogBytes(0)
+    , mLogLines(0)
     , mMetronomeEnabled(true)
-    , mHousekeepingTickCounter(0)
-    , mHousekeepingCreatureIndex(0)
+    , mMetricsServer(nullptr)
+    , mReplayMode(false)
+    , mReplayTick(0)
+    , mReplaySpeed(1.0)
+    , mShardView(nullptr)
+    , mShardRegionItem(nullptr)
+    , mAttachedShard(-1)
+    , mAttachOwnedCount(0)
 {
     setWindowTitle("2dsim08 - Alpha-Led Multi-Herd System");
     setMinimumSize(1000, 700);
@@ -327,6 +338,38 @@ MainWindow::MainWindow(QWidget* parent)
     int usableCores = std::max(1, totalCores > 1 ? totalCores - 1 : 1);
     m_threadPool->setMaxThreadCount(usableCores);
 
+    // Optional worker pinning (--pin-workers); pinned threads must never expire and respawn
+    CpuTopology topology = CpuTopology::detect();
+    QString pinError;
+    QVector<int> pinnedCpus = topology.selectCpus(workerPinPolicy(), usableCores, 0, 1, &pinError);
+    if (!pinnedCpus.isEmpty()) {
+        setWorkerCpus(pinnedCpus);
+        m_threadPool->setExpiryTimeout(-1);
+    }
+
+    // Tile rasterizer (idle until the renderer is switched to tiles); shares the sim's pool
+    mTileRenderer = new TileRenderer(m_threadPool);
+    mTileRenderer->setRingWidth(CREATURE_RING_WIDTH);
+
+    // Trajectory recorder (idle until toggled on)
+    mRecorder = new TrajectoryRecorder(this);
+    mRecorder->setKeyframeInterval(RECORDER_KEYFRAME_INTERVAL);
+    mRecorder->setQueueCapacity(RECORDER_QUEUE_CAPACITY);
+    mRecorder->setCompressionLevel(RECORDER_COMPRESSION_LEVEL);
+    mRecorder->setDropPolicy(RECORDER_DOWNSAMPLE);
+
+    mReplayReader = new TrajectoryReader;
+
+    // Simulation core: commits one batch per tick and reports herd changes for repainting
+    mWorld = new SimWorld(m_threadPool);
+    mWorld->setCommitBatchSize(CREATURES_UPDATED_PER_TICK);
+    mWorld->setTrackRecolors(true);
+    mWorld->setProcessEventsWhileWaiting(true);
+    mWorld->setLogger([this](const QString& text) { appendOutput(text); });
+    mWorld->setDeterministic(sDeterministicSeed >= 0);
+    mWorld->setAutoTune(true);
+    mWorld->setParams(sScenario.params);
+
     setupGUI();
     setupGraphics();
     setupTerrain();
@@ -335,8 +378,23 @@ MainWindow::MainWindow(QWidget* parent)
 
     appendOutput(QString("=== ALPHA-LED MULTI-HERD SIMULATION INITIALIZED ==="));
     appendOutput(QString("Thread pool: %1 cores (of %2 total)").arg(usableCores).arg(totalCores));
-    appendOutput(QString("Creatures: %1 (with %2 alpha leaders)").arg(STARTING_CREATURE_COUNT).arg(STARTING_CREATURE_COUNT / ALPHA_RATIO));
-    appendOutput(QString("Terrain: %1x%2, World size: %3x%4").arg(NUM_TERRAIN_COLS).arg(NUM_TERRAIN_ROWS).arg(WORLD_SCENE_WIDTH).arg(WORLD_SCENE_HEIGHT));
+    for (const QString& line : topology.report()) {
+        appendOutput(line);
+    }
+    if (!pinError.isEmpty()) {
+        appendOutput(QString("Worker pinning: %1").arg(pinError));
+    }
+    if (!pinnedCpus.isEmpty()) {
+        appendOutput(QString("Worker pinning (%1): cpus %2").arg(workerPinPolicy()).arg(CpuTopology::formatCpuList(pinnedCpus)));
+    }
+    appendOutput(QString("Kinematics: %1, %2 bytes per creature").arg(SIM_PRECISION_NAME).arg(sizeof(SimpleCreature)));
+    if (mWorld->isDeterministic()) {
+        appendOutput(QString("Deterministic: seed %1 (same state on any thread count)").arg(sDeterministicSeed));
+    }
+    appendOutput(sScenario.describe());
+    appendOutput(QString("Creatures: %1 (with %2 alpha leaders)").arg(sScenario.creatures).arg(sScenario.creatures / sScenario.params.alphaRatio));
+    appendOutput(QString("Terrain: %1x%2, World size: %3x%4").arg(mWorld->terrain().cols()).arg(mWorld->terrain().rows())
+                .arg(sScenario.params.worldWidth).arg(sScenario.params.worldHeight));
     appendOutput("Use mouse wheel to zoom, WASD to pan. Click Start to begin!");
     appendOutput("=== Each herd has its own unique color! ===");
     appendOutput("Black ring alphas lead white ring herds around the world");
@@ -348,28 +406,34 @@ MainWindow::MainWindow(QWidget* parent)
 MainWindow::~MainWindow() {
     g_mainWindow = nullptr;
 
-    // Clean up creatures
-    for (auto* creature : mCreatures) {
-        if (creature) {
-            delete creature->graphicsItem;
-            delete creature;
-        }
+    // Extra views unlist themselves as they go, so close them while the list still exists
+    const QVector<SnapshotView*> views = mExtraViews;
+    for (auto* view : views) {
+        delete view;
     }
 
-    // Clean up terrain
-    for (auto& row : mTerrain2D) {
-        for (auto* terrain : row) {
-            if (terrain) {
-                delete terrain->graphicsItem;
-                delete terrain;
-            }
-        }
+    // Flush any queued frames before the creatures go away
+    mRecorder->stopRecording();
+    delete mMetricsServer;   // Joins the server thread before mMetrics goes away
+    delete mReplayReader;
+    delete mShardView;
+    mWorldView->setTileRenderer(nullptr);
+    delete mTileRenderer;
+
+    // Graphics items first; the world owns (and deletes) the data behind them
+    for (auto* creature : mWorld->creatures()) {
+        delete creature->graphicsItem;
     }
+    delete mWorld;
 }
 
 void MainWindow::appendOutput(const QString& text) {
     // Always allow direct calls to appendOutput (for important messages)
     QMetaObject::invokeMethod(this, [this, text]() {
+        const qint64 bytes = text.size() * static_cast<qint64>(sizeof(QChar));
+        MemoryStats::allocated(MEMORY_LOGS, bytes);
+        mLogBytes += bytes;
+        mLogLines++;
         outputText->append(text);
         outputText->ensureCursorVisible();
     }, Qt::QueuedConnection);
@@ -386,14 +450,51 @@ void MainWindow::setupGUI() {
     startButton = new QPushButton("Start Simulation");
     clearButton = new QPushButton("Clear Output");
     debugToggleButton = new QPushButton("Debug: OFF");  // Changed from "Debug: ON"
+    recordToggleButton = new QPushButton("Record: OFF");
+    replayButton = new QPushButton("Open Replay...");
+    rendererToggleButton = new QPushButton("Renderer: Scene");
+    traceToggleButton = new QPushButton("Trace: OFF");
+    saveTraceButton = new QPushButton("Save Trace");
+    saveTraceButton->setEnabled(false);   // Until tracing is on
+    lodToggleButton = new QPushButton("LOD: OFF");
+    herdStatsToggleButton = new QPushButton("Herds: OFF");
+    memoryButton = new QPushButton("Memory");
+    addViewButton = new QPushButton("Add View");
+    editToolCombo = new QComboBox();
+    editToolCombo->addItem("Edit: Pan", EDIT_NONE);
+    editToolCombo->addItem("Edit: Spawn Herd", EDIT_SPAWN_HERD);
+    editToolCombo->addItem("Edit: Move Alpha", EDIT_MOVE_ALPHA);
+    editToolCombo->addItem("Edit: Retarget Herd", EDIT_RETARGET_HERD);
+    editToolCombo->addItem("Edit: Paint Water", EDIT_PAINT_WATER);
+    editToolCombo->addItem("Edit: Paint Sand", EDIT_PAINT_SAND);
+    editToolCombo->addItem("Edit: Paint Foliage", EDIT_PAINT_FOLIAGE);
 
     startButton->setStyleSheet("QPushButton { background-color: lightgreen; padding: 5px; }");
     clearButton->setStyleSheet("QPushButton { background-color: lightyellow; padding: 5px; }");
     debugToggleButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");  // Changed from lightcyan
+    recordToggleButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
+    replayButton->setStyleSheet("QPushButton { background-color: plum; padding: 5px; }");
+    rendererToggleButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
+    traceToggleButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
+    saveTraceButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
+    lodToggleButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
+    herdStatsToggleButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
+    memoryButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
+    addViewButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
 
     buttonLayout->addWidget(startButton);
     buttonLayout->addWidget(debugToggleButton);
+    buttonLayout->addWidget(recordToggleButton);
+    buttonLayout->addWidget(replayButton);
+    buttonLayout->addWidget(rendererToggleButton);
+    buttonLayout->addWidget(traceToggleButton);
+    buttonLayout->addWidget(saveTraceButton);
+    buttonLayout->addWidget(lodToggleButton);
+    buttonLayout->addWidget(herdStatsToggleButton);
+    buttonLayout->addWidget(addViewButton);
+    buttonLayout->addWidget(editToolCombo);
     buttonLayout->addStretch();
+    buttonLayout->addWidget(memoryButton);
     buttonLayout->addWidget(clearButton);
 
     outputText = new QTextEdit();
@@ -405,23 +506,91 @@ void MainWindow::setupGUI() {
     mainLayout->addWidget(statusLabel);
     mainLayout->addLayout(buttonLayout);
 
+    setupReplayBar();
+    mainLayout->addWidget(mReplayBar);
+
     connect(startButton, &QPushButton::clicked, this, &MainWindow::runSimulation);
     connect(clearButton, &QPushButton::clicked, this, &MainWindow::clearOutput);
+    connect(memoryButton, &QPushButton::clicked, this, &MainWindow::reportMemory);
     connect(debugToggleButton, &QPushButton::clicked, this, &MainWindow::toggleDebugOutput);
+    connect(recordToggleButton, &QPushButton::clicked, this, &MainWindow::toggleRecording);
+    connect(replayButton, &QPushButton::clicked, this, &MainWindow::openReplay);
+    connect(rendererToggleButton, &QPushButton::clicked, this, &MainWindow::toggleRenderer);
+    connect(traceToggleButton, &QPushButton::clicked, this, &MainWindow::toggleTracing);
+    connect(saveTraceButton, &QPushButton::clicked, this, &MainWindow::saveTrace);
+    connect(lodToggleButton, &QPushButton::clicked, this, &MainWindow::toggleLevelOfDetail);
+    connect(herdStatsToggleButton, &QPushButton::clicked, this, &MainWindow::toggleHerdStatistics);
+    connect(addViewButton, &QPushButton::clicked, this, &MainWindow::addView);
+    connect(editToolCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MainWindow::editToolChanged);
+}
+
+void MainWindow::setupReplayBar() {
+    // Hidden until a recording is opened
+    mReplayBar = new QWidget(this);
+    QHBoxLayout* replayLayout = new QHBoxLayout(mReplayBar);
+    replayLayout->setContentsMargins(0, 0, 0, 0);
+
+    replayStepBackButton = new QPushButton("<|");
+    replayPlayButton = new QPushButton("Play");
+    replayStepForwardButton = new QPushButton("|>");
+    replaySpeedCombo = new QComboBox();
+    replaySlider = new QSlider(Qt::Horizontal);
+    replayTickLabel = new QLabel();
+    replayExitButton = new QPushButton("Exit Replay");
+
+    const qreal speeds[] = {0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 32.0};
+    for (qreal speed : speeds) {
+        replaySpeedCombo->addItem(QString("%1x").arg(speed), speed);
+    }
+    replaySpeedCombo->setCurrentIndex(2);  // 1x
+    replayTickLabel->setMinimumWidth(260);
+
+    replayLayout->addWidget(replayStepBackButton);
+    replayLayout->addWidget(replayPlayButton);
+    replayLayout->addWidget(replayStepForwardButton);
+    replayLayout->addWidget(replaySpeedCombo);
+    replayLayout->addWidget(replaySlider, 1);
+    replayLayout->addWidget(replayTickLabel);
+    replayLayout->addWidget(replayExitButton);
+    mReplayBar->setVisible(false);
+
+    connect(replayPlayButton, &QPushButton::clicked, this, &MainWindow::toggleReplayPlayback);
+    connect(replayStepBackButton, &QPushButton::clicked, this, [this]() { stepReplay(-1); });
+    connect(replayStepForwardButton, &QPushButton::clicked, this, [this]() { stepReplay(1); });
+    connect(replayExitButton, &QPushButton::clicked, this, &MainWindow::exitReplay);
+    connect(replaySlider, &QSlider::valueChanged, this, &MainWindow::replaySliderMoved);
+    connect(replaySpeedCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MainWindow::replaySpeedChanged);
+    connect(&mReplayTimer, &QTimer::timeout, this, &MainWindow::replayTimerTick);
+    mReplayTimer.setInterval(20);  // Same 50 FPS as the live sim
 }
 
 void MainWindow::setupGraphics() {
     // Create main world scene (like 2dsim07)
-    mWorldScene = new QGraphicsScene(0, 0, WORLD_SCENE_WIDTH, WORLD_SCENE_HEIGHT);
+    const QRectF world = mWorld->params().worldRect();
+    mWorldScene = new QGraphicsScene(world);
     mWorldView = new CustomGraphicsView(mWorldScene, this);
 
-    // Add graphics view to main layout
-    layout()->addWidget(mWorldView);
+    // Minimap docked beside the main view; it draws the per-tick snapshot, never the scene
+    mMiniMap = new MiniMap(&mWorld->terrain(), world, this);
+    mMiniMap->setFixedSize(MINIMAP_WIDTH, qMax(1, qRound(MINIMAP_WIDTH * world.height() / world.width())));
+    connect(mMiniMap, &MiniMap::centerRequested, this, &MainWindow::centerMainView);
+    connect(mWorldView, &CustomGraphicsView::viewChanged, this, &MainWindow::updateViewOutlines);
+
+    // Add graphics view and minimap to main layout
+    QHBoxLayout* viewLayout = new QHBoxLayout();
+    QVBoxLayout* dockLayout = new QVBoxLayout();
+    dockLayout->addWidget(mMiniMap);
+    dockLayout->addStretch();
+    viewLayout->addWidget(mWorldView, 1);
+    viewLayout->addLayout(dockLayout);
+    static_cast<QVBoxLayout*>(layout())->addLayout(viewLayout);
     layout()->addWidget(outputText);
 
     // Setup metronome visual indicator (from 2dsim07)
     if (mMetronomeEnabled) {
-        int metronomeSize = WORLD_SCENE_WIDTH / 200;
+        int metronomeSize = world.width() / 200;
         mMetronome = new QGraphicsRectItem(20, 20, metronomeSize, metronomeSize);
         QPen pen(Qt::black, 2);
         mMetronome->setPen(pen);
@@ -433,78 +602,94 @@ void MainWindow::setupGraphics() {
     }
 
     // Fit view to scene after a short delay - ZOOMED IN
-    QTimer::singleShot(200, [this]() {
+    QTimer::singleShot(200, [this, world]() {
         // Instead of fitting the entire world, zoom to show a reasonable section
         // Show roughly a 10,000 x 5,625 section (1/10th of world size)
-        QRectF viewRect(0, 0, WORLD_SCENE_WIDTH / 1.5, WORLD_SCENE_HEIGHT / 1.5);
+        QRectF viewRect(0, 0, world.width() / 1.5, world.height() / 1.5);
         mWorldView->fitInView(viewRect, Qt::KeepAspectRatio);
+        updateViewOutlines();
     });
 }
 
 void MainWindow::setupTerrain() {
     appendOutput("Setting up terrain...");
+    QElapsedTimer setupTimer;
+    setupTimer.start();
 
-    // Initialize 2D terrain vector (like 2dsim07)
-    mTerrain2D.resize(NUM_TERRAIN_COLS);
-    for (int col = 0; col < NUM_TERRAIN_COLS; col++) {
-        mTerrain2D[col].resize(NUM_TERRAIN_ROWS);
-        for (int row = 0; row < NUM_TERRAIN_ROWS; row++) {
-            mTerrain2D[col][row] = createTerrain(col, row, TERRAIN_FOLIAGE);
-        }
-    }
-
-    // Add some random water and sand patches
-    for (int i = 0; i < 50; i++) {
-        int col = QRandomGenerator::global()->bounded(NUM_TERRAIN_COLS);
-        int row = QRandomGenerator::global()->bounded(NUM_TERRAIN_ROWS);
-        TerrainType type = (QRandomGenerator::global()->bounded(2) == 0) ? TERRAIN_WATER : TERRAIN_SAND;
+    mWorld->setupTerrain(sDeterministicSeed >= 0 ? static_cast<quint32>(sDeterministicSeed) : QRandomGenerator::global()->generate());
 
-        SimpleTerrain* terrain = mTerrain2D[col][row];
-        terrain->type = type;
-        setTerrainColor(terrain);
-    }
+    // No scene items: the view draws the chunks under it, generating them on first sight
+    const TerrainChunks& terrain = mWorld->terrain();
+    mWorldView->setTerrain(&terrain);
+    mTerrainRevision = terrain.revision();
 
-    appendOutput(QString("Terrain created: %1x%2 = %3 squares").arg(NUM_TERRAIN_COLS).arg(NUM_TERRAIN_ROWS).arg(NUM_TERRAIN_COLS * NUM_TERRAIN_ROWS));
+    appendOutput(QString("Terrain set up: %1x%2 cells in %3x%4 chunks of %5x%5, cache %6 MB plus a chunk per creature, in %7 ms")
+                .arg(terrain.cols()).arg(terrain.rows()).arg(terrain.chunkCols()).arg(terrain.chunkRows())
+                .arg(TerrainChunks::CHUNK_CELLS).arg(TerrainChunks::TERRAIN_CACHE_MB)
+                .arg(setupTimer.elapsed()));
 }
 
 void MainWindow::setupCreatures() {
     appendOutput("Creating alpha-led multi-herd system...");
+    QElapsedTimer setupTimer;
+    setupTimer.start();
+
+    mWorld->setupCreatures(sScenario.creatures,
+                           sDeterministicSeed >= 0 ? static_cast<quint32>(sDeterministicSeed) : QRandomGenerator::global()->generate());
+    qint64 dataMs = setupTimer.elapsed();
+
+    // Build graphics items off the GUI thread, then add them in one bulk pass
+    const QVector<SimpleCreature*>& creatures = mWorld->creatures();
+    QVector<QGraphicsItem*> items;
+    items.reserve(creatures.size());
+    mWorld->parallelFor(creatures.size(), [this, &creatures](int start, int end, int) {
+        for (int i = start; i < end; i++) {
+            createCreatureGraphics(creatures[i]);
+        }
+    });
 
-    // Create alpha creatures first
-    QVector<SimpleCreature*> alphas;
-    int numAlphas = qMax(1, STARTING_CREATURE_COUNT / ALPHA_RATIO);
-
-    for (int i = 0; i < numAlphas; i++) {
-        qreal x = QRandomGenerator::global()->bounded(WORLD_SCENE_WIDTH);
-        qreal y = QRandomGenerator::global()->bounded(WORLD_SCENE_HEIGHT);
-        SimpleCreature* alpha = createCreature(x, y, true); // true = isAlpha
-        alphas.push_back(alpha);
-        mCreatures.push_back(alpha);
-    }
-
-    // Create regular herd members and assign them to alphas
-    for (int i = numAlphas; i < STARTING_CREATURE_COUNT; i++) {
-        qreal x = QRandomGenerator::global()->bounded(WORLD_SCENE_WIDTH);
-        qreal y = QRandomGenerator::global()->bounded(WORLD_SCENE_HEIGHT);
-        SimpleCreature* member = createCreature(x, y, false); // false = not alpha
-
-        // Assign to nearest alpha
-        assignCreatureToNearestAlpha(member, alphas);
-        mCreatures.push_back(member);
+    for (auto* creature : creatures) {
+        items.push_back(creature->graphicsItem);
     }
+    addItemsToSceneBulk(items);
 
-    appendOutput(QString("Created %1 alphas (black rings) leading %2 total creatures").arg(numAlphas).arg(mCreatures.size()));
+    int numAlphas = qMax(1, sScenario.creatures / mWorld->params().alphaRatio);
+    appendOutput(QString("Created %1 alphas (black rings) leading %2 total creatures").arg(numAlphas).arg(creatures.size()));
+    appendOutput(QString("Startup: creature data %1 ms, graphics %2 ms")
+                .arg(dataMs).arg(setupTimer.elapsed() - dataMs));
     appendOutput(QString("Each of %1 herds has its own unique color!").arg(numAlphas));
     printCreatureSample("Alpha and herd sample:");
+    updateWorldSprites();   // The minimap shows the herds before the first tick
+    reportMemory();
 }
 
 void MainWindow::setupEventLoop() {
     // Setup event loop timer (like 2dsim07)
     connect(&mEventLoopTimer, &QTimer::timeout, this, &MainWindow::eventLoopTick);
+    connect(mWorldView, &CustomGraphicsView::replayTogglePlayRequested, this, &MainWindow::toggleReplayPlayback);
+    connect(mWorldView, &CustomGraphicsView::replayStepRequested, this, &MainWindow::stepReplay);
+    connect(mWorldView, &CustomGraphicsView::editPressed, this, &MainWindow::editPressed);
+    connect(mWorldView, &CustomGraphicsView::editDragged, this, &MainWindow::editDragged);
     mEventLoopTimer.setInterval(20); // 50 FPS
+    mWorld->setTickBudget(mEventLoopTimer.interval() * 1000);   // Housekeeping fills the slack
     appendOutput("Event loop configured (20ms interval - 50 FPS).");
 }
 
+void MainWindow::addItemsToSceneBulk(const QVector<QGraphicsItem*>& items) {
+    // Inserting into the BSP one item at a time is what makes large scenes slow to build;
+    // insert unindexed and let the scene rebuild its index once
+    QGraphicsScene::ItemIndexMethod indexMethod = mWorldScene->itemIndexMethod();
+    mWorldScene->setItemIndexMethod(QGraphicsScene::NoIndex);
+
+    for (auto* item : items) {
+        if (item) {
+            mWorldScene->addItem(item);
+        }
+    }
+
+    mWorldScene->setItemIndexMethod(indexMethod);
+}
+
 void MainWindow::runSimulation() {
     if (!mSimulationRunning) {
         mSimulationRunning = true;
@@ -523,11 +708,20 @@ void MainWindow::runSimulation() {
 
 void MainWindow::clearOutput() {
     outputText->clear();
+    MemoryStats::freed(MEMORY_LOGS, mLogBytes, mLogLines);
+    mLogBytes = 0;
+    mLogLines = 0;
     if (mDebugOutputEnabled) {
         appendOutput("Output cleared. Ready for next run!");
     }
 }
 
+void MainWindow::reportMemory() {
+    for (const QString& line : MemoryStats::report(mWorld->creatures().size())) {
+        appendOutput(line);
+    }
+}
+
 void MainWindow::toggleDebugOutput() {
     mDebugOutputEnabled = !mDebugOutputEnabled;
 
@@ -544,327 +738,810 @@ void MainWindow::toggleDebugOutput() {
     }
 }
 
-void MainWindow::eventLoopTick() {
-    if (!mSimulationRunning) return;
+void MainWindow::toggleRecording() {
+    if (!mRecorder->isRecording()) {
+        QString directory = QDir::current().filePath(
+            QString("recordings/run_%1").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss")));
 
-    // Update metronome (visual indicator)
-    if (mMetronomeEnabled) {
-        moveMetronome();
+        if (!mRecorder->startRecording(directory)) {
+            appendOutput(QString("Recorder: could not open %1").arg(directory));
+            return;
+        }
+
+        recordToggleButton->setText("Record: ON");
+        recordToggleButton->setStyleSheet("QPushButton { background-color: salmon; padding: 5px; }");
+        appendOutput(QString("=== RECORDING TO %1 ===").arg(directory));
+    } else {
+        finishRecording();
     }
+}
+
+void MainWindow::finishRecording() {
+    mRecorder->stopRecording();
+    RecorderStats stats = mRecorder->stats();
 
-    // Run housekeeping periodically
-    mHousekeepingTickCounter++;
-    if (mHousekeepingTickCounter >= MainWindow::HOUSEKEEPING_INTERVAL) {
-        runHousekeeping();
-        mHousekeepingTickCounter = 0; // Reset counter
+    recordToggleButton->setText("Record: OFF");
+    recordToggleButton->setStyleSheet("QPushButton { background-color: lightgray; padding: 5px; }");
+    appendOutput("=== RECORDING STOPPED ===");
+    if (!stats.writeError.isEmpty()) {
+        appendOutput(QString("Recorder: write failed, %1 frames lost: %2").arg(stats.framesFailed).arg(stats.writeError));
     }
+    appendOutput(QString("Recorder: %1 frames written (%2 keyframes), %3 KB, %4 dropped, %5 downsampled")
+                .arg(stats.framesWritten).arg(stats.keyframesWritten)
+                .arg(stats.bytesWritten / 1024)
+                .arg(stats.framesDropped).arg(stats.framesDownsampled));
+}
 
-    // Handle orphan assignment in main thread (needs access to creature vector)
-    for (auto* creature : mCreatures) {
-        if (creature && creature->exists && !creature->isAlpha && !creature->myAlpha) {
-            // This creature needs an alpha - assign to nearest one
-            SimpleCreature* nearestAlpha = nullptr;
-            qreal nearestDistance = std::numeric_limits<qreal>::max();
+// === Replay Mode ===
+void MainWindow::openReplay() {
+    QString directory = QFileDialog::getExistingDirectory(this, "Open Recording", QDir::current().filePath("recordings"));
+    if (directory.isEmpty()) return;
 
-            for (auto* potential : mCreatures) {
-                if (potential && potential->isAlpha && potential->exists) {
-                    qreal distance = distanceBetween(creature->posX, creature->posY, potential->posX, potential->posY);
-                    if (distance < nearestDistance) {
-                        nearestDistance = distance;
-                        nearestAlpha = potential;
-                    }
-                }
-            }
+    if (!mReplayReader->open(directory)) {
+        appendOutput(QString("Replay: %1").arg(mReplayReader->errorString()));
+        return;
+    }
 
-            if (nearestAlpha) {
-                creature->myAlpha = nearestAlpha;
-                creature->color = generateHerdColor(nearestAlpha->uniqueID);
-                creature->graphicsItem->setBrush(QBrush(creature->color));
-                creature->graphicsItem->setPen(QPen(Qt::white, CREATURE_RING_WIDTH));
-            }
-        }
+    // Replay never re-simulates: stop the live sim and hide its creatures
+    if (mSimulationRunning) {
+        runSimulation();
     }
+    for (auto* creature : mWorld->creatures()) {
+        creature->graphicsItem->setVisible(false);
+    }
+    startButton->setEnabled(false);
+    replayButton->setEnabled(false);
+    editToolCombo->setCurrentIndex(0);
+    editToolCombo->setEnabled(false);
+
+    mReplayMode = true;
+    mWorldView->setReplayMode(true);
+    mReplayTick = mReplayReader->firstTick();
+    mReplayHerdBrushes.clear();
+
+    replaySlider->blockSignals(true);
+    replaySlider->setRange(static_cast<int>(mReplayReader->firstTick()), static_cast<int>(mReplayReader->lastTick()));
+    replaySlider->setValue(static_cast<int>(mReplayTick));
+    replaySlider->blockSignals(false);
+    mReplayBar->setVisible(true);
+
+    statusLabel->setText("REPLAY - Space: play/pause, comma/period: step, drag slider to seek");
+    appendOutput(QString("=== REPLAY: %1 ===").arg(directory));
+    appendOutput(QString("Replay: ticks %1-%2, %3 frames, %4 keyframes")
+                .arg(mReplayReader->firstTick()).arg(mReplayReader->lastTick())
+                .arg(mReplayReader->frameCount()).arg(mReplayReader->keyframeCount()));
+
+    showReplayFrame(static_cast<qint64>(mReplayTick));
+}
 
-    // Update creatures using parallel processing
-    updateCreaturesParallel();
+void MainWindow::exitReplay() {
+    if (!mReplayMode) return;
 
-    // Update graphics in main thread
-    updateGraphics();
-}
+    mReplayTimer.stop();
+    replayPlayButton->setText("Play");
+    mReplayBar->setVisible(false);
 
-void MainWindow::updateCreaturesParallel() {
-    if (mCreatures.empty()) return;
+    for (auto* item : mReplayItems) {
+        delete item;
+    }
+    mReplayItems.clear();
+    mReplayHerdBrushes.clear();
+    mReplayReader->close();
 
-    int numThreads = m_threadPool->maxThreadCount();
-    int chunkSize = qMax(1, mCreatures.size() / numThreads);
+    for (auto* creature : mWorld->creatures()) {
+        creature->graphicsItem->setVisible(!mSoftwareRendering);
+    }
+    startButton->setEnabled(true);
+    replayButton->setEnabled(true);
+    editToolCombo->setEnabled(true);
+
+    mReplayMode = false;
+    mWorldView->setReplayMode(false);
+    updateWorldSprites();
+    statusLabel->setText("Replay closed - click Start to resume the live simulation");
+    appendOutput("=== REPLAY CLOSED ===");
+}
 
-    // Create tasks for parallel processing (like 2dsim08)
-    for (int i = 0; i < numThreads; i++) {
-        int start = i * chunkSize;
-        int end = (i == numThreads - 1) ? mCreatures.size() : (i + 1) * chunkSize;
-        if (start >= mCreatures.size()) break;
+void MainWindow::toggleReplayPlayback() {
+    if (!mReplayMode) return;
 
-        CreatureUpdateTask* task = new CreatureUpdateTask(&mCreatures, start, end, i);
-        m_threadPool->start(task);
+    if (mReplayTimer.isActive()) {
+        mReplayTimer.stop();
+        replayPlayButton->setText("Play");
+    } else {
+        if (mReplayTick >= mReplayReader->lastTick()) {
+            mReplayTick = mReplayReader->firstTick();  // Restart from the top
+        }
+        mReplayTimer.start();
+        replayPlayButton->setText("Pause");
     }
+}
+
+void MainWindow::stepReplay(int frames) {
+    if (!mReplayMode) return;
 
-    // Wait for all tasks to complete
-    while (!m_threadPool->waitForDone(1)) {
-        QApplication::processEvents();
+    mReplayTimer.stop();
+    replayPlayButton->setText("Play");
+    mReplayTick = mReplayReader->stepTick(static_cast<qint64>(mReplayTick), frames);
+    showReplayFrame(static_cast<qint64>(mReplayTick));
+}
+
+void MainWindow::replayTimerTick() {
+    mReplayTick += mReplaySpeed;
+    if (mReplayTick >= mReplayReader->lastTick()) {
+        mReplayTick = mReplayReader->lastTick();
+        mReplayTimer.stop();
+        replayPlayButton->setText("Play");
     }
+    showReplayFrame(static_cast<qint64>(mReplayTick));
 }
 
-void MainWindow::updateGraphics() {
-    // Update creature graphics in main thread (thread-safe)
-    int updated = 0;
-    for (int i = mCurrentCreatureIndex; i < mCurrentCreatureIndex + CREATURES_UPDATED_PER_TICK && i < mCreatures.size(); i++) {
-        SimpleCreature* creature = mCreatures[i];
-        if (creature && creature->exists) {
-            // Update position
-            creature->posX = creature->newX;
-            creature->posY = creature->newY;
-            creature->graphicsItem->setPos(creature->posX, creature->posY);
+void MainWindow::replaySliderMoved(int value) {
+    if (!mReplayMode) return;
+    mReplayTick = value;
+    showReplayFrame(value);
+}
 
-            // Keep the assigned herd color (don't randomize!)
-            creature->graphicsItem->setBrush(QBrush(creature->color));
+void MainWindow::replaySpeedChanged(int index) {
+    mReplaySpeed = replaySpeedCombo->itemData(index).toReal();
+}
 
-            // Check for water collision (like 2dsim07)
-            TerrainType terrainType = findTerrainTypeByXY(creature->posX, creature->posY);
-            if (terrainType == TERRAIN_WATER) {
-                creature->newX = QRandomGenerator::global()->bounded(WORLD_SCENE_WIDTH);
-                creature->newY = QRandomGenerator::global()->bounded(WORLD_SCENE_HEIGHT);
-            }
+void MainWindow::showReplayFrame(qint64 tick) {
+    const TrajectoryFrame* frame = mReplayReader->frameAt(tick);
+    if (!frame) {
+        appendOutput(QString("Replay: could not decode tick %1").arg(tick));
+        mReplayTimer.stop();
+        return;
+    }
+
+    displayFrame(*frame, frame->creatures.size());
+
+    replaySlider->blockSignals(true);
+    replaySlider->setValue(static_cast<int>(tick));
+    replaySlider->blockSignals(false);
+    replayTickLabel->setText(QString("Tick %1 / %2  (decoded %3)")
+                            .arg(frame->tick).arg(mReplayReader->lastTick())
+                            .arg(mReplayReader->framesDecodedLastSeek()));
+}
 
-            updated++;
+void MainWindow::displayFrame(const TrajectoryFrame& frame, int ghostStart) {
+    // Every view draws the frame's snapshot; the scene items serve the main view alone
+    const bool drawItems = !mSoftwareRendering;
+    if (drawItems) {
+        // Grow the item pool on demand; extra items are hidden rather than deleted
+        while (mReplayItems.size() < frame.creatures.size()) {
+            QGraphicsEllipseItem* item = new QGraphicsEllipseItem(0, 0, DEFAULT_CREATURE_SIZE, DEFAULT_CREATURE_SIZE);
+            mWorldScene->addItem(item);
+            mReplayItems.push_back(item);
+        }
+        for (int i = frame.creatures.size(); i < mReplayItems.size(); i++) {
+            mReplayItems[i]->setVisible(false);
         }
     }
 
-    mCurrentCreatureIndex += CREATURES_UPDATED_PER_TICK;
-    if (mCurrentCreatureIndex >= mCreatures.size()) {
-        mCurrentCreatureIndex = 0;
+    mSprites.resize(frame.creatures.size());
+    for (int i = 0; i < frame.creatures.size(); i++) {
+        const TrajectoryCreature& creature = frame.creatures[i];
+        int herdID = creature.isAlpha ? creature.uniqueID : creature.alphaID;
+        auto brush = mReplayHerdBrushes.find(herdID);
+        if (brush == mReplayHerdBrushes.end()) {
+            QColor color = herdID ? SimWorld::generateHerdColor(herdID) : QColor(Qt::lightGray);
+            brush = mReplayHerdBrushes.insert(herdID, QBrush(color));
+        }
+
+        RenderSprite& sprite = mSprites[i];
+        sprite.x = creature.posX;
+        sprite.y = creature.posY;
+        sprite.size = DEFAULT_CREATURE_SIZE;
+        sprite.opacity = i < ghostStart ? 1.0f : static_cast<float>(SHARD_GHOST_OPACITY);
+        sprite.fill = brush.value().color().rgb();
+        sprite.isAlpha = creature.isAlpha != 0;
+        if (!drawItems) continue;
+
+        // setBrush/setPen are no-ops when unchanged, so only herd switches cost anything
+        QGraphicsEllipseItem* item = mReplayItems[i];
+        item->setBrush(brush.value());
+        item->setPen(QPen(creature.isAlpha ? Qt::black : Qt::white, CREATURE_RING_WIDTH));
+        item->setZValue(creature.isAlpha ? 20 : 10);
+        item->setPos(creature.posX, creature.posY);
+        item->setOpacity(i < ghostStart ? 1.0 : SHARD_GHOST_OPACITY);
+        item->setVisible(true);
     }
+    mCollapsedHerds.resize(0);   // Recorded frames carry no collapsed herds
+    publishSnapshot(mSprites, mCollapsedHerds, frame.tick);
+}
 
-    // Advance scene
-    mWorldScene->advance();
+// === Tile Renderer ===
+void MainWindow::toggleRenderer() {
+    setSoftwareRendering(!mSoftwareRendering);
 }
 
-void MainWindow::moveMetronome() {
-    if (!mMetronome) return;
+void MainWindow::setSoftwareRendering(bool enabled) {
+    if (enabled == mSoftwareRendering) return;
+    mSoftwareRendering = enabled;
 
-    // Move metronome around (like 2dsim07)
-    qreal dx = WORLD_SCENE_WIDTH * 0.002;
-    qreal dy = WORLD_SCENE_HEIGHT * -0.001;
-    qreal newX = mMetronome->x() + dx;
-    qreal newY = mMetronome->y() + dy;
+    if (enabled && !mTileRenderer->hasTerrain()) {
+        // Same chunk cache the scene view and the simulation use
+        mTileRenderer->setTerrain(&mWorld->terrain());
+        mTileRenderer->setBackground(mWorldView->palette().color(QPalette::Base));
+    }
 
-    if (newX < 0) newX = WORLD_SCENE_WIDTH - 100;
-    else if (newX > WORLD_SCENE_WIDTH) newX = 100;
-    if (newY < 0) newY = WORLD_SCENE_HEIGHT - 100;
-    else if (newY > WORLD_SCENE_HEIGHT) newY = 100;
+    setSceneItemsVisible(!enabled);
+    mWorldView->setTileRenderer(enabled ? mTileRenderer : nullptr);
 
-    mMetronomeRotation += 3;
-    if (mMetronomeRotation > 360) mMetronomeRotation -= 360;
+    // Refill whichever layer is now showing
+    if (mReplayMode) {
+        showReplayFrame(static_cast<qint64>(mReplayTick));
+    } else if (mAttachedShard >= 0) {
+        displayFrame(mAttachFrame, mAttachOwnedCount);
+    } else if (enabled) {
+        updateWorldSprites();
+    }
 
-    mMetronome->setRotation(mMetronomeRotation);
-    mMetronome->setPos(newX, newY);
+    mTileRenderFrames = 0;
+    rendererToggleButton->setText(enabled ? "Renderer: Tiles" : "Renderer: Scene");
+    rendererToggleButton->setStyleSheet(enabled ? "QPushButton { background-color: lightcyan; padding: 5px; }"
+                                                : "QPushButton { background-color: lightgray; padding: 5px; }");
+    appendOutput(enabled ? QString("Renderer: tiles (%1x%1 px, %2 threads)").arg(TileRenderer::TILE_SIZE).arg(m_threadPool->maxThreadCount())
+                         : QString("Renderer: scene"));
+}
 
-    // Randomly change color
-    if (QRandomGenerator::global()->bounded(100) > 95) {
-        QColor newColor = getRandomColor();
-        mMetronome->setBrush(QBrush(newColor));
+void MainWindow::setSceneItemsVisible(bool visible) {
+    // Live creature items were not moved while hidden; bring them up to date first
+    bool showLive = visible && !mReplayMode && mAttachedShard < 0;
+    for (auto* creature : mWorld->creatures()) {
+        if (showLive) {
+            creature->graphicsItem->setPos(creature->posX, creature->posY);
+            creature->graphicsItem->setBrush(QBrush(creature->color));
+            creature->graphicsItem->setPen(QPen(creature->isAlpha ? Qt::black : Qt::white, CREATURE_RING_WIDTH));
+        }
+        creature->graphicsItem->setVisible(showLive);
+    }
+
+    if (!visible) {
+        for (auto* item : mReplayItems) {
+            item->setVisible(false);
+        }
     }
 }
 
-// === Creature Methods ===
-SimpleCreature* MainWindow::createCreature(qreal x, qreal y, bool isAlpha) {
-    SimpleCreature* creature = new SimpleCreature;
-
-    // Initialize creature data
-    creature->posX = x;
-    creature->posY = y;
-    creature->newX = x;
-    creature->newY = y;
-
-    // Set speeds based on creature type
-    if (isAlpha) {
-        creature->speed = ALPHA_SPEED_SLOW;  // Alphas move slowly
-    } else {
-        creature->speed = CREATURE_SPEED_NORMAL;  // Creatures move at normal speed
+void MainWindow::updateWorldSprites() {
+    // Collapsed members are counted where their herd is instead
+    mCollapsedHerds.resize(0);
+    for (const HerdAggregate& aggregate : mWorld->aggregates()) {
+        const SimpleCreature* alpha = aggregate.alpha;
+        if (!aggregate.collapsed || !alpha || !alpha->exists) continue;
+        RenderHerd herd;
+        herd.x = alpha->posX + aggregate.offsetX + alpha->size / 2;
+        herd.y = alpha->posY + aggregate.offsetY + alpha->size / 2;
+        herd.members = aggregate.members;
+        herd.fill = alpha->color.rgb();
+        mCollapsedHerds.push_back(herd);
     }
-    creature->originalSpeed = creature->speed;
 
-    creature->size = DEFAULT_CREATURE_SIZE + QRandomGenerator::global()->bounded(50);
+    // Only the minimap to feed: cell densities straight from the world, no sprites
+    if (!mSoftwareRendering && mExtraViews.isEmpty()) {
+        mSnapshot = mSnapshotBuilder.buildDensity(mWorld, mCollapsedHerds, mWorld->tickCount());
+        mMiniMap->setSnapshot(mSnapshot);
+        return;
+    }
 
-    // Alpha system
-    creature->isAlpha = isAlpha;
-    creature->myAlpha = nullptr;
+    // Copy the committed state into flat sprites on the pool; the renderer never reads the world
+    const QVector<SimpleCreature*>& creatures = mWorld->creatures();
+    mSprites.resize(creatures.size());
+    RenderSprite* out = mSprites.data();
+    mWorld->parallelFor(creatures.size(), [&creatures, out](int start, int end, int) {
+        for (int i = start; i < end; i++) {
+            const SimpleCreature* creature = creatures[i];
+            RenderSprite& sprite = out[i];
+            sprite.x = creature->posX;
+            sprite.y = creature->posY;
+            sprite.size = creature->size;
+            sprite.opacity = creature->exists && !creature->collapsed ? 1.0f : 0.0f;   // Collapsed: a stale position
+            sprite.fill = creature->color.rgb();
+            sprite.isAlpha = creature->isAlpha;
+        }
+    });
+    publishSnapshot(mSprites, mCollapsedHerds, mWorld->tickCount());
+}
 
-    // *** FIX: Initialize alpha targets using small box logic ***
-    if (isAlpha) {
-        // Give alphas small local destinations using the same box logic as normal wandering
-        qreal offsetX = QRandomGenerator::global()->bounded(ALPHA_NORMAL_WANDER_DISTANCE * 2 + 1) - ALPHA_NORMAL_WANDER_DISTANCE;
-        qreal offsetY = QRandomGenerator::global()->bounded(ALPHA_NORMAL_WANDER_DISTANCE * 2 + 1) - ALPHA_NORMAL_WANDER_DISTANCE;
+void MainWindow::publishSnapshot(const QVector<RenderSprite>& sprites, const QVector<RenderHerd>& herds, qint64 tick) {
+    // Built once; every consumer shares the same immutable data
+    mSnapshot = mSnapshotBuilder.build(mWorld, sprites, herds, tick);
+    if (mSoftwareRendering) {
+        mTileRenderer->setSprites(QVector<RenderSprite>(mSnapshot->sprites));
+        mWorldView->viewport()->update();
+    }
+    mMiniMap->setSnapshot(mSnapshot);
+    for (auto* view : mExtraViews) {
+        view->setSnapshot(mSnapshot);
+    }
+}
 
-        qreal targetX = x + offsetX;  // Use spawn position + small offset
-        qreal targetY = y + offsetY;
+// === Snapshot Views ===
+void MainWindow::addView() {
+    // Its own window, pan and zoom over the same snapshot; painting it walks only the cells it shows
+    SnapshotView* view = new SnapshotView(&mWorld->terrain(), mWorld->params().worldRect(), this, Qt::Window);
+    view->setAttribute(Qt::WA_DeleteOnClose);
+    view->setWindowTitle(QString("2dsim08 - View %1").arg(++mViewsOpened));
+    view->setRingWidth(CREATURE_RING_WIDTH);
+    view->resize(EXTRA_VIEW_WIDTH, EXTRA_VIEW_HEIGHT);
+    view->setSnapshot(mSnapshot);
+    connect(view, &SnapshotView::viewChanged, this, &MainWindow::updateViewOutlines);
+    connect(view, &QObject::destroyed, this, [this, view]() {
+        mExtraViews.removeAll(view);
+        updateViewOutlines();
+    });
+    mExtraViews.push_back(view);
+    if (mSnapshot && !mSnapshot->hasSprites) {
+        updateWorldSprites();   // The minimap alone only needed densities
+    }
+
+    // Opens on what the main view shows
+    const QRectF shown = mWorldView->mapToScene(mWorldView->viewport()->rect()).boundingRect();
+    view->setView(shown.center(), mWorldView->transform().m11());
+    view->show();
+    appendOutput(QString("View %1 opened (%2 views share the snapshot)").arg(mViewsOpened).arg(mExtraViews.size() + 2));
+}
 
-        // Keep target within world bounds
-        targetX = qMax(0.0, qMin(static_cast<qreal>(WORLD_SCENE_WIDTH), targetX));
-        targetY = qMax(0.0, qMin(static_cast<qreal>(WORLD_SCENE_HEIGHT), targetY));
+void MainWindow::centerMainView(const QPointF& scenePos) {
+    mWorldView->centerOn(scenePos);
+    updateViewOutlines();
+}
 
-        creature->alphaTargetX = targetX;
-        creature->alphaTargetY = targetY;
-    } else {
-        creature->alphaTargetX = 0;  // Non-alphas don't use these
-        creature->alphaTargetY = 0;
+void MainWindow::updateViewOutlines() {
+    if (!mMiniMap) return;
+    QVector<QRectF> outlines;
+    outlines.push_back(mWorldView->mapToScene(mWorldView->viewport()->rect()).boundingRect());
+    for (auto* view : mExtraViews) {
+        outlines.push_back(view->visibleScene());
     }
+    mMiniMap->setViewOutlines(outlines);
+}
 
-    creature->alphaRestingTime = 0;
+void MainWindow::reportTileRender() {
+    if (++mTileRenderFrames % TILE_RENDER_REPORT_INTERVAL != 0) return;
 
-    // Herding system
-    creature->herdTarget = nullptr;
-    creature->hasHerdTarget = false;
-    creature->restingTimeLeft = 0;
-    creature->herdingRange = creature->size * 4.0;     // Seek herds within 4 diameters
+    TileRenderStats stats = mTileRenderer->lastStats();
+    appendToOutput(QString("Tile renderer: %1 tiles, %2 sprites binned, bin %3 us, raster %4 us")
+                  .arg(stats.tiles).arg(stats.sprites).arg(stats.binMicros).arg(stats.rasterMicros));
+}
 
-    // Dynamic elbow room: randomize each creature's personal space preference
-    creature->elbowRoomRange = QRandomGenerator::global()->bounded(static_cast<int>(ELBOW_ROOM_FACTOR * 100)) / 100.0; // 0.0 to ELBOW_ROOM_FACTOR
+// === Precision Check ===
+void MainWindow::setPrecisionCheck(bool enabled) {
+    mWorld->setPrecisionCheck(enabled);
+    appendOutput(QString("Precision check %1 (%2 kinematics, report every %3 ticks)")
+                 .arg(enabled ? "on" : "off").arg(SIM_PRECISION_NAME).arg(SimWorld::PRECISION_REPORT_INTERVAL));
+}
 
-    // Wandering system
-    creature->wanderTargetX = 0;
-    creature->wanderTargetY = 0;
+// === Metrics ===
+bool MainWindow::startMetrics(const QString& address) {
+    MetricsServer* server = new MetricsServer(&mMetrics);
+    QString error;
+    if (!server->listen(address, &error)) {
+        appendOutput(QString("Metrics: cannot listen on %1: %2").arg(address, error));
+        delete server;
+        return false;
+    }
+    delete mMetricsServer;
+    mMetricsServer = server;
+    appendOutput(QString("Metrics: serving Prometheus text on %1").arg(address));
+    return true;
+}
 
-    creature->exists = true;
-    creature->uniqueID = getUniqueID();
+// === World Feed ===
+bool MainWindow::startPublishing(const QString& name) {
+    // Spawns past the headroom move the feed to a larger segment (logged)
+    const int capacity = WorldFeed::capacityFor(mWorld->creatures().size());
+    QString error;
+    mFeed.setLogger([this](const QString& text) { appendOutput(text); });
+    if (!mFeed.create(name, capacity, mWorld->params().worldRect(), -1, &error)) {
+        appendOutput(QString("Feed: %1").arg(error));
+        return false;
+    }
+    mFeed.publish(*mWorld);   // Readers see the world before the first tick, too
+    appendOutput(QString("Feed: publishing every tick to shared memory %1 (%2 frames deep, %3 creatures per frame)")
+                .arg(name).arg(WorldFeed::FEED_SLOTS).arg(capacity));
+    return true;
+}
 
-    // Set initial state and color
-    if (isAlpha) {
-        creature->state = STATE_ALPHA_TRAVELING;
-        // Alphas get the same herd color as their members, but with a black ring
-        creature->color = generateHerdColor(creature->uniqueID); // Same color as herd
-    } else {
-        creature->state = STATE_RESTING;  // Start followers in resting state
-        // Herd members get a bright random color (will be overridden when assigned to alpha)
-        creature->color = getRandomBrightColor();
-        creature->restingTimeLeft = MainWindow::CREATURE_MIN_REST_TICKS +
-            QRandomGenerator::global()->bounded(MainWindow::CREATURE_MAX_REST_TICKS - MainWindow::CREATURE_MIN_REST_TICKS);
+// === Auto-Tuning ===
+void MainWindow::setAutoTune(bool enabled) {
+    mWorld->setAutoTune(enabled);
+    mReportedTunings = 0;
+    UpdatePlan plan = mWorld->updatePlan();
+    appendOutput(enabled ? QString("Auto-tune: on (up to %1 workers)").arg(m_threadPool->maxThreadCount())
+                         : QString("Auto-tune: off (%1 workers x %2 slices)").arg(plan.workers).arg(plan.slices));
+}
+
+// === Tracing ===
+void MainWindow::setTracing(bool enabled) {
+    SimTrace::setEnabled(enabled);
+    traceToggleButton->setText(enabled ? "Trace: ON" : "Trace: OFF");
+    traceToggleButton->setStyleSheet(enabled ? "QPushButton { background-color: lightcyan; padding: 5px; }"
+                                             : "QPushButton { background-color: lightgray; padding: 5px; }");
+    saveTraceButton->setEnabled(enabled);
+    appendOutput(enabled ? QString("Trace: on - Save Trace writes the last %1 s").arg(SimTrace::TRACE_WINDOW_MS / 1000)
+                         : QString("Trace: off"));
+}
+
+void MainWindow::toggleTracing() {
+    setTracing(!SimTrace::enabled());
+}
+
+void MainWindow::saveTrace() {
+    // Tracing keeps running, so a hitch can be captured right after it is seen
+    QString path = QDir::current().filePath(
+        QString("traces/trace_%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss")));
+    QString error;
+    if (!SimTrace::exportWindow(path, SimTrace::TRACE_WINDOW_MS, &error)) {
+        appendOutput(QString("Trace: %1").arg(error));
+        return;
     }
+    appendOutput(QString("Trace: saved %1 (open in ui.perfetto.dev or chrome://tracing)").arg(path));
+}
 
-    // Create graphics with ring indicator
-    creature->graphicsItem = new QGraphicsEllipseItem(0, 0, creature->size, creature->size);
-    creature->graphicsItem->setPos(x, y);
-    creature->graphicsItem->setBrush(QBrush(creature->color));
+// === Level of Detail ===
+void MainWindow::setLevelOfDetail(bool enabled) {
+    mWorld->setLevelOfDetail(enabled);
+    lodToggleButton->setText(enabled ? "LOD: ON" : "LOD: OFF");
+    lodToggleButton->setStyleSheet(enabled ? "QPushButton { background-color: lightcyan; padding: 5px; }"
+                                           : "QPushButton { background-color: lightgray; padding: 5px; }");
+    appendOutput(enabled ? QString("LOD: on - herds more than %1 units outside the view follow their alpha as aggregates")
+                               .arg(SimWorld::LOD_MARGIN)
+                         : QString("LOD: off - every creature simulated"));
+}
 
-    // Set ring color and Z-value based on alpha status
-    if (isAlpha) {
-        creature->graphicsItem->setPen(QPen(Qt::black, CREATURE_RING_WIDTH)); // Black ring for alphas
-        creature->graphicsItem->setZValue(20); // Alphas always on top
+void MainWindow::toggleLevelOfDetail() {
+    setLevelOfDetail(!mWorld->levelOfDetail());
+}
+
+// === Herd Statistics ===
+void MainWindow::setHerdStatistics(bool enabled) {
+    mWorld->setHerdStatistics(enabled);
+    mWorldView->setHerdOverlay(enabled ? mWorld : nullptr);
+    herdStatsToggleButton->setText(enabled ? "Herds: ON" : "Herds: OFF");
+    herdStatsToggleButton->setStyleSheet(enabled ? "QPushButton { background-color: lightcyan; padding: 5px; }"
+                                                 : "QPushButton { background-color: lightgray; padding: 5px; }");
+    if (enabled) {
+        const HerdSummary& summary = mWorld->herdSummary();
+        appendOutput(QString("Herds: %1 herds, %2 members, largest %3, %4% resting, mean spread %5 (dashed = collapsed by LOD)")
+                    .arg(summary.herds).arg(summary.members).arg(summary.largest)
+                    .arg(qRound(100 * summary.restingShare)).arg(summary.meanSpread, 0, 'f', 0));
     } else {
-        creature->graphicsItem->setPen(QPen(Qt::white, CREATURE_RING_WIDTH)); // White ring for regular creatures
-        creature->graphicsItem->setZValue(10); // Regular creatures below alphas
+        appendOutput("Herds: statistics off");
+    }
+}
+
+void MainWindow::toggleHerdStatistics() {
+    setHerdStatistics(!mWorld->herdStatisticsEnabled());
+}
+
+// === Live Edits ===
+void MainWindow::editToolChanged(int index) {
+    mEditTool = static_cast<EditTool>(editToolCombo->itemData(index).toInt());
+    mEditAlphaID = 0;
+    mWorldView->setEditMode(mEditTool != EDIT_NONE);
+    switch (mEditTool) {
+        case EDIT_SPAWN_HERD:
+            appendOutput(QString("Edit: click to spawn a herd of %1").arg(EDIT_SPAWN_COUNT));
+            break;
+        case EDIT_MOVE_ALPHA:
+        case EDIT_RETARGET_HERD:
+            appendOutput("Edit: click an alpha, then its destination");
+            break;
+        case EDIT_PAINT_WATER:
+        case EDIT_PAINT_SAND:
+        case EDIT_PAINT_FOLIAGE:
+            appendOutput("Edit: click or drag to paint terrain");
+            break;
+        default:
+            break;
     }
+}
 
-    mWorldScene->addItem(creature->graphicsItem);
+void MainWindow::editPressed(const QPointF& scenePos) {
+    switch (mEditTool) {
+        case EDIT_SPAWN_HERD:
+            pushEdit(WorldCommand::spawnHerd(scenePos.x(), scenePos.y(), EDIT_SPAWN_COUNT, EDIT_SPAWN_RADIUS));
+            break;
+        case EDIT_MOVE_ALPHA:
+        case EDIT_RETARGET_HERD:
+            if (mEditAlphaID == 0) {
+                const SimpleCreature* alpha = mWorld->nearestAlpha(scenePos.x(), scenePos.y(), EDIT_PICK_RADIUS);
+                if (!alpha) {
+                    appendOutput("Edit: no alpha near there");
+                    return;
+                }
+                mEditAlphaID = alpha->uniqueID;
+                appendOutput(QString("Edit: alpha %1 selected - click its destination").arg(mEditAlphaID));
+                return;
+            }
+            pushEdit(mEditTool == EDIT_MOVE_ALPHA ? WorldCommand::moveAlpha(mEditAlphaID, scenePos.x(), scenePos.y())
+                                                  : WorldCommand::retargetHerd(mEditAlphaID, scenePos.x(), scenePos.y()));
+            mEditAlphaID = 0;
+            break;
+        case EDIT_PAINT_WATER:
+        case EDIT_PAINT_SAND:
+        case EDIT_PAINT_FOLIAGE:
+            editDragged(scenePos);
+            break;
+        default:
+            break;
+    }
+}
 
-    return creature;
+void MainWindow::editDragged(const QPointF& scenePos) {
+    TerrainType terrain;
+    switch (mEditTool) {
+        case EDIT_PAINT_WATER: terrain = TERRAIN_WATER; break;
+        case EDIT_PAINT_SAND: terrain = TERRAIN_SAND; break;
+        case EDIT_PAINT_FOLIAGE: terrain = TERRAIN_FOLIAGE; break;
+        default: return;   // Only the brushes drag
+    }
+    pushEdit(WorldCommand::paintTerrain(scenePos.x(), scenePos.y(), EDIT_PAINT_RADIUS, terrain));
 }
 
-void MainWindow::findHerdTarget(SimpleCreature* creature) {
-    // This function is no longer used in the simplified system
-    // Keeping it for compatibility but it does nothing
+void MainWindow::pushEdit(const WorldCommand& command) {
+    if (!mWorld->commands().push(command)) {
+        appendOutput("Edit: command queue full, edit dropped");
+        return;
+    }
+    // Running: the next tick applies it. Paused: applied from the event loop, but never while a
+    // tick is still waiting on its workers (a Stop click can land inside that wait)
+    if (!mSimulationRunning && !mEditsQueued) {
+        mEditsQueued = true;
+        QMetaObject::invokeMethod(this, [this]() { applyPausedEdits(); }, Qt::QueuedConnection);
+    }
 }
 
-void MainWindow::assignCreatureToNearestAlpha(SimpleCreature* creature, const QVector<SimpleCreature*>& alphas) {
-    if (!creature || creature->isAlpha || alphas.empty()) return; // Don't assign alphas to other alphas!
+void MainWindow::applyPausedEdits() {
+    if (mInTick) return;   // eventLoopTick calls again once tick() has returned
+    mEditsQueued = false;
+    if (mSimulationRunning) return;   // Resumed meanwhile; the next tick applies them
+    mWorld->applyCommands();
+    showEdits();
+    updateGraphics();
+}
 
-    // Find nearest alpha
-    SimpleCreature* nearestAlpha = nullptr;
-    qreal nearestDistance = std::numeric_limits<qreal>::max();
+void MainWindow::showEdits() {
+    // A herd at a time: straight into the index. Toggling the index method would rebuild it for
+    // every item in the scene.
+    for (auto* creature : mWorld->takeSpawnedCreatures()) {
+        createCreatureGraphics(creature);
+        creature->graphicsItem->setVisible(!mSoftwareRendering);
+        mWorldScene->addItem(creature->graphicsItem);
+    }
 
-    for (auto* alpha : alphas) {
-        if (alpha && alpha->isAlpha) {
-            qreal distance = distanceBetween(creature->posX, creature->posY, alpha->posX, alpha->posY);
-            if (distance < nearestDistance) {
-                nearestDistance = distance;
-                nearestAlpha = alpha;
-            }
+    const TerrainChunks& terrain = mWorld->terrain();
+    if (terrain.revision() != mTerrainRevision) {
+        mTerrainRevision = terrain.revision();
+        if (mSoftwareRendering) {
+            mTileRenderer->setTerrain(&terrain);   // Drops its cached frame
         }
+        mWorldView->viewport()->update();
     }
+}
 
-    if (nearestAlpha) {
-        creature->myAlpha = nearestAlpha;
-        // Give this creature the same color as its alpha's herd
-        creature->color = generateHerdColor(nearestAlpha->uniqueID);
-        // Keep the white ring for regular herd members (as per your preference)
-        creature->graphicsItem->setPen(QPen(Qt::white, CREATURE_RING_WIDTH));
+QRectF MainWindow::detailRegion() const {
+    // Recordings need every creature where it really is
+    if (mRecorder->isRecording()) {
+        return mWorld->params().worldRect();
+    }
+    // Every view shows creatures where they are
+    QRectF region = mWorldView->mapToScene(mWorldView->viewport()->rect()).boundingRect();
+    for (auto* view : mExtraViews) {
+        region = region.united(view->visibleScene());
     }
+    return region;
 }
 
-qreal MainWindow::distanceBetween(qreal x1, qreal y1, qreal x2, qreal y2) {
-    qreal dx = x2 - x1;
-    qreal dy = y2 - y1;
-    return sqrt(dx * dx + dy * dy);
+// === Attached Shard ===
+bool MainWindow::attachToShard(const QString& runId, int shard) {
+    mShardView = new ShardView;
+    if (!mShardView->attach(shardViewKey(runId, shard))) {
+        appendOutput(QString("Attach: %1").arg(mShardView->errorString()));
+        delete mShardView;
+        mShardView = nullptr;
+        return false;
+    }
+
+    // Like replay: the local world stays loaded but hidden and stopped
+    if (mSimulationRunning) {
+        runSimulation();
+    }
+    for (auto* creature : mWorld->creatures()) {
+        creature->graphicsItem->setVisible(false);
+    }
+    startButton->setEnabled(false);
+    replayButton->setEnabled(false);
+    recordToggleButton->setEnabled(false);
+    herdStatsToggleButton->setEnabled(false);
+    editToolCombo->setCurrentIndex(0);
+    editToolCombo->setEnabled(false);      // The shard belongs to its node; this world is not shown
+    mWorldView->setHerdOverlay(nullptr);   // The shard's herds are not measured here
+
+    mAttachedShard = shard;
+    mShardRegionItem = new QGraphicsRectItem();
+    mShardRegionItem->setPen(QPen(Qt::red, CREATURE_RING_WIDTH * 2));
+    mShardRegionItem->setBrush(Qt::NoBrush);
+    mShardRegionItem->setZValue(50);
+    mWorldScene->addItem(mShardRegionItem);
+
+    connect(&mAttachTimer, &QTimer::timeout, this, &MainWindow::attachTimerTick);
+    mAttachTimer.start(20);
+
+    statusLabel->setText(QString("ATTACHED to shard %1 of run %2 (read-only). Faded creatures are halo ghosts owned by neighbors.")
+                        .arg(shard).arg(runId));
+    appendOutput(QString("=== ATTACHED: run %1, shard %2 ===").arg(runId).arg(shard));
+    return true;
+}
+
+void MainWindow::attachTimerTick() {
+    ShardViewInfo info;
+    if (!mShardView->read(&info, &mAttachFrame)) return;   // No new tick yet
+
+    QRectF region(info.regionX, info.regionY, info.regionWidth, info.regionHeight);
+    if (mShardRegionItem->rect() != region) {
+        mShardRegionItem->setRect(region);
+        mWorldView->fitInView(region, Qt::KeepAspectRatio);
+    }
+
+    mAttachOwnedCount = info.ownedCount;
+    displayFrame(mAttachFrame, info.ownedCount);
+    statusLabel->setText(QString("ATTACHED to shard %1 - tick %2, %3 owned, %4 halo ghosts")
+                        .arg(info.shard).arg(mAttachFrame.tick).arg(info.ownedCount)
+                        .arg(mAttachFrame.creatures.size() - info.ownedCount));
 }
 
-// === Terrain Methods ===
-SimpleTerrain* MainWindow::createTerrain(int col, int row, TerrainType type) {
-    SimpleTerrain* terrain = new SimpleTerrain;
+void MainWindow::eventLoopTick() {
+    if (!mSimulationRunning) return;
 
-    terrain->type = type;
-    terrain->density = 1;
-    terrain->initialized = true;
+    // Update metronome (visual indicator)
+    if (mMetronomeEnabled) {
+        moveMetronome();
+    }
 
-    // Create graphics
-    qreal x = col * TERRAIN_SIZE;
-    qreal y = row * TERRAIN_SIZE;
-    terrain->graphicsItem = new QGraphicsRectItem(x, y, TERRAIN_SIZE, TERRAIN_SIZE);
-    terrain->graphicsItem->setZValue(0);
+    // Orphan assignment, parallel update, commit, then budgeted housekeeping
+    if (mWorld->levelOfDetail()) {
+        mWorld->setDetailRegion(detailRegion());
+    }
+    mInTick = true;
+    mWorld->tick();
+    mInTick = false;
+    if (mEditsQueued) {
+        applyPausedEdits();   // Stopped and edited while the tick waited
+    }
+    showEdits();
+    mFeed.publish(*mWorld);   // No-op unless publishing
+    const AutoTuner* tuner = mWorld->autoTuner();
+    if (tuner && tuner->tunings() != mReportedTunings) {
+        mReportedTunings = tuner->tunings();
+        appendOutput(QString("Auto-tune: %1").arg(tuner->describe()));
+    }
 
-    setTerrainColor(terrain);
-    mWorldScene->addItem(terrain->graphicsItem);
+    // Update graphics in main thread
+    if (mMetricsServer) {
+        mMetrics.recordTick(*mWorld, m_threadPool->maxThreadCount());
+        QElapsedTimer renderTimer;
+        renderTimer.start();
+        updateGraphics();
+        mMetrics.recordRenderMicros(renderTimer.nsecsElapsed() / 1000);
+        if (mRecorder->isRunning()) {   // Also the tick a write error stopped it
+            RecorderStats stats = mRecorder->stats();
+            mMetrics.setDroppedFrames(stats.framesDropped, stats.framesDownsampled, stats.framesFailed);
+        }
+        mMetrics.setFeedTruncated(mFeed.truncated());
+    } else {
+        updateGraphics();
+    }
 
-    return terrain;
+    // Hand this tick's state to the recorder (no-op unless recording)
+    recordTrajectoryFrame();
 }
 
-void MainWindow::setTerrainColor(SimpleTerrain* terrain) {
-    if (!terrain) return;
+void MainWindow::updateGraphics() {
+    TraceScope trace("graphics");
+    if (mSoftwareRendering) {
+        // Items stay hidden and unmoved; setSceneItemsVisible() resyncs them on switching back
+        mWorld->takeRecoloredCreatures();
+        updateWorldSprites();
+        reportTileRender();
+        mWorldScene->advance();
+        return;
+    }
+
+    // Move only the batch the world committed this tick
+    const QVector<SimpleCreature*>& creatures = mWorld->creatures();
+    for (int i = mWorld->lastCommitStart(); i < mWorld->lastCommitEnd(); i++) {
+        SimpleCreature* creature = creatures[i];
+        if (creature && creature->exists) {
+            creature->graphicsItem->setPos(creature->posX, creature->posY);
 
-    switch (terrain->type) {
-        case TERRAIN_FOLIAGE:
-            terrain->color = QColor(180, 230, 180); // Light green
-            break;
-        case TERRAIN_SAND:
-            terrain->color = QColor(180, 153, 102); // Sandy brown
-            break;
-        case TERRAIN_WATER:
-            terrain->color = QColor(51, 153, 255);  // Blue
-            break;
-        default:
-            terrain->color = QColor(100, 100, 100); // Gray
-            break;
+            // Keep the assigned herd color (don't randomize!)
+            creature->graphicsItem->setBrush(QBrush(creature->color));
+        }
+    }
+
+    // Creatures that joined a new herd (or were re-expanded or moved) this tick get the herd color and their ring
+    for (auto* creature : mWorld->takeRecoloredCreatures()) {
+        creature->graphicsItem->setPos(creature->posX, creature->posY);
+        creature->graphicsItem->setBrush(QBrush(creature->color));
+        creature->graphicsItem->setPen(QPen(creature->isAlpha ? Qt::black : Qt::white, CREATURE_RING_WIDTH));
     }
 
-    terrain->graphicsItem->setBrush(QBrush(terrain->color));
-    terrain->graphicsItem->setPen(QPen(Qt::transparent));
+    // The minimap and extra views draw from the snapshot, not from the items
+    updateWorldSprites();
+
+    // Advance scene
+    mWorldScene->advance();
 }
 
-TerrainType MainWindow::findTerrainTypeByXY(qreal x, qreal y) {
-    int col = static_cast<int>(x / TERRAIN_SIZE);
-    int row = static_cast<int>(y / TERRAIN_SIZE);
+void MainWindow::recordTrajectoryFrame() {
+    if (mRecorder->hasFailed()) {
+        finishRecording();   // Once, as the writer stopped on a write error
+        return;
+    }
+    if (!mRecorder->wantsFrame(mWorld->tickCount())) return;
 
-    if (col < 0 || col >= NUM_TERRAIN_COLS || row < 0 || row >= NUM_TERRAIN_ROWS) {
-        return TERRAIN_FOLIAGE; // Default
+    TrajectoryFrame frame;
+    mWorld->snapshot(&frame);
+    mRecorder->submitFrame(std::move(frame));
+}
+
+void MainWindow::moveMetronome() {
+    if (!mMetronome) return;
+
+    // Move metronome around (like 2dsim07)
+    const qreal width = mWorld->params().worldWidth;
+    const qreal height = mWorld->params().worldHeight;
+    qreal dx = width * 0.002;
+    qreal dy = height * -0.001;
+    qreal newX = mMetronome->x() + dx;
+    qreal newY = mMetronome->y() + dy;
+
+    if (newX < 0) newX = width - 100;
+    else if (newX > width) newX = 100;
+    if (newY < 0) newY = height - 100;
+    else if (newY > height) newY = 100;
+
+    mMetronomeRotation += 3;
+    if (mMetronomeRotation > 360) mMetronomeRotation -= 360;
+
+    mMetronome->setRotation(mMetronomeRotation);
+    mMetronome->setPos(newX, newY);
+
+    // Randomly change color
+    if (QRandomGenerator::global()->bounded(100) > 95) {
+        QColor newColor = getRandomColor();
+        mMetronome->setBrush(QBrush(newColor));
     }
+}
+
+// === Creature Methods ===
+void MainWindow::createCreatureGraphics(SimpleCreature* creature) {
+    // Builds the item but does not add it to the scene (caller decides single vs bulk insert)
+    creature->graphicsItem = new CreatureItem(0, 0, creature->size, creature->size);
+    creature->graphicsItem->setPos(creature->posX, creature->posY);
+    creature->graphicsItem->setBrush(QBrush(creature->color));
 
-    return mTerrain2D[col][row]->type;
+    // Set ring color and Z-value based on alpha status
+    if (creature->isAlpha) {
+        creature->graphicsItem->setPen(QPen(Qt::black, CREATURE_RING_WIDTH)); // Black ring for alphas
+        creature->graphicsItem->setZValue(20); // Alphas always on top
+    } else {
+        creature->graphicsItem->setPen(QPen(Qt::white, CREATURE_RING_WIDTH)); // White ring for regular creatures
+        creature->graphicsItem->setZValue(10); // Regular creatures below alphas
+    }
 }
 
 // === Utility Methods ===
 void MainWindow::printCreatureSample(const QString& label) {
     appendOutput(label);
-    int sampleSize = qMin(8, mCreatures.size()); // Show more samples to see alphas and herds
+    const QVector<SimpleCreature*>& creatures = mWorld->creatures();
+    int sampleSize = qMin(8, creatures.size()); // Show more samples to see alphas and herds
     for (int i = 0; i < sampleSize; i++) {
-        SimpleCreature* creature = mCreatures[i];
+        SimpleCreature* creature = creatures[i];
         QString stateStr;
         switch(creature->state) {
             case STATE_SEEKING_HERD: stateStr = "seeking"; break;
@@ -889,9 +1566,6 @@ void MainWindow::printCreatureSample(const QString& label) {
     }
 }
 
-bool MainWindow::isValidCoordinate(qreal x, qreal y) {
-    return x >= 0 && x < WORLD_SCENE_WIDTH && y >= 0 && y < WORLD_SCENE_HEIGHT;
-}
 
 QColor MainWindow::getRandomColor() {
     int r = QRandomGenerator::global()->bounded(256);
@@ -899,120 +1573,3 @@ QColor MainWindow::getRandomColor() {
     int b = QRandomGenerator::global()->bounded(256);
     return QColor(r, g, b);
 }
-
-QColor MainWindow::getRandomBrightColor() {
-    // Generate bright, saturated colors for better visibility
-    int colorChoice = QRandomGenerator::global()->bounded(12);
-    switch (colorChoice) {
-        case 0: return QColor(255, 100, 100);  // Bright red
-        case 1: return QColor(100, 255, 100);  // Bright green
-        case 2: return QColor(100, 100, 255);  // Bright blue
-        case 3: return QColor(255, 255, 100);  // Bright yellow
-        case 4: return QColor(255, 100, 255);  // Bright magenta
-        case 5: return QColor(100, 255, 255);  // Bright cyan
-        case 6: return QColor(255, 165, 0);    // Orange
-        case 7: return QColor(255, 20, 147);   // Deep pink
-        case 8: return QColor(50, 205, 50);    // Lime green
-        case 9: return QColor(138, 43, 226);   // Blue violet
-        case 10: return QColor(255, 140, 0);   // Dark orange
-        case 11: return QColor(30, 144, 255);  // Dodger blue
-        default: return QColor(255, 100, 100); // Default bright red
-    }
-}
-
-QColor MainWindow::generateHerdColor(int alphaID) {
-    // Generate consistent herd colors based on alpha ID
-    // Use the alpha ID as a seed for consistent color generation
-    QRandomGenerator generator(alphaID);
-
-    // Generate bright, saturated colors for each herd
-    int hue = generator.bounded(360);  // 0-359 degrees on color wheel
-    int saturation = 200 + generator.bounded(56); // 200-255 (high saturation)
-    int value = 200 + generator.bounded(56);      // 200-255 (high brightness)
-
-    return QColor::fromHsv(hue, saturation, value);
-}
-
-int MainWindow::getUniqueID() {
-    static int nextID = 1;
-    return nextID++;
-}
-
-// === Housekeeping Methods ===
-void MainWindow::runHousekeeping() {
-    if (mCreatures.empty()) return;
-
-    if (mDebugOutputEnabled) {
-        appendOutput(QString("=== HOUSEKEEPING: Processing creatures starting at index %1 ===").arg(mHousekeepingCreatureIndex));
-    }
-
-    int orphansFound = 0;
-    int orphansRehomed = 0;
-
-    // Process a chunk of creatures
-    int processed = 0;
-
-    while (processed < MainWindow::HOUSEKEEPING_CREATURES_PER_INTERVAL && mHousekeepingCreatureIndex < mCreatures.size()) {
-        SimpleCreature* creature = mCreatures[mHousekeepingCreatureIndex];
-
-        if (creature && creature->exists && !creature->isAlpha) {
-            // Check if this creature is orphaned (no alpha assigned)
-            if (!creature->myAlpha) {
-                orphansFound++;
-
-                // Find a herd that's not full (has fewer than HERD_MAX_SIZE members)
-                QVector<SimpleCreature*> availableAlphas;
-
-                for (auto* alpha : mCreatures) {
-                    if (alpha && alpha->isAlpha && alpha->exists) {
-                        // Count current herd size for this alpha
-                        int herdSize = 0;
-                        for (auto* member : mCreatures) {
-                            if (member && member->exists && member->myAlpha == alpha) {
-                                herdSize++;
-                            }
-                        }
-
-                        if (herdSize < MainWindow::HERD_MAX_SIZE) {
-                            availableAlphas.push_back(alpha);
-                        }
-                    }
-                }
-
-                // Assign orphan to a random available alpha
-                if (!availableAlphas.empty()) {
-                    int randomIndex = QRandomGenerator::global()->bounded(availableAlphas.size());
-                    SimpleCreature* newAlpha = availableAlphas[randomIndex];
-
-                    // Assign to herd
-                    creature->myAlpha = newAlpha;
-                    creature->color = generateHerdColor(newAlpha->uniqueID);
-                    creature->graphicsItem->setBrush(QBrush(creature->color));
-                    // Keep the white ring for regular herd members (as per your preference)
-                    creature->graphicsItem->setPen(QPen(Qt::white, MainWindow::CREATURE_RING_WIDTH));
-
-                    // Reset creature state to resting
-                    creature->state = STATE_RESTING;
-                    creature->restingTimeLeft = MainWindow::CREATURE_MIN_REST_TICKS +
-                        QRandomGenerator::global()->bounded(MainWindow::CREATURE_MAX_REST_TICKS - MainWindow::CREATURE_MIN_REST_TICKS);
-                    creature->herdTarget = nullptr;
-                    creature->hasHerdTarget = false;
-
-                    orphansRehomed++;
-                }
-            }
-        }
-
-        mHousekeepingCreatureIndex++;
-        processed++;
-    }
-
-    // Reset index when we've processed all creatures
-    if (mHousekeepingCreatureIndex >= mCreatures.size()) {
-        mHousekeepingCreatureIndex = 0;
-    }
-
-    if (orphansFound > 0) {
-        appendOutput(QString("Housekeeping: Found %1 orphans, rehomed %2").arg(orphansFound).arg(orphansRehomed));
-    }
-}
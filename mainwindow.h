@@ -8,6 +8,9 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QTextEdit>
+#include <QSlider>
+#include <QComboBox>
+#include <QHash>
 #include <QThreadPool>
 #include <QMutex>
 #include <QTimer>
@@ -20,71 +23,20 @@
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <QResizeEvent>
+#include <QPaintEvent>
 #include <QRandomGenerator>
 #include <QVector>
-
-// === Simple Enums ===
-enum TerrainType {
-    TERRAIN_NONE = 0,
-    TERRAIN_FOLIAGE = 1,
-    TERRAIN_SAND = 2,
-    TERRAIN_WATER = 3
-};
-
-enum CreatureState {
-    STATE_SEEKING_HERD,      // Looking for another creature in same herd to follow
-    STATE_MOVING_TO_HERD,    // Moving toward herd target (same herd member)
-    STATE_FINDING_SPACE,     // Trying to find elbow room (avoiding overlap)
-    STATE_RESTING,           // Socially satisfied, resting
-    STATE_WANDERING,         // Moving to random point near alpha
-    STATE_ALPHA_TRAVELING,   // Alpha moving to chosen destination
-    STATE_ALPHA_RESTING      // Alpha resting at destination
-};
-
-// === Simple Structs (Alpha-Led Multi-Herd System) ===
-struct SimpleCreature {
-    // Position and movement
-    qreal posX;
-    qreal posY;
-    qreal newX;
-    qreal newY;
-    qreal speed;
-    qreal originalSpeed;
-    qreal size;
-
-    // Alpha system
-    bool isAlpha;
-    SimpleCreature* myAlpha;         // Which alpha do I follow?
-    qreal alphaTargetX;              // For alphas: destination X
-    qreal alphaTargetY;              // For alphas: destination Y
-    int alphaRestingTime;            // For alphas: how long to rest at destination
-
-    // Herding system (within herd only)
-    SimpleCreature* herdTarget;      // Random member of same herd to follow
-    bool hasHerdTarget;
-    int restingTimeLeft;
-    qreal herdingRange;      // How close to get to herd target
-    qreal elbowRoomRange;    // Personal space distance (dynamically calculated)
-
-    // Wandering system
-    qreal wanderTargetX;     // Random wander destination X
-    qreal wanderTargetY;     // Random wander destination Y
-
-    // Graphics and state
-    QGraphicsEllipseItem* graphicsItem;
-    QColor color;            // Herd color (shared among herd members)
-    CreatureState state;
-    bool exists;
-    int uniqueID;
-};
-
-struct SimpleTerrain {
-    TerrainType type;
-    int density;
-    QColor color;
-    QGraphicsRectItem* graphicsItem;
-    bool initialized;
-};
+#include <functional>
+#include "simworld.h"
+#include "trajectoryrecorder.h"
+#include "trajectoryreader.h"
+#include "shardlink.h"
+#include "tilerenderer.h"
+#include "metrics.h"
+#include "worldfeed.h"
+#include "snapshotviews.h"
+
+struct Scenario;
 
 // === Custom GraphicsView (from 2dsim07) ===
 class CustomGraphicsView : public QGraphicsView
@@ -94,19 +46,49 @@ class CustomGraphicsView : public QGraphicsView
 public:
     CustomGraphicsView(QGraphicsScene *scene, QWidget *parent = nullptr);
     void zoomAllTheWayOut();
+    void setReplayMode(bool enabled) { mReplayMode = enabled; }
+    // Non-null: the background is this renderer's frame and the scene only draws overlays
+    void setTileRenderer(TileRenderer* renderer);
+    void setTerrain(const TerrainChunks* terrain) { mTerrain = terrain; viewport()->update(); }
+    // Non-null: each herd's centroid, spread and alpha link, plus a summary, over the scene
+    void setHerdOverlay(const SimWorld* world);
+    // On: left clicks and drags are edits (see editPressed) instead of panning
+    void setEditMode(bool enabled);
+
+signals:
+    // Replay keyboard controls: Space = play/pause, comma/period = step one frame
+    void replayTogglePlayRequested();
+    void replayStepRequested(int frames);
+    // Edit mode: left button pressed, then moved while held (scene units)
+    void editPressed(const QPointF& scenePos);
+    void editDragged(const QPointF& scenePos);
+    // Scrolled, zoomed or resized (the minimap outlines it)
+    void viewChanged();
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
     void wheelEvent(QWheelEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void paintEvent(QPaintEvent *event) override;
+    void drawBackground(QPainter *painter, const QRectF &rect) override;
+    void drawForeground(QPainter *painter, const QRectF &rect) override;
 
 private:
     void zoom(int inOrOut);
     void zoomOverMouse(int inOrOut, QPoint mousePos);
+    void updateViewportMode();
 
     qreal mCurrentScaleFactor;
     qreal mWASDdelta;
+    bool mReplayMode;
+    bool mEditMode;
+    TileRenderer* mTileRenderer;
+    const TerrainChunks* mTerrain;   // Drawn as the scene background
+    const SimWorld* mHerdOverlay;    // Its herd statistics, drawn over the scene
+    static const int HERD_LABEL_MIN_PIXELS = 60;   // Herds drawn smaller than this get no label
     static const int ZOOM_IN = 1;
     static const int ZOOM_OUT = -1;
 };
@@ -123,21 +105,69 @@ public:
     // Thread-safe method to append text to the output
     void appendOutput(const QString& text);
 
+    // Stops the local simulation and shows a shard of a running sharded world instead
+    bool attachToShard(const QString& runId, int shard);
+
+    // Logs reduced-precision kinematics error against a double reference (see SimWorld)
+    void setPrecisionCheck(bool enabled);
+
+    // Paint creatures and terrain with the multithreaded tile rasterizer instead of scene items
+    void setSoftwareRendering(bool enabled);
+
+    // Serves Prometheus metrics on a local port or Unix socket path from a side thread
+    bool startMetrics(const QString& address);
+
+    // Publishes every tick to a shared-memory feed that other processes read (see WorldFeed)
+    bool startPublishing(const QString& name);
+
+    // Times the update phase under different worker counts and grains and keeps the fastest (on by default)
+    void setAutoTune(bool enabled);
+
+    // Records tick phases, worker tasks and painting into per-thread trace buffers (see SimTrace)
+    void setTracing(bool enabled);
+
+    // Simulates herds out of view as aggregates that follow their alpha (see SimWorld::setLevelOfDetail)
+    void setLevelOfDetail(bool enabled);
+
+    // Measures every herd each tick and draws the results over the view (see SimWorld::setHerdStatistics)
+    void setHerdStatistics(bool enabled);
+
+    // Seeds the world and makes it deterministic (see SimWorld::setDeterministic); before construction
+    static void setDeterministicSeed(quint32 seed);
+
+    // Creature count, world size and herd knobs (--scenario / --set, see scenario.h); before construction
+    static void setScenario(const Scenario& scenario);
+
     // Public member for global access
     bool mDebugOutputEnabled;
 
     // === Housekeeping ===
-    static const int HOUSEKEEPING_INTERVAL = 250;
-    static const int HOUSEKEEPING_CREATURES_PER_INTERVAL = 100;
+    // Incremental herd census + orphan rehoming, run after the main tick phases in the slack
+    // left before the next tick (see SimWorld::runHousekeeping)
+    static const int HOUSEKEEPING_MIN_BUDGET_US = 50;         // Always granted, so passes keep moving
+    static const int HOUSEKEEPING_MAX_BUDGET_US = 2000;       // Never more per tick, however idle
+    static const int HOUSEKEEPING_PRIORITY_BUDGET_US = 1000;  // Granted when orphans pile up...
+    static const int HOUSEKEEPING_ORPHAN_PRIORITY = 25;       // ...i.e. this many are waiting
+    static const int HOUSEKEEPING_CHUNK = 256;                // Creatures between clock checks
+    static const int HOUSEKEEPING_PARALLEL_MIN = 20000;       // Remaining creatures worth fanning out to workers
+    static const int HOUSEKEEPING_DETERMINISTIC_CREATURES = 2048;   // Census per tick in deterministic worlds (no clock)
 
     // === World ===
     static const int VECTOR_SIZE = 1000000;
     static const int USE_PCT_CORE = 95;  // Increased from 80 to 95
     static const int WORLD_SCENE_WIDTH = 100000;
     static const int WORLD_SCENE_HEIGHT = 56250;
-    static const int NUM_TERRAIN_COLS = 100;
-    static const int NUM_TERRAIN_ROWS = 56;
-    static const int TERRAIN_SIZE = WORLD_SCENE_WIDTH / 100;
+    static const int NUM_TERRAIN_COLS = 1000;            // Cells, generated in chunks on demand
+    static const int NUM_TERRAIN_ROWS = 562;
+    static const int TERRAIN_SIZE = WORLD_SCENE_WIDTH / NUM_TERRAIN_COLS;
+
+    // Scale profiles (--scenario large / huge, see scenario.h); the kernels are specialized for each
+    static const int LARGE_CREATURE_COUNT = 100000;
+    static const int LARGE_WORLD_WIDTH = 400000;
+    static const int LARGE_WORLD_HEIGHT = 225000;
+    static const int HUGE_CREATURE_COUNT = 1000000;
+    static const int HUGE_WORLD_WIDTH = 1600000;
+    static const int HUGE_WORLD_HEIGHT = 900000;
 
     // Creatures
     static const int STARTING_CREATURE_COUNT = 3001;  // 3000 seems to run okay
@@ -167,24 +197,106 @@ public:
     static const int ALPHA_SPEED_BURST = 6000;
     static const int ALPHA_NORMAL_WANDER_DISTANCE = 2500;  // Creates a 50x50 box around alpha
 
+    // Trajectory recorder
+    static const int RECORDER_KEYFRAME_INTERVAL = 50;   // Ticks between full keyframes
+    static const int RECORDER_QUEUE_CAPACITY = 32;      // Frames buffered for the writer thread
+    static const int RECORDER_COMPRESSION_LEVEL = 3;    // qCompress level (speed over ratio)
+
+    // Shard viewer
+    static constexpr qreal SHARD_GHOST_OPACITY = 0.35;  // Halo ghosts owned by a neighbor shard
+
+    // Tile renderer
+    static const int TILE_RENDER_REPORT_INTERVAL = 250;  // Frames between debug timing lines
+
+    // Snapshot views (the minimap and Add View windows; see snapshotviews.h)
+    static const int MINIMAP_WIDTH = 256;       // Pixels; the height follows the world's aspect
+    static const int EXTRA_VIEW_WIDTH = 640;
+    static const int EXTRA_VIEW_HEIGHT = 360;
+
+    // Live edits (the edit tool box; see SimWorld::commands)
+    static const int EDIT_SPAWN_COUNT = ALPHA_RATIO;                 // Creatures per spawned herd, alpha included
+    static const int EDIT_SPAWN_RADIUS = HERD_GROUP_FOOTPRINT_SIZE;
+    static const int EDIT_PAINT_RADIUS = 1500;                       // Brush, scene units
+    static const int EDIT_PICK_RADIUS = 5000;                        // Clicks farther from every alpha select none
+
 private slots:
     void runSimulation();
     void clearOutput();
+    void reportMemory();
     void toggleDebugOutput();
+    void toggleRecording();
+    void toggleRenderer();
+    void toggleTracing();
+    void toggleLevelOfDetail();
+    void toggleHerdStatistics();
+    void addView();
+    void centerMainView(const QPointF& scenePos);
+    void updateViewOutlines();
+    void editToolChanged(int index);
+    void editPressed(const QPointF& scenePos);
+    void editDragged(const QPointF& scenePos);
+    void saveTrace();
     void eventLoopTick();
 
+    // Replay mode
+    void openReplay();
+    void exitReplay();
+    void toggleReplayPlayback();
+    void stepReplay(int frames);
+    void replayTimerTick();
+    void replaySliderMoved(int value);
+    void replaySpeedChanged(int index);
+
+    // Attached shard viewer
+    void attachTimerTick();
+
 private:
     // === GUI Components ===
     QLabel* statusLabel;
     QPushButton* startButton;
     QPushButton* clearButton;
     QPushButton* debugToggleButton;
+    QPushButton* recordToggleButton;
+    QPushButton* rendererToggleButton;
+    QPushButton* traceToggleButton;
+    QPushButton* saveTraceButton;
+    QPushButton* lodToggleButton;
+    QPushButton* herdStatsToggleButton;
+    QPushButton* memoryButton;
+    QPushButton* addViewButton;
+    QComboBox* editToolCombo;
     QTextEdit* outputText;
 
+    // === Replay Controls ===
+    QPushButton* replayButton;
+    QWidget* mReplayBar;
+    QPushButton* replayPlayButton;
+    QPushButton* replayStepBackButton;
+    QPushButton* replayStepForwardButton;
+    QPushButton* replayExitButton;
+    QComboBox* replaySpeedCombo;
+    QSlider* replaySlider;
+    QLabel* replayTickLabel;
+
     // === Graphics Components ===
     CustomGraphicsView* mWorldView;
     QGraphicsScene* mWorldScene;
 
+    // === Snapshot Views ===
+    // One snapshot per tick, shared by the minimap, the extra views and the tile renderer
+    RenderSnapshotBuilder mSnapshotBuilder;
+    RenderSnapshotPtr mSnapshot;
+    QVector<RenderSprite> mSprites;       // This tick's creatures; capacity reused
+    QVector<RenderHerd> mCollapsedHerds;
+    MiniMap* mMiniMap;
+    QVector<SnapshotView*> mExtraViews;   // Closed views delete and unlist themselves
+    int mViewsOpened;
+
+    // === Tile Renderer ===
+    TileRenderer* mTileRenderer;
+    bool mSoftwareRendering;
+    int mTileRenderFrames;
+
     // === Threading ===
     QThreadPool* m_threadPool;
     QMutex outputMutex;
@@ -192,20 +304,60 @@ private:
     // === Game Loop ===
     QTimer mEventLoopTimer;
     bool mSimulationRunning;
-    int mCurrentCreatureIndex;
-
-    // === Game Data (Qt containers) ===
-    QVector<SimpleCreature*> mCreatures;
-    QVector<QVector<SimpleTerrain*>> mTerrain2D;
+    bool mInTick;             // Inside mWorld->tick(); its waits process events
+    bool mEditsQueued;        // applyPausedEdits() is pending
+
+    // === Game Data (owned by the simulation core) ===
+    SimWorld* mWorld;
+    int mReportedTunings;     // Auto-tuner searches already logged
+
+    // === Live Edits ===
+    enum EditTool {
+        EDIT_NONE,            // Pan
+        EDIT_SPAWN_HERD,
+        EDIT_MOVE_ALPHA,      // Click an alpha, then where it goes
+        EDIT_RETARGET_HERD,   // Click an alpha, then where its herd should travel
+        EDIT_PAINT_WATER,
+        EDIT_PAINT_SAND,
+        EDIT_PAINT_FOLIAGE
+    };
+    EditTool mEditTool;
+    int mEditAlphaID;         // Selected by the first click of a move / retarget (0 = none)
+    quint64 mTerrainRevision; // Terrain last drawn
+
+    // === Output Log ===
+    qint64 mLogBytes;         // Text in outputText, as MEMORY_LOGS saw it
+    qint64 mLogLines;
 
     // === Metronome ===
     QGraphicsRectItem* mMetronome;
     int mMetronomeRotation;
     bool mMetronomeEnabled;
 
-    // === Housekeeping System ===
-    int mHousekeepingTickCounter;
-    int mHousekeepingCreatureIndex;
+    // === Trajectory Recording ===
+    TrajectoryRecorder* mRecorder;
+
+    // === Metrics ===
+    SimMetrics mMetrics;
+    MetricsServer* mMetricsServer;
+    WorldFeed mFeed;
+
+    // === Replay ===
+    TrajectoryReader* mReplayReader;
+    QTimer mReplayTimer;
+    bool mReplayMode;
+    qreal mReplayTick;        // Fractional so sub-1x speeds advance smoothly
+    qreal mReplaySpeed;
+    QVector<QGraphicsEllipseItem*> mReplayItems;
+    QHash<int, QBrush> mReplayHerdBrushes;
+
+    // === Attached Shard ===
+    ShardView* mShardView;
+    QTimer mAttachTimer;
+    QGraphicsRectItem* mShardRegionItem;
+    TrajectoryFrame mAttachFrame;
+    int mAttachedShard;
+    int mAttachOwnedCount;
 
     // === Setup Methods ===
     void setupGUI();
@@ -213,33 +365,31 @@ private:
     void setupTerrain();
     void setupCreatures();
     void setupEventLoop();
+    void addItemsToSceneBulk(const QVector<QGraphicsItem*>& items);
 
     // === Game Loop Methods ===
-    void updateCreaturesParallel();
     void updateGraphics();
     void moveMetronome();
-
-    // === Housekeeping Methods ===
-    void runHousekeeping();
+    void recordTrajectoryFrame();
+    void finishRecording();
+    void setupReplayBar();
+    void showReplayFrame(qint64 tick);
+    void displayFrame(const TrajectoryFrame& frame, int ghostStart);   // [ghostStart, end) drawn faded
+    void updateWorldSprites();     // Builds and publishes this tick's snapshot
+    void publishSnapshot(const QVector<RenderSprite>& sprites, const QVector<RenderHerd>& herds, qint64 tick);
+    void setSceneItemsVisible(bool visible);
+    void reportTileRender();
+    QRectF detailRegion() const;   // What the level of detail keeps fully simulated
+    void pushEdit(const WorldCommand& command);
+    void applyPausedEdits();       // Queued by pushEdit while paused; never runs inside a tick
+    void showEdits();              // Items for spawned creatures, repainted terrain
 
     // === Creature Methods ===
-    SimpleCreature* createCreature(qreal x, qreal y, bool isAlpha = false);
-    void findHerdTarget(SimpleCreature* creature);
-    void assignCreatureToNearestAlpha(SimpleCreature* creature, const QVector<SimpleCreature*>& alphas);
-    qreal distanceBetween(qreal x1, qreal y1, qreal x2, qreal y2);
-
-    // === Terrain Methods ===
-    SimpleTerrain* createTerrain(int col, int row, TerrainType type);
-    void setTerrainColor(SimpleTerrain* terrain);
-    TerrainType findTerrainTypeByXY(qreal x, qreal y);
+    void createCreatureGraphics(SimpleCreature* creature);
 
     // === Utility Methods ===
     void printCreatureSample(const QString& label);
-    bool isValidCoordinate(qreal x, qreal y);
     QColor getRandomColor();
-    QColor getRandomBrightColor();
-    QColor generateHerdColor(int alphaID);
-    int getUniqueID();
 };
 
 #endif // MAINWINDOW_H
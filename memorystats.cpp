@@ -0,0 +1,143 @@
+// 2dsim08/memorystats.cpp - Memory accounting by subsystem and the per-creature footprint
+#include "memorystats.h"
+#include <QString>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+// === Counters ===
+// One cache line per tag, so subsystems recording on different threads do not share lines.
+// Static storage is zeroed before any code runs, so recording works from static initializers too.
+struct alignas(64) MemoryTagCounters {
+    std::atomic<qint64> bytes;
+    std::atomic<qint64> allocations;
+    std::atomic<qint64> peakBytes;
+    std::atomic<qint64> totalAllocations;
+};
+
+static MemoryTagCounters sCounters[MEMORY_TAG_COUNT];
+
+static const char* const MEMORY_TAG_NAMES[MEMORY_TAG_COUNT] = {
+    "creatures", "scene items", "terrain", "arenas", "queues", "logs"
+};
+
+static void raisePeak(MemoryTagCounters& counters, qint64 bytes) {
+    qint64 peak = counters.peakBytes.load(std::memory_order_relaxed);
+    while (bytes > peak && !counters.peakBytes.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryStats::allocated(MemoryTag tag, qint64 bytes, qint64 allocations) {
+    MemoryTagCounters& counters = sCounters[tag];
+    counters.allocations.fetch_add(allocations, std::memory_order_relaxed);
+    counters.totalAllocations.fetch_add(allocations, std::memory_order_relaxed);
+    raisePeak(counters, counters.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void MemoryStats::freed(MemoryTag tag, qint64 bytes, qint64 allocations) {
+    MemoryTagCounters& counters = sCounters[tag];
+    counters.allocations.fetch_sub(allocations, std::memory_order_relaxed);
+    counters.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemoryStats::resized(MemoryTag tag, qint64 deltaBytes) {
+    MemoryTagCounters& counters = sCounters[tag];
+    raisePeak(counters, counters.bytes.fetch_add(deltaBytes, std::memory_order_relaxed) + deltaBytes);
+}
+
+MemoryUsage MemoryStats::usage(MemoryTag tag) {
+    const MemoryTagCounters& counters = sCounters[tag];
+    MemoryUsage usage;
+    usage.bytes = counters.bytes.load(std::memory_order_relaxed);
+    usage.allocations = counters.allocations.load(std::memory_order_relaxed);
+    usage.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    usage.totalAllocations = counters.totalAllocations.load(std::memory_order_relaxed);
+    return usage;
+}
+
+const char* MemoryStats::tagName(MemoryTag tag) {
+    return MEMORY_TAG_NAMES[tag];
+}
+
+// === Process ===
+qint64 MemoryStats::residentBytes() {
+#ifdef Q_OS_LINUX
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    long long size = 0;
+    long long resident = 0;
+    const bool ok = std::fscanf(file, "%lld %lld", &size, &resident) == 2;
+    std::fclose(file);
+    return ok ? resident * sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+qint64 MemoryStats::peakResidentBytes() {
+#ifdef Q_OS_LINUX
+    FILE* file = std::fopen("/proc/self/status", "r");
+    if (!file) return 0;
+    char line[256];
+    long long kilobytes = 0;
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::strncmp(line, "VmHWM:", 6) == 0) {
+            std::sscanf(line + 6, "%lld", &kilobytes);
+            break;
+        }
+    }
+    std::fclose(file);
+    return kilobytes * 1024;
+#else
+    return 0;
+#endif
+}
+
+// === Report ===
+QString MemoryStats::formatBytes(qint64 bytes) {
+    if (bytes < 0) return "-" + formatBytes(-bytes);
+    if (bytes < 10 * 1024) return QString("%1 B").arg(bytes);
+    if (bytes < 10 * 1024 * 1024) return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+    return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+QStringList MemoryStats::report(int creatures) {
+    QStringList lines;
+    qint64 total = 0;
+    qint64 perCreature = 0;
+    qint64 peakPerCreature = 0;
+    for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        const MemoryTag tag = static_cast<MemoryTag>(i);
+        const MemoryUsage tagUsage = usage(tag);
+        if (tagUsage.totalAllocations == 0) continue;
+        lines << QString("Memory: %1 %2 in %3 allocations (peak %4)")
+                 .arg(tagName(tag)).arg(formatBytes(tagUsage.bytes)).arg(tagUsage.allocations)
+                 .arg(formatBytes(tagUsage.peakBytes));
+        total += tagUsage.bytes;
+        if (tag == MEMORY_CREATURES || tag == MEMORY_SCENE_ITEMS) {
+            perCreature += tagUsage.bytes;
+            peakPerCreature += tagUsage.peakBytes;
+        }
+    }
+
+    const qint64 resident = residentBytes();
+    const qint64 peakResident = peakResidentBytes();
+    lines << QString("Memory: %1 accounted, process resident %2 (peak %3)")
+             .arg(formatBytes(total)).arg(formatBytes(resident)).arg(formatBytes(peakResident));
+    if (resident > 0) {
+        // Qt's internals behind items and containers, allocator slack, code and libraries
+        lines << QString("Memory: %1 resident but unaccounted").arg(formatBytes(resident - total));
+    }
+    if (creatures > 0) {
+        lines << QString("Memory per creature: %1 in the creature and its item (peak %2), %3 of all accounted, "
+                         "%4 resident (peak %5)")
+                 .arg(formatBytes(perCreature / creatures)).arg(formatBytes(peakPerCreature / creatures))
+                 .arg(formatBytes(total / creatures)).arg(formatBytes(resident / creatures))
+                 .arg(formatBytes(peakResident / creatures));
+    }
+    return lines;
+}
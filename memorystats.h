@@ -0,0 +1,67 @@
+// 2dsim08/memorystats.h - Memory accounting by subsystem and the per-creature footprint
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <QStringList>
+#include <QtGlobal>
+#include <cstddef>
+
+// === Memory Tags ===
+enum MemoryTag {
+    MEMORY_CREATURES,      // SimpleCreature
+    MEMORY_SCENE_ITEMS,    // Creature graphics items (GUI only)
+    MEMORY_TERRAIN,        // Resident terrain chunks and the overview image
+    MEMORY_ARENAS,         // Tick arena blocks
+    MEMORY_QUEUES,         // Command queue cells, recorder frames waiting to be written
+    MEMORY_LOGS,           // Output log text, trace buffers
+    MEMORY_TAG_COUNT
+};
+
+struct MemoryUsage {
+    qint64 bytes;             // Live
+    qint64 allocations;       // Live
+    qint64 peakBytes;
+    qint64 totalAllocations;  // Ever made
+
+    MemoryUsage() : bytes(0), allocations(0), peakBytes(0), totalAllocations(0) {}
+};
+
+// Process-wide byte and allocation counts per subsystem. The owners record at their allocation
+// sites (allocated / freed / resized); object types inherit MemoryTagged, whose operator
+// new / delete do it for them. Every call is a couple of relaxed atomic adds on the tag's own
+// cache line, so any thread may record. Memory no tag sees - Qt's private item data and scene
+// index, allocator slack, code - is reported as the resident size left unaccounted.
+// --memory-report (MemoryReport, see alloccheck.h) prints all of it for a headless world.
+class MemoryStats
+{
+public:
+    static void allocated(MemoryTag tag, qint64 bytes, qint64 allocations = 1);
+    static void freed(MemoryTag tag, qint64 bytes, qint64 allocations = 1);
+    static void resized(MemoryTag tag, qint64 deltaBytes);   // An existing allocation grew or shrank
+
+    static MemoryUsage usage(MemoryTag tag);
+    static const char* tagName(MemoryTag tag);
+    static qint64 residentBytes();       // Process RSS; 0 where unknown (non-Linux)
+    static qint64 peakResidentBytes();   // Process high-water RSS
+
+    // Per-tag lines, totals, the unaccounted rest and the current and peak cost per creature
+    static QStringList report(int creatures);
+    static QString formatBytes(qint64 bytes);
+};
+
+// === Tagged Allocation ===
+// Inherit to have every heap instance counted under Tag (the base is empty and adds no size).
+// Deleting through a base pointer is counted too, as long as the base has a virtual destructor.
+template <MemoryTag Tag>
+struct MemoryTagged {
+    static void* operator new(size_t bytes) {
+        MemoryStats::allocated(Tag, static_cast<qint64>(bytes));
+        return ::operator new(bytes);
+    }
+    static void operator delete(void* pointer, size_t bytes) {
+        MemoryStats::freed(Tag, static_cast<qint64>(bytes));
+        ::operator delete(pointer);
+    }
+};
+
+#endif // MEMORYSTATS_H
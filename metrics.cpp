@@ -0,0 +1,398 @@
+// 2dsim08/metrics.cpp - Lock-free simulation metrics and a Prometheus text endpoint
+#include "metrics.h"
+#include "simworld.h"
+#include "autotuner.h"
+#include "mainwindow.h"
+#include "memorystats.h"
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QScopedPointer>
+
+// Latency buckets (seconds): 50 us .. 1 s, dense around the 20 ms tick
+static const QVector<double> LATENCY_BOUNDS = {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+                                               0.01, 0.02, 0.05, 0.1, 0.25, 1.0};
+static const int HERD_SIZE_BOUNDS[SimMetrics::HERD_SIZE_BUCKETS - 1] = {0, 1, 5, 10, 25, 50, 100, 250, 500, 1000};
+
+static QByteArray joinLabels(const QByteArray& labels, const QByteArray& extra) {
+    if (labels.isEmpty() && extra.isEmpty()) return QByteArray();
+    if (labels.isEmpty()) return "{" + extra + "}";
+    if (extra.isEmpty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+static void writeHeader(QByteArray* out, const char* name, const char* type, const char* help) {
+    out->append("# HELP ").append(name).append(' ').append(help).append('\n');
+    out->append("# TYPE ").append(name).append(' ').append(type).append('\n');
+}
+
+static void writeValue(QByteArray* out, const char* name, const char* type, const char* help,
+                       const QByteArray& labels, double value) {
+    writeHeader(out, name, type, help);
+    out->append(name).append(joinLabels(labels, QByteArray())).append(' ')
+        .append(QByteArray::number(value, 'g', 12)).append('\n');
+}
+
+// One gauge with a sample per memory tag
+static void writeMemoryTags(QByteArray* out, const char* name, const char* help, const QByteArray& labels,
+                            qint64 MemoryUsage::*field) {
+    writeHeader(out, name, "gauge", help);
+    for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        const MemoryTag tag = static_cast<MemoryTag>(i);
+        out->append(name).append(joinLabels(labels, QByteArray("tag=\"") + MemoryStats::tagName(tag) + "\""))
+            .append(' ').append(QByteArray::number(MemoryStats::usage(tag).*field)).append('\n');
+    }
+}
+
+template <typename T>
+static double load(const std::atomic<T>* value) {
+    return static_cast<double>(value->load(std::memory_order_relaxed));
+}
+
+// === Histogram ===
+MetricsHistogram::MetricsHistogram(const QVector<double>& bounds)
+    : mBounds(bounds)
+    , mCounts(new std::atomic<quint64>[bounds.size() + 1])
+    , mCount(0)
+    , mSum(0)
+{
+    reset();
+}
+
+void MetricsHistogram::observe(double value) {
+    int bucket = 0;
+    while (bucket < mBounds.size() && value > mBounds[bucket]) {
+        bucket++;
+    }
+    mCounts[bucket].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSum.store(mSum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);   // Single writer
+}
+
+void MetricsHistogram::reset() {
+    for (int i = 0; i <= mBounds.size(); i++) {
+        mCounts[i].store(0, std::memory_order_relaxed);
+    }
+    mCount.store(0, std::memory_order_relaxed);
+    mSum.store(0, std::memory_order_relaxed);
+}
+
+void MetricsHistogram::write(QByteArray* out, const char* name, const char* help, const QByteArray& labels) const {
+    writeHeader(out, name, "histogram", help);
+    QByteArray bucketName = QByteArray(name) + "_bucket";
+    quint64 cumulative = 0;
+    for (int i = 0; i <= mBounds.size(); i++) {
+        cumulative += mCounts[i].load(std::memory_order_relaxed);
+        QByteArray le = i < mBounds.size() ? QByteArray::number(mBounds[i], 'g', 6) : QByteArray("+Inf");
+        out->append(bucketName).append(joinLabels(labels, "le=\"" + le + "\"")).append(' ')
+            .append(QByteArray::number(cumulative)).append('\n');
+    }
+    out->append(name).append("_sum").append(joinLabels(labels, QByteArray())).append(' ')
+        .append(QByteArray::number(mSum.load(std::memory_order_relaxed), 'g', 12)).append('\n');
+    out->append(name).append("_count").append(joinLabels(labels, QByteArray())).append(' ')
+        .append(QByteArray::number(cumulative)).append('\n');
+}
+
+// === SimMetrics ===
+SimMetrics::SimMetrics()
+    : mTicks(0)
+    , mTickRate(0)
+    , mCreatures(0)
+    , mAlphas(0)
+    , mOrphans(0)
+    , mOrphansWaiting(0)
+    , mOpenHerds(0)
+    , mWorkerThreads(0)
+    , mWorkerUtilization(0)
+    , mWorkerBusySeconds(0)
+    , mUpdateWorkers(0)
+    , mUpdateSlices(0)
+    , mAutoTunings(0)
+    , mTerrainChunks(0)
+    , mTerrainBytes(0)
+    , mTerrainGenerated(0)
+    , mTerrainEvictions(0)
+    , mLodHerds(0)
+    , mLodCreatures(0)
+    , mHousekeepingPasses(0)
+    , mOrphansRehomed(0)
+    , mTickOverruns(0)
+    , mFramesDropped(0)
+    , mFramesDownsampled(0)
+    , mFramesFailed(0)
+    , mFeedTruncated(0)
+    , mTickSeconds(LATENCY_BOUNDS)
+    , mOrphansSeconds(LATENCY_BOUNDS)
+    , mUpdateSeconds(LATENCY_BOUNDS)
+    , mCommitSeconds(LATENCY_BOUNDS)
+    , mHousekeepingSeconds(LATENCY_BOUNDS)
+    , mRenderSeconds(LATENCY_BOUNDS)
+    , mHerdSizeSequence(0)
+    , mRateTicks(0)
+    , mLastBusyNanos(0)
+    , mLastCensus(0)
+{
+    mRateTimer.start();
+    mUtilizationTimer.start();
+}
+
+void SimMetrics::recordTick(const SimWorld& world, int workerThreads) {
+    const TickTimings& timings = world.lastTickTimings();
+    quint64 ticks = mTicks.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    mTickSeconds.observe(timings.totalMicros / 1e6);
+    mOrphansSeconds.observe(timings.orphansMicros / 1e6);
+    mUpdateSeconds.observe(timings.updateMicros / 1e6);
+    mCommitSeconds.observe(timings.commitMicros / 1e6);
+    mHousekeepingSeconds.observe(timings.housekeepingMicros / 1e6);
+    if (world.tickBudget() > 0 && timings.totalMicros > world.tickBudget()) {
+        mTickOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Counts come from the housekeeping census, so recording stays O(1) per tick
+    const HousekeepingStats& housekeeping = world.housekeepingStats();
+    mCreatures.store(world.creatures().size(), std::memory_order_relaxed);
+    mAlphas.store(housekeeping.censusAlphas, std::memory_order_relaxed);
+    mOrphans.store(housekeeping.censusOrphans, std::memory_order_relaxed);
+    mOrphansWaiting.store(housekeeping.pendingOrphans, std::memory_order_relaxed);
+    mOpenHerds.store(housekeeping.openHerds, std::memory_order_relaxed);
+    mHousekeepingPasses.store(housekeeping.passes, std::memory_order_relaxed);
+    mOrphansRehomed.store(housekeeping.orphansRehomed, std::memory_order_relaxed);
+
+    if (housekeeping.passes != mLastCensus) {
+        mLastCensus = housekeeping.passes;
+        qint64 counts[HERD_SIZE_BUCKETS] = {};
+        for (const SimpleCreature* herd : world.herds()) {
+            int bucket = 0;
+            while (bucket < HERD_SIZE_BUCKETS - 1 && herd->herdSize > HERD_SIZE_BOUNDS[bucket]) {
+                bucket++;
+            }
+            counts[bucket]++;
+        }
+        mHerdSizeSequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        qint64 cumulative = 0;
+        for (int i = 0; i < HERD_SIZE_BUCKETS; i++) {
+            cumulative += counts[i];
+            mHerdSizeCounts[i].store(cumulative, std::memory_order_relaxed);
+        }
+        mHerdSizeSequence.fetch_add(1, std::memory_order_release);
+    }
+
+    // Tick rate over roughly one-second windows
+    qint64 rateElapsed = mRateTimer.elapsed();
+    if (rateElapsed >= 1000) {
+        mTickRate.store((ticks - mRateTicks) * 1000.0 / rateElapsed, std::memory_order_relaxed);
+        mRateTicks = ticks;
+        mRateTimer.restart();
+    }
+
+    // Worker utilization: busy time of all workers over wall time x workers since the last tick
+    qint64 busyNanos = world.workerBusyNanos();
+    qint64 wallNanos = mUtilizationTimer.nsecsElapsed();
+    mUtilizationTimer.restart();
+    if (workerThreads > 0 && wallNanos > 0) {
+        double utilization = static_cast<double>(busyNanos - mLastBusyNanos) / (static_cast<double>(wallNanos) * workerThreads);
+        mWorkerUtilization.store(qBound(0.0, utilization, 1.0), std::memory_order_relaxed);
+    }
+    mLastBusyNanos = busyNanos;
+    mWorkerThreads.store(workerThreads, std::memory_order_relaxed);
+    UpdatePlan plan = world.updatePlan();
+    mUpdateWorkers.store(plan.workers, std::memory_order_relaxed);
+    mUpdateSlices.store(plan.slices, std::memory_order_relaxed);
+    mAutoTunings.store(world.autoTuner() ? world.autoTuner()->tunings() : 0, std::memory_order_relaxed);
+    TerrainCacheStats terrain = world.terrain().stats();
+    mTerrainChunks.store(terrain.residentChunks, std::memory_order_relaxed);
+    mTerrainBytes.store(terrain.residentBytes, std::memory_order_relaxed);
+    mTerrainGenerated.store(terrain.misses, std::memory_order_relaxed);
+    mTerrainEvictions.store(terrain.evictions, std::memory_order_relaxed);
+    mLodHerds.store(world.lodStats().collapsedHerds, std::memory_order_relaxed);
+    mLodCreatures.store(world.lodStats().collapsedCreatures, std::memory_order_relaxed);
+    mWorkerBusySeconds.store(busyNanos / 1e9, std::memory_order_relaxed);
+}
+
+void SimMetrics::recordRenderMicros(qint64 micros) {
+    mRenderSeconds.observe(micros / 1e6);
+}
+
+void SimMetrics::setDroppedFrames(qint64 dropped, qint64 downsampled, qint64 failed) {
+    mFramesDropped.store(dropped, std::memory_order_relaxed);
+    mFramesDownsampled.store(downsampled, std::memory_order_relaxed);
+    mFramesFailed.store(failed, std::memory_order_relaxed);
+}
+
+void SimMetrics::setFeedTruncated(quint64 frames) {
+    mFeedTruncated.store(frames, std::memory_order_relaxed);
+}
+
+void SimMetrics::writeHerdSizes(QByteArray* out) const {
+    qint64 counts[HERD_SIZE_BUCKETS];
+    quint32 before;
+    quint32 after;
+    do {
+        before = mHerdSizeSequence.load(std::memory_order_acquire);
+        for (int i = 0; i < HERD_SIZE_BUCKETS; i++) {
+            counts[i] = mHerdSizeCounts[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = mHerdSizeSequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    const char* name = "sim_herd_size_herds";
+    writeHeader(out, name, "gauge", "Herds with at most le members at the last census.");
+    for (int i = 0; i < HERD_SIZE_BUCKETS; i++) {
+        QByteArray le = i < HERD_SIZE_BUCKETS - 1 ? QByteArray::number(HERD_SIZE_BOUNDS[i]) : QByteArray("+Inf");
+        out->append(name).append(joinLabels(mLabels, "le=\"" + le + "\"")).append(' ')
+            .append(QByteArray::number(counts[i])).append('\n');
+    }
+}
+
+QByteArray SimMetrics::render() const {
+    QByteArray out;
+    out.reserve(8192);
+    writeValue(&out, "sim_ticks_total", "counter", "Simulation ticks completed.", mLabels, load(&mTicks));
+    writeValue(&out, "sim_tick_rate", "gauge", "Ticks per second over the last second.", mLabels, load(&mTickRate));
+    writeValue(&out, "sim_tick_overruns_total", "counter", "Ticks that took longer than the tick interval.", mLabels, load(&mTickOverruns));
+    mTickSeconds.write(&out, "sim_tick_seconds", "Wall time of a whole tick.", mLabels);
+    mOrphansSeconds.write(&out, "sim_phase_orphans_seconds", "Orphan assignment phase.", mLabels);
+    mUpdateSeconds.write(&out, "sim_phase_update_seconds", "Parallel creature update phase.", mLabels);
+    mCommitSeconds.write(&out, "sim_phase_commit_seconds", "Commit phase.", mLabels);
+    mHousekeepingSeconds.write(&out, "sim_phase_housekeeping_seconds", "Budgeted housekeeping phase.", mLabels);
+    mRenderSeconds.write(&out, "sim_phase_render_seconds", "Graphics update after a tick (GUI only).", mLabels);
+
+    writeValue(&out, "sim_creatures", "gauge", "Creatures in this world.", mLabels, load(&mCreatures));
+    writeValue(&out, "sim_alphas", "gauge", "Alphas at the last housekeeping census.", mLabels, load(&mAlphas));
+    writeValue(&out, "sim_orphans", "gauge", "Orphans found by the last housekeeping census.", mLabels, load(&mOrphans));
+    writeValue(&out, "sim_orphans_waiting", "gauge", "Orphans waiting for a herd with room.", mLabels, load(&mOrphansWaiting));
+    writeValue(&out, "sim_open_herds", "gauge", "Herds below the maximum size at the last census.", mLabels, load(&mOpenHerds));
+    writeValue(&out, "sim_orphans_rehomed_total", "counter", "Orphans placed into herds by housekeeping.", mLabels, load(&mOrphansRehomed));
+    writeValue(&out, "sim_housekeeping_passes_total", "counter", "Completed housekeeping censuses.", mLabels, load(&mHousekeepingPasses));
+    writeHerdSizes(&out);
+
+    writeValue(&out, "sim_worker_threads", "gauge", "Worker threads in the pool.", mLabels, load(&mWorkerThreads));
+    writeValue(&out, "sim_worker_utilization", "gauge", "Share of worker time spent in tasks during the last tick.", mLabels, load(&mWorkerUtilization));
+    writeValue(&out, "sim_worker_busy_seconds_total", "counter", "Worker time spent in tasks.", mLabels, load(&mWorkerBusySeconds));
+    writeValue(&out, "sim_update_workers", "gauge", "Tasks running the update phase (1 = on the tick thread).", mLabels, load(&mUpdateWorkers));
+    writeValue(&out, "sim_update_slices", "gauge", "Chunks the update phase splits the creatures into.", mLabels, load(&mUpdateSlices));
+    writeValue(&out, "sim_autotune_runs_total", "counter", "Completed auto-tuner searches.", mLabels, load(&mAutoTunings));
+    writeValue(&out, "sim_terrain_chunks", "gauge", "Terrain chunks resident in the cache.", mLabels, load(&mTerrainChunks));
+    writeValue(&out, "sim_terrain_cache_bytes", "gauge", "Memory held by resident terrain chunks.", mLabels, load(&mTerrainBytes));
+    writeValue(&out, "sim_terrain_chunks_generated_total", "counter", "Terrain chunks generated, regenerations included.", mLabels, load(&mTerrainGenerated));
+    writeValue(&out, "sim_terrain_chunk_evictions_total", "counter", "Terrain chunks evicted from the cache.", mLabels, load(&mTerrainEvictions));
+    writeValue(&out, "sim_lod_collapsed_herds", "gauge", "Herds simulated as aggregates (level of detail).", mLabels, load(&mLodHerds));
+    writeValue(&out, "sim_lod_collapsed_creatures", "gauge", "Members carried by collapsed herds instead of simulated.", mLabels, load(&mLodCreatures));
+
+    writeValue(&out, "sim_recorder_frames_dropped_total", "counter", "Recorder frames lost to a full queue.", mLabels, load(&mFramesDropped));
+    writeValue(&out, "sim_recorder_frames_downsampled_total", "counter", "Recorder frames skipped by downsampling.", mLabels, load(&mFramesDownsampled));
+    writeValue(&out, "sim_recorder_frames_failed_total", "counter", "Recorder frames lost to a write error.", mLabels, load(&mFramesFailed));
+    writeValue(&out, "sim_feed_truncated_frames_total", "counter", "Live feed frames cut off at the feed's capacity.", mLabels, load(&mFeedTruncated));
+
+    writeMemoryTags(&out, "sim_memory_bytes", "Live bytes by subsystem.", mLabels, &MemoryUsage::bytes);
+    writeMemoryTags(&out, "sim_memory_allocations", "Live allocations by subsystem.", mLabels, &MemoryUsage::allocations);
+    writeMemoryTags(&out, "sim_memory_peak_bytes", "High-water bytes by subsystem.", mLabels, &MemoryUsage::peakBytes);
+    writeValue(&out, "process_resident_bytes", "gauge", "Resident set size.", mLabels, MemoryStats::residentBytes());
+    writeValue(&out, "process_resident_peak_bytes", "gauge", "Peak resident set size.", mLabels, MemoryStats::peakResidentBytes());
+    return out;
+}
+
+// === Metrics Server ===
+MetricsServer::MetricsServer(const SimMetrics* metrics, QObject* parent)
+    : QThread(parent)
+    , mMetrics(metrics)
+    , mListening(false)
+{
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::listen(const QString& address, QString* error) {
+    mAddress = address;
+    start();
+    mListenDone.acquire();
+    if (!mListening) {
+        wait();
+        if (error) *error = mError;
+    }
+    return mListening;
+}
+
+void MetricsServer::stop() {
+    if (isRunning()) {
+        quit();
+        wait();
+    }
+}
+
+void MetricsServer::run() {
+    // Servers and sockets live (and are deleted) on this thread; the sim never waits on them
+    QScopedPointer<QTcpServer> tcpServer;
+    QScopedPointer<QLocalServer> localServer;
+    bool isPort = false;
+    int port = mAddress.toInt(&isPort);
+
+    if (isPort) {
+        tcpServer.reset(new QTcpServer);
+        mListening = tcpServer->listen(QHostAddress::LocalHost, static_cast<quint16>(port));
+        if (!mListening) mError = tcpServer->errorString();
+        QTcpServer* server = tcpServer.data();
+        connect(server, &QTcpServer::newConnection, server, [this, server]() {
+            while (QTcpSocket* socket = server->nextPendingConnection()) {
+                connect(socket, &QIODevice::readyRead, socket, [this, socket]() { serve(socket); });
+                connect(socket, &QAbstractSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+    } else {
+        QLocalServer::removeServer(mAddress);   // Stale socket file from a crashed run
+        localServer.reset(new QLocalServer);
+        mListening = localServer->listen(mAddress);
+        if (!mListening) mError = localServer->errorString();
+        QLocalServer* server = localServer.data();
+        connect(server, &QLocalServer::newConnection, server, [this, server]() {
+            while (QLocalSocket* socket = server->nextPendingConnection()) {
+                connect(socket, &QIODevice::readyRead, socket, [this, socket]() { serve(socket); });
+                connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+    }
+
+    mListenDone.release();
+    if (mListening) {
+        exec();
+    }
+}
+
+void MetricsServer::serve(QIODevice* socket) {
+    // Answer once the request headers are complete; the body (if any) is ignored
+    QByteArray request = socket->peek(8192);
+    if (!request.contains("\r\n\r\n") && !request.contains("\n\n")) return;
+    socket->readAll();
+
+    QList<QByteArray> requestLine = request.left(request.indexOf('\n')).trimmed().split(' ');
+    QByteArray path = requestLine.size() > 1 ? requestLine[1] : QByteArray("/");
+
+    QByteArray status = "200 OK";
+    QByteArray body;
+    if (path == "/" || path.startsWith("/metrics")) {
+        body = mMetrics->render();
+    } else {
+        status = "404 Not Found";
+        body = "Try /metrics\n";
+    }
+
+    QByteArray response = "HTTP/1.1 " + status + "\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body;
+    socket->write(response);
+
+    // Both close only after the pending data is written
+    if (QTcpSocket* tcp = qobject_cast<QTcpSocket*>(socket)) {
+        tcp->disconnectFromHost();
+    } else if (QLocalSocket* local = qobject_cast<QLocalSocket*>(socket)) {
+        local->disconnectFromServer();
+    }
+}
@@ -0,0 +1,136 @@
+// 2dsim08/metrics.h - Lock-free simulation metrics and a Prometheus text endpoint
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+class SimWorld;
+class QIODevice;
+
+// Fixed-bucket histogram. One writer (the sim thread) bumps relaxed atomics; any number of
+// readers render it. A scrape may see a tick half-recorded, never a torn value.
+class MetricsHistogram
+{
+public:
+    explicit MetricsHistogram(const QVector<double>& bounds);   // Upper bounds, ascending (+Inf implied)
+
+    void observe(double value);
+    void reset();
+    void write(QByteArray* out, const char* name, const char* help, const QByteArray& labels) const;
+
+private:
+    QVector<double> mBounds;
+    std::unique_ptr<std::atomic<quint64>[]> mCounts;             // Non-cumulative; +Inf last
+    std::atomic<quint64> mCount;
+    std::atomic<double> mSum;
+};
+
+// Everything the endpoint reports. Writers: the thread that owns the world, once per tick.
+// Reader: the metrics server thread. Nothing here takes a lock or touches SimWorld from the
+// reader side - record*() copy what they need into atomics.
+class SimMetrics
+{
+public:
+    static const int HERD_SIZE_BUCKETS = 11;   // HERD_SIZE_BOUNDS plus +Inf
+
+    SimMetrics();
+
+    void setLabels(const QString& labels) { mLabels = labels.toUtf8(); }   // e.g. shard="2"; before serving
+
+    // === Writer side ===
+    void recordTick(const SimWorld& world, int workerThreads);
+    void recordRenderMicros(qint64 micros);                     // GUI draw phase, if any
+    void setDroppedFrames(qint64 dropped, qint64 downsampled, qint64 failed);   // Recorder totals
+    void setFeedTruncated(quint64 frames);                      // WorldFeed::truncated()
+
+    // === Reader side ===
+    QByteArray render() const;
+
+private:
+    void writeHerdSizes(QByteArray* out) const;
+
+    QByteArray mLabels;
+
+    std::atomic<quint64> mTicks;
+    std::atomic<double> mTickRate;             // Ticks per second over the last window
+    std::atomic<qint64> mCreatures;
+    std::atomic<qint64> mAlphas;
+    std::atomic<qint64> mOrphans;              // Found by the last census
+    std::atomic<qint64> mOrphansWaiting;       // Found, but no herd had room yet
+    std::atomic<qint64> mOpenHerds;
+    std::atomic<qint64> mWorkerThreads;
+    std::atomic<double> mWorkerUtilization;    // Busy share of all workers over the last tick
+    std::atomic<double> mWorkerBusySeconds;
+    std::atomic<qint64> mUpdateWorkers;         // Update plan in use (see AutoTuner)
+    std::atomic<qint64> mUpdateSlices;
+    std::atomic<qint64> mAutoTunings;
+    std::atomic<qint64> mTerrainChunks;         // Resident in the chunk cache
+    std::atomic<qint64> mTerrainBytes;
+    std::atomic<qint64> mTerrainGenerated;      // Chunks generated, including regenerations
+    std::atomic<qint64> mTerrainEvictions;
+    std::atomic<qint64> mLodHerds;              // Herds collapsed into aggregates
+    std::atomic<qint64> mLodCreatures;          // Members they carry
+    std::atomic<qint64> mHousekeepingPasses;
+    std::atomic<qint64> mOrphansRehomed;
+    std::atomic<qint64> mTickOverruns;          // Ticks longer than the tick budget
+    std::atomic<qint64> mFramesDropped;
+    std::atomic<qint64> mFramesDownsampled;
+    std::atomic<qint64> mFramesFailed;          // Lost to a recorder write error
+    std::atomic<quint64> mFeedTruncated;        // Published frames cut off at the feed's capacity
+
+    MetricsHistogram mTickSeconds;
+    MetricsHistogram mOrphansSeconds;
+    MetricsHistogram mUpdateSeconds;
+    MetricsHistogram mCommitSeconds;
+    MetricsHistogram mHousekeepingSeconds;
+    MetricsHistogram mRenderSeconds;
+
+    // Herds per size bucket at the last census (cumulative, like le buckets), as gauges: a census
+    // replaces the distribution, so it cannot be a histogram. Published whole under a sequence
+    // count (odd while the writer copies a census in); the reader retries a torn read.
+    std::atomic<qint64> mHerdSizeCounts[HERD_SIZE_BUCKETS];
+    std::atomic<quint32> mHerdSizeSequence;
+
+    // Writer-only bookkeeping
+    QElapsedTimer mRateTimer;
+    quint64 mRateTicks;
+    QElapsedTimer mUtilizationTimer;
+    qint64 mLastBusyNanos;
+    int mLastCensus;
+};
+
+// Serves GET /metrics (any path, really) on its own thread with its own event loop.
+// Address: a port number (TCP on 127.0.0.1) or a socket path/name (Unix domain socket).
+class MetricsServer : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(const SimMetrics* metrics, QObject* parent = nullptr);
+    ~MetricsServer();
+
+    bool listen(const QString& address, QString* error);   // Starts the thread; false if bind failed
+    QString address() const { return mAddress; }
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    void serve(QIODevice* socket);
+
+    const SimMetrics* mMetrics;
+    QString mAddress;
+    QString mError;
+    QSemaphore mListenDone;
+    bool mListening;
+};
+
+#endif // METRICS_H
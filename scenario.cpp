@@ -0,0 +1,143 @@
+// 2dsim08/scenario.cpp - World tuning chosen at startup: presets, scenario files and NAME=VALUE overrides
+#include "scenario.h"
+#include "mainwindow.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+
+static const char* const CREATURE_COUNT_NAME = "STARTING_CREATURE_COUNT";
+
+// === Presets ===
+static const struct {
+    const char* name;
+    int creatures;
+    int worldWidth;
+    int worldHeight;
+} SCENARIO_PRESETS[] = {
+    { "default", MainWindow::STARTING_CREATURE_COUNT, MainWindow::WORLD_SCENE_WIDTH, MainWindow::WORLD_SCENE_HEIGHT },
+    { "large", MainWindow::LARGE_CREATURE_COUNT, MainWindow::LARGE_WORLD_WIDTH, MainWindow::LARGE_WORLD_HEIGHT },
+    { "huge", MainWindow::HUGE_CREATURE_COUNT, MainWindow::HUGE_WORLD_WIDTH, MainWindow::HUGE_WORLD_HEIGHT },
+};
+
+Scenario::Scenario()
+    : name("default")
+    , creatures(MainWindow::STARTING_CREATURE_COUNT)
+{
+}
+
+QStringList Scenario::presets() {
+    QStringList result;
+    for (const auto& preset : SCENARIO_PRESETS) {
+        result << preset.name;
+    }
+    return result;
+}
+
+bool Scenario::preset(const QString& name, Scenario* scenario) {
+    for (const auto& preset : SCENARIO_PRESETS) {
+        if (name == QLatin1String(preset.name)) {
+            *scenario = Scenario();
+            scenario->name = preset.name;
+            scenario->creatures = preset.creatures;
+            scenario->params.worldWidth = preset.worldWidth;
+            scenario->params.worldHeight = preset.worldHeight;
+            return true;
+        }
+    }
+    return false;
+}
+
+// === Loading ===
+bool Scenario::load(const QString& presetOrPath, QString* error) {
+    if (preset(presetOrPath, this)) return true;
+
+    QFile file(presetOrPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("%1 is neither a preset (%2) nor a readable file: %3")
+                 .arg(presetOrPath, presets().join(", "), file.errorString());
+        return false;
+    }
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        *error = QString("%1: %2").arg(presetOrPath, parseError.errorString());
+        return false;
+    }
+    QJsonObject root = document.object();
+
+    const QString base = root.value("base").toString("default");
+    if (!preset(base, this)) {
+        *error = QString("%1: unknown base %2 (presets: %3)").arg(presetOrPath, base, presets().join(", "));
+        return false;
+    }
+    name = QFileInfo(presetOrPath).fileName();
+    creatures = root.value("creatures").toInt(creatures);
+
+    QJsonObject values = root.value("params").toObject();
+    for (const QString& key : values.keys()) {
+        if (!set(key, values.value(key).toInt())) {
+            *error = QString("%1: unknown parameter %2 (known: %3, %4)")
+                     .arg(presetOrPath, key, QString(CREATURE_COUNT_NAME), SimParams::names().join(", "));
+            return false;
+        }
+    }
+    return isValid(error);
+}
+
+bool Scenario::set(const QString& name, int value) {
+    if (name == QLatin1String(CREATURE_COUNT_NAME)) {
+        creatures = value;
+        return true;
+    }
+    return params.set(name, value);
+}
+
+bool Scenario::applyOverrides(const QStringList& assignments, QString* error) {
+    for (const QString& assignment : assignments) {
+        const int equals = assignment.indexOf('=');
+        bool ok = false;
+        const int value = equals > 0 ? assignment.mid(equals + 1).toInt(&ok) : 0;
+        if (!ok) {
+            *error = QString("--set expects NAME=VALUE with an integer value, not %1").arg(assignment);
+            return false;
+        }
+        const QString key = assignment.left(equals).trimmed();
+        if (!set(key, value)) {
+            *error = QString("unknown parameter %1 (known: %2, %3)")
+                     .arg(key, QString(CREATURE_COUNT_NAME), SimParams::names().join(", "));
+            return false;
+        }
+    }
+    if (!assignments.isEmpty()) {
+        name += " + overrides";
+    }
+    return isValid(error);
+}
+
+bool Scenario::isValid(QString* error) const {
+    if (creatures < 1) {
+        *error = QString("%1 must be at least 1").arg(CREATURE_COUNT_NAME);
+        return false;
+    }
+    return params.isValid(error);
+}
+
+// === Reporting ===
+QString Scenario::describe() const {
+    return QString("Scenario %1: %2 creatures, world %3x%4, kernels %5")
+           .arg(name).arg(creatures).arg(params.worldWidth).arg(params.worldHeight)
+           .arg(kernelProfileName(kernelProfileFor(params)));
+}
+
+QStringList Scenario::arguments(const SimParams& params) {
+    const SimParams defaults;
+    QStringList result;
+    for (const QString& key : SimParams::names()) {
+        if (params.value(key) != defaults.value(key)) {
+            result << "--set" << QString("%1=%2").arg(key).arg(params.value(key));
+        }
+    }
+    return result;
+}
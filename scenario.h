@@ -0,0 +1,35 @@
+// 2dsim08/scenario.h - World tuning chosen at startup: presets, scenario files and NAME=VALUE overrides
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "simworld.h"
+#include <QString>
+#include <QStringList>
+
+// === Scenario ===
+// Creature count, world size and herd knobs, named like MainWindow's constants (the defaults).
+// --scenario takes a preset ("default", "large", "huge") or a JSON file, e.g.
+//   { "base": "large", "creatures": 250000,
+//     "params": { "ALPHA_RATIO": 50, "CREATURE_SPEED_NORMAL": 8 } }
+// and each --set NAME=VALUE is applied on top. Names are STARTING_CREATURE_COUNT and those of
+// SimParams::names(). The presets match the kernels' compile-time profiles (see KernelProfile);
+// anything else runs the generic kernels.
+struct Scenario {
+    QString name;                // Preset or file, "+ overrides" when --set changed it
+    int creatures;               // STARTING_CREATURE_COUNT
+    SimParams params;
+
+    Scenario();                  // "default"
+    static QStringList presets();
+    static bool preset(const QString& name, Scenario* scenario);
+    bool load(const QString& presetOrPath, QString* error);
+    bool set(const QString& name, int value);
+    bool applyOverrides(const QStringList& assignments, QString* error);   // "NAME=VALUE" each
+    bool isValid(QString* error) const;
+
+    QString describe() const;    // One line for the log
+    // --set pairs for every parameter that differs from the defaults (shard processes get these)
+    static QStringList arguments(const SimParams& params);
+};
+
+#endif // SCENARIO_H
@@ -0,0 +1,449 @@
+// 2dsim08/shardlink.cpp - Shared-memory transport between shard processes (halo + migration + view)
+#include "shardlink.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <cstring>
+#include <new>
+
+static const quint32 SHARD_LINK_MAGIC = 0x4B4E4C53;   // "SLNK"
+static const quint32 SHARD_VIEW_MAGIC = 0x57495653;   // "SVIW"
+static const quint32 SHARD_SEGMENT_VERSION = 1;
+static const int SHARD_SPIN_ITERATIONS = 2000;        // Busy-wait before falling back to sleeping
+static const int SHARD_VIEW_READ_RETRIES = 8;
+
+QString shardLinkKey(const QString& runId, int fromShard, int toShard) {
+    return QString("2dsim08_%1_link_%2_%3").arg(runId).arg(fromShard).arg(toShard);
+}
+
+QString shardViewKey(const QString& runId, int shard) {
+    return QString("2dsim08_%1_view_%2").arg(runId).arg(shard);
+}
+
+// Waits for condition() with a short spin (neighbors usually finish within microseconds of
+// each other), then sleeps in 1 ms steps. Returns false on timeout.
+template <typename Condition>
+static bool waitFor(Condition condition, int timeoutMs) {
+    for (int i = 0; i < SHARD_SPIN_ITERATIONS; i++) {
+        if (condition()) return true;
+        QThread::yieldCurrentThread();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timeoutMs >= 0 && timer.elapsed() > timeoutMs) return false;
+        QThread::msleep(1);
+    }
+    return true;
+}
+
+// Creates a segment, clearing one left behind by a crashed run with the same key
+// (on Unix the segment outlives a killed process until someone detaches from it)
+static bool createSegment(QSharedMemory& segment, const QString& key, int size) {
+    segment.setKey(key);
+    if (segment.create(size)) return true;
+
+    if (segment.error() == QSharedMemory::AlreadyExists && segment.attach()) {
+        segment.detach();
+        return segment.create(size);
+    }
+    return false;
+}
+
+// === Link Ring ===
+struct ShardLink::RingHeader {
+    std::atomic<quint32> magic;
+    quint32 version;
+    quint64 capacity;
+    alignas(64) std::atomic<quint64> writePosition;    // Producer cache line
+    alignas(64) std::atomic<quint64> readPosition;     // Consumer cache line
+};
+
+ShardLink::ShardLink()
+    : mHeader(nullptr)
+    , mRing(nullptr)
+    , mCapacity(0)
+    , mBytesPublished(0)
+    , mBytesConsumed(0)
+    , mOutgoing(nullptr)
+    , mGhostsSent(0)
+    , mMigrantsSent(0)
+    , mOutgoingDone(true)
+    , mIncomingStarted(false)
+{
+}
+
+ShardLink::~ShardLink() {
+    close();
+}
+
+bool ShardLink::create(const QString& key, int capacityBytes) {
+    close();
+    if (!createSegment(mSegment, key, static_cast<int>(sizeof(RingHeader)) + capacityBytes)) {
+        mError = QString("Cannot create link %1: %2").arg(key).arg(mSegment.errorString());
+        return false;
+    }
+
+    void* memory = mSegment.data();
+    std::memset(memory, 0, sizeof(RingHeader));
+    mHeader = new (memory) RingHeader;
+    mHeader->version = SHARD_SEGMENT_VERSION;
+    mHeader->capacity = static_cast<quint64>(capacityBytes);
+    mHeader->writePosition.store(0, std::memory_order_relaxed);
+    mHeader->readPosition.store(0, std::memory_order_relaxed);
+    mHeader->magic.store(SHARD_LINK_MAGIC, std::memory_order_release);   // Ready for consumers
+
+    mRing = static_cast<uchar*>(memory) + sizeof(RingHeader);
+    mCapacity = static_cast<quint64>(capacityBytes);
+    return true;
+}
+
+bool ShardLink::attach(const QString& key, int timeoutMs) {
+    close();
+    mSegment.setKey(key);
+
+    // The producer may not have started yet
+    bool attached = waitFor([this]() {
+        if (!mSegment.isAttached() && !mSegment.attach()) return false;
+        const RingHeader* header = static_cast<const RingHeader*>(mSegment.constData());
+        return header->magic.load(std::memory_order_acquire) == SHARD_LINK_MAGIC;
+    }, timeoutMs);
+
+    if (!attached) {
+        mError = QString("Timed out attaching link %1").arg(key);
+        mSegment.detach();
+        return false;
+    }
+
+    mHeader = static_cast<RingHeader*>(mSegment.data());
+    if (mHeader->version != SHARD_SEGMENT_VERSION) {
+        mError = QString("Link %1 has an unsupported version").arg(key);
+        close();
+        return false;
+    }
+    mRing = static_cast<uchar*>(mSegment.data()) + sizeof(RingHeader);
+    mCapacity = mHeader->capacity;
+    return true;
+}
+
+void ShardLink::close() {
+    if (mSegment.isAttached()) {
+        mSegment.detach();
+    }
+    mHeader = nullptr;
+    mRing = nullptr;
+    mCapacity = 0;
+    mOutgoing = nullptr;
+    mOutgoingDone = true;
+    mIncomingStarted = false;
+}
+
+void ShardLink::writeBytes(quint64 position, const void* data, quint64 size) {
+    quint64 offset = position % mCapacity;
+    quint64 first = qMin(size, mCapacity - offset);
+    std::memcpy(mRing + offset, data, first);
+    std::memcpy(mRing, static_cast<const uchar*>(data) + first, size - first);
+}
+
+void ShardLink::readBytes(quint64 position, void* data, quint64 size) const {
+    quint64 offset = position % mCapacity;
+    quint64 first = qMin(size, mCapacity - offset);
+    std::memcpy(data, mRing + offset, first);
+    std::memcpy(static_cast<uchar*>(data) + first, mRing, size - first);
+}
+
+// Wire layout, per part: u32 payloadSize, then i64 tick, u32 ghostCount, u32 migrantCount,
+// u32 last, ghosts, migrants. A tick's message is one or more parts; last = 1 on its final one.
+static const quint32 SHARD_PART_HEADER_BYTES = sizeof(qint64) + 3 * sizeof(quint32);
+
+void ShardLink::stage(const ShardMessage& message) {
+    mOutgoing = &message;
+    mGhostsSent = 0;
+    mMigrantsSent = 0;
+    mOutgoingDone = false;
+}
+
+bool ShardLink::publishSome(bool* done) {
+    if (!mHeader || !mOutgoing) {
+        mError = "Link is not open";
+        return false;
+    }
+
+    // Half a ring per part: one part can always go out once the consumer read the one before
+    const quint64 partRoom = mCapacity / 2 - sizeof(quint32) - SHARD_PART_HEADER_BYTES;
+    while (!mOutgoingDone) {
+        const quint64 ghostsLeft = mOutgoing->ghosts.size() - mGhostsSent;
+        const quint64 migrantsLeft = mOutgoing->migrants.size() - mMigrantsSent;
+        const quint32 ghostCount = static_cast<quint32>(qMin(ghostsLeft, partRoom / sizeof(TrajectoryCreature)));
+        const quint64 migrantRoom = partRoom - ghostCount * sizeof(TrajectoryCreature);
+        const quint32 migrantCount = static_cast<quint32>(qMin(migrantsLeft, migrantRoom / sizeof(ShardCreatureRecord)));
+        const quint32 last = (ghostCount == ghostsLeft && migrantCount == migrantsLeft) ? 1 : 0;
+        const quint32 payloadSize = SHARD_PART_HEADER_BYTES
+                                  + ghostCount * sizeof(TrajectoryCreature)
+                                  + migrantCount * sizeof(ShardCreatureRecord);
+        const quint64 needed = sizeof(quint32) + payloadSize;
+
+        const quint64 write = mHeader->writePosition.load(std::memory_order_relaxed);
+        if (mCapacity - (write - mHeader->readPosition.load(std::memory_order_acquire)) < needed) {
+            break;   // The consumer has not made room yet
+        }
+
+        mScratch.resize(static_cast<int>(needed));
+        char* out = mScratch.data();
+        std::memcpy(out, &payloadSize, sizeof(payloadSize));                 out += sizeof(payloadSize);
+        std::memcpy(out, &mOutgoing->tick, sizeof(mOutgoing->tick));         out += sizeof(mOutgoing->tick);
+        std::memcpy(out, &ghostCount, sizeof(ghostCount));                   out += sizeof(ghostCount);
+        std::memcpy(out, &migrantCount, sizeof(migrantCount));               out += sizeof(migrantCount);
+        std::memcpy(out, &last, sizeof(last));                               out += sizeof(last);
+        std::memcpy(out, mOutgoing->ghosts.constData() + mGhostsSent, ghostCount * sizeof(TrajectoryCreature));
+        out += ghostCount * sizeof(TrajectoryCreature);
+        std::memcpy(out, mOutgoing->migrants.constData() + mMigrantsSent, migrantCount * sizeof(ShardCreatureRecord));
+
+        writeBytes(write, mScratch.constData(), needed);
+        mHeader->writePosition.store(write + needed, std::memory_order_release);
+        mBytesPublished += static_cast<qint64>(needed);
+        mGhostsSent += ghostCount;
+        mMigrantsSent += migrantCount;
+        mOutgoingDone = (last != 0);
+    }
+    *done = mOutgoingDone;
+    return true;
+}
+
+bool ShardLink::consumeSome(ShardMessage* message, bool* done) {
+    *done = false;
+    if (!mHeader) {
+        mError = "Link is not open";
+        return false;
+    }
+
+    // The producer moves writePosition past whole parts only; stop after a message's last one,
+    // the next tick's parts may already follow it
+    for (;;) {
+        const quint64 read = mHeader->readPosition.load(std::memory_order_relaxed);
+        if (mHeader->writePosition.load(std::memory_order_acquire) <= read) return true;
+
+        quint32 payloadSize = 0;
+        readBytes(read, &payloadSize, sizeof(payloadSize));
+        mScratch.resize(static_cast<int>(payloadSize));
+        readBytes(read + sizeof(payloadSize), mScratch.data(), payloadSize);
+        mHeader->readPosition.store(read + sizeof(payloadSize) + payloadSize, std::memory_order_release);
+        mBytesConsumed += static_cast<qint64>(sizeof(payloadSize) + payloadSize);
+
+        const char* in = mScratch.constData();
+        qint64 tick = 0;
+        quint32 ghostCount = 0;
+        quint32 migrantCount = 0;
+        quint32 last = 0;
+        std::memcpy(&tick, in, sizeof(tick));                      in += sizeof(tick);
+        std::memcpy(&ghostCount, in, sizeof(ghostCount));          in += sizeof(ghostCount);
+        std::memcpy(&migrantCount, in, sizeof(migrantCount));      in += sizeof(migrantCount);
+        std::memcpy(&last, in, sizeof(last));                      in += sizeof(last);
+
+        if (!mIncomingStarted) {
+            message->tick = tick;
+            message->ghosts.resize(0);
+            message->migrants.resize(0);
+            mIncomingStarted = true;
+        }
+        const int ghosts = message->ghosts.size();
+        message->ghosts.resize(ghosts + static_cast<int>(ghostCount));
+        std::memcpy(message->ghosts.data() + ghosts, in, ghostCount * sizeof(TrajectoryCreature));
+        in += ghostCount * sizeof(TrajectoryCreature);
+        const int migrants = message->migrants.size();
+        message->migrants.resize(migrants + static_cast<int>(migrantCount));
+        std::memcpy(message->migrants.data() + migrants, in, migrantCount * sizeof(ShardCreatureRecord));
+
+        if (last) {
+            mIncomingStarted = false;
+            *done = true;
+            return true;
+        }
+    }
+}
+
+// === View Segment ===
+struct ShardView::ViewHeader {
+    std::atomic<quint32> magic;
+    qint32 capacity;
+    std::atomic<quint64> sequence;    // Odd while a write is in progress
+    qint64 tick;
+    qint32 shard;
+    qint32 count;
+    qint32 ownedCount;
+    std::atomic<qint32> replacedBy;   // 0 = current; else the generation that replaced this one
+    qreal regionX;
+    qreal regionY;
+    qreal regionWidth;
+    qreal regionHeight;
+};
+
+ShardView::ShardView()
+    : mHeader(nullptr)
+    , mCreatures(nullptr)
+    , mCapacity(0)
+    , mGeneration(0)
+    , mLastSequenceRead(0)
+    , mTruncated(0)
+    , mTruncating(false)
+{
+}
+
+ShardView::~ShardView() {
+    close();
+}
+
+QString ShardView::generationKey(const QString& key, int generation) {
+    return generation == 0 ? key : QString("%1_%2").arg(key).arg(generation);
+}
+
+bool ShardView::create(const QString& key, int capacityCreatures) {
+    close();
+    mKey = key;
+    mTruncated = 0;
+    mTruncating = false;
+    return map(0, capacityCreatures);
+}
+
+// Creates a fresh segment for the generation, then marks the current one (if any) replaced and
+// detaches it; viewers still on it keep it alive until they follow. On failure the current
+// segment stays in use.
+bool ShardView::map(int generation, int capacityCreatures) {
+    const QString key = generationKey(mKey, generation);
+    QScopedPointer<QSharedMemory> segment(new QSharedMemory);
+    int size = static_cast<int>(sizeof(ViewHeader) + capacityCreatures * sizeof(TrajectoryCreature));
+    if (!createSegment(*segment, key, size)) {
+        mError = QString("Cannot create view %1: %2").arg(key).arg(segment->errorString());
+        return false;
+    }
+
+    void* memory = segment->data();
+    std::memset(memory, 0, sizeof(ViewHeader));
+    ViewHeader* header = new (memory) ViewHeader;
+    header->capacity = capacityCreatures;
+    header->sequence.store(0, std::memory_order_relaxed);
+    header->replacedBy.store(0, std::memory_order_relaxed);
+    header->magic.store(SHARD_VIEW_MAGIC, std::memory_order_release);
+
+    if (mHeader) {
+        mHeader->replacedBy.store(generation, std::memory_order_release);
+    }
+    close();
+    mSegment.swap(segment);
+    mHeader = header;
+    mCreatures = reinterpret_cast<TrajectoryCreature*>(static_cast<uchar*>(memory) + sizeof(ViewHeader));
+    mCapacity = capacityCreatures;
+    mGeneration = generation;
+    return true;
+}
+
+bool ShardView::attach(const QString& key) {
+    close();
+    mKey = key;
+
+    // Generations the shard retired are gone once no viewer holds them; a live one may point on
+    for (int generation = 0; generation <= VIEW_MAX_GENERATIONS; generation++) {
+        QScopedPointer<QSharedMemory> segment(new QSharedMemory(generationKey(key, generation)));
+        if (!segment->attach(QSharedMemory::ReadOnly)) continue;
+
+        ViewHeader* header = static_cast<ViewHeader*>(segment->data());
+        if (header->magic.load(std::memory_order_acquire) != SHARD_VIEW_MAGIC) {
+            mError = QString("%1 is not a shard view").arg(key);
+            return false;
+        }
+        const int replacedBy = header->replacedBy.load(std::memory_order_acquire);
+        if (replacedBy > generation) {
+            generation = replacedBy - 1;
+            continue;
+        }
+
+        mSegment.swap(segment);
+        mHeader = header;
+        mCreatures = reinterpret_cast<TrajectoryCreature*>(static_cast<uchar*>(mSegment->data()) + sizeof(ViewHeader));
+        mCapacity = header->capacity;
+        mGeneration = generation;
+        mLastSequenceRead = 0;
+        return true;
+    }
+    mError = QString("No shard is publishing %1").arg(key);
+    return false;
+}
+
+void ShardView::close() {
+    if (mSegment && mSegment->isAttached()) {
+        mSegment->detach();
+    }
+    mSegment.reset();
+    mHeader = nullptr;
+    mCreatures = nullptr;
+    mCapacity = 0;
+}
+
+void ShardView::publish(const ShardViewInfo& info, const TrajectoryFrame& frame) {
+    if (!mHeader) return;
+
+    if (frame.creatures.size() > mCapacity && !mTruncating) {
+        // Gathering herds or ghosts outgrew the segment (tried once per truncation run)
+        const int capacity = qMax(capacityFor(frame.creatures.size()), 2 * mCapacity);
+        if (mGeneration < VIEW_MAX_GENERATIONS && map(mGeneration + 1, capacity)) {
+            log(QString("View: grew to %1 creatures per frame").arg(capacity));
+        } else {
+            log(QString("View: cannot grow to %1 creatures (%2); frames are truncated, ghosts first")
+                .arg(capacity).arg(mError));
+        }
+    }
+    int count = qMin(frame.creatures.size(), mCapacity);
+    if (count < frame.creatures.size()) {
+        mTruncated++;
+        mTruncating = true;
+    } else if (mTruncating) {
+        mTruncating = false;
+        log(QString("View: frames whole again after %1 truncated").arg(mTruncated));
+    }
+
+    quint64 sequence = mHeader->sequence.load(std::memory_order_relaxed);
+    mHeader->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mHeader->tick = frame.tick;
+    mHeader->shard = info.shard;
+    mHeader->count = count;
+    mHeader->ownedCount = qMin(info.ownedCount, count);
+    mHeader->regionX = info.regionX;
+    mHeader->regionY = info.regionY;
+    mHeader->regionWidth = info.regionWidth;
+    mHeader->regionHeight = info.regionHeight;
+    std::memcpy(mCreatures, frame.creatures.constData(), count * sizeof(TrajectoryCreature));
+
+    mHeader->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool ShardView::read(ShardViewInfo* info, TrajectoryFrame* frame) {
+    // Follow the shard to a larger segment; retried on later calls until the new one is found
+    if (mHeader && mHeader->replacedBy.load(std::memory_order_acquire) != 0) attach(mKey);
+    if (!mHeader && (mKey.isEmpty() || !attach(mKey))) return false;
+
+    for (int attempt = 0; attempt < SHARD_VIEW_READ_RETRIES; attempt++) {
+        quint64 before = mHeader->sequence.load(std::memory_order_acquire);
+        if (before == mLastSequenceRead) return false;   // Nothing new since the last read
+        if (before & 1) continue;                        // Write in progress
+
+        int count = qBound(0, mHeader->count, mCapacity);
+        frame->tick = mHeader->tick;
+        frame->creatures.resize(count);
+        std::memcpy(frame->creatures.data(), mCreatures, count * sizeof(TrajectoryCreature));
+        info->shard = mHeader->shard;
+        info->ownedCount = qBound(0, mHeader->ownedCount, count);
+        info->regionX = mHeader->regionX;
+        info->regionY = mHeader->regionY;
+        info->regionWidth = mHeader->regionWidth;
+        info->regionHeight = mHeader->regionHeight;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mHeader->sequence.load(std::memory_order_relaxed) == before) {
+            mLastSequenceRead = before;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,164 @@
+// 2dsim08/shardlink.h - Shared-memory transport between shard processes (halo + migration + view)
+#ifndef SHARDLINK_H
+#define SHARDLINK_H
+
+#include "trajectoryformat.h"
+#include <QScopedPointer>
+#include <QSharedMemory>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+#include <functional>
+
+// === Segment Naming ===
+// Every segment of one sharded run shares the run id, so several runs can coexist on a box:
+//   2dsim08_<run>_link_<from>_<to>   - one ring per directed neighbor pair
+//   2dsim08_<run>_view_<shard>       - latest committed frame of one shard (for attached viewers)
+QString shardLinkKey(const QString& runId, int fromShard, int toShard);
+QString shardViewKey(const QString& runId, int shard);
+
+// Full creature state for a herd member changing owner. Pointers travel as unique IDs
+// (alphaID) and are re-linked by the receiving shard; herd targets are dropped.
+struct ShardCreatureRecord {
+    qreal posX;
+    qreal posY;
+    qreal newX;
+    qreal newY;
+    qreal speed;
+    qreal originalSpeed;
+    qreal size;
+    qreal alphaTargetX;
+    qreal alphaTargetY;
+    qreal herdingRange;
+    qreal elbowRoomRange;
+    qreal wanderTargetX;
+    qreal wanderTargetY;
+    qint32 uniqueID;
+    qint32 alphaID;              // 0 = none
+    qint32 alphaRestingTime;
+    qint32 restingTimeLeft;
+    quint32 rgba;                // Herd color
+    quint8 state;                // CreatureState
+    quint8 isAlpha;
+    quint8 exists;
+    quint8 reserved;
+};
+
+// One tick's traffic on one link: ghosts (read-only copies of creatures inside the halo)
+// followed by migrants (whole herds whose alpha crossed into or toward the receiver)
+struct ShardMessage {
+    qint64 tick;
+    QVector<TrajectoryCreature> ghosts;
+    QVector<ShardCreatureRecord> migrants;
+
+    ShardMessage() : tick(0) {}
+};
+
+// === Link Ring ===
+// Single-producer / single-consumer byte ring in a QSharedMemory segment. The producer owns
+// (creates) the segment; the consumer attaches. Read and write cursors are monotonic byte
+// counts held in lock-free atomics inside the segment, so no system semaphore is taken per
+// message. Messages are length-prefixed and may wrap around the end of the ring. A message
+// larger than half the ring goes out in parts as the consumer makes room, so its size is not
+// bounded by the ring.
+class ShardLink
+{
+public:
+    ShardLink();
+    ~ShardLink();
+
+    bool create(const QString& key, int capacityBytes);   // Producer side
+    bool attach(const QString& key, int timeoutMs);       // Consumer side, waits for the producer
+    void close();
+    QString errorString() const { return mError; }
+
+    // One message each way per tick, without blocking: call both until done, alternating with
+    // the other links, so two neighbors sending each other big messages never wait on each
+    // other. False only on a link that is not open.
+    void stage(const ShardMessage& message);               // Kept by reference until published
+    bool publishSome(bool* done);                          // Writes the parts that fit now
+    bool consumeSome(ShardMessage* message, bool* done);   // Appends the parts that arrived
+
+    qint64 bytesPublished() const { return mBytesPublished; }
+    qint64 bytesConsumed() const { return mBytesConsumed; }
+
+private:
+    struct RingHeader;
+
+    void writeBytes(quint64 position, const void* data, quint64 size);
+    void readBytes(quint64 position, void* data, quint64 size) const;
+
+    QSharedMemory mSegment;
+    RingHeader* mHeader;
+    uchar* mRing;
+    quint64 mCapacity;
+    QString mError;
+    qint64 mBytesPublished;
+    qint64 mBytesConsumed;
+    QByteArray mScratch;
+
+    // The message being published, and how much of it is out
+    const ShardMessage* mOutgoing;
+    int mGhostsSent;
+    int mMigrantsSent;
+    bool mOutgoingDone;
+    bool mIncomingStarted;       // Parts of the message being consumed have arrived
+};
+
+// === View Segment ===
+// Latest committed frame of one shard, guarded by a sequence lock: the shard writes without
+// ever waiting on viewers, and a viewer retries its copy if a write overlapped it. A frame that
+// outgrows the segment moves the view to a larger one, keyed <key>_<generation>; the old one is
+// marked replaced and viewers follow. Only if that fails are frames truncated, ghosts first.
+struct ShardViewInfo {
+    int shard;
+    qreal regionX;
+    qreal regionY;
+    qreal regionWidth;
+    qreal regionHeight;
+    int ownedCount;              // frame.creatures[0, ownedCount) are owned, the rest are ghosts
+};
+
+class ShardView
+{
+public:
+    static const int VIEW_HEADROOM_PERCENT = 25;   // Capacity above the creature count, at creation
+    static const int VIEW_MAX_GENERATIONS = 64;    // Growths a viewer looks through; each at least doubles
+
+    ShardView();
+    ~ShardView();
+
+    bool create(const QString& key, int capacityCreatures);   // Shard side
+    bool attach(const QString& key);                          // Viewer side; finds the current generation
+    void close();
+    bool isAttached() const { return mHeader != nullptr; }
+    QString errorString() const { return mError; }
+    void setLogger(const std::function<void(const QString&)>& logger) { mLogger = logger; }
+    static int capacityFor(int creatures) { return creatures * (100 + VIEW_HEADROOM_PERCENT) / 100; }
+
+    void publish(const ShardViewInfo& info, const TrajectoryFrame& frame);
+    bool read(ShardViewInfo* info, TrajectoryFrame* frame);   // false = no new frame yet
+    quint64 truncated() const { return mTruncated; }          // Frames with more creatures than capacity
+
+private:
+    struct ViewHeader;
+
+    static QString generationKey(const QString& key, int generation);
+    bool map(int generation, int capacityCreatures);
+    void log(const QString& text) { if (mLogger) mLogger(text); }
+
+    QScopedPointer<QSharedMemory> mSegment;
+    ViewHeader* mHeader;
+    TrajectoryCreature* mCreatures;
+    int mCapacity;
+    QString mKey;
+    int mGeneration;
+    QString mError;
+    quint64 mLastSequenceRead;
+    quint64 mTruncated;
+    bool mTruncating;              // The last frame was truncated
+    std::function<void(const QString&)> mLogger;
+};
+
+#endif // SHARDLINK_H
@@ -0,0 +1,593 @@
+// 2dsim08/shardnode.cpp - Sharded multi-process world: shard layout, shard process, coordinator
+#include "shardnode.h"
+#include "mainwindow.h"
+#include "cputopology.h"
+#include "simtrace.h"
+#include "autotuner.h"
+#include "scenario.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QThread>
+#include <climits>
+#include <cstdio>
+
+// === Shard Layout ===
+ShardLayout::ShardLayout()
+    : cols(1)
+    , rows(1)
+    , worldWidth(MainWindow::WORLD_SCENE_WIDTH)
+    , worldHeight(MainWindow::WORLD_SCENE_HEIGHT)
+{
+}
+
+bool ShardLayout::parse(const QString& spec, ShardLayout* layout) {
+    QStringList parts = spec.toLower().split('x');
+    if (parts.size() != 2) return false;
+
+    bool colsOk = false, rowsOk = false;
+    int cols = parts[0].toInt(&colsOk);
+    int rows = parts[1].toInt(&rowsOk);
+    if (!colsOk || !rowsOk || cols < 1 || rows < 1) return false;
+    if (cols > maxCount() / rows) return false;
+
+    layout->cols = cols;
+    layout->rows = rows;
+    return true;
+}
+
+int ShardLayout::maxCount() {
+    // Shard N hands out IDs 1 + N * SHARD_ID_STRIDE up to (N + 1) * SHARD_ID_STRIDE
+    return static_cast<int>(INT_MAX / ShardNode::SHARD_ID_STRIDE);
+}
+
+QRectF ShardLayout::region(int shard) const {
+    qreal width = static_cast<qreal>(worldWidth) / cols;
+    qreal height = static_cast<qreal>(worldHeight) / rows;
+    return QRectF((shard % cols) * width, (shard / cols) * height, width, height);
+}
+
+int ShardLayout::shardAt(qreal x, qreal y) const {
+    int col = qBound(0, static_cast<int>(x * cols / worldWidth), cols - 1);
+    int row = qBound(0, static_cast<int>(y * rows / worldHeight), rows - 1);
+    return row * cols + col;
+}
+
+QVector<int> ShardLayout::neighbors(int shard) const {
+    QVector<int> result;
+    int col = shard % cols;
+    int row = shard / cols;
+    for (int dr = -1; dr <= 1; dr++) {
+        for (int dc = -1; dc <= 1; dc++) {
+            int c = col + dc;
+            int r = row + dr;
+            if ((dc || dr) && c >= 0 && c < cols && r >= 0 && r < rows) {
+                result.push_back(r * cols + c);
+            }
+        }
+    }
+    return result;
+}
+
+int ShardLayout::nextHop(int from, int to) const {
+    // Diagonal steps are allowed, so any shard is at most max(dCol, dRow) hops away
+    int col = from % cols;
+    int row = from / cols;
+    int dc = (to % cols > col) - (to % cols < col);
+    int dr = (to / cols > row) - (to / cols < row);
+    return (row + dr) * cols + (col + dc);
+}
+
+// === Creature Transfer ===
+static ShardCreatureRecord toRecord(const SimpleCreature* creature) {
+    ShardCreatureRecord record;
+    record.posX = creature->posX;
+    record.posY = creature->posY;
+    record.newX = creature->newX;
+    record.newY = creature->newY;
+    record.speed = creature->speed;
+    record.originalSpeed = creature->originalSpeed;
+    record.size = creature->size;
+    record.alphaTargetX = creature->alphaTargetX;
+    record.alphaTargetY = creature->alphaTargetY;
+    record.herdingRange = creature->herdingRange;
+    record.elbowRoomRange = creature->elbowRoomRange;
+    record.wanderTargetX = creature->wanderTargetX;
+    record.wanderTargetY = creature->wanderTargetY;
+    record.uniqueID = creature->uniqueID;
+    record.alphaID = creature->myAlpha ? creature->myAlpha->uniqueID : 0;
+    record.alphaRestingTime = creature->alphaRestingTime;
+    record.restingTimeLeft = creature->restingTimeLeft;
+    record.rgba = creature->color.rgba();
+    record.state = static_cast<quint8>(creature->state);
+    record.isAlpha = creature->isAlpha ? 1 : 0;
+    record.exists = creature->exists ? 1 : 0;
+    record.reserved = 0;
+    return record;
+}
+
+static SimpleCreature* fromRecord(const ShardCreatureRecord& record) {
+    SimpleCreature* creature = new SimpleCreature;
+    creature->posX = record.posX;
+    creature->posY = record.posY;
+    creature->newX = record.newX;
+    creature->newY = record.newY;
+    creature->speed = record.speed;
+    creature->originalSpeed = record.originalSpeed;
+    creature->size = record.size;
+    creature->isAlpha = record.isAlpha != 0;
+    creature->myAlpha = nullptr;               // Re-linked by the caller
+    creature->alphaTargetX = record.alphaTargetX;
+    creature->alphaTargetY = record.alphaTargetY;
+    creature->alphaRestingTime = record.alphaRestingTime;
+    creature->herdTarget = nullptr;
+    creature->hasHerdTarget = false;
+    creature->restingTimeLeft = record.restingTimeLeft;
+    creature->herdingRange = record.herdingRange;
+    creature->elbowRoomRange = record.elbowRoomRange;
+    creature->wanderTargetX = record.wanderTargetX;
+    creature->wanderTargetY = record.wanderTargetY;
+    creature->graphicsItem = nullptr;
+    creature->color = QColor::fromRgba(record.rgba);
+    creature->state = static_cast<CreatureState>(record.state);
+    creature->exists = record.exists != 0;
+    creature->uniqueID = record.uniqueID;
+    return creature;
+}
+
+// === Shard Process ===
+ShardNode::ShardNode(QObject* parent)
+    : QObject(parent)
+    , mThreadPool(nullptr)
+    , mWorld(nullptr)
+    , mMetricsServer(nullptr)
+    , mMigratedOut(0)
+    , mMigratedIn(0)
+    , mExchangeNs(0)
+    , mReportedTunings(0)
+{
+    connect(&mTickTimer, &QTimer::timeout, this, &ShardNode::tickOnce);
+}
+
+ShardNode::~ShardNode() {
+    mTickTimer.stop();
+    delete mMetricsServer;
+    for (auto& neighbor : mNeighbors) {
+        delete neighbor.outgoing;
+        delete neighbor.incoming;
+    }
+    delete mWorld;
+}
+
+QString ShardNode::metricsAddress(const QString& base, int shard) {
+    bool isPort = false;
+    int port = base.toInt(&isPort);
+    return isPort ? QString::number(port + shard) : QString("%1.%2").arg(base).arg(shard);
+}
+
+QString ShardNode::feedName(const QString& base, int shard) {
+    return QString("%1_%2").arg(base).arg(shard);
+}
+
+bool ShardNode::start(const ShardNodeConfig& config) {
+    mConfig = config;
+    mRegion = config.layout.region(config.shard);
+    const int shardCount = config.layout.count();
+
+    mThreadPool = new QThreadPool(this);
+    mThreadPool->setMaxThreadCount(qMax(1, config.threads));
+
+    // Each shard pins to its own slice of the CPU order, so shards don't share cores
+    CpuTopology topology = CpuTopology::detect();
+    QString pinError;
+    QVector<int> pinnedCpus = topology.selectCpus(config.pinPolicy, mThreadPool->maxThreadCount(),
+                                                  config.shard, shardCount, &pinError);
+    if (!pinnedCpus.isEmpty()) {
+        setWorkerCpus(pinnedCpus);
+        mThreadPool->setExpiryTimeout(-1);
+    }
+    if (config.shard == 0) {
+        for (const QString& line : topology.report()) {
+            log(line);
+        }
+        log(QString("Kinematics: %1, %2 bytes per creature").arg(SIM_PRECISION_NAME).arg(sizeof(SimpleCreature)));
+        log(QString("World %1x%2, kernels %3").arg(config.params.worldWidth).arg(config.params.worldHeight)
+            .arg(kernelProfileName(kernelProfileFor(config.params))));
+    }
+    if (!pinError.isEmpty()) {
+        log(QString("Worker pinning: %1").arg(pinError));
+    }
+    if (!pinnedCpus.isEmpty()) {
+        log(QString("Worker pinning (%1): cpus %2").arg(config.pinPolicy).arg(CpuTopology::formatCpuList(pinnedCpus)));
+    }
+
+    // Identical terrain everywhere; creatures spawn inside this shard with a disjoint ID block
+    mWorld = new SimWorld(mThreadPool);
+    mWorld->setParams(config.params);
+    mWorld->setRegion(mRegion);
+    mWorld->setUniqueIDBase(static_cast<int>(1 + config.shard * SHARD_ID_STRIDE));
+    mWorld->setLogger([this](const QString& text) { log(text); });
+    mWorld->setPrecisionCheck(config.validatePrecision);
+    mWorld->setTickBudget(config.tickIntervalMs * 1000);
+    mWorld->setAutoTune(config.autoTune);
+    mWorld->setupTerrain(config.seed);
+
+    int creatures = config.creatures / shardCount + (config.shard < config.creatures % shardCount ? 1 : 0);
+    mWorld->setupCreatures(creatures, config.seed + 7919u * (config.shard + 1));
+
+    // Owned creatures plus about as many ghosts; beyond that the view grows
+    mView.setLogger([this](const QString& text) { log(text); });
+    if (!mView.create(shardViewKey(config.runId, config.shard), ShardView::capacityFor(2 * creatures))) {
+        log(mView.errorString());
+        return false;
+    }
+
+    // Create every outgoing ring before waiting on incoming ones, so startup can't deadlock
+    for (int shard : config.layout.neighbors(config.shard)) {
+        Neighbor neighbor;
+        neighbor.shard = shard;
+        neighbor.sent = false;
+        neighbor.received = false;
+        neighbor.haloRegion = config.layout.region(shard).adjusted(-SHARD_HALO_WIDTH, -SHARD_HALO_WIDTH,
+                                                                   SHARD_HALO_WIDTH, SHARD_HALO_WIDTH);
+        neighbor.outgoing = new ShardLink;
+        neighbor.incoming = new ShardLink;
+        mNeighbors.push_back(neighbor);
+
+        if (!neighbor.outgoing->create(shardLinkKey(config.runId, config.shard, shard), SHARD_LINK_BYTES)) {
+            log(neighbor.outgoing->errorString());
+            return false;
+        }
+    }
+    for (auto& neighbor : mNeighbors) {
+        if (!neighbor.incoming->attach(shardLinkKey(config.runId, neighbor.shard, config.shard), SHARD_ATTACH_TIMEOUT_MS)) {
+            log(neighbor.incoming->errorString());
+            return false;
+        }
+    }
+
+    if (!config.metrics.isEmpty()) {
+        QString address = metricsAddress(config.metrics, config.shard);
+        QString error;
+        mMetrics.setLabels(QString("shard=\"%1\"").arg(config.shard));
+        mMetricsServer = new MetricsServer(&mMetrics);
+        if (!mMetricsServer->listen(address, &error)) {
+            log(QString("Metrics: cannot listen on %1: %2").arg(address, error));
+            return false;
+        }
+        log(QString("Metrics: serving Prometheus text on %1").arg(address));
+    }
+
+    if (!config.feed.isEmpty()) {
+        // Herds gather, so a shard may briefly hold well over its share; beyond that the feed grows
+        const int capacity = qMin(config.creatures, 2 * (config.creatures / shardCount + 1));
+        const QString name = feedName(config.feed, config.shard);
+        QString error;
+        mFeed.setLogger([this](const QString& text) { log(text); });
+        if (!mFeed.create(name, capacity, mRegion, config.shard, &error)) {
+            log(QString("Feed: %1").arg(error));
+            return false;
+        }
+        log(QString("Feed: publishing every tick to shared memory %1").arg(name));
+    }
+
+    if (config.trace) {
+        SimTrace::setEnabled(true);
+    }
+
+    log(QString("Region (%1,%2) %3x%4, %5 creatures, %6 neighbors, %7 threads")
+        .arg(mRegion.x()).arg(mRegion.y()).arg(mRegion.width()).arg(mRegion.height())
+        .arg(mWorld->creatures().size()).arg(mNeighbors.size()).arg(mThreadPool->maxThreadCount()));
+
+    publishView();
+    mTickTimer.start(config.tickIntervalMs);
+    return true;
+}
+
+void ShardNode::tickOnce() {
+    mWorld->tick();
+    const AutoTuner* tuner = mWorld->autoTuner();
+    if (tuner && tuner->tunings() != mReportedTunings) {
+        mReportedTunings = tuner->tunings();
+        log(QString("Auto-tune: %1").arg(tuner->describe()));
+    }
+    if (mMetricsServer) {
+        mMetrics.recordTick(*mWorld, mThreadPool->maxThreadCount());
+        mMetrics.setFeedTruncated(mFeed.truncated());
+    }
+
+    QElapsedTimer exchangeTimer;
+    exchangeTimer.start();
+    if (!exchange()) {
+        finish(1);
+        return;
+    }
+    mExchangeNs += exchangeTimer.nsecsElapsed();
+
+    publishView();
+    mFeed.publish(*mWorld);
+
+    qint64 tick = mWorld->tickCount();
+    if (tick % SHARD_STATS_INTERVAL == 0) {
+        log(QString("Tick %1: %2 creatures, migrated out %3 / in %4, exchange avg %5 us")
+            .arg(tick).arg(mWorld->creatures().size()).arg(mMigratedOut).arg(mMigratedIn)
+            .arg(mExchangeNs / 1000 / tick));
+    }
+
+    if (mConfig.ticks > 0 && tick >= mConfig.ticks) {
+        finish(0);
+    }
+}
+
+bool ShardNode::exchange() {
+    TraceScope trace("exchange");
+    collectOutgoing();
+
+    for (auto& neighbor : mNeighbors) {
+        neighbor.outgoing->stage(neighbor.message);
+        neighbor.sent = false;
+        neighbor.received = false;
+    }
+
+    // Send and receive in turns until every part is through: a message too big for one ring
+    // goes out as its consumer drains it, so neighbors never wait on each other in a cycle
+    int pending = 2 * mNeighbors.size();
+    int idleRounds = 0;
+    QElapsedTimer idle;
+    idle.start();
+    while (pending > 0) {
+        bool progressed = false;
+        for (auto& neighbor : mNeighbors) {
+            if (!neighbor.sent) {
+                const qint64 before = neighbor.outgoing->bytesPublished();
+                if (!neighbor.outgoing->publishSome(&neighbor.sent)) {
+                    log(QString("Link to shard %1: %2").arg(neighbor.shard).arg(neighbor.outgoing->errorString()));
+                    return false;
+                }
+                progressed |= neighbor.outgoing->bytesPublished() != before;
+                pending -= neighbor.sent ? 1 : 0;
+            }
+            if (!neighbor.received) {
+                const qint64 before = neighbor.incoming->bytesConsumed();
+                if (!neighbor.incoming->consumeSome(&neighbor.incomingMessage, &neighbor.received)) {
+                    log(QString("Link from shard %1: %2").arg(neighbor.shard).arg(neighbor.incoming->errorString()));
+                    return false;
+                }
+                progressed |= neighbor.incoming->bytesConsumed() != before;
+                pending -= neighbor.received ? 1 : 0;
+            }
+        }
+        if (pending == 0) break;
+
+        // Neighbors usually finish within microseconds of each other: spin briefly, then sleep
+        if (progressed) {
+            idleRounds = 0;
+            idle.restart();
+        } else if (idle.elapsed() > SHARD_EXCHANGE_TIMEOUT_MS) {
+            for (const auto& neighbor : mNeighbors) {
+                if (!neighbor.sent || !neighbor.received) {
+                    log(QString("Link with shard %1: timed out (%2)").arg(neighbor.shard)
+                        .arg(neighbor.sent ? "waiting for its tick" : "waiting for it to read"));
+                }
+            }
+            return false;
+        } else if (++idleRounds < SHARD_EXCHANGE_SPINS) {
+            QThread::yieldCurrentThread();
+        } else {
+            QThread::msleep(1);
+        }
+    }
+
+    for (auto& neighbor : mNeighbors) {
+        ShardMessage& incoming = neighbor.incomingMessage;
+        if (incoming.tick != mWorld->tickCount()) {
+            log(QString("Shard %1 is at tick %2, expected %3").arg(neighbor.shard).arg(incoming.tick).arg(mWorld->tickCount()));
+            return false;
+        }
+        neighbor.ghosts.swap(incoming.ghosts);
+        applyIncoming(incoming);
+    }
+    return true;
+}
+
+void ShardNode::collectOutgoing() {
+    QHash<int, int> neighborSlot;
+    for (int n = 0; n < mNeighbors.size(); n++) {
+        Neighbor& neighbor = mNeighbors[n];
+        neighbor.message.tick = mWorld->tickCount();
+        neighbor.message.ghosts.clear();
+        neighbor.message.migrants.clear();
+        neighborSlot.insert(neighbor.shard, n);
+    }
+
+    // A herd belongs to the shard holding its alpha; alphas that left send the whole herd
+    // one hop toward their new shard (it keeps moving on later ticks if it's further away)
+    const QVector<SimpleCreature*>& creatures = mWorld->creatures();
+    QHash<const SimpleCreature*, int> leavingAlphas;
+    for (auto* creature : creatures) {
+        if (creature->isAlpha && !mRegion.contains(creature->posX, creature->posY)) {
+            int target = mConfig.layout.shardAt(creature->posX, creature->posY);
+            if (target != mConfig.shard) {
+                leavingAlphas.insert(creature, neighborSlot.value(mConfig.layout.nextHop(mConfig.shard, target)));
+            }
+        }
+    }
+
+    QVector<int> departing;
+    for (int i = 0; i < creatures.size(); i++) {
+        const SimpleCreature* creature = creatures[i];
+        const SimpleCreature* alpha = creature->isAlpha ? creature : creature->myAlpha;
+
+        auto leaving = alpha ? leavingAlphas.constFind(alpha) : leavingAlphas.constEnd();
+        if (leaving != leavingAlphas.constEnd()) {
+            mNeighbors[leaving.value()].message.migrants.push_back(toRecord(creature));
+            departing.push_back(i);
+            continue;
+        }
+
+        // Halo: anything near a neighbor's border is mirrored there read-only
+        for (auto& neighbor : mNeighbors) {
+            if (neighbor.haloRegion.contains(creature->posX, creature->posY)) {
+                neighbor.message.ghosts.push_back(SimWorld::trajectoryCreature(creature));
+            }
+        }
+    }
+
+    // Highest index first: swap-remove only ever pulls in creatures that are staying
+    for (int i = departing.size() - 1; i >= 0; i--) {
+        delete mWorld->takeCreature(departing[i]);
+    }
+    mMigratedOut += departing.size();
+}
+
+void ShardNode::applyIncoming(const ShardMessage& message) {
+    if (message.migrants.isEmpty()) return;
+
+    // Alphas always travel with their herd, so every follower's alpha is in the same message
+    QHash<int, SimpleCreature*> arrivedAlphas;
+    QVector<QPair<SimpleCreature*, int>> followers;
+    for (const auto& record : message.migrants) {
+        SimpleCreature* creature = fromRecord(record);
+        mWorld->addCreature(creature);
+        if (creature->isAlpha) {
+            arrivedAlphas.insert(creature->uniqueID, creature);
+        } else {
+            followers.push_back(qMakePair(creature, record.alphaID));
+        }
+    }
+    for (auto& follower : followers) {
+        follower.first->myAlpha = arrivedAlphas.value(follower.second, nullptr);  // Missing = orphan
+    }
+
+    mMigratedIn += message.migrants.size();
+}
+
+void ShardNode::publishView() {
+    mWorld->snapshot(&mViewFrame);
+
+    ShardViewInfo info;
+    info.shard = mConfig.shard;
+    info.regionX = mRegion.x();
+    info.regionY = mRegion.y();
+    info.regionWidth = mRegion.width();
+    info.regionHeight = mRegion.height();
+    info.ownedCount = mViewFrame.creatures.size();
+
+    for (const auto& neighbor : mNeighbors) {
+        mViewFrame.creatures += neighbor.ghosts;
+    }
+    mView.publish(info, mViewFrame);
+}
+
+void ShardNode::finish(int exitCode) {
+    mTickTimer.stop();
+    log(QString("Stopped at tick %1: %2 creatures, migrated out %3 / in %4")
+        .arg(mWorld->tickCount()).arg(mWorld->creatures().size()).arg(mMigratedOut).arg(mMigratedIn));
+    if (mConfig.trace) {
+        QString path = QDir::current().filePath(QString("traces/run%1_shard%2.json").arg(mConfig.runId).arg(mConfig.shard));
+        QString error;
+        log(SimTrace::exportWindow(path, SimTrace::TRACE_WINDOW_MS, &error) ? QString("Trace: saved %1").arg(path)
+                                                                             : QString("Trace: %1").arg(error));
+    }
+    QCoreApplication::exit(exitCode);
+}
+
+void ShardNode::log(const QString& text) {
+    std::printf("[shard %d] %s\n", mConfig.shard, qPrintable(text));
+    std::fflush(stdout);
+}
+
+// === Coordinator ===
+ShardCoordinator::ShardCoordinator(QObject* parent)
+    : QObject(parent)
+    , mRunning(0)
+    , mFailed(0)
+{
+}
+
+ShardCoordinator::~ShardCoordinator() {
+    for (auto* process : mProcesses) {
+        if (process->state() != QProcess::NotRunning) {
+            process->kill();
+            process->waitForFinished(1000);
+        }
+    }
+}
+
+bool ShardCoordinator::start(const ShardNodeConfig& config) {
+    mConfig = config;
+    const int shardCount = config.layout.count();
+
+    std::printf("Coordinator: run %s, %s shards, %d creatures, seed %u\n",
+                qPrintable(config.runId), qPrintable(config.layout.toString()), config.creatures, config.seed);
+
+    for (int shard = 0; shard < shardCount; shard++) {
+        QStringList arguments;
+        arguments << "--shard-node" << QString::number(shard)
+                  << "--shards" << config.layout.toString()
+                  << "--run" << config.runId
+                  << "--creatures" << QString::number(config.creatures)
+                  << "--seed" << QString::number(config.seed)
+                  << "--ticks" << QString::number(config.ticks)
+                  << "--tick-ms" << QString::number(config.tickIntervalMs)
+                  << "--threads" << QString::number(config.threads)
+                  << "--pin-workers" << config.pinPolicy;
+        if (config.validatePrecision) {
+            arguments << "--validate-precision";
+        }
+        if (!config.metrics.isEmpty()) {
+            arguments << "--metrics" << config.metrics;
+        }
+        if (!config.feed.isEmpty()) {
+            arguments << "--publish" << config.feed;
+        }
+        if (config.trace) {
+            arguments << "--trace";
+        }
+        if (!config.autoTune) {
+            arguments << "--no-autotune";
+        }
+        arguments << Scenario::arguments(config.params);
+
+        QProcess* process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                this, &ShardCoordinator::shardFinished);
+        mProcesses.push_back(process);
+
+        process->start(QCoreApplication::applicationFilePath(), arguments);
+        if (!process->waitForStarted()) {
+            std::printf("Coordinator: shard %d failed to start\n", shard);
+            return false;
+        }
+        mRunning++;
+    }
+
+    std::printf("Coordinator: attach a viewer with  %s --attach-shard <0-%d> --run %s\n",
+                qPrintable(QCoreApplication::applicationFilePath()), shardCount - 1, qPrintable(config.runId));
+    std::fflush(stdout);
+    return true;
+}
+
+void ShardCoordinator::shardFinished(int exitCode, QProcess::ExitStatus status) {
+    mRunning--;
+    if (exitCode != 0 || status != QProcess::NormalExit) {
+        mFailed++;
+
+        // Neighbors of a dead shard would only time out; stop the whole run now
+        for (auto* process : mProcesses) {
+            if (process->state() != QProcess::NotRunning) {
+                process->terminate();
+            }
+        }
+    }
+
+    if (mRunning == 0) {
+        std::printf("Coordinator: all shards stopped (%d failed)\n", mFailed);
+        std::fflush(stdout);
+        QCoreApplication::exit(mFailed ? 1 : 0);
+    }
+}
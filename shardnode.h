@@ -0,0 +1,149 @@
+// 2dsim08/shardnode.h - Sharded multi-process world: shard layout, shard process, coordinator
+#ifndef SHARDNODE_H
+#define SHARDNODE_H
+
+#include "simworld.h"
+#include "shardlink.h"
+#include "metrics.h"
+#include "worldfeed.h"
+#include <QObject>
+#include <QProcess>
+#include <QRectF>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+// === Shard Layout ===
+// The world split into cols x rows equal rectangles; shard index = row * cols + col.
+// Neighbors are the (up to) eight surrounding shards.
+struct ShardLayout {
+    int cols;
+    int rows;
+    int worldWidth;          // The scenario's world (SimParams::worldWidth)
+    int worldHeight;
+
+    ShardLayout();
+    static bool parse(const QString& spec, ShardLayout* layout);   // "3x2"; at most maxCount() shards
+    static int maxCount();               // Shards whose unique ID blocks all fit in an int
+    QString toString() const { return QString("%1x%2").arg(cols).arg(rows); }
+
+    int count() const { return cols * rows; }
+    QRectF region(int shard) const;
+    int shardAt(qreal x, qreal y) const;                  // Clamped to the grid
+    QVector<int> neighbors(int shard) const;
+    int nextHop(int from, int to) const;                  // Neighbor one step toward `to`
+};
+
+struct ShardNodeConfig {
+    QString runId;
+    ShardLayout layout;
+    int shard;
+    int creatures;           // Whole-world creature count, split evenly between shards
+    quint32 seed;            // Same on every shard (terrain must match across borders)
+    qint64 ticks;            // 0 = run until stopped
+    int tickIntervalMs;      // 0 = as fast as the slowest neighbor allows
+    SimParams params;        // Scenario; the coordinator forwards what differs from the defaults
+    int threads;
+    QString pinPolicy;       // See CpuTopology::selectCpus
+    bool validatePrecision;  // Run SimWorld's double-precision check alongside the kernel
+    QString metrics;         // Base port or socket path; shard N serves port + N or path.N
+    QString feed;            // Shared-memory feed base name; shard N publishes name_N
+    bool trace;              // Write the last SimTrace window to traces/ on exit
+    bool autoTune;           // Let the AutoTuner pick the update plan
+
+    ShardNodeConfig() : shard(0), creatures(0), seed(0), ticks(0), tickIntervalMs(20), threads(1), pinPolicy("none"),
+                        validatePrecision(false), trace(false), autoTune(true) {}
+};
+
+// === Shard Process ===
+// Simulates the herds whose alpha is inside its region. After every tick it exchanges one
+// message with each neighbor (halo ghosts + migrating herds), then publishes its view.
+// Shards run in lockstep: a shard cannot start tick N+1 until every neighbor finished tick N.
+class ShardNode : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ShardNode(QObject* parent = nullptr);
+    ~ShardNode();
+
+    bool start(const ShardNodeConfig& config);
+
+    // === Sharding ===
+    static const int SHARD_HALO_WIDTH = 2500;                 // Border band mirrored to neighbors
+    static const int SHARD_LINK_BYTES = 16 * 1024 * 1024;     // Per directed link
+    static const int SHARD_ATTACH_TIMEOUT_MS = 30000;         // Waiting for neighbors to start
+    static const int SHARD_EXCHANGE_TIMEOUT_MS = 10000;       // Waiting for a neighbor's tick
+    static const int SHARD_EXCHANGE_SPINS = 2000;             // Idle rounds that yield before sleeping
+    static const int SHARD_STATS_INTERVAL = 250;              // Ticks between progress lines
+    static const quint32 SHARD_ID_STRIDE = 1u << 24;          // Unique ID block per shard
+
+    static QString metricsAddress(const QString& base, int shard);
+    static QString feedName(const QString& base, int shard);
+
+private slots:
+    void tickOnce();
+
+private:
+    struct Neighbor {
+        int shard;
+        QRectF haloRegion;       // Its region grown by the halo width
+        ShardLink* outgoing;
+        ShardLink* incoming;
+        ShardMessage message;
+        ShardMessage incomingMessage;
+        bool sent;               // This tick's exchange: every part out / in
+        bool received;
+        QVector<TrajectoryCreature> ghosts;   // Last ghosts received from it
+    };
+
+    bool exchange();
+    void collectOutgoing();
+    void applyIncoming(const ShardMessage& message);
+    void publishView();
+    void finish(int exitCode);
+    void log(const QString& text);
+
+    ShardNodeConfig mConfig;
+    QRectF mRegion;
+    QThreadPool* mThreadPool;
+    SimWorld* mWorld;
+    QVector<Neighbor> mNeighbors;
+    ShardView mView;
+    QTimer mTickTimer;
+    TrajectoryFrame mViewFrame;
+    SimMetrics mMetrics;
+    MetricsServer* mMetricsServer;
+    WorldFeed mFeed;
+
+    // === Stats ===
+    qint64 mMigratedOut;
+    qint64 mMigratedIn;
+    qint64 mExchangeNs;
+    int mReportedTunings;
+};
+
+// === Coordinator ===
+// Spawns one shard process per region on this machine and waits for them. Shard output is
+// forwarded to the coordinator's terminal; if one shard fails the others are stopped.
+class ShardCoordinator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ShardCoordinator(QObject* parent = nullptr);
+    ~ShardCoordinator();
+
+    bool start(const ShardNodeConfig& config);   // shard field ignored
+
+private slots:
+    void shardFinished(int exitCode, QProcess::ExitStatus status);
+
+private:
+    ShardNodeConfig mConfig;
+    QVector<QProcess*> mProcesses;
+    int mRunning;
+    int mFailed;
+};
+
+#endif // SHARDNODE_H
@@ -0,0 +1,60 @@
+// 2dsim08/simarena.cpp - Bump arenas for per-tick scratch data
+#include "simarena.h"
+#include "memorystats.h"
+#include <cstdlib>
+
+TickArena::TickArena()
+    : mCurrent(0)
+    , mOffset(0)
+    , mUsed(0)
+    , mHighWater(0)
+{
+}
+
+TickArena::~TickArena() {
+    for (const Block& block : mBlocks) {
+        std::free(block.data);
+        MemoryStats::freed(MEMORY_ARENAS, block.size);
+    }
+}
+
+void* TickArena::allocate(size_t bytes, size_t alignment) {
+    // Current block first, then any later block already held, then a new one (warm-up only)
+    while (mCurrent < mBlocks.size()) {
+        const Block& block = mBlocks[mCurrent];
+        size_t start = (reinterpret_cast<quintptr>(block.data) + mOffset + alignment - 1) & ~(alignment - 1);
+        size_t offset = start - reinterpret_cast<quintptr>(block.data);
+        if (offset + bytes <= block.size) {
+            mUsed += offset + bytes - mOffset;
+            mOffset = offset + bytes;
+            mHighWater = qMax(mHighWater, mUsed);
+            return block.data + offset;
+        }
+        mUsed += block.size - mOffset;
+        mCurrent++;
+        mOffset = 0;
+    }
+
+    Block block;
+    block.size = qMax<size_t>(ARENA_BLOCK_BYTES, bytes + alignment);
+    block.data = static_cast<char*>(std::malloc(block.size));
+    if (!block.data) throw std::bad_alloc();
+    MemoryStats::allocated(MEMORY_ARENAS, block.size);
+    mBlocks.push_back(block);
+    mCurrent = mBlocks.size() - 1;
+    return allocate(bytes, alignment);
+}
+
+void TickArena::reset() {
+    mCurrent = 0;
+    mOffset = 0;
+    mUsed = 0;
+}
+
+size_t TickArena::capacity() const {
+    size_t bytes = 0;
+    for (const Block& block : mBlocks) {
+        bytes += block.size;
+    }
+    return bytes;
+}
@@ -0,0 +1,104 @@
+// 2dsim08/simarena.h - Bump arenas for per-tick scratch data
+#ifndef SIMARENA_H
+#define SIMARENA_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// === Tick Arena ===
+// Hands out memory by bumping an offset; reset() rewinds to the start and keeps every block,
+// so after the first few ticks have sized it, scratch data costs no heap allocations at all.
+// One thread at a time. Nothing is destroyed by reset(): store trivially destructible data,
+// or destroy what you created before the reset.
+class TickArena
+{
+public:
+    static const int ARENA_BLOCK_BYTES = 64 * 1024;
+
+    TickArena();
+    ~TickArena();
+
+    void* allocate(size_t bytes, size_t alignment);
+    void reset();
+    size_t capacity() const;          // Bytes held in blocks
+    size_t highWater() const { return mHighWater; }   // Most bytes in use at once
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    T* createArray(int count) {
+        T* items = static_cast<T*>(allocate(sizeof(T) * qMax(count, 1), alignof(T)));
+        for (int i = 0; i < count; i++) {
+            new (&items[i]) T();
+        }
+        return items;
+    }
+
+private:
+    TickArena(const TickArena&);
+    TickArena& operator=(const TickArena&);
+
+    struct Block {
+        char* data;
+        size_t size;
+    };
+    QVector<Block> mBlocks;
+    int mCurrent;            // Block being bumped
+    size_t mOffset;          // Into the current block
+    size_t mUsed;            // Since the last reset (including skipped block tails)
+    size_t mHighWater;
+};
+
+// === Arena Vector ===
+// Growable array of trivially copyable items in a TickArena. Growing copies into a fresh
+// arena slice and abandons the old one until the arena resets.
+template <typename T>
+class ArenaVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaVector items are copied with memcpy");
+
+public:
+    explicit ArenaVector(TickArena* arena = nullptr) : mArena(arena), mData(nullptr), mSize(0), mCapacity(0) {}
+
+    void setArena(TickArena* arena) { mArena = arena; mData = nullptr; mSize = 0; mCapacity = 0; }
+    void push_back(const T& item) {
+        if (mSize == mCapacity) grow(mCapacity ? mCapacity * 2 : 64);
+        mData[mSize++] = item;
+    }
+    void append(const ArenaVector& other) {
+        if (mSize + other.mSize > mCapacity) grow(qMax(mSize + other.mSize, mCapacity * 2));
+        if (other.mSize) std::memcpy(mData + mSize, other.mData, sizeof(T) * other.mSize);
+        mSize += other.mSize;
+    }
+    void clear() { mSize = 0; }
+    int size() const { return mSize; }
+    bool isEmpty() const { return mSize == 0; }
+    T& operator[](int index) { return mData[index]; }
+    const T& operator[](int index) const { return mData[index]; }
+    T* begin() { return mData; }
+    T* end() { return mData + mSize; }
+    const T* begin() const { return mData; }
+    const T* end() const { return mData + mSize; }
+
+private:
+    void grow(int capacity) {
+        T* data = static_cast<T*>(mArena->allocate(sizeof(T) * capacity, alignof(T)));
+        if (mSize) std::memcpy(data, mData, sizeof(T) * mSize);
+        mData = data;
+        mCapacity = capacity;
+    }
+
+    TickArena* mArena;
+    T* mData;
+    int mSize;
+    int mCapacity;
+};
+
+#endif // SIMARENA_H
@@ -0,0 +1,147 @@
+// 2dsim08/simtrace.cpp - Opt-in span tracer with per-thread lock-free buffers and Chrome trace export
+#include "simtrace.h"
+#include "memorystats.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <chrono>
+#include <memory>
+
+std::atomic<bool> SimTrace::sEnabled(false);
+
+struct TraceEvent {
+    const char* name;
+    qint64 startNs;
+    qint64 endNs;
+    int arg;
+};
+
+// One per recording thread, never freed (a pool thread may expire while its spans are still
+// worth exporting). head counts every event ever written; slot = head % capacity.
+struct TraceBuffer {
+    QString threadName;
+    int threadIndex;
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<quint64> head;
+
+    TraceBuffer() : threadIndex(0), events(new TraceEvent[SimTrace::TRACE_BUFFER_EVENTS]), head(0) {}
+};
+
+static QMutex sBuffersMutex;                // Registration and export only
+static QVector<TraceBuffer*> sBuffers;
+static thread_local TraceBuffer* tBuffer = nullptr;
+
+static TraceBuffer* threadBuffer() {
+    if (!tBuffer) {
+        TraceBuffer* buffer = new TraceBuffer;
+        MemoryStats::allocated(MEMORY_LOGS, sizeof(TraceBuffer) + sizeof(TraceEvent) * SimTrace::TRACE_BUFFER_EVENTS);
+        QThread* thread = QThread::currentThread();
+        bool isMain = QCoreApplication::instance() && thread == QCoreApplication::instance()->thread();
+
+        QMutexLocker locker(&sBuffersMutex);
+        buffer->threadIndex = sBuffers.size();
+        buffer->threadName = isMain ? QString("main")
+                           : !thread->objectName().isEmpty() ? thread->objectName()
+                           : QString("worker %1").arg(buffer->threadIndex);
+        sBuffers.push_back(buffer);
+        tBuffer = buffer;
+    }
+    return tBuffer;
+}
+
+void SimTrace::setEnabled(bool enabled) {
+    sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 SimTrace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SimTrace::record(const char* name, qint64 startNs, qint64 endNs, int arg) {
+    TraceBuffer* buffer = threadBuffer();
+    quint64 head = buffer->head.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer->events[head & (TRACE_BUFFER_EVENTS - 1)];
+    event.name = name;
+    event.startNs = startNs;
+    event.endNs = endNs;
+    event.arg = arg;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+static void appendJsonString(QByteArray* out, const QString& text) {
+    out->append('"');
+    const QByteArray utf8 = text.toUtf8();
+    for (int i = 0; i < utf8.size(); i++) {
+        if (utf8[i] == '"' || utf8[i] == '\\') out->append('\\');
+        out->append(utf8[i]);
+    }
+    out->append('"');
+}
+
+bool SimTrace::exportWindow(const QString& path, qint64 windowMs, QString* error) {
+    const qint64 cutoff = now() - windowMs * 1000000;
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QVector<TraceBuffer*> buffers;
+    {
+        QMutexLocker locker(&sBuffersMutex);
+        buffers = sBuffers;
+    }
+
+    QByteArray json;
+    json.reserve(1 << 20);
+    json.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    int exported = 0;
+
+    QVector<TraceEvent> copy(TRACE_BUFFER_EVENTS);
+    for (TraceBuffer* buffer : buffers) {
+        json.append(first ? "" : ",\n");
+        first = false;
+        json.append(QString("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%1,\"tid\":%2,\"args\":{\"name\":")
+                    .arg(pid).arg(buffer->threadIndex).toUtf8());
+        appendJsonString(&json, buffer->threadName);
+        json.append("}}");
+
+        // Copy while the owner keeps writing, then drop whatever it may have overwritten meanwhile
+        quint64 end = buffer->head.load(std::memory_order_acquire);
+        quint64 begin = end > static_cast<quint64>(TRACE_BUFFER_EVENTS) ? end - TRACE_BUFFER_EVENTS : 0;
+        for (quint64 i = begin; i < end; i++) {
+            copy[static_cast<int>(i - begin)] = buffer->events[i & (TRACE_BUFFER_EVENTS - 1)];
+        }
+        quint64 after = buffer->head.load(std::memory_order_acquire);
+        quint64 valid = after > static_cast<quint64>(TRACE_BUFFER_EVENTS) ? after - TRACE_BUFFER_EVENTS : 0;
+
+        for (quint64 i = qMax(begin, valid); i < end; i++) {
+            const TraceEvent& event = copy[static_cast<int>(i - begin)];
+            if (event.endNs < cutoff) continue;
+            json.append(QString(",\n{\"ph\":\"X\",\"cat\":\"sim\",\"name\":\"%1\",\"pid\":%2,\"tid\":%3,\"ts\":%4,\"dur\":%5")
+                        .arg(QString::fromLatin1(event.name)).arg(pid).arg(buffer->threadIndex)
+                        .arg(event.startNs / 1000.0, 0, 'f', 3).arg((event.endNs - event.startNs) / 1000.0, 0, 'f', 3)
+                        .toUtf8());
+            if (event.arg >= 0) {
+                json.append(QString(",\"args\":{\"n\":%1}").arg(event.arg).toUtf8());
+            }
+            json.append('}');
+            exported++;
+        }
+    }
+    json.append("\n]}\n");
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+        *error = QString("%1: %2").arg(path, file.errorString());
+        return false;
+    }
+    if (exported == 0) {
+        *error = "no spans in the window (is tracing on?)";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,2017 @@
+// 2dsim08/simworld.cpp - Headless simulation core (creatures, terrain data, tick pipeline)
+#include "simworld.h"
+#include "mainwindow.h"
+#include "cputopology.h"
+#include "simtrace.h"
+#include "autotuner.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThread>
+#include <algorithm>
+#include <limits>
+#include <climits>
+#include <cmath>
+#include <atomic>
+#include <memory>
+
+// === Behavior Kernels (Alpha-Led Herding System) ===
+// One specialization per BehaviorBucket. step() updates one creature and returns the bucket
+// it belongs to next tick; the only branches left are the (rarely taken) state transitions.
+struct KernelContext {
+    const SimParams* params;
+    KernelProfile profile;      // Which build of the kernels runs (see Kernel Profiles)
+    PrecisionCheck* precisionCheck;
+    PrecisionStats* precisionStats;
+    bool deterministic;
+    quint64 tickKey;            // Deterministic worlds: hash of (seed, tick)
+};
+
+// splitmix64 finalizer: spreads any key over all 64 bits
+static inline quint64 mixRandomKey(quint64 z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Random draws inside the kernels (splitmix64). A deterministic world keys the stream on
+// (seed, tick, creature), so a draw never depends on which thread runs the creature or in
+// what order; otherwise each stream starts from the shared global generator.
+class KernelRandom {
+public:
+    KernelRandom(const KernelContext& context, const SimpleCreature* creature)
+        : mState(context.deterministic
+                 ? context.tickKey ^ (static_cast<quint64>(static_cast<quint32>(creature->uniqueID)) * 0xD1B54A32D192ED03ull)
+                 : QRandomGenerator::global()->generate64()) {}
+
+    int bounded(int highest) {
+        return static_cast<int>(((next() >> 32) * static_cast<quint64>(highest)) >> 32);
+    }
+
+private:
+    quint64 next() {
+        return mixRandomKey(mState += 0x9E3779B97F4A7C15ull);
+    }
+
+    quint64 mState;
+};
+
+// === Kernel Profiles ===
+// The knobs the kernels read for every creature. A FixedProfile holds them as compile-time
+// constants, so the world bounds, range divisors and rest spans fold into the instructions;
+// RuntimeProfile loads them from SimParams. Each KernelProfile gets its own instantiation of
+// the kernels, and the update task dispatches to it once per slice.
+template <int Width, int Height, int Footprint, int AlphaWander, int MinRest, int MaxRest, int AlphaMinRest, int AlphaMaxRest>
+struct FixedProfile {
+    static constexpr int worldWidth() { return Width; }
+    static constexpr int worldHeight() { return Height; }
+    static constexpr int herdFootprint() { return Footprint; }
+    static constexpr int alphaWanderDistance() { return AlphaWander; }
+    static constexpr int creatureMinRestTicks() { return MinRest; }
+    static constexpr int creatureMaxRestTicks() { return MaxRest; }
+    static constexpr int alphaMinRestTicks() { return AlphaMinRest; }
+    static constexpr int alphaMaxRestTicks() { return AlphaMaxRest; }
+
+    static bool matches(const SimParams& params) {
+        return params.worldWidth == Width && params.worldHeight == Height && params.herdFootprint == Footprint &&
+               params.alphaWanderDistance == AlphaWander && params.creatureMinRestTicks == MinRest &&
+               params.creatureMaxRestTicks == MaxRest && params.alphaMinRestTicks == AlphaMinRest &&
+               params.alphaMaxRestTicks == AlphaMaxRest;
+    }
+};
+
+// The scale profiles differ in world size only; the herd knobs are the defaults
+template <int Width, int Height>
+using ScaleProfile = FixedProfile<Width, Height, MainWindow::HERD_GROUP_FOOTPRINT_SIZE, MainWindow::ALPHA_NORMAL_WANDER_DISTANCE,
+                                  MainWindow::CREATURE_MIN_REST_TICKS, MainWindow::CREATURE_MAX_REST_TICKS,
+                                  MainWindow::ALPHA_MIN_REST_DURATION, MainWindow::ALPHA_MAX_REST_DURATION>;
+typedef ScaleProfile<MainWindow::WORLD_SCENE_WIDTH, MainWindow::WORLD_SCENE_HEIGHT> DefaultProfile;
+typedef ScaleProfile<MainWindow::LARGE_WORLD_WIDTH, MainWindow::LARGE_WORLD_HEIGHT> LargeProfile;
+typedef ScaleProfile<MainWindow::HUGE_WORLD_WIDTH, MainWindow::HUGE_WORLD_HEIGHT> HugeProfile;
+
+struct RuntimeProfile {
+    const SimParams* params;
+
+    int worldWidth() const { return params->worldWidth; }
+    int worldHeight() const { return params->worldHeight; }
+    int herdFootprint() const { return params->herdFootprint; }
+    int alphaWanderDistance() const { return params->alphaWanderDistance; }
+    int creatureMinRestTicks() const { return params->creatureMinRestTicks; }
+    int creatureMaxRestTicks() const { return params->creatureMaxRestTicks; }
+    int alphaMinRestTicks() const { return params->alphaMinRestTicks; }
+    int alphaMaxRestTicks() const { return params->alphaMaxRestTicks; }
+};
+
+KernelProfile kernelProfileFor(const SimParams& params) {
+    if (DefaultProfile::matches(params)) return KERNEL_PROFILE_DEFAULT;
+    if (LargeProfile::matches(params)) return KERNEL_PROFILE_LARGE;
+    if (HugeProfile::matches(params)) return KERNEL_PROFILE_HUGE;
+    return KERNEL_PROFILE_RUNTIME;
+}
+
+const char* kernelProfileName(KernelProfile profile) {
+    switch (profile) {
+        case KERNEL_PROFILE_DEFAULT: return "default (specialized)";
+        case KERNEL_PROFILE_LARGE: return "large (specialized)";
+        case KERNEL_PROFILE_HUGE: return "huge (specialized)";
+        default: return "runtime parameters";
+    }
+}
+
+template <typename Profile>
+static inline void keepInWorld(SimpleCreature* creature, const Profile& profile) {
+    creature->newX = qBound<SimReal>(0, creature->newX, profile.worldWidth());
+    creature->newY = qBound<SimReal>(0, creature->newY, profile.worldHeight());
+}
+
+// Returns true when the target is reached this tick
+template <typename Profile>
+static inline bool moveToward(int index, SimpleCreature* creature, SimReal targetX, SimReal targetY, KernelContext& context,
+                              const Profile& profile) {
+    SimReal nextX, nextY;
+    bool arrived = stepToward<SimReal>(creature->posX, creature->posY, targetX, targetY, creature->speed, &nextX, &nextY);
+    creature->newX = nextX;
+    creature->newY = nextY;
+    keepInWorld(creature, profile);
+    if (context.precisionCheck) {
+        context.precisionCheck->recordMove(index, creature, targetX, targetY, arrived, context.precisionStats);
+    }
+    return arrived;
+}
+
+static inline void holdStill(int index, SimpleCreature* creature, KernelContext& context) {
+    creature->newX = creature->posX;
+    creature->newY = creature->posY;
+    if (context.precisionCheck) {
+        context.precisionCheck->recordStill(index, creature);
+    }
+}
+
+// Uniform in [min, max); min when the range is empty
+template <typename Random>
+static inline int restTicks(Random& random, int min, int max) {
+    return max > min ? min + random.bounded(max - min) : min;
+}
+
+template <typename Profile>
+static inline void startResting(SimpleCreature* creature, KernelContext& context, const Profile& profile) {
+    KernelRandom random(context, creature);
+    creature->state = STATE_RESTING;
+    creature->restingTimeLeft = restTicks(random, profile.creatureMinRestTicks(), profile.creatureMaxRestTicks());
+}
+
+// Random point within +/- range of (x, y), kept inside the world
+template <typename Profile>
+static inline void pickTargetAround(qreal x, qreal y, int range, KernelRandom& random, SimScalar* targetX, SimScalar* targetY,
+                                    const Profile& profile) {
+    qreal offsetX = random.bounded(range * 2 + 1) - range;
+    qreal offsetY = random.bounded(range * 2 + 1) - range;
+    *targetX = qBound(0.0, x + offsetX, static_cast<qreal>(profile.worldWidth()));
+    *targetY = qBound(0.0, y + offsetY, static_cast<qreal>(profile.worldHeight()));
+}
+
+template <BehaviorBucket Bucket> struct BehaviorKernel;
+
+template <> struct BehaviorKernel<BUCKET_ALPHA_TRAVELING> {
+    template <typename Profile>
+    static BehaviorBucket step(int index, SimpleCreature* creature, KernelContext& context, const Profile& profile) {
+        // Move toward alpha destination
+        if (!moveToward(index, creature, creature->alphaTargetX, creature->alphaTargetY, context, profile)) {
+            return BUCKET_ALPHA_TRAVELING;
+        }
+        // Reached destination, start resting
+        creature->state = STATE_ALPHA_RESTING;
+        KernelRandom random(context, creature);
+        creature->alphaRestingTime = restTicks(random, profile.alphaMinRestTicks(), profile.alphaMaxRestTicks());
+        return BUCKET_ALPHA_RESTING;
+    }
+};
+
+template <> struct BehaviorKernel<BUCKET_ALPHA_RESTING> {
+    template <typename Profile>
+    static BehaviorBucket step(int index, SimpleCreature* creature, KernelContext& context, const Profile& profile) {
+        // Stay put and count down resting time
+        holdStill(index, creature, context);
+        if (--creature->alphaRestingTime > 0) {
+            return BUCKET_ALPHA_RESTING;
+        }
+        // Pick small random offset from current position for normal wandering
+        KernelRandom random(context, creature);
+        pickTargetAround(creature->posX, creature->posY, profile.alphaWanderDistance(), random,
+                         &creature->alphaTargetX, &creature->alphaTargetY, profile);
+        creature->state = STATE_ALPHA_TRAVELING;
+        return BUCKET_ALPHA_TRAVELING;
+    }
+};
+
+template <> struct BehaviorKernel<BUCKET_ALPHA_IDLE> {
+    template <typename Profile>
+    static BehaviorBucket step(int index, SimpleCreature* creature, KernelContext& context, const Profile& profile) {
+        // Pick initial destination anywhere in the world
+        holdStill(index, creature, context);
+        KernelRandom random(context, creature);
+        creature->alphaTargetX = random.bounded(profile.worldWidth());
+        creature->alphaTargetY = random.bounded(profile.worldHeight());
+        creature->state = STATE_ALPHA_TRAVELING;
+        return BUCKET_ALPHA_TRAVELING;
+    }
+};
+
+template <> struct BehaviorKernel<BUCKET_MEMBER_RESTING> {
+    template <typename Profile>
+    static BehaviorBucket step(int index, SimpleCreature* creature, KernelContext& context, const Profile& profile) {
+        // Stay put and count down resting time
+        holdStill(index, creature, context);
+        if (--creature->restingTimeLeft > 0) {
+            return BUCKET_MEMBER_RESTING;
+        }
+        // Done resting, pick random position around alpha (or just nearby without one)
+        KernelRandom random(context, creature);
+        if (creature->myAlpha) {
+            pickTargetAround(creature->myAlpha->posX, creature->myAlpha->posY, profile.herdFootprint(), random,
+                             &creature->wanderTargetX, &creature->wanderTargetY, profile);
+        } else {
+            creature->wanderTargetX = creature->posX + (random.bounded(2001) - 1000); // -1000 to +1000
+            creature->wanderTargetY = creature->posY + (random.bounded(2001) - 1000);
+        }
+        creature->state = STATE_WANDERING;
+        return BUCKET_MEMBER_WANDERING;
+    }
+};
+
+template <> struct BehaviorKernel<BUCKET_MEMBER_WANDERING> {
+    template <typename Profile>
+    static BehaviorBucket step(int index, SimpleCreature* creature, KernelContext& context, const Profile& profile) {
+        // Move toward wander target (position around alpha)
+        if (!moveToward(index, creature, creature->wanderTargetX, creature->wanderTargetY, context, profile)) {
+            return BUCKET_MEMBER_WANDERING;
+        }
+        // Reached target position, start resting again
+        startResting(creature, context, profile);
+        return BUCKET_MEMBER_RESTING;
+    }
+};
+
+template <> struct BehaviorKernel<BUCKET_MEMBER_SETTLING> {
+    template <typename Profile>
+    static BehaviorBucket step(int index, SimpleCreature* creature, KernelContext& context, const Profile& profile) {
+        // Legacy herd-seeking states simply go to resting
+        holdStill(index, creature, context);
+        startResting(creature, context, profile);
+        return BUCKET_MEMBER_RESTING;
+    }
+};
+
+template <BehaviorBucket Bucket, typename Profile>
+static void runBucket(const QVector<SimpleCreature*>& creatures, CreatureBuckets* buckets, KernelContext& context,
+                      const Profile& profile) {
+    const QVector<int>& indices = buckets->current[Bucket];
+    for (int index : indices) {
+        BehaviorBucket next = BehaviorKernel<Bucket>::step(index, creatures[index], context, profile);
+        buckets->next[next].push_back(index);
+    }
+}
+
+// Every active bucket of one slice, with one profile's build of the kernels
+template <typename Profile>
+static void runBuckets(const QVector<SimpleCreature*>& creatures, CreatureBuckets* buckets, KernelContext& context,
+                       const Profile& profile) {
+    runBucket<BUCKET_ALPHA_TRAVELING>(creatures, buckets, context, profile);
+    runBucket<BUCKET_ALPHA_RESTING>(creatures, buckets, context, profile);
+    runBucket<BUCKET_ALPHA_IDLE>(creatures, buckets, context, profile);
+    runBucket<BUCKET_MEMBER_RESTING>(creatures, buckets, context, profile);
+    runBucket<BUCKET_MEMBER_WANDERING>(creatures, buckets, context, profile);
+    runBucket<BUCKET_MEMBER_SETTLING>(creatures, buckets, context, profile);
+}
+
+static BehaviorBucket behaviorBucket(const SimpleCreature* creature) {
+    if (!creature || !creature->exists || creature->collapsed) return BUCKET_INACTIVE;
+
+    if (creature->isAlpha) {
+        switch (creature->state) {
+            case STATE_ALPHA_TRAVELING: return BUCKET_ALPHA_TRAVELING;
+            case STATE_ALPHA_RESTING: return BUCKET_ALPHA_RESTING;
+            default: return BUCKET_ALPHA_IDLE;
+        }
+    }
+    switch (creature->state) {
+        case STATE_RESTING: return BUCKET_MEMBER_RESTING;
+        case STATE_WANDERING: return BUCKET_MEMBER_WANDERING;
+        default: return BUCKET_MEMBER_SETTLING;
+    }
+}
+
+void CreatureBuckets::rebuild(const QVector<SimpleCreature*>& creatures, int first, int last) {
+    start = first;
+    end = last;
+    for (int b = 0; b < BUCKET_COUNT; b++) {
+        current[b].clear();
+        next[b].clear();
+    }
+    for (int i = first; i < last; i++) {
+        current[behaviorBucket(creatures[i])].push_back(i);
+    }
+}
+
+void CreatureBuckets::swap() {
+    // No kernel moves a creature into or out of the inactive list, so it is never run or swapped
+    // (collapsed herds cost nothing here)
+    for (int b = 0; b < BUCKET_INACTIVE; b++) {
+        current[b].swap(next[b]);
+        next[b].clear();   // Keeps capacity, so steady-state ticks don't allocate
+    }
+}
+
+// === Creature Update Task ===
+class CreatureUpdateTask : public QRunnable {
+private:
+    const QVector<SimpleCreature*>* mCreatures;
+    CreatureBuckets* mBuckets;
+    int mTaskId;
+    KernelContext mContext;     // Shared part; precisionStats is filled in per run
+    bool mSimulatedCoreLoad;
+
+public:
+    CreatureUpdateTask(const QVector<SimpleCreature*>* creatures, CreatureBuckets* buckets, int taskId,
+                       const KernelContext& context, bool simulatedCoreLoad = true)
+        : mCreatures(creatures), mBuckets(buckets), mTaskId(taskId), mContext(context),
+          mSimulatedCoreLoad(simulatedCoreLoad) {
+        setAutoDelete(true);
+    }
+
+    void run() override {
+        if (debugOutputEnabled()) {
+            appendToOutput(QString("[Thread %1] Alpha Herd Task %2 processing creatures [%3-%4)")
+                           .arg((quintptr)QThread::currentThreadId())
+                           .arg(mTaskId)
+                           .arg(mBuckets->start)
+                           .arg(mBuckets->end));
+        }
+
+        PrecisionStats precisionStats;
+        KernelContext context = mContext;
+        context.precisionStats = &precisionStats;
+
+        // Process creatures bucket by bucket - ALPHA-LED HERDING BEHAVIOR
+        switch (context.profile) {
+            case KERNEL_PROFILE_DEFAULT:
+                runBuckets(*mCreatures, mBuckets, context, DefaultProfile());
+                break;
+            case KERNEL_PROFILE_LARGE:
+                runBuckets(*mCreatures, mBuckets, context, LargeProfile());
+                break;
+            case KERNEL_PROFILE_HUGE:
+                runBuckets(*mCreatures, mBuckets, context, HugeProfile());
+                break;
+            default:
+                runBuckets(*mCreatures, mBuckets, context, RuntimeProfile{context.params});
+                break;
+        }
+        mBuckets->swap();
+
+        if (context.precisionCheck) {
+            context.precisionCheck->merge(precisionStats);
+        }
+
+        // Simulate some processing time based on core utilization (from 2dsim08)
+        if (mSimulatedCoreLoad && MainWindow::USE_PCT_CORE < 100) {
+            int delayMs = (100 - MainWindow::USE_PCT_CORE) * 0.5;  // Reduced delay multiplier
+            QThread::msleep(delayMs);
+        }
+
+        if (debugOutputEnabled()) {
+            appendToOutput(QString("[Thread %1] Alpha Herd Task %2 completed")
+                           .arg((quintptr)QThread::currentThreadId())
+                           .arg(mTaskId));
+        }
+    }
+};
+
+// === Parallel Range Task (used by setup and other bulk passes) ===
+// Lives in the caller's tick arena and borrows the body: the caller waits for every task, then
+// destroys them itself (no auto-delete), so a parallelFor costs no heap allocations
+class ParallelRangeTask : public QRunnable {
+private:
+    const std::function<void(int, int, int)>* mBody;
+    int mStartIndex;
+    int mEndIndex;
+    int mTaskId;
+    std::atomic<qint64>* mBusyNanos;   // Worker utilization counter
+
+public:
+    ParallelRangeTask(const std::function<void(int, int, int)>* body, int start, int end, int taskId,
+                      std::atomic<qint64>* busyNanos)
+        : mBody(body), mStartIndex(start), mEndIndex(end), mTaskId(taskId), mBusyNanos(busyNanos) {
+        setAutoDelete(false);
+    }
+
+    void run() override {
+        TraceScope trace("pool task", mTaskId);
+        QElapsedTimer busyTimer;
+        busyTimer.start();
+        (*mBody)(mStartIndex, mEndIndex, mTaskId);
+        mBusyNanos->fetch_add(busyTimer.nsecsElapsed(), std::memory_order_relaxed);
+    }
+};
+
+// === Placed Slice Task (parallelForPlaced) ===
+// Claims free slices until none are left, starting with the run of slices that belongs to its
+// thread's slot, so the same worker keeps touching the same creatures tick after tick
+class PlacedSliceTask : public QRunnable {
+private:
+    const std::function<void(int, int, int)>* mBody;
+    int mCount;
+    int mWorkers;
+    int mSlices;                        // Usually a multiple of mWorkers
+    int mChunkSize;
+    std::atomic<int>* mClaimed;         // One flag per slice
+    std::atomic<qint64>* mBusyNanos;
+
+public:
+    PlacedSliceTask(const std::function<void(int, int, int)>* body, int count, int workers, int slices, int chunkSize,
+                    std::atomic<int>* claimed, std::atomic<qint64>* busyNanos)
+        : mBody(body), mCount(count), mWorkers(workers), mSlices(slices), mChunkSize(chunkSize), mClaimed(claimed),
+          mBusyNanos(busyNanos) {
+        setAutoDelete(false);
+    }
+
+    void run() override {
+        QElapsedTimer busyTimer;
+        busyTimer.start();
+        int home = (currentWorkerSlot() % mWorkers) * (mSlices / mWorkers);
+        for (int k = 0; k < mSlices; k++) {
+            int slice = (home + k) % mSlices;
+            if (mClaimed[slice].exchange(1, std::memory_order_acq_rel) == 0) {
+                TraceScope trace("pool task", slice);
+                (*mBody)(qMin(mCount, slice * mChunkSize), qMin(mCount, (slice + 1) * mChunkSize), slice);
+            }
+        }
+        mBusyNanos->fetch_add(busyTimer.nsecsElapsed(), std::memory_order_relaxed);
+    }
+};
+
+// === Alpha Spatial Grid Implementation ===
+void AlphaGrid::build(const QVector<SimpleCreature*>& alphas, qreal worldWidth, qreal worldHeight) {
+    // Aim for roughly one alpha per cell
+    int alphaCount = qMax(1, alphas.size());
+    cellSize = qMax(static_cast<qreal>(1.0), std::sqrt(worldWidth * worldHeight / alphaCount));
+    cols = qMax(1, static_cast<int>(std::ceil(worldWidth / cellSize)));
+    rows = qMax(1, static_cast<int>(std::ceil(worldHeight / cellSize)));
+
+    cells.clear();
+    cells.resize(cols * rows);
+    for (auto* alpha : alphas) {
+        if (!alpha || !alpha->isAlpha || !alpha->exists) continue;
+        int col = qBound(0, static_cast<int>(alpha->posX / cellSize), cols - 1);
+        int row = qBound(0, static_cast<int>(alpha->posY / cellSize), rows - 1);
+        cells[row * cols + col].push_back(alpha);
+    }
+}
+
+SimpleCreature* AlphaGrid::nearest(qreal x, qreal y) const {
+    if (cells.isEmpty()) return nullptr;
+
+    int centerCol = qBound(0, static_cast<int>(x / cellSize), cols - 1);
+    int centerRow = qBound(0, static_cast<int>(y / cellSize), rows - 1);
+    int maxRing = qMax(cols, rows);
+
+    SimpleCreature* best = nullptr;
+    qreal bestDistSq = std::numeric_limits<qreal>::max();
+
+    // Search square rings outward; anything beyond ring r is at least r * cellSize away
+    for (int ring = 0; ring <= maxRing; ring++) {
+        for (int row = centerRow - ring; row <= centerRow + ring; row++) {
+            if (row < 0 || row >= rows) continue;
+            bool edgeRow = (row == centerRow - ring || row == centerRow + ring);
+            int step = edgeRow ? 1 : 2 * ring;
+            for (int col = centerCol - ring; col <= centerCol + ring; col += qMax(1, step)) {
+                if (col < 0 || col >= cols) continue;
+                for (auto* alpha : cells[row * cols + col]) {
+                    qreal dx = alpha->posX - x;
+                    qreal dy = alpha->posY - y;
+                    qreal distSq = dx * dx + dy * dy;
+                    if (distSq < bestDistSq) {
+                        bestDistSq = distSq;
+                        best = alpha;
+                    }
+                }
+            }
+        }
+
+        qreal searched = ring * cellSize;
+        if (best && bestDistSq <= searched * searched) break;
+    }
+
+    return best;
+}
+
+// === Precision Check Implementation ===
+void PrecisionStats::add(const PrecisionStats& other) {
+    maxStepError = qMax(maxStepError, other.maxStepError);
+    sumStepError += other.sumStepError;
+    maxDrift = qMax(maxDrift, other.maxDrift);
+    steps += other.steps;
+}
+
+void PrecisionCheck::reset(const QVector<SimpleCreature*>& creatures) {
+    int count = creatures.size();
+    shadowX.resize(count);
+    shadowY.resize(count);
+    shadowNewX.resize(count);
+    shadowNewY.resize(count);
+    for (int i = 0; i < count; i++) {
+        shadowX[i] = shadowNewX[i] = creatures[i]->posX;
+        shadowY[i] = shadowNewY[i] = creatures[i]->posY;
+    }
+    stale = false;
+}
+
+static inline double clampToWorld(double value, double limit) {
+    return qBound(0.0, value, limit);
+}
+
+void PrecisionCheck::recordMove(int index, const SimpleCreature* creature, SimReal targetX, SimReal targetY, bool arrived, PrecisionStats* local) {
+    const double width = worldWidth;
+    const double height = worldHeight;
+    double newX = creature->newX;
+    double newY = creature->newY;
+
+    // Step error: the same step from the same stored inputs, in double
+    double refX, refY;
+    stepToward<double>(creature->posX, creature->posY, targetX, targetY, creature->speed, &refX, &refY);
+    double stepError = std::hypot(clampToWorld(refX, width) - newX, clampToWorld(refY, height) - newY);
+
+    // Drift: the double shadow walks the same leg; it re-syncs when the creature arrives
+    double shadowNextX, shadowNextY;
+    stepToward<double>(shadowX[index], shadowY[index], targetX, targetY, creature->speed, &shadowNextX, &shadowNextY);
+    shadowNextX = clampToWorld(shadowNextX, width);
+    shadowNextY = clampToWorld(shadowNextY, height);
+    double drift = std::hypot(shadowNextX - newX, shadowNextY - newY);
+    shadowNewX[index] = arrived ? newX : shadowNextX;
+    shadowNewY[index] = arrived ? newY : shadowNextY;
+
+    local->maxStepError = qMax(local->maxStepError, stepError);
+    local->sumStepError += stepError;
+    local->maxDrift = qMax(local->maxDrift, drift);
+    local->steps++;
+}
+
+void PrecisionCheck::recordStill(int index, const SimpleCreature* creature) {
+    shadowNewX[index] = creature->newX;
+    shadowNewY[index] = creature->newY;
+}
+
+void PrecisionCheck::merge(const PrecisionStats& local) {
+    if (local.steps == 0) return;
+    QMutexLocker locker(&statsMutex);
+    stats.add(local);
+}
+
+void PrecisionCheck::commit(int index) {
+    shadowX[index] = shadowNewX[index];
+    shadowY[index] = shadowNewY[index];
+}
+
+// === Behavior Parameters ===
+static const int MIN_WORLD_SIZE = MainWindow::TERRAIN_SIZE * 10;   // A few terrain cells each way
+
+static const struct {
+    const char* name;
+    int SimParams::*field;
+    int minimum;
+    int maximum;
+} SIM_PARAM_FIELDS[] = {
+    { "WORLD_SCENE_WIDTH", &SimParams::worldWidth, MIN_WORLD_SIZE, SIM_MAX_WORLD_SIZE },
+    { "WORLD_SCENE_HEIGHT", &SimParams::worldHeight, MIN_WORLD_SIZE, SIM_MAX_WORLD_SIZE },
+    { "ALPHA_RATIO", &SimParams::alphaRatio, 1, INT_MAX },
+    { "HERD_MAX_SIZE", &SimParams::herdMaxSize, 1, INT_MAX },
+    { "HERD_GROUP_FOOTPRINT_SIZE", &SimParams::herdFootprint, 0, INT_MAX },
+    { "CREATURE_SPEED_NORMAL", &SimParams::creatureSpeed, 1, INT_MAX },
+    { "ALPHA_SPEED_SLOW", &SimParams::alphaSpeed, 1, INT_MAX },
+    { "CREATURE_MIN_REST_TICKS", &SimParams::creatureMinRestTicks, 1, INT_MAX },
+    { "CREATURE_MAX_REST_TICKS", &SimParams::creatureMaxRestTicks, 1, INT_MAX },
+    { "ALPHA_MIN_REST_DURATION", &SimParams::alphaMinRestTicks, 1, INT_MAX },
+    { "ALPHA_MAX_REST_DURATION", &SimParams::alphaMaxRestTicks, 1, INT_MAX },
+    { "ALPHA_NORMAL_WANDER_DISTANCE", &SimParams::alphaWanderDistance, 0, INT_MAX },
+};
+
+SimParams::SimParams()
+    : worldWidth(MainWindow::WORLD_SCENE_WIDTH)
+    , worldHeight(MainWindow::WORLD_SCENE_HEIGHT)
+    , alphaRatio(MainWindow::ALPHA_RATIO)
+    , herdMaxSize(MainWindow::HERD_MAX_SIZE)
+    , herdFootprint(MainWindow::HERD_GROUP_FOOTPRINT_SIZE)
+    , creatureSpeed(MainWindow::CREATURE_SPEED_NORMAL)
+    , alphaSpeed(MainWindow::ALPHA_SPEED_SLOW)
+    , creatureMinRestTicks(MainWindow::CREATURE_MIN_REST_TICKS)
+    , creatureMaxRestTicks(MainWindow::CREATURE_MAX_REST_TICKS)
+    , alphaMinRestTicks(MainWindow::ALPHA_MIN_REST_DURATION)
+    , alphaMaxRestTicks(MainWindow::ALPHA_MAX_REST_DURATION)
+    , alphaWanderDistance(MainWindow::ALPHA_NORMAL_WANDER_DISTANCE)
+{
+}
+
+bool SimParams::set(const QString& name, int value) {
+    for (const auto& field : SIM_PARAM_FIELDS) {
+        if (name == QLatin1String(field.name)) {
+            this->*field.field = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+int SimParams::value(const QString& name) const {
+    for (const auto& field : SIM_PARAM_FIELDS) {
+        if (name == QLatin1String(field.name)) {
+            return this->*field.field;
+        }
+    }
+    return 0;
+}
+
+bool SimParams::isValid(QString* error) const {
+    for (const auto& field : SIM_PARAM_FIELDS) {
+        if (this->*field.field < field.minimum) {
+            *error = QString("%1 must be at least %2").arg(field.name).arg(field.minimum);
+            return false;
+        }
+        if (this->*field.field > field.maximum) {
+            *error = QString("%1 must be at most %2 with %3 kinematics").arg(field.name).arg(field.maximum)
+                     .arg(SIM_PRECISION_NAME);
+            return false;
+        }
+    }
+    if (creatureMaxRestTicks < creatureMinRestTicks || alphaMaxRestTicks < alphaMinRestTicks) {
+        *error = "rest maximums must not be below their minimums";
+        return false;
+    }
+    return true;
+}
+
+bool SimParams::operator==(const SimParams& other) const {
+    for (const auto& field : SIM_PARAM_FIELDS) {
+        if (this->*field.field != other.*field.field) return false;
+    }
+    return true;
+}
+
+QStringList SimParams::names() {
+    QStringList result;
+    for (const auto& field : SIM_PARAM_FIELDS) {
+        result << field.name;
+    }
+    return result;
+}
+
+// === SimWorld Implementation ===
+SimWorld::SimWorld(QThreadPool* threadPool)
+    : mThreadPool(threadPool)
+    , mRegion(0, 0, MainWindow::WORLD_SCENE_WIDTH, MainWindow::WORLD_SCENE_HEIGHT)
+    , mNextUniqueID(1)
+    , mCommitBatchSize(0)
+    , mTrackRecolors(false)
+    , mProcessEventsWhileWaiting(false)
+    , mKernelProfile(kernelProfileFor(mParams))
+    , mSimulatedCoreLoad(true)
+    , mDeterministic(false)
+    , mSeed(0)
+    , mRng(QRandomGenerator::global()->generate())
+    , mAutoTuner(nullptr)
+    , mTickCount(0)
+    , mCurrentCreatureIndex(0)
+    , mLastCommitStart(0)
+    , mLastCommitEnd(0)
+    , mHousekeepingCreatureIndex(0)
+    , mTickBudgetMicros(0)
+    , mHousekeepingPassStart(0)
+    , mCensusOrphans(0)
+    , mLevelOfDetail(false)
+    , mLodDirty(false)
+    , mHerdStatistics(false)
+    , mPrecisionCheck(nullptr)
+    , mBucketsStale(true)
+    , mWorkerBusyNanos(0)
+    , mTaskArenaCount(0)
+{
+}
+
+SimWorld::~SimWorld() {
+    delete mPrecisionCheck;
+    delete mAutoTuner;
+
+    // Graphics items belong to whoever created them (MainWindow deletes those first)
+    for (auto* creature : mCreatures) {
+        delete creature;
+    }
+}
+
+void SimWorld::parallelFor(int count, const std::function<void(int start, int end, int taskId)>& body) {
+    if (count <= 0) return;
+
+    if (!mThreadPool) {
+        body(0, count, 0);
+        return;
+    }
+
+    // Split into a few tasks per thread so uneven chunks still balance out
+    int numTasks = qMin(count, mThreadPool->maxThreadCount() * 4);
+    int chunkSize = (count + numTasks - 1) / numTasks;
+
+    ParallelRangeTask** tasks = mTickArena.createArray<ParallelRangeTask*>(numTasks);
+    int started = 0;
+    for (int i = 0; i < numTasks; i++) {
+        int start = i * chunkSize;
+        int end = qMin(count, start + chunkSize);
+        if (start >= end) break;
+        tasks[started] = mTickArena.create<ParallelRangeTask>(&body, start, end, i, &mWorkerBusyNanos);
+        mThreadPool->start(tasks[started++]);
+    }
+
+    mThreadPool->waitForDone();
+    for (int i = 0; i < started; i++) {
+        tasks[i]->~ParallelRangeTask();
+    }
+}
+
+void SimWorld::parallelForPlaced(int count, const std::function<void(int start, int end, int slice)>& body,
+                                 const UpdatePlan& plan) {
+    if (count <= 0) return;
+
+    if (!mThreadPool) {
+        body(0, count, 0);
+        return;
+    }
+
+    // Default: one slice per worker
+    const int slices = qMin(count, plan.slices > 0 ? plan.slices : mThreadPool->maxThreadCount());
+    const int workers = qBound(1, plan.workers > 0 ? plan.workers : slices, slices);
+    const int chunkSize = (count + slices - 1) / slices;
+
+    // A single worker runs on the calling thread: no handoff, no wakeups
+    if (workers == 1) {
+        for (int slice = 0; slice < slices; slice++) {
+            body(qMin(count, slice * chunkSize), qMin(count, (slice + 1) * chunkSize), slice);
+        }
+        return;
+    }
+
+    std::atomic<int>* claimed = mTickArena.createArray<std::atomic<int>>(slices);
+    for (int i = 0; i < slices; i++) {
+        claimed[i].store(0, std::memory_order_relaxed);
+    }
+
+    PlacedSliceTask** tasks = mTickArena.createArray<PlacedSliceTask*>(workers);
+    for (int i = 0; i < workers; i++) {
+        tasks[i] = mTickArena.create<PlacedSliceTask>(&body, count, workers, slices, chunkSize,
+                                                      claimed, &mWorkerBusyNanos);
+        mThreadPool->start(tasks[i]);
+    }
+
+    waitForTasks();
+    for (int i = 0; i < workers; i++) {
+        tasks[i]->~PlacedSliceTask();
+    }
+}
+
+UpdatePlan SimWorld::updatePlan() const {
+    if (!mThreadPool) return UpdatePlan(1, 1);
+    int slices = mUpdatePlan.slices > 0 ? mUpdatePlan.slices : mThreadPool->maxThreadCount();
+    int workers = qBound(1, mUpdatePlan.workers > 0 ? mUpdatePlan.workers : slices, slices);
+    return UpdatePlan(workers, slices);
+}
+
+void SimWorld::setAutoTune(bool enabled) {
+    delete mAutoTuner;
+    mAutoTuner = (enabled && mThreadPool) ? new AutoTuner(mThreadPool->maxThreadCount()) : nullptr;
+    if (!mAutoTuner) {
+        mUpdatePlan = UpdatePlan();
+    }
+}
+
+UpdateMix SimWorld::updateMix() const {
+    UpdateMix mix;
+    mix.total = 0;
+    for (int b = 0; b < BUCKET_COUNT; b++) {
+        mix.counts[b] = 0;
+        for (const CreatureBuckets& buckets : mBuckets) {
+            mix.counts[b] += buckets.current[b].size();
+        }
+        mix.total += mix.counts[b];
+    }
+    return mix;
+}
+
+void SimWorld::waitForTasks() {
+    if (mProcessEventsWhileWaiting) {
+        while (!mThreadPool->waitForDone(1)) {
+            QCoreApplication::processEvents();
+        }
+    } else {
+        mThreadPool->waitForDone();
+    }
+}
+
+void SimWorld::setPrecisionCheck(bool enabled) {
+    if (enabled == (mPrecisionCheck != nullptr)) return;
+    delete mPrecisionCheck;
+    mPrecisionCheck = enabled ? new PrecisionCheck : nullptr;
+    if (mPrecisionCheck) {
+        mPrecisionCheck->worldWidth = mParams.worldWidth;
+        mPrecisionCheck->worldHeight = mParams.worldHeight;
+    }
+}
+
+void SimWorld::setParams(const SimParams& params) {
+    if (mRegion == mParams.worldRect()) {
+        mRegion = params.worldRect();
+    }
+    mParams = params;
+    mKernelProfile = kernelProfileFor(mParams);
+    if (mPrecisionCheck) {
+        mPrecisionCheck->worldWidth = mParams.worldWidth;
+        mPrecisionCheck->worldHeight = mParams.worldHeight;
+    }
+}
+
+void SimWorld::reportPrecision() {
+    PrecisionStats stats;
+    {
+        QMutexLocker locker(&mPrecisionCheck->statsMutex);
+        stats = mPrecisionCheck->stats;
+        mPrecisionCheck->stats = PrecisionStats();
+    }
+    if (stats.steps == 0) return;
+
+    log(QString("Precision check (%1 vs double, %2 ticks): step error max %3 / mean %4, drift max %5, %6 steps")
+        .arg(SIM_PRECISION_NAME).arg(PRECISION_REPORT_INTERVAL)
+        .arg(stats.maxStepError, 0, 'g', 3).arg(stats.sumStepError / stats.steps, 0, 'g', 3)
+        .arg(stats.maxDrift, 0, 'g', 3).arg(stats.steps));
+}
+
+// === Setup ===
+void SimWorld::setupTerrain(quint32 seed) {
+    // Nothing is generated here: chunks appear on first lookup (or renderer prefetch)
+    // Cell size is fixed; a larger world has more cells (and chunks, still generated on demand)
+    mTerrain.setup(seed, MainWindow::TERRAIN_SIZE, mParams.worldWidth / MainWindow::TERRAIN_SIZE,
+                   mParams.worldHeight / MainWindow::TERRAIN_SIZE, mThreadPool);
+}
+
+void SimWorld::setupCreatures(int count, quint32 seed) {
+    int numAlphas = qMax(1, count / qMax(1, mParams.alphaRatio));
+    int numCreatures = qMax(numAlphas, count);
+    const qreal left = mRegion.left();
+    const qreal top = mRegion.top();
+    const int spawnWidth = qMax(1, static_cast<int>(mRegion.width()));
+    const int spawnHeight = qMax(1, static_cast<int>(mRegion.height()));
+
+    // Every slot is written by exactly one task, so workers fill the vector in place
+    int firstSlot = mCreatures.size();
+    mCreatures.resize(firstSlot + numCreatures);
+    SimpleCreature** creatureSlots = mCreatures.data() + firstSlot;
+    int firstID = reserveUniqueIDs(numCreatures);
+    markCreaturesChanged();
+
+    // Deterministic worlds draw everything from this seed from here on (see KernelRandom)
+    mSeed = seed;
+    if (mDeterministic) {
+        mRng.seed(seed ^ 0xA511E9B3u);
+    }
+
+    // Random streams below belong to blocks of SETUP_RANDOM_BLOCK creatures, never to tasks, so
+    // a seed gives the same world on any thread count
+
+    // Phase 1: allocate every creature on the worker whose update slice will own it (same
+    // slicing as updateCreaturesParallel)
+    parallelForPlaced(numCreatures, [=](int start, int end, int) {
+        for (int i = start; i < end; i++) {
+            creatureSlots[i] = new SimpleCreature;
+        }
+    });
+
+    // Phase 2: place the alphas - followers need them first
+    const int alphaBlocks = (numAlphas + SETUP_RANDOM_BLOCK - 1) / SETUP_RANDOM_BLOCK;
+    parallelFor(alphaBlocks, [=](int start, int end, int) {
+        for (int block = start; block < end; block++) {
+            QRandomGenerator rng(seed + block);
+            for (int i = block * SETUP_RANDOM_BLOCK; i < qMin(numAlphas, (block + 1) * SETUP_RANDOM_BLOCK); i++) {
+                qreal x = left + rng.bounded(spawnWidth);
+                qreal y = top + rng.bounded(spawnHeight);
+                initCreatureData(creatureSlots[i], x, y, true, firstID + i, rng); // true = isAlpha
+            }
+        }
+    });
+
+    for (int i = 0; i < numAlphas; i++) {
+        assignHerdSlot(creatureSlots[i]);
+    }
+
+    AlphaGrid alphaGrid;
+    alphaGrid.build(mCreatures.mid(firstSlot, numAlphas), mParams.worldWidth, mParams.worldHeight);
+
+    // Phase 3: herd members, each assigned to its nearest alpha and given the herd color
+    const int memberBlocks = (numCreatures - numAlphas + SETUP_RANDOM_BLOCK - 1) / SETUP_RANDOM_BLOCK;
+    parallelFor(memberBlocks, [=, &alphaGrid](int start, int end, int) {
+        for (int block = start; block < end; block++) {
+            QRandomGenerator rng(seed ^ (0x9E3779B9u + block));
+            const int first = numAlphas + block * SETUP_RANDOM_BLOCK;
+            for (int i = first; i < qMin(numCreatures, first + SETUP_RANDOM_BLOCK); i++) {
+                qreal x = left + rng.bounded(spawnWidth);
+                qreal y = top + rng.bounded(spawnHeight);
+                SimpleCreature* member = creatureSlots[i];
+                initCreatureData(member, x, y, false, firstID + i, rng); // false = not alpha
+
+                SimpleCreature* nearestAlpha = alphaGrid.nearest(x, y);
+                if (nearestAlpha) {
+                    member->myAlpha = nearestAlpha;
+                    member->color = nearestAlpha->color;  // Alpha color == generateHerdColor(alpha ID)
+                }
+            }
+        }
+    });
+
+    // Scattered creatures (and their water respawns) touch up to one chunk each; the cache holds
+    // that many, so commits do not evict and regenerate chunks tick after tick
+    mTerrain.reserveChunks(mCreatures.size());
+}
+
+// === Tick Pipeline ===
+void SimWorld::tick() {
+    TraceScope trace("tick");
+    QElapsedTimer tickTimer;
+    tickTimer.start();
+    mTickCount++;
+
+    // Edits queued since the last tick land here, before anything reads the creatures
+    applyCommands();
+    qint64 commandsDone = tickTimer.nsecsElapsed() / 1000;
+
+    // Handle orphan assignment in main thread (needs access to creature vector)
+    assignOrphans();
+    qint64 orphansDone = tickTimer.nsecsElapsed() / 1000;
+
+    // Update creatures using parallel processing
+    updateCreaturesParallel();
+    qint64 updateDone = tickTimer.nsecsElapsed() / 1000;
+
+    // Commit new positions
+    commitCreatures();
+    if (mLevelOfDetail && (mLodDirty || mTickCount % LOD_INTERVAL == 0)) {
+        updateLevelOfDetail(false);
+    }
+    qint64 commitDone = tickTimer.nsecsElapsed() / 1000;
+
+    if (mHerdStatistics) {
+        updateHerdStatistics();
+    }
+    qint64 statisticsDone = tickTimer.nsecsElapsed() / 1000;
+
+    // Housekeeping gets the slack the main phases left (more when orphans pile up)
+    runHousekeeping(housekeepingBudget(statisticsDone));
+
+    mLastTickTimings.commandsMicros = commandsDone;
+    mLastTickTimings.orphansMicros = orphansDone - commandsDone;
+    mLastTickTimings.updateMicros = updateDone - orphansDone;
+    mLastTickTimings.commitMicros = commitDone - updateDone;
+    mLastTickTimings.housekeepingMicros = mHousekeepingStats.lastUsedMicros;
+    mLastTickTimings.statisticsMicros = statisticsDone - commitDone;
+    mLastTickTimings.totalMicros = tickTimer.nsecsElapsed() / 1000;
+
+    if (mPrecisionCheck && mTickCount % PRECISION_REPORT_INTERVAL == 0) {
+        reportPrecision();
+    }
+    if (mAutoTuner) {
+        mUpdatePlan = mAutoTuner->observe(mLastTickTimings.updateMicros, updateMix());
+    }
+    resetArenas();
+}
+
+void SimWorld::resetArenas() {
+    mTickArena.reset();
+    for (int i = 0; i < mTaskArenaCount; i++) {
+        mTaskArenas[i].reset();
+    }
+}
+
+void SimWorld::assignOrphans() {
+    TraceScope trace("orphans");
+    for (auto* creature : mCreatures) {
+        if (creature && creature->exists && !creature->isAlpha && !creature->myAlpha) {
+            // This creature needs an alpha - assign to nearest one
+            SimpleCreature* nearestAlpha = nullptr;
+            qreal nearestDistance = std::numeric_limits<qreal>::max();
+
+            for (auto* potential : mCreatures) {
+                if (potential && potential->isAlpha && potential->exists) {
+                    qreal distance = distanceBetween(creature->posX, creature->posY, potential->posX, potential->posY);
+                    if (distance < nearestDistance) {
+                        nearestDistance = distance;
+                        nearestAlpha = potential;
+                    }
+                }
+            }
+
+            if (nearestAlpha) {
+                setHerd(creature, nearestAlpha);
+            }
+        }
+    }
+}
+
+void SimWorld::updateCreaturesParallel() {
+    if (mCreatures.empty()) return;
+    TraceScope trace("update");
+
+    if (mPrecisionCheck && mPrecisionCheck->stale) {
+        mPrecisionCheck->reset(mCreatures);
+    }
+
+    // Placed slices: each worker updates the creatures it allocated at setup, keeping the
+    // slice's buckets between ticks (rebuilt only when the slice or creature set changes)
+    const UpdatePlan plan = updatePlan();
+    mBuckets.resize(qMin(plan.slices, mCreatures.size()));
+    KernelContext context = { &mParams, mKernelProfile, mPrecisionCheck, nullptr, mDeterministic,
+                              mixRandomKey((static_cast<quint64>(mSeed) << 32) ^ static_cast<quint64>(mTickCount)) };
+    // Two captures at most: the body then fits inside std::function without a heap allocation
+    parallelForPlaced(mCreatures.size(), [this, &context](int start, int end, int slice) {
+        TraceScope sliceTrace("update slice", slice);
+        CreatureBuckets* buckets = &mBuckets[slice];
+        if (mBucketsStale || buckets->start != start || buckets->end != end) {
+            buckets->rebuild(mCreatures, start, end);
+        }
+        CreatureUpdateTask task(&mCreatures, buckets, slice, context, mSimulatedCoreLoad);
+        task.setAutoDelete(false);
+        task.run();
+    }, plan);
+    mBucketsStale = false;
+}
+
+void SimWorld::commitCreatures() {
+    TraceScope trace("commit");
+    // Commit a batch of creatures per tick (all of them when the batch size is 0)
+    int batch = mCommitBatchSize > 0 ? mCommitBatchSize : mCreatures.size();
+    if (mCurrentCreatureIndex >= mCreatures.size()) {
+        mCurrentCreatureIndex = 0;
+    }
+
+    mLastCommitStart = mCurrentCreatureIndex;
+    mLastCommitEnd = qMin(mCurrentCreatureIndex + batch, mCreatures.size());
+
+    // The chunks this batch lands on, generated in parallel up front rather than one at a time by
+    // the lookups below, under the lock the renderers' prefetch takes too. Neighbors in the list
+    // are mostly herd mates, so consecutive repeats are dropped here and the rest by the terrain.
+    mCommitChunks.resize(0);
+    int lastChunk = -1;
+    for (int i = mLastCommitStart; i < mLastCommitEnd; i++) {
+        const SimpleCreature* creature = mCreatures[i];
+        if (creature && creature->exists && !creature->collapsed) {
+            const int chunk = mTerrain.chunkIndexAt(creature->newX, creature->newY);
+            if (chunk >= 0 && chunk != lastChunk) {
+                mCommitChunks.push_back(chunk);
+                lastChunk = chunk;
+            }
+        }
+    }
+    mTerrain.prefetchChunks(mCommitChunks);
+
+    // Then the terrain under every landing spot, read under one lock rather than one per creature
+    mCommitPoints.resize(0);
+    for (int i = mLastCommitStart; i < mLastCommitEnd; i++) {
+        const SimpleCreature* creature = mCreatures[i];
+        if (creature && creature->exists && !creature->collapsed) {
+            mCommitPoints.push_back(QPointF(creature->newX, creature->newY));
+        }
+    }
+    mTerrain.typesAt(mCommitPoints, &mCommitTypes);
+
+    int landed = 0;
+    for (int i = mLastCommitStart; i < mLastCommitEnd; i++) {
+        SimpleCreature* creature = mCreatures[i];
+        if (creature && creature->exists && !creature->collapsed) {
+            // Update position
+            creature->posX = creature->newX;
+            creature->posY = creature->newY;
+            if (mPrecisionCheck) {
+                mPrecisionCheck->commit(i);
+            }
+
+            // Check for water collision (like 2dsim07)
+            TerrainType terrainType = static_cast<TerrainType>(mCommitTypes[landed++]);
+            if (terrainType == TERRAIN_WATER) {
+                creature->newX = mRng.bounded(mParams.worldWidth);
+                creature->newY = mRng.bounded(mParams.worldHeight);
+            }
+        }
+    }
+
+    mCurrentCreatureIndex += batch;
+    if (mCurrentCreatureIndex >= mCreatures.size()) {
+        mCurrentCreatureIndex = 0;
+    }
+}
+
+// === Housekeeping ===
+qint64 SimWorld::housekeepingBudget(qint64 usedMicros) const {
+    qint64 budget = MainWindow::HOUSEKEEPING_MIN_BUDGET_US;
+    if (mTickBudgetMicros > 0) {
+        // Half the slack; the rest is left for drawing or publishing the tick
+        budget = qBound<qint64>(MainWindow::HOUSEKEEPING_MIN_BUDGET_US, (mTickBudgetMicros - usedMicros) / 2,
+                                MainWindow::HOUSEKEEPING_MAX_BUDGET_US);
+    }
+    if (mPendingOrphans.size() >= MainWindow::HOUSEKEEPING_ORPHAN_PRIORITY) {
+        budget = qMax<qint64>(budget, MainWindow::HOUSEKEEPING_PRIORITY_BUDGET_US);
+    }
+    return budget;
+}
+
+void SimWorld::runHousekeeping(qint64 budgetMicros) {
+    TraceScope trace("housekeeping");
+    QElapsedTimer timer;
+    timer.start();
+    mHousekeepingStats.lastBudgetMicros = budgetMicros;
+    mHousekeepingStats.lastCreatures = 0;
+    if (mCreatures.empty()) return;
+
+    int orphansFound = 0;
+    int orphansRehomed = 0;
+
+    // Deterministic worlds budget work instead of wall time, so every run censuses the same
+    // creatures on the same tick
+    int censusQuota = MainWindow::HOUSEKEEPING_DETERMINISTIC_CREATURES;
+    auto withinBudget = [&]() {
+        return mDeterministic ? censusQuota > 0 : timer.nsecsElapsed() / 1000 < budgetMicros;
+    };
+
+    // Orphans already waiting go first
+    while (!mPendingOrphans.isEmpty() && withinBudget()) {
+        SimpleCreature* orphan = mPendingOrphans.last();
+        if (!orphan->myAlpha && orphan->exists) {
+            if (!rehomeOrphan(orphan)) break;   // No herd has room until the next census
+            orphansRehomed++;
+        }
+        mPendingOrphans.removeLast();
+    }
+
+    // Census a chunk at a time until the budget is spent (at most one full pass per tick)
+    ArenaVector<SimpleCreature*> orphans(&mTickArena);
+    const int chunk = MainWindow::HOUSEKEEPING_CHUNK;   // A copy: qMin binds by reference
+    while (withinBudget()) {
+        int start = mHousekeepingCreatureIndex;
+        int remaining = mCreatures.size() - start;
+        if (mDeterministic) {
+            remaining = qMin(remaining, censusQuota);
+        }
+        int end = start + qMin(remaining, chunk);
+
+        if (mThreadPool && remaining >= MainWindow::HOUSEKEEPING_PARALLEL_MIN) {
+            // Workers sit idle between ticks: hand them a bigger block, merge their counts here
+            // Each task records into its own arena; counts are merged here, in task order
+            int tasks = mThreadPool->maxThreadCount() * 4;
+            end = start + qMin(remaining, chunk * tasks);
+            if (mTaskArenaCount < tasks) {
+                mTaskArenas.reset(new TickArena[tasks]);
+                mTaskArenaCount = tasks;
+            }
+            struct {
+                int start;
+                ArenaVector<CensusRecord>* records;
+                ArenaVector<SimpleCreature*>* orphans;
+            } census = { start, mTickArena.createArray<ArenaVector<CensusRecord>>(tasks),
+                         mTickArena.createArray<ArenaVector<SimpleCreature*>>(tasks) };
+            for (int t = 0; t < tasks; t++) {
+                census.records[t].setArena(taskArena(t));
+                census.orphans[t].setArena(taskArena(t));
+            }
+            parallelFor(end - start, [this, &census](int first, int last, int taskId) {
+                censusRecords(census.start + first, census.start + last, &census.records[taskId], &census.orphans[taskId]);
+            });
+            for (int t = 0; t < tasks; t++) {
+                for (const CensusRecord& record : census.records[t]) {
+                    countCensus(record.herd, record.members);
+                }
+                orphans.append(census.orphans[t]);
+            }
+        } else {
+            censusRange(start, end, &orphans);
+        }
+
+        mHousekeepingStats.lastCreatures += end - start;
+        mHousekeepingCreatureIndex = end;
+        censusQuota -= end - start;
+        if (mHousekeepingCreatureIndex >= mCreatures.size()) {
+            finishHousekeepingPass();
+            break;
+        }
+    }
+
+    // Rehome what the census found; the rest waits (and raises the next budget if it piles up)
+    mCensusOrphans += orphans.size();
+    for (auto* orphan : orphans) {
+        orphansFound++;
+        if (rehomeOrphan(orphan)) {
+            orphansRehomed++;
+        } else {
+            mPendingOrphans.push_back(orphan);
+        }
+    }
+
+    mHousekeepingStats.lastUsedMicros = timer.nsecsElapsed() / 1000;
+    mHousekeepingStats.pendingOrphans = mPendingOrphans.size();
+    mHousekeepingStats.orphansRehomed += orphansRehomed;
+    if ((orphansFound > 0 || orphansRehomed > 0) && mLogger) {
+        log(QString("Housekeeping: Found %1 orphans, rehomed %2 (%3 waiting)")
+            .arg(orphansFound).arg(orphansRehomed).arg(mPendingOrphans.size()));
+    }
+}
+
+void SimWorld::censusRange(int start, int end, ArenaVector<SimpleCreature*>* orphans) {
+    for (int i = start; i < end; i++) {
+        SimpleCreature* creature = mCreatures[i];
+        if (!creature || !creature->exists) continue;
+
+        if (creature->isAlpha) {
+            countCensus(creature, 0);   // Empty herds are open herds too
+        } else if (creature->myAlpha) {
+            countCensus(creature->myAlpha, 1);
+        } else {
+            orphans->push_back(creature);
+        }
+    }
+}
+
+void SimWorld::censusRecords(int start, int end, ArenaVector<CensusRecord>* records, ArenaVector<SimpleCreature*>* orphans) const {
+    // Worker side: alphas are shared between tasks, so counting waits for the merge
+    for (int i = start; i < end; i++) {
+        SimpleCreature* creature = mCreatures[i];
+        if (!creature || !creature->exists) continue;
+
+        if (creature->isAlpha) {
+            records->push_back({ creature, 0 });
+        } else if (creature->myAlpha) {
+            records->push_back({ creature->myAlpha, 1 });
+        } else {
+            orphans->push_back(creature);
+        }
+    }
+}
+
+void SimWorld::countCensus(SimpleCreature* herd, int members) {
+    if (herd->censusMembers < 0) {
+        herd->censusMembers = 0;
+        mCensusHerds.push_back(herd);
+    }
+    herd->censusMembers += members;
+}
+
+void SimWorld::finishHousekeepingPass() {
+    // The census becomes the current herd sizes; counts live in the alphas, lists keep their capacity
+    for (auto* herd : mHerds) {
+        herd->herdSize = -1;
+    }
+    for (auto* herd : mCensusHerds) {
+        herd->herdSize = herd->censusMembers;
+        herd->censusMembers = -1;
+    }
+    mHerds.swap(mCensusHerds);
+    mCensusHerds.clear();
+
+    // Find a herd that's not full (has fewer than HERD_MAX_SIZE members)
+    mOpenHerds.clear();
+    for (auto* herd : mHerds) {
+        if (herd->herdSize < mParams.herdMaxSize) {
+            mOpenHerds.push_back(herd);
+        }
+    }
+    // Census order follows the task split; the random pick below must not
+    std::sort(mOpenHerds.begin(), mOpenHerds.end(), [](const SimpleCreature* a, const SimpleCreature* b) {
+        return a->uniqueID < b->uniqueID;
+    });
+
+    // Anyone still waiting is found again by the next census
+    mPendingOrphans.clear();
+
+    mHousekeepingStats.passes++;
+    mHousekeepingStats.lastPassTicks = static_cast<int>(mTickCount - mHousekeepingPassStart);
+    mHousekeepingStats.openHerds = mOpenHerds.size();
+    mHousekeepingStats.censusAlphas = mHerds.size();
+    mHousekeepingStats.censusOrphans = mCensusOrphans;
+    mCensusOrphans = 0;
+    mHousekeepingPassStart = mTickCount;
+    mHousekeepingCreatureIndex = 0;
+
+    if (debugOutputEnabled()) {
+        appendToOutput(QString("=== HOUSEKEEPING: census of %1 creatures took %2 ticks, %3 of %4 herds open ===")
+                       .arg(mCreatures.size()).arg(mHousekeepingStats.lastPassTicks)
+                       .arg(mOpenHerds.size()).arg(mHerds.size()));
+    }
+}
+
+bool SimWorld::rehomeOrphan(SimpleCreature* orphan) {
+    while (!mOpenHerds.isEmpty()) {
+        // Assign orphan to a random available alpha
+        int randomIndex = mRng.bounded(mOpenHerds.size());
+        SimpleCreature* newAlpha = mOpenHerds[randomIndex];
+        int& herdSize = newAlpha->herdSize;
+        if (!newAlpha->exists || herdSize >= mParams.herdMaxSize) {
+            mOpenHerds[randomIndex] = mOpenHerds.last();
+            mOpenHerds.removeLast();
+            continue;
+        }
+
+        // Assign to herd
+        setHerd(orphan, newAlpha);
+        herdSize++;
+
+        // Reset creature state to resting
+        orphan->state = STATE_RESTING;
+        orphan->restingTimeLeft = restTicks(mRng, mParams.creatureMinRestTicks, mParams.creatureMaxRestTicks);
+        orphan->herdTarget = nullptr;
+        orphan->hasHerdTarget = false;
+        markCreaturesChanged();
+        return true;
+    }
+    return false;
+}
+
+void SimWorld::setHerd(SimpleCreature* creature, SimpleCreature* alpha) {
+    creature->myAlpha = alpha;
+    creature->color = generateHerdColor(alpha->uniqueID);
+    if (mTrackRecolors) {
+        mRecolored.push_back(creature);
+    }
+}
+
+QVector<SimpleCreature*> SimWorld::takeRecoloredCreatures() {
+    QVector<SimpleCreature*> recolored;
+    recolored.swap(mRecolored);
+    return recolored;
+}
+
+// === Level of Detail ===
+void SimWorld::setLevelOfDetail(bool enabled) {
+    if (enabled == mLevelOfDetail) return;
+    if (!enabled) {
+        updateLevelOfDetail(true);   // Everyone simulated individually again
+        mLodStats = LodStats();
+    }
+    mLevelOfDetail = enabled;
+    mLodDirty = enabled;
+}
+
+void SimWorld::setDetailRegion(const QRectF& region) {
+    mDetailRegion = region;
+    // Small pans wait for the regular check; the margin covers them
+    const qreal slack = LOD_MARGIN / 4;
+    if (qAbs(region.left() - mLodPassRegion.left()) > slack || qAbs(region.top() - mLodPassRegion.top()) > slack ||
+        qAbs(region.right() - mLodPassRegion.right()) > slack || qAbs(region.bottom() - mLodPassRegion.bottom()) > slack) {
+        mLodDirty = true;
+    }
+}
+
+void SimWorld::updateLevelOfDetail(bool expandAll) {
+    TraceScope trace("lod");
+    mLodDirty = false;
+    mLodPassRegion = mDetailRegion;
+    const QRectF detail = mDetailRegion.adjusted(-LOD_MARGIN, -LOD_MARGIN, LOD_MARGIN, LOD_MARGIN);
+
+    // Pass 1: count every herd, and measure the members still simulated individually
+    for (auto& herd : mAggregates) {
+        herd.members = 0;
+        herd.expanded = 0;
+        herd.sumX = herd.sumY = herd.sumSqX = herd.sumSqY = 0;
+    }
+    for (auto* creature : mCreatures) {
+        if (!creature || !creature->exists || creature->isAlpha || !creature->myAlpha) continue;
+        SimpleCreature* alpha = creature->myAlpha;
+        if (alpha->herdSlot < 0) {
+            assignHerdSlot(alpha);
+        }
+        HerdAggregate& herd = mAggregates[alpha->herdSlot];
+        herd.members++;
+        if (creature->collapsed) continue;
+
+        const double x = creature->posX;
+        const double y = creature->posY;
+        const double dx = x - alpha->posX;
+        const double dy = y - alpha->posY;
+        if (herd.expanded == 0) {
+            herd.minX = herd.maxX = x;
+            herd.minY = herd.maxY = y;
+        } else {
+            herd.minX = qMin(herd.minX, x);
+            herd.maxX = qMax(herd.maxX, x);
+            herd.minY = qMin(herd.minY, y);
+            herd.maxY = qMax(herd.maxY, y);
+        }
+        herd.expanded++;
+        herd.sumX += dx;
+        herd.sumY += dy;
+        herd.sumSqX += dx * dx;
+        herd.sumSqY += dy * dy;
+    }
+
+    // Decide per herd: collapse (or absorb newcomers) when outside, expand when near
+    enum { LOD_KEEP, LOD_COLLAPSE, LOD_EXPAND };
+    QVector<uchar>& actions = mLodActions;
+    actions.fill(LOD_KEEP, mAggregates.size());
+    bool changed = false;
+    for (int slot = 0; slot < mAggregates.size(); slot++) {
+        HerdAggregate& herd = mAggregates[slot];
+        const SimpleCreature* alpha = herd.alpha;
+        if (!alpha || !alpha->exists || herd.members == 0) continue;
+
+        QRectF extent(alpha->posX, alpha->posY, alpha->size, alpha->size);
+        if (herd.collapsed) {
+            const double cx = alpha->posX + herd.offsetX;
+            const double cy = alpha->posY + herd.offsetY;
+            const double rx = LOD_SPREAD_SIGMAS * herd.spreadX + MainWindow::DEFAULT_CREATURE_SIZE;
+            const double ry = LOD_SPREAD_SIGMAS * herd.spreadY + MainWindow::DEFAULT_CREATURE_SIZE;
+            extent = extent.united(QRectF(cx - rx, cy - ry, 2 * rx, 2 * ry));
+        }
+        if (herd.expanded > 0) {
+            extent = extent.united(QRectF(herd.minX, herd.minY, herd.maxX - herd.minX + MainWindow::DEFAULT_CREATURE_SIZE,
+                                          herd.maxY - herd.minY + MainWindow::DEFAULT_CREATURE_SIZE));
+        }
+        const bool near = expandAll || detail.intersects(extent);
+
+        if (herd.collapsed && near) {
+            actions[slot] = LOD_EXPAND;
+            herd.collapsed = false;
+            mLodStats.expansions++;
+            changed = true;
+        } else if (!near && herd.expanded > 0) {
+            if (!herd.collapsed) {
+                // The stored distribution is that of the members as they were last simulated
+                herd.offsetX = herd.sumX / herd.expanded;
+                herd.offsetY = herd.sumY / herd.expanded;
+                herd.spreadX = std::sqrt(qMax(0.0, herd.sumSqX / herd.expanded - herd.offsetX * herd.offsetX));
+                herd.spreadY = std::sqrt(qMax(0.0, herd.sumSqY / herd.expanded - herd.offsetY * herd.offsetY));
+                herd.collapsed = true;
+                mLodStats.collapses++;
+            }
+            actions[slot] = LOD_COLLAPSE;
+            changed = true;
+        }
+    }
+
+    // Pass 2: apply, member by member
+    if (changed) {
+        std::normal_distribution<double> gauss;
+        for (auto* creature : mCreatures) {
+            if (!creature || !creature->exists || creature->isAlpha || !creature->myAlpha) continue;
+            const int slot = creature->myAlpha->herdSlot;
+            if (actions[slot] == LOD_COLLAPSE && !creature->collapsed) {
+                creature->collapsed = true;
+            } else if (actions[slot] == LOD_EXPAND && creature->collapsed) {
+                expandMember(creature, mAggregates[slot], gauss);
+            }
+        }
+        markCreaturesChanged();
+    }
+
+    mLodStats.collapsedHerds = 0;
+    mLodStats.collapsedCreatures = 0;
+    for (const auto& herd : mAggregates) {
+        if (herd.collapsed) {
+            mLodStats.collapsedHerds++;
+            mLodStats.collapsedCreatures += herd.members;
+        }
+    }
+}
+
+void SimWorld::expandMember(SimpleCreature* member, const HerdAggregate& herd, std::normal_distribution<double>& gauss) {
+    // A plausible spot in the herd as it was when collapsed, resting (its old leg is stale)
+    const SimpleCreature* alpha = member->myAlpha;
+    qreal x = alpha->posX + herd.offsetX + gauss(mRng) * herd.spreadX;
+    qreal y = alpha->posY + herd.offsetY + gauss(mRng) * herd.spreadY;
+    member->posX = member->newX = qBound<qreal>(0, x, mParams.worldWidth);
+    member->posY = member->newY = qBound<qreal>(0, y, mParams.worldHeight);
+    member->state = STATE_RESTING;
+    member->restingTimeLeft = restTicks(mRng, mParams.creatureMinRestTicks, mParams.creatureMaxRestTicks);
+    member->collapsed = false;
+    if (mTrackRecolors) {
+        mRecolored.push_back(member);   // Moves its graphics item too
+    }
+}
+
+int SimWorld::assignHerdSlot(SimpleCreature* alpha) {
+    int slot;
+    if (!mFreeHerdSlots.isEmpty()) {
+        slot = mFreeHerdSlots.takeLast();
+    } else {
+        slot = mAggregates.size();
+        mAggregates.push_back(HerdAggregate());
+        mHerdStats.push_back(HerdStatistics());
+    }
+    mAggregates[slot].alpha = alpha;
+    mHerdStats[slot].alpha = alpha;
+    alpha->herdSlot = slot;
+    return slot;
+}
+
+// === Herd Statistics ===
+void SimWorld::setHerdStatistics(bool enabled) {
+    mHerdStatistics = enabled;
+    if (enabled) {
+        updateHerdStatistics();   // Valid right away, even while paused
+    } else {
+        mHerdSummary = HerdSummary();
+    }
+}
+
+const HerdStatistics* SimWorld::herdStatistics(const SimpleCreature* alpha) const {
+    if (!alpha || alpha->herdSlot < 0 || alpha->herdSlot >= mHerdStats.size()) return nullptr;
+    const HerdStatistics& stats = mHerdStats[alpha->herdSlot];
+    return stats.alpha == alpha ? &stats : nullptr;
+}
+
+void SimWorld::updateHerdStatistics() {
+    TraceScope trace("herd statistics");
+    const int herdCount = mHerdStats.size();
+
+    // Pass 1: every update slice sums its own creatures into its own partials (no locks; the
+    // same placement as the update, so each worker reads creatures already in its cache)
+    const UpdatePlan plan = updatePlan();
+    mHerdPartials.resize(mCreatures.isEmpty() ? 0 : qMin(plan.slices, mCreatures.size()));
+    parallelForPlaced(mCreatures.size(), [this, herdCount](int start, int end, int slice) {
+        QVector<HerdPartial>& partials = mHerdPartials[slice];
+        partials.fill(HerdPartial(), herdCount);
+        HerdPartial* sums = partials.data();
+        for (int i = start; i < end; i++) {
+            const SimpleCreature* creature = mCreatures[i];
+            if (!creature || !creature->exists || creature->isAlpha || !creature->myAlpha) continue;
+            const SimpleCreature* alpha = creature->myAlpha;
+            if (alpha->herdSlot < 0) continue;
+
+            HerdPartial& sum = sums[alpha->herdSlot];
+            sum.members++;
+            if (creature->collapsed) continue;
+            const double dx = creature->posX - alpha->posX;
+            const double dy = creature->posY - alpha->posY;
+            const double distanceSq = dx * dx + dy * dy;
+            const double distance = std::sqrt(distanceSq);
+            sum.simulated++;
+            if (creature->state == STATE_RESTING) {
+                sum.resting++;
+            }
+            sum.sumX += dx;
+            sum.sumY += dy;
+            sum.sumSq += distanceSq;
+            sum.sumDistance += distance;
+            sum.maxDistance = qMax(sum.maxDistance, distance);
+        }
+    }, plan);
+
+    // Pass 2: merge the slices herd by herd; each task owns a range of herd slots
+    parallelFor(herdCount, [this](int start, int end, int) {
+        for (int slot = start; slot < end; slot++) {
+            HerdStatistics& stats = mHerdStats[slot];
+            const SimpleCreature* alpha = stats.alpha;
+            if (!alpha) continue;
+
+            HerdPartial total = HerdPartial();
+            for (const auto& partials : mHerdPartials) {
+                const HerdPartial& sum = partials[slot];
+                total.members += sum.members;
+                total.simulated += sum.simulated;
+                total.resting += sum.resting;
+                total.sumX += sum.sumX;
+                total.sumY += sum.sumY;
+                total.sumSq += sum.sumSq;
+                total.sumDistance += sum.sumDistance;
+                total.maxDistance = qMax(total.maxDistance, sum.maxDistance);
+            }
+
+            stats.members = total.members;
+            stats.estimated = total.simulated < total.members;
+            if (total.simulated > 0) {
+                const double offsetX = total.sumX / total.simulated;
+                const double offsetY = total.sumY / total.simulated;
+                stats.simulated = total.simulated;
+                stats.resting = total.resting;
+                stats.centroidX = alpha->posX + offsetX;
+                stats.centroidY = alpha->posY + offsetY;
+                stats.spread = std::sqrt(qMax(0.0, total.sumSq / total.simulated - offsetX * offsetX - offsetY * offsetY));
+                stats.meanAlphaDistance = total.sumDistance / total.simulated;
+                stats.maxAlphaDistance = total.maxDistance;
+            } else if (mAggregates[slot].collapsed) {
+                // Follows the alpha; resting and alpha distances stay as last measured
+                const HerdAggregate& herd = mAggregates[slot];
+                stats.centroidX = alpha->posX + herd.offsetX;
+                stats.centroidY = alpha->posY + herd.offsetY;
+                stats.spread = std::sqrt(herd.spreadX * herd.spreadX + herd.spreadY * herd.spreadY);
+            } else {
+                stats.simulated = 0;
+                stats.resting = 0;
+                stats.centroidX = alpha->posX;
+                stats.centroidY = alpha->posY;
+                stats.spread = 0;
+                stats.meanAlphaDistance = 0;
+                stats.maxAlphaDistance = 0;
+            }
+        }
+    });
+
+    HerdSummary summary;
+    int measured = 0;
+    int resting = 0;
+    double spreadSum = 0;
+    double distanceSum = 0;
+    for (const HerdStatistics& stats : mHerdStats) {
+        if (!stats.alpha || stats.members == 0) continue;
+        summary.herds++;
+        summary.members += stats.members;
+        summary.largest = qMax(summary.largest, stats.members);
+        spreadSum += stats.spread;
+        measured += stats.simulated;
+        resting += stats.resting;
+        distanceSum += stats.meanAlphaDistance * stats.simulated;
+    }
+    if (summary.herds > 0) {
+        summary.meanSpread = spreadSum / summary.herds;
+    }
+    if (measured > 0) {
+        summary.restingShare = double(resting) / measured;
+        summary.meanAlphaDistance = distanceSum / measured;
+    }
+    mHerdSummary = summary;
+}
+
+// === State Hash ===
+static inline void hashBytes(quint64* hash, const void* data, size_t size) {
+    const uchar* bytes = static_cast<const uchar*>(data);
+    for (size_t i = 0; i < size; i++) {
+        *hash = (*hash ^ bytes[i]) * 1099511628211ull;   // FNV-1a
+    }
+}
+
+template <typename T>
+static inline void hashValue(quint64* hash, const T& value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+quint64 SimWorld::stateHash() const {
+    quint64 hash = 14695981039346656037ull;
+    hashValue(&hash, mTickCount);
+    for (const SimpleCreature* creature : mCreatures) {
+        if (!creature) continue;
+        hashValue(&hash, creature->uniqueID);
+        hashValue(&hash, creature->exists);
+        hashValue(&hash, creature->isAlpha);
+        hashValue(&hash, creature->state);
+        hashValue(&hash, creature->posX);
+        hashValue(&hash, creature->posY);
+        hashValue(&hash, creature->newX);
+        hashValue(&hash, creature->newY);
+        hashValue(&hash, creature->speed);
+        hashValue(&hash, creature->alphaTargetX);
+        hashValue(&hash, creature->alphaTargetY);
+        hashValue(&hash, creature->wanderTargetX);
+        hashValue(&hash, creature->wanderTargetY);
+        hashValue(&hash, creature->alphaRestingTime);
+        hashValue(&hash, creature->restingTimeLeft);
+        hashValue(&hash, creature->myAlpha ? creature->myAlpha->uniqueID : 0);
+        hashValue(&hash, creature->color.rgba());
+    }
+    return hash;
+}
+
+// === Live Edits ===
+int SimWorld::applyCommands() {
+    if (!mCommands.hasPending()) return 0;
+    TraceScope trace("commands");
+    mCommandBatch.resize(COMMAND_BATCH);   // Allocated by the first drain, then reused
+    WorldCommand* batch = mCommandBatch.data();
+    const int count = mCommands.drain(batch, COMMAND_BATCH);
+    mCommandStats.lastBatch = count;
+
+    // Resolve every alpha the batch names in one walk over the herd slots, not the creatures
+    QHash<int, SimpleCreature*> alphas;
+    for (int i = 0; i < count; i++) {
+        if (batch[i].type == COMMAND_MOVE_ALPHA || batch[i].type == COMMAND_RETARGET_HERD) {
+            alphas.insert(batch[i].alphaID, nullptr);
+        }
+    }
+    if (!alphas.isEmpty()) {
+        for (const HerdAggregate& herd : mAggregates) {
+            if (herd.alpha && alphas.contains(herd.alpha->uniqueID)) {
+                alphas[herd.alpha->uniqueID] = herd.alpha;
+            }
+        }
+    }
+
+    // Applied in queue order; the bucket rebuild they need is paid once for the whole batch
+    bool changed = false;
+    for (int i = 0; i < count; i++) {
+        const WorldCommand& command = batch[i];
+        const qreal x = qBound(0.0, command.x, static_cast<qreal>(mParams.worldWidth));
+        const qreal y = qBound(0.0, command.y, static_cast<qreal>(mParams.worldHeight));
+        switch (command.type) {
+            case COMMAND_SPAWN_HERD:
+                spawnHerd(command);
+                mTerrain.reserveChunks(mCreatures.size());
+                break;
+            case COMMAND_MOVE_ALPHA:
+            case COMMAND_RETARGET_HERD: {
+                SimpleCreature* alpha = alphas.value(command.alphaID, nullptr);
+                if (!alpha) {
+                    mCommandStats.stale++;
+                    continue;
+                }
+                if (command.type == COMMAND_MOVE_ALPHA) {
+                    // Set down and rested there as if it had walked; the members catch up on their own
+                    alpha->posX = alpha->newX = x;
+                    alpha->posY = alpha->newY = y;
+                    alpha->state = STATE_ALPHA_RESTING;
+                    alpha->alphaRestingTime = mParams.alphaMinRestTicks;
+                    if (mTrackRecolors) {
+                        mRecolored.push_back(alpha);   // Moves its graphics item now, not at its commit batch
+                    }
+                } else {
+                    alpha->state = STATE_ALPHA_TRAVELING;
+                }
+                alpha->alphaTargetX = x;
+                alpha->alphaTargetY = y;
+                break;
+            }
+            case COMMAND_PAINT_TERRAIN:
+                mTerrain.paint(x, y, command.radius, command.terrain);
+                break;
+        }
+        mCommandStats.applied++;
+        changed = true;
+    }
+    if (changed) {
+        markCreaturesChanged();
+        mLodDirty = true;   // Spawned or moved herds may belong on the other side of the detail region
+    }
+    return count;
+}
+
+void SimWorld::spawnHerd(const WorldCommand& command) {
+    const int count = qBound(1, command.count, mParams.herdMaxSize);
+    const qreal radius = qMax(0.0, command.radius);
+    const qreal width = mParams.worldWidth;
+    const qreal height = mParams.worldHeight;
+    auto clampX = [width](qreal value) { return qBound(0.0, value, width); };
+    auto clampY = [height](qreal value) { return qBound(0.0, value, height); };
+
+    SimpleCreature* alpha = new SimpleCreature;
+    initCreatureData(alpha, clampX(command.x), clampY(command.y), true, getUniqueID(), mRng);
+    assignHerdSlot(alpha);
+    mCreatures.push_back(alpha);
+    if (mTrackRecolors) {
+        mSpawned.push_back(alpha);
+    }
+
+    // Members uniformly over the disc around the alpha, already in its herd
+    for (int i = 1; i < count; i++) {
+        qreal dx, dy;
+        do {
+            dx = (2 * mRng.generateDouble() - 1) * radius;
+            dy = (2 * mRng.generateDouble() - 1) * radius;
+        } while (dx * dx + dy * dy > radius * radius);
+        SimpleCreature* member = new SimpleCreature;
+        initCreatureData(member, clampX(command.x + dx), clampY(command.y + dy), false, getUniqueID(), mRng);
+        member->myAlpha = alpha;
+        member->color = alpha->color;
+        mCreatures.push_back(member);
+        if (mTrackRecolors) {
+            mSpawned.push_back(member);
+        }
+    }
+    mCommandStats.spawned += count;
+}
+
+const SimpleCreature* SimWorld::nearestAlpha(qreal x, qreal y, qreal maxDistance) const {
+    const SimpleCreature* nearest = nullptr;
+    qreal nearestDistance = maxDistance;
+    for (const HerdAggregate& herd : mAggregates) {
+        if (!herd.alpha) continue;
+        const qreal distance = distanceBetween(x, y, herd.alpha->posX + herd.alpha->size / 2, herd.alpha->posY + herd.alpha->size / 2);
+        if (distance <= nearestDistance) {
+            nearest = herd.alpha;
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
+
+QVector<SimpleCreature*> SimWorld::takeSpawnedCreatures() {
+    QVector<SimpleCreature*> spawned;
+    spawned.swap(mSpawned);
+    return spawned;
+}
+
+// === Creature Methods ===
+SimpleCreature* SimWorld::createCreature(qreal x, qreal y, bool isAlpha) {
+    SimpleCreature* creature = new SimpleCreature;
+    initCreatureData(creature, x, y, isAlpha, getUniqueID(), mRng);
+    if (isAlpha) {
+        assignHerdSlot(creature);
+    }
+    mCreatures.push_back(creature);
+    markCreaturesChanged();
+    return creature;
+}
+
+void SimWorld::addCreature(SimpleCreature* creature) {
+    creature->censusMembers = -1;   // Census and LOD state belonged to the world it came from
+    creature->herdSize = -1;
+    creature->herdSlot = -1;
+    creature->collapsed = false;
+    if (creature->isAlpha) {
+        assignHerdSlot(creature);
+    }
+    mCreatures.push_back(creature);
+    markCreaturesChanged();
+}
+
+SimpleCreature* SimWorld::takeCreature(int index) {
+    // Swap-remove; callers must not hold indices across this call
+    SimpleCreature* creature = mCreatures[index];
+    mCreatures[index] = mCreatures.last();
+    mCreatures.removeLast();
+    markCreaturesChanged();
+
+    // Housekeeping must not keep pointers to a creature this world no longer owns
+    mPendingOrphans.removeAll(creature);
+    if (creature->censusMembers >= 0) {
+        mCensusHerds.removeAll(creature);
+    }
+    if (creature->herdSize >= 0) {
+        mHerds.removeAll(creature);
+    }
+    mOpenHerds.removeAll(creature);
+    mSpawned.removeAll(creature);
+
+    // Anyone following the departing creature becomes an orphan (and is simulated again);
+    // its herd slot is free for the next alpha
+    if (creature->herdSlot >= 0) {
+        mAggregates[creature->herdSlot] = HerdAggregate();
+        mHerdStats[creature->herdSlot] = HerdStatistics();
+        mFreeHerdSlots.push_back(creature->herdSlot);
+        creature->herdSlot = -1;
+    }
+    if (creature->isAlpha) {
+        for (auto* member : mCreatures) {
+            if (member->myAlpha == creature) {
+                member->myAlpha = nullptr;
+                member->collapsed = false;
+                mPendingOrphans.push_back(member);
+            }
+        }
+    } else if (creature->myAlpha && creature->myAlpha->herdSize > 0) {
+        creature->myAlpha->herdSize--;
+    }
+    return creature;
+}
+
+void SimWorld::snapshot(TrajectoryFrame* frame) const {
+    // Copy committed state only; consumers never see live creatures
+    frame->tick = mTickCount;
+    frame->creatures.resize(mCreatures.size());
+
+    TrajectoryCreature* out = frame->creatures.data();
+    for (int i = 0; i < mCreatures.size(); i++) {
+        out[i] = trajectoryCreature(mCreatures[i]);
+    }
+}
+
+TrajectoryCreature SimWorld::trajectoryCreature(const SimpleCreature* creature) {
+    TrajectoryCreature out;
+    out.uniqueID = creature->uniqueID;
+    out.posX = qRound(creature->posX);
+    out.posY = qRound(creature->posY);
+    out.alphaID = creature->myAlpha ? creature->myAlpha->uniqueID : 0;
+    out.state = static_cast<quint8>(creature->state);
+    out.isAlpha = creature->isAlpha ? 1 : 0;
+    return out;
+}
+
+int SimWorld::reserveUniqueIDs(int count) {
+    int first = mNextUniqueID;
+    mNextUniqueID += count;
+    return first;
+}
+
+void SimWorld::initCreatureData(SimpleCreature* creature, qreal x, qreal y, bool isAlpha, int uniqueID, QRandomGenerator& rng) {
+    // Pure data setup - no scene access, so it is safe to call from worker threads
+    creature->censusMembers = -1;
+    creature->herdSize = -1;
+    creature->herdSlot = -1;
+    creature->collapsed = false;
+    creature->posX = x;
+    creature->posY = y;
+    creature->newX = x;
+    creature->newY = y;
+
+    // Set speeds based on creature type
+    if (isAlpha) {
+        creature->speed = mParams.alphaSpeed;  // Alphas move slowly
+    } else {
+        creature->speed = mParams.creatureSpeed;  // Creatures move at normal speed
+    }
+    creature->originalSpeed = creature->speed;
+
+    creature->size = MainWindow::DEFAULT_CREATURE_SIZE + rng.bounded(50);
+
+    // Alpha system
+    creature->isAlpha = isAlpha;
+    creature->myAlpha = nullptr;
+
+    // *** FIX: Initialize alpha targets using small box logic ***
+    if (isAlpha) {
+        // Give alphas small local destinations using the same box logic as normal wandering
+        qreal offsetX = rng.bounded(mParams.alphaWanderDistance * 2 + 1) - mParams.alphaWanderDistance;
+        qreal offsetY = rng.bounded(mParams.alphaWanderDistance * 2 + 1) - mParams.alphaWanderDistance;
+
+        qreal targetX = x + offsetX;  // Use spawn position + small offset
+        qreal targetY = y + offsetY;
+
+        // Keep target within world bounds
+        targetX = qMax(0.0, qMin(static_cast<qreal>(mParams.worldWidth), targetX));
+        targetY = qMax(0.0, qMin(static_cast<qreal>(mParams.worldHeight), targetY));
+
+        creature->alphaTargetX = targetX;
+        creature->alphaTargetY = targetY;
+    } else {
+        creature->alphaTargetX = 0;  // Non-alphas don't use these
+        creature->alphaTargetY = 0;
+    }
+
+    creature->alphaRestingTime = 0;
+
+    // Herding system
+    creature->herdTarget = nullptr;
+    creature->hasHerdTarget = false;
+    creature->restingTimeLeft = 0;
+    creature->herdingRange = creature->size * 4.0;     // Seek herds within 4 diameters
+
+    // Dynamic elbow room: randomize each creature's personal space preference
+    creature->elbowRoomRange = rng.bounded(static_cast<int>(MainWindow::ELBOW_ROOM_FACTOR * 100)) / 100.0; // 0.0 to MainWindow::ELBOW_ROOM_FACTOR
+
+    // Wandering system
+    creature->wanderTargetX = 0;
+    creature->wanderTargetY = 0;
+
+    creature->exists = true;
+    creature->uniqueID = uniqueID;
+    creature->graphicsItem = nullptr;
+
+    // Set initial state and color
+    if (isAlpha) {
+        creature->state = STATE_ALPHA_TRAVELING;
+        // Alphas get the same herd color as their members, but with a black ring
+        creature->color = generateHerdColor(creature->uniqueID); // Same color as herd
+    } else {
+        creature->state = STATE_RESTING;  // Start followers in resting state
+        // Herd members get a bright random color (will be overridden when assigned to alpha)
+        creature->color = getRandomBrightColor(rng);
+        creature->restingTimeLeft = restTicks(rng, mParams.creatureMinRestTicks, mParams.creatureMaxRestTicks);
+    }
+}
+
+qreal SimWorld::distanceBetween(qreal x1, qreal y1, qreal x2, qreal y2) {
+    qreal dx = x2 - x1;
+    qreal dy = y2 - y1;
+    return sqrt(dx * dx + dy * dy);
+}
+
+// === Utility Methods ===
+bool SimWorld::isValidCoordinate(qreal x, qreal y) const {
+    return x >= 0 && x < mParams.worldWidth && y >= 0 && y < mParams.worldHeight;
+}
+
+QColor SimWorld::getRandomBrightColor(QRandomGenerator& rng) {
+    // Generate bright, saturated colors for better visibility
+    int colorChoice = rng.bounded(12);
+    switch (colorChoice) {
+        case 0: return QColor(255, 100, 100);  // Bright red
+        case 1: return QColor(100, 255, 100);  // Bright green
+        case 2: return QColor(100, 100, 255);  // Bright blue
+        case 3: return QColor(255, 255, 100);  // Bright yellow
+        case 4: return QColor(255, 100, 255);  // Bright magenta
+        case 5: return QColor(100, 255, 255);  // Bright cyan
+        case 6: return QColor(255, 165, 0);    // Orange
+        case 7: return QColor(255, 20, 147);   // Deep pink
+        case 8: return QColor(50, 205, 50);    // Lime green
+        case 9: return QColor(138, 43, 226);   // Blue violet
+        case 10: return QColor(255, 140, 0);   // Dark orange
+        case 11: return QColor(30, 144, 255);  // Dodger blue
+        default: return QColor(255, 100, 100); // Default bright red
+    }
+}
+
+QColor SimWorld::generateHerdColor(int alphaID) {
+    // Generate consistent herd colors based on alpha ID
+    // Use the alpha ID as a seed for consistent color generation
+    QRandomGenerator generator(alphaID);
+
+    // Generate bright, saturated colors for each herd
+    int hue = generator.bounded(360);  // 0-359 degrees on color wheel
+    int saturation = 200 + generator.bounded(56); // 200-255 (high saturation)
+    int value = 200 + generator.bounded(56);      // 200-255 (high brightness)
+
+    return QColor::fromHsv(hue, saturation, value);
+}
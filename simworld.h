@@ -0,0 +1,551 @@
+// 2dsim08/simworld.h - Headless simulation core (creatures, terrain data, tick pipeline)
+#ifndef SIMWORLD_H
+#define SIMWORLD_H
+
+#include <QThreadPool>
+#include <QRandomGenerator>
+#include <QGraphicsEllipseItem>
+#include <QColor>
+#include <QRectF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMutex>
+#include <QHash>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <random>
+#include "simprecision.h"
+#include "simarena.h"
+#include "memorystats.h"
+#include "trajectoryformat.h"
+#include "terrainchunks.h"
+#include "worldcommands.h"
+
+// === Simple Enums ===
+enum CreatureState {
+    STATE_SEEKING_HERD,      // Looking for another creature in same herd to follow
+    STATE_MOVING_TO_HERD,    // Moving toward herd target (same herd member)
+    STATE_FINDING_SPACE,     // Trying to find elbow room (avoiding overlap)
+    STATE_RESTING,           // Socially satisfied, resting
+    STATE_WANDERING,         // Moving to random point near alpha
+    STATE_ALPHA_TRAVELING,   // Alpha moving to chosen destination
+    STATE_ALPHA_RESTING      // Alpha resting at destination
+};
+
+// === Simple Structs (Alpha-Led Multi-Herd System) ===
+// Kinematic fields are SimScalar (double unless built with reduced precision, see simprecision.h)
+struct SimpleCreature : MemoryTagged<MEMORY_CREATURES> {
+    // Position and movement
+    SimScalar posX;
+    SimScalar posY;
+    SimScalar newX;
+    SimScalar newY;
+    SimScalar speed;
+    SimScalar originalSpeed;
+    SimScalar size;
+
+    // Alpha system
+    bool isAlpha;
+    SimpleCreature* myAlpha;         // Which alpha do I follow?
+    SimScalar alphaTargetX;          // For alphas: destination X
+    SimScalar alphaTargetY;          // For alphas: destination Y
+    int alphaRestingTime;            // For alphas: how long to rest at destination
+
+    // Herding system (within herd only)
+    SimpleCreature* herdTarget;      // Random member of same herd to follow
+    bool hasHerdTarget;
+    int restingTimeLeft;
+    SimScalar herdingRange;    // How close to get to herd target
+    SimScalar elbowRoomRange;  // Personal space distance (dynamically calculated)
+
+    // Wandering system
+    SimScalar wanderTargetX;   // Random wander destination X
+    SimScalar wanderTargetY;   // Random wander destination Y
+
+    // Graphics and state
+    QGraphicsEllipseItem* graphicsItem;
+    QColor color;            // Herd color (shared among herd members)
+    CreatureState state;
+    bool exists;
+    int uniqueID;
+
+    // Housekeeping census (alphas only; -1 = not counted)
+    int censusMembers;         // Counted so far by the census in progress
+    int herdSize;              // At the last complete census, kept current by rehoming
+
+    // Level of detail and herd statistics (see SimWorld::setLevelOfDetail, setHerdStatistics)
+    int herdSlot;              // Alphas: index of the herd's aggregate and statistics (-1 = none yet)
+    bool collapsed;            // Members: carried by the herd aggregate, not simulated
+};
+
+// === Alpha Spatial Grid ===
+// Uniform bucket grid over the alphas so nearest-alpha lookups don't scan every alpha.
+// Built once on the main thread, then read-only (safe to query from worker threads).
+struct AlphaGrid {
+    int cols;
+    int rows;
+    qreal cellSize;
+    QVector<QVector<SimpleCreature*>> cells;
+
+    AlphaGrid() : cols(0), rows(0), cellSize(1.0) {}
+    void build(const QVector<SimpleCreature*>& alphas, qreal worldWidth, qreal worldHeight);
+    SimpleCreature* nearest(qreal x, qreal y) const;
+};
+
+// === Precision Check ===
+// Validates reduced-precision builds against a double-precision reference while running.
+// Every movement step is recomputed in double from the same stored inputs (step error), and
+// a double shadow of each creature follows the same decisions along each leg until it
+// arrives (drift, i.e. how far the reduced-precision trajectory wanders off the reference).
+struct PrecisionStats {
+    double maxStepError;
+    double sumStepError;
+    double maxDrift;
+    qint64 steps;
+
+    PrecisionStats() : maxStepError(0), sumStepError(0), maxDrift(0), steps(0) {}
+    void add(const PrecisionStats& other);
+};
+
+struct PrecisionCheck {
+    double worldWidth;           // Steps are clamped to the world like the kernels'
+    double worldHeight;
+    QVector<double> shadowX;
+    QVector<double> shadowY;
+    QVector<double> shadowNewX;
+    QVector<double> shadowNewY;
+    bool stale;                  // Creatures were added/removed; re-seed the shadows
+
+    QMutex statsMutex;
+    PrecisionStats stats;
+
+    PrecisionCheck() : worldWidth(0), worldHeight(0), stale(true) {}
+    void reset(const QVector<SimpleCreature*>& creatures);
+    // Worker side: one call per creature per update, into task-local stats
+    void recordMove(int index, const SimpleCreature* creature, SimReal targetX, SimReal targetY, bool arrived, PrecisionStats* local);
+    void recordStill(int index, const SimpleCreature* creature);
+    void merge(const PrecisionStats& local);
+    void commit(int index);
+};
+
+// === Herd Level of Detail ===
+// A herd wholly outside the detail region is collapsed into one of these: its members stop
+// being simulated and the herd is carried by its alpha, which still is. When the herd comes
+// near the region again its members are re-expanded around the alpha, drawn from the stored
+// centroid and spread.
+struct HerdAggregate {
+    SimpleCreature* alpha;       // nullptr once the alpha left this world
+    bool collapsed;
+    int members;                 // At the last LOD pass
+    double offsetX;              // Member centroid relative to the alpha
+    double offsetY;
+    double spreadX;              // Standard deviation of the members around the centroid
+    double spreadY;
+
+    // Scratch for one LOD pass: members still simulated individually
+    int expanded;
+    double sumX, sumY, sumSqX, sumSqY;
+    double minX, minY, maxX, maxY;
+
+    HerdAggregate() : alpha(nullptr), collapsed(false), members(0), offsetX(0), offsetY(0), spreadX(0), spreadY(0),
+                      expanded(0), sumX(0), sumY(0), sumSqX(0), sumSqY(0), minX(0), minY(0), maxX(0), maxY(0) {}
+};
+
+// === Herd Statistics ===
+// One herd as measured after the last tick's commit. Kept per herd slot (like HerdAggregate),
+// so a question about a herd is a lookup, not a scan of the creatures.
+struct HerdStatistics {
+    SimpleCreature* alpha;       // nullptr = free slot
+    int members;                 // Including members collapsed by level of detail
+    int simulated;               // Members measured individually this tick
+    int resting;                 // Of those, members in STATE_RESTING
+    double centroidX;            // Member centroid (the alpha itself while the herd is empty)
+    double centroidY;
+    double spread;               // RMS distance of the members from the centroid
+    double meanAlphaDistance;
+    double maxAlphaDistance;
+    bool estimated;              // Collapsed: centroid and spread from the aggregate, the rest as last measured
+
+    HerdStatistics() : alpha(nullptr), members(0), simulated(0), resting(0), centroidX(0), centroidY(0), spread(0),
+                       meanAlphaDistance(0), maxAlphaDistance(0), estimated(false) {}
+    double restingShare() const { return simulated > 0 ? double(resting) / simulated : 0.0; }
+};
+
+// All herds together, merged from the same pass
+struct HerdSummary {
+    int herds;                   // Alphas with at least one member
+    int members;
+    int largest;
+    double restingShare;         // Of the members measured individually
+    double meanSpread;           // Over herds, unweighted
+    double meanAlphaDistance;    // Over members
+
+    HerdSummary() : herds(0), members(0), largest(0), restingShare(0), meanSpread(0), meanAlphaDistance(0) {}
+};
+
+struct LodStats {
+    int collapsedHerds;
+    int collapsedCreatures;      // Members not simulated individually right now
+    qint64 collapses;            // Herds collapsed / expanded since level of detail was turned on
+    qint64 expansions;
+
+    LodStats() : collapsedHerds(0), collapsedCreatures(0), collapses(0), expansions(0) {}
+};
+
+// === Behavior Buckets ===
+// Creatures of one update slice, grouped by (alpha/member, state) as index lists. Each bucket
+// runs its own template-specialized kernel, and the kernels append every creature to the list
+// for its next state, so the grouping follows transitions without re-scanning the slice.
+enum BehaviorBucket {
+    BUCKET_ALPHA_TRAVELING,
+    BUCKET_ALPHA_RESTING,
+    BUCKET_ALPHA_IDLE,          // No destination yet
+    BUCKET_MEMBER_RESTING,
+    BUCKET_MEMBER_WANDERING,
+    BUCKET_MEMBER_SETTLING,     // Legacy herd-seeking states (and anything unknown) -> resting
+    BUCKET_INACTIVE,            // Null, !exists or collapsed; never updated (must stay last)
+    BUCKET_COUNT
+};
+
+struct CreatureBuckets {
+    int start;                  // Slice these lists were built for
+    int end;
+    QVector<int> current[BUCKET_COUNT];
+    QVector<int> next[BUCKET_COUNT];
+
+    CreatureBuckets() : start(0), end(0) {}
+    void rebuild(const QVector<SimpleCreature*>& creatures, int first, int last);
+    void swap();                // next -> current after an update (the inactive list stays as is)
+};
+
+// === Update Plan ===
+// How the update phase is spread over the pool: `workers` tasks share `slices` equal chunks of
+// the creature list (more slices than workers = finer grain, claimed dynamically). 0 = one
+// slice per pool thread. One worker runs every slice on the tick thread itself.
+struct UpdatePlan {
+    int workers;
+    int slices;
+
+    UpdatePlan(int workerCount = 0, int sliceCount = 0) : workers(workerCount), slices(sliceCount) {}
+    bool operator==(const UpdatePlan& other) const { return workers == other.workers && slices == other.slices; }
+    bool operator!=(const UpdatePlan& other) const { return !(*this == other); }
+};
+
+// Creatures per behavior bucket after the last update (what the auto-tuner watches for drift)
+struct UpdateMix {
+    int counts[BUCKET_COUNT];
+    int total;
+};
+
+class AutoTuner;
+
+// === Housekeeping ===
+// Housekeeping walks the creatures a few chunks per tick (as many as the time budget allows),
+// counting herd sizes and rehoming orphans into herds that had room at the last full census.
+struct HousekeepingStats {
+    qint64 lastBudgetMicros;
+    qint64 lastUsedMicros;
+    int lastCreatures;           // Creatures censused last tick
+    int pendingOrphans;
+    int passes;                  // Completed censuses
+    int lastPassTicks;           // Ticks the last complete census took
+    int openHerds;               // Herds below HERD_MAX_SIZE at the last census
+    int censusAlphas;            // Alphas counted by the last census
+    int censusOrphans;           // Orphans the last census found
+    qint64 orphansRehomed;
+
+    HousekeepingStats() : lastBudgetMicros(0), lastUsedMicros(0), lastCreatures(0), pendingOrphans(0),
+                          passes(0), lastPassTicks(0), openHerds(0), censusAlphas(0), censusOrphans(0),
+                          orphansRehomed(0) {}
+};
+
+// Wall time of each tick phase, in microseconds
+struct TickTimings {
+    qint64 commandsMicros;
+    qint64 orphansMicros;
+    qint64 updateMicros;
+    qint64 commitMicros;
+    qint64 housekeepingMicros;
+    qint64 statisticsMicros;
+    qint64 totalMicros;
+
+    TickTimings() : commandsMicros(0), orphansMicros(0), updateMicros(0), commitMicros(0), housekeepingMicros(0), statisticsMicros(0),
+                    totalMicros(0) {}
+};
+
+// Commands applied from the queue since construction (see SimWorld::applyCommands)
+struct CommandStats {
+    qint64 applied;
+    qint64 stale;                // Named an alpha this world does not have (left, or never did)
+    qint64 spawned;              // Creatures
+    int lastBatch;               // Commands the last drain took
+
+    CommandStats() : applied(0), stale(0), spawned(0), lastBatch(0) {}
+};
+
+// === Behavior Parameters ===
+// The herd behavior knobs and the world size, per world. Defaults are MainWindow's constants of
+// the same names; scenarios (see scenario.h) and the ensemble runner (see ensemble.h) override
+// them by those names.
+struct SimParams {
+    int worldWidth;              // WORLD_SCENE_WIDTH (terrain: one cell per TERRAIN_SIZE units)
+    int worldHeight;             // WORLD_SCENE_HEIGHT
+    int alphaRatio;              // ALPHA_RATIO: 1 alpha per this many creatures
+    int herdMaxSize;             // HERD_MAX_SIZE
+    int herdFootprint;           // HERD_GROUP_FOOTPRINT_SIZE: members wander this far around the alpha
+    int creatureSpeed;           // CREATURE_SPEED_NORMAL
+    int alphaSpeed;              // ALPHA_SPEED_SLOW
+    int creatureMinRestTicks;    // CREATURE_MIN_REST_TICKS
+    int creatureMaxRestTicks;    // CREATURE_MAX_REST_TICKS
+    int alphaMinRestTicks;       // ALPHA_MIN_REST_DURATION
+    int alphaMaxRestTicks;       // ALPHA_MAX_REST_DURATION
+    int alphaWanderDistance;     // ALPHA_NORMAL_WANDER_DISTANCE
+
+    SimParams();
+    bool set(const QString& name, int value);   // By constant name; false if unknown
+    int value(const QString& name) const;
+    bool isValid(QString* error) const;
+    static QStringList names();
+    QRectF worldRect() const { return QRectF(0, 0, worldWidth, worldHeight); }
+    bool operator==(const SimParams& other) const;
+    bool operator!=(const SimParams& other) const { return !(*this == other); }
+};
+
+// Which build of the behavior kernels runs: one of the compile-time profiles (world bounds,
+// ranges and rest spans folded into the code) when the parameters match it exactly, else the
+// generic build that reads them from SimParams. See the Kernel Profiles section of simworld.cpp.
+enum KernelProfile {
+    KERNEL_PROFILE_RUNTIME,
+    KERNEL_PROFILE_DEFAULT,      // MainWindow's constants
+    KERNEL_PROFILE_LARGE,        // Scenario "large"
+    KERNEL_PROFILE_HUGE          // Scenario "huge"
+};
+KernelProfile kernelProfileFor(const SimParams& params);
+const char* kernelProfileName(KernelProfile profile);
+
+// Thread-safe debug output (shown only when the GUI has debug output on; no-op headless)
+void appendToOutput(const QString& text);
+bool debugOutputEnabled();   // Check before formatting a message in a hot path
+
+// === Simulation World ===
+// Owns creature and terrain data and runs the tick pipeline. Knows nothing about the scene:
+// graphicsItem pointers are filled in (and kept in sync) by MainWindow, and stay null when
+// the world runs headless (shards, batch runs).
+class SimWorld
+{
+public:
+    explicit SimWorld(QThreadPool* threadPool = nullptr);  // nullptr = run tasks inline
+    ~SimWorld();
+
+    // === Configuration (before setup) ===
+    void setRegion(const QRectF& region) { mRegion = region; }   // Area this world spawns into
+    QRectF region() const { return mRegion; }
+    void setUniqueIDBase(int firstID) { mNextUniqueID = firstID; }
+    void setCommitBatchSize(int creatures) { mCommitBatchSize = creatures; }  // 0 = all per tick
+    void setTrackRecolors(bool enabled) { mTrackRecolors = enabled; }
+    void setProcessEventsWhileWaiting(bool enabled) { mProcessEventsWhileWaiting = enabled; }
+    void setLogger(const std::function<void(const QString&)>& logger) { mLogger = logger; }
+    void setParams(const SimParams& params);       // Before setupTerrain; the region follows a whole-world region
+    const SimParams& params() const { return mParams; }
+    void setSimulatedCoreLoad(bool enabled) { mSimulatedCoreLoad = enabled; }   // USE_PCT_CORE sleep; on by default
+    // Same seed -> bit-identical state on any thread count: kernel randomness keyed on (seed, tick,
+    // creature), housekeeping budgeted in creatures instead of time. Before setupCreatures.
+    void setDeterministic(bool enabled) { mDeterministic = enabled; }
+    bool isDeterministic() const { return mDeterministic; }
+    KernelProfile kernelProfile() const { return mKernelProfile; }   // Chosen by setParams
+    void setUpdatePlan(const UpdatePlan& plan) { mUpdatePlan = plan; }
+    UpdatePlan updatePlan() const;                 // As run: defaults resolved
+    // Times the update phase under different plans during warm-up and keeps the fastest;
+    // tunes again when the population or the behavior mix drifts (see AutoTuner)
+    void setAutoTune(bool enabled);
+    const AutoTuner* autoTuner() const { return mAutoTuner; }
+    void setTickBudget(qint64 micros) { mTickBudgetMicros = micros; }   // Tick interval; 0 = unthrottled
+    qint64 tickBudget() const { return mTickBudgetMicros; }
+    void setPrecisionCheck(bool enabled);        // See PrecisionCheck; reports every PRECISION_REPORT_INTERVAL ticks
+    static const int PRECISION_REPORT_INTERVAL = 250;
+    static const int SETUP_RANDOM_BLOCK = 1024;     // Creatures per setup random stream
+
+    // === Level of Detail ===
+    // Off (default): every creature is simulated individually. On: a herd wholly outside the
+    // detail region (grown by LOD_MARGIN) collapses into a HerdAggregate that follows its alpha,
+    // and expands again as it nears the region. Checked every LOD_INTERVAL ticks, or on the next
+    // tick once the region has moved by a quarter margin.
+    void setLevelOfDetail(bool enabled);
+    bool levelOfDetail() const { return mLevelOfDetail; }
+    void setDetailRegion(const QRectF& region);
+    const LodStats& lodStats() const { return mLodStats; }
+    const QVector<HerdAggregate>& aggregates() const { return mAggregates; }   // By herd slot
+    static const int LOD_INTERVAL = 10;
+    static const int LOD_MARGIN = 4000;                  // About one alpha leg between checks
+    static constexpr double LOD_SPREAD_SIGMAS = 2.5;     // Collapsed herd extent around its centroid
+
+    // === Herd Statistics ===
+    // Off (default): no cost. On: after every commit one parallel pass over the creatures sums
+    // each herd into per-slice partials, which are then merged slot by slot (also in parallel).
+    void setHerdStatistics(bool enabled);
+    bool herdStatisticsEnabled() const { return mHerdStatistics; }
+    const QVector<HerdStatistics>& herdStatistics() const { return mHerdStats; }   // By herd slot
+    const HerdStatistics* herdStatistics(const SimpleCreature* alpha) const;      // nullptr if unknown here
+    const HerdSummary& herdSummary() const { return mHerdSummary; }
+
+    // === Live Edits ===
+    // Any thread pushes WorldCommands into commands(); tick() applies what is queued before its
+    // first phase (at most COMMAND_BATCH per tick, the rest next tick), so no edit ever lands
+    // inside a parallel phase. Spawned creatures are listed for whoever draws them.
+    WorldCommandQueue& commands() { return mCommands; }
+    int applyCommands();               // Tick thread, between ticks (tick() calls it first)
+    QVector<SimpleCreature*> takeSpawnedCreatures();
+    const SimpleCreature* nearestAlpha(qreal x, qreal y, qreal maxDistance) const;   // Over the herd slots
+    const CommandStats& commandStats() const { return mCommandStats; }
+    static const int COMMAND_BATCH = 256;
+
+    // === Setup ===
+    void setupTerrain(quint32 seed);
+    void setupCreatures(int count, quint32 seed);
+
+    // === Tick Pipeline ===
+    void tick();                       // Queued commands, then all phases below, in order
+    void assignOrphans();
+    void updateCreaturesParallel();
+    void commitCreatures();
+    void runHousekeeping(qint64 budgetMicros);   // Resumes the census where the last call stopped
+    const HousekeepingStats& housekeepingStats() const { return mHousekeepingStats; }
+    const QVector<SimpleCreature*>& herds() const { return mHerds; }   // Alphas at the last census (see herdSize)
+    const TickTimings& lastTickTimings() const { return mLastTickTimings; }
+    // Time pool workers spent inside parallelFor/parallelForPlaced bodies, since construction
+    qint64 workerBusyNanos() const { return mWorkerBusyNanos.load(std::memory_order_relaxed); }
+    int lastCommitStart() const { return mLastCommitStart; }
+    int lastCommitEnd() const { return mLastCommitEnd; }
+    qint64 tickCount() const { return mTickCount; }
+    quint64 stateHash() const;         // FNV-1a over every creature's simulation state, in order
+
+    // === Creatures ===
+    SimpleCreature* createCreature(qreal x, qreal y, bool isAlpha);   // Data only, appended
+    void initCreatureData(SimpleCreature* creature, qreal x, qreal y, bool isAlpha, int uniqueID, QRandomGenerator& rng);
+    void addCreature(SimpleCreature* creature);                         // Takes ownership
+    SimpleCreature* takeCreature(int index);                            // Releases ownership
+    const QVector<SimpleCreature*>& creatures() const { return mCreatures; }
+    QVector<SimpleCreature*> takeRecoloredCreatures();   // Joined a herd, were re-expanded or moved (new position)
+    void snapshot(TrajectoryFrame* frame) const;
+    static TrajectoryCreature trajectoryCreature(const SimpleCreature* creature);
+    int getUniqueID() { return mNextUniqueID++; }
+    int reserveUniqueIDs(int count);   // Returns first ID of a contiguous block
+
+    // === Terrain ===
+    const TerrainChunks& terrain() const { return mTerrain; }
+    TerrainType terrainTypeAt(qreal x, qreal y) const { return mTerrain.typeAt(x, y); }
+
+    // === Helpers ===
+    void parallelFor(int count, const std::function<void(int start, int end, int taskId)>& body);
+    // One slice per worker, each preferably run by the same pool thread every call (see cputopology.h)
+    void parallelForPlaced(int count, const std::function<void(int start, int end, int slice)>& body,
+                           const UpdatePlan& plan = UpdatePlan());
+    QThreadPool* threadPool() const { return mThreadPool; }
+    static QColor generateHerdColor(int alphaID);
+    static QColor getRandomBrightColor(QRandomGenerator& rng);
+    static qreal distanceBetween(qreal x1, qreal y1, qreal x2, qreal y2);
+    bool isValidCoordinate(qreal x, qreal y) const;
+
+private:
+    void setHerd(SimpleCreature* creature, SimpleCreature* alpha);
+    void log(const QString& text) { if (mLogger) mLogger(text); }
+    void waitForTasks();
+    void reportPrecision();
+    // Microseconds housekeeping may use this tick: half the slack left in the tick budget, more when orphans pile up
+    qint64 housekeepingBudget(qint64 usedMicros) const;
+    struct CensusRecord {
+        SimpleCreature* herd;      // Alpha
+        int members;               // 0 for the alpha itself, so empty herds are counted too
+    };
+    void censusRange(int start, int end, ArenaVector<SimpleCreature*>* orphans);
+    void censusRecords(int start, int end, ArenaVector<CensusRecord>* records, ArenaVector<SimpleCreature*>* orphans) const;
+    void countCensus(SimpleCreature* herd, int members);
+    TickArena* taskArena(int taskId) { return &mTaskArenas[taskId]; }
+    void resetArenas();
+    bool rehomeOrphan(SimpleCreature* orphan);
+    void finishHousekeepingPass();
+    UpdateMix updateMix() const;
+    void updateLevelOfDetail(bool expandAll);
+    int assignHerdSlot(SimpleCreature* alpha);   // Aggregate and statistics slot, reusing freed ones
+    struct HerdPartial {
+        int members;
+        int simulated;
+        int resting;
+        double sumX, sumY;          // Relative to the alpha
+        double sumSq;
+        double sumDistance;
+        double maxDistance;
+    };
+    void updateHerdStatistics();
+    void spawnHerd(const WorldCommand& command);
+    void expandMember(SimpleCreature* member, const HerdAggregate& herd, std::normal_distribution<double>& gauss);
+    // Creatures were added, removed or had their state changed outside the update kernel
+    void markCreaturesChanged() { mBucketsStale = true; if (mPrecisionCheck) mPrecisionCheck->stale = true; }
+
+    QThreadPool* mThreadPool;
+    QRectF mRegion;
+    int mNextUniqueID;
+    int mCommitBatchSize;
+    QVector<int> mCommitChunks;                     // Terrain chunks of the batch being committed; capacity reused
+    QVector<QPointF> mCommitPoints;                 // Where its creatures land, and the terrain there
+    QVector<uchar> mCommitTypes;
+    bool mTrackRecolors;
+    bool mProcessEventsWhileWaiting;
+    std::function<void(const QString&)> mLogger;
+    SimParams mParams;
+    KernelProfile mKernelProfile;
+    bool mSimulatedCoreLoad;
+    bool mDeterministic;
+    quint32 mSeed;              // Creature seed; keys the kernels' random streams when deterministic
+    QRandomGenerator mRng;      // Main-thread randomness (housekeeping, water respawn)
+
+    QVector<SimpleCreature*> mCreatures;
+    TerrainChunks mTerrain;
+    QVector<SimpleCreature*> mRecolored;
+    QVector<CreatureBuckets> mBuckets;   // One per update slice
+    UpdatePlan mUpdatePlan;
+    AutoTuner* mAutoTuner;               // nullptr unless auto-tuning
+
+    qint64 mTickCount;
+    int mCurrentCreatureIndex;
+    int mLastCommitStart;
+    int mLastCommitEnd;
+    int mHousekeepingCreatureIndex;
+    qint64 mTickBudgetMicros;
+    qint64 mHousekeepingPassStart;                  // Tick the census in progress started
+    int mCensusOrphans;                             // Orphans found by the census in progress
+    QVector<SimpleCreature*> mCensusHerds;          // Alphas counted by the census in progress
+    QVector<SimpleCreature*> mHerds;                // Alphas at the last complete census
+    QVector<SimpleCreature*> mOpenHerds;            // Alphas with room at the last census
+    QVector<SimpleCreature*> mPendingOrphans;       // Orphans waiting for an open herd
+    HousekeepingStats mHousekeepingStats;
+    bool mLevelOfDetail;
+    bool mLodDirty;                                 // Pass on the next tick
+    QRectF mDetailRegion;
+    QRectF mLodPassRegion;                          // Detail region of the last pass
+    QVector<HerdAggregate> mAggregates;             // By alpha herdSlot
+    QVector<int> mFreeHerdSlots;                    // Their alphas left this world
+    QVector<uchar> mLodActions;                     // Per aggregate, during a pass
+    LodStats mLodStats;
+    bool mHerdStatistics;
+    QVector<HerdStatistics> mHerdStats;             // By alpha herdSlot
+    QVector<QVector<HerdPartial>> mHerdPartials;    // [slice][herd slot], capacity reused
+    HerdSummary mHerdSummary;
+    WorldCommandQueue mCommands;
+    QVector<WorldCommand> mCommandBatch;
+    CommandStats mCommandStats;
+    QVector<SimpleCreature*> mSpawned;              // Since the last takeSpawnedCreatures()
+    PrecisionCheck* mPrecisionCheck;   // nullptr unless validating
+    bool mBucketsStale;
+    TickTimings mLastTickTimings;
+    std::atomic<qint64> mWorkerBusyNanos;
+
+    // === Scratch (reset at the end of every tick) ===
+    TickArena mTickArena;                        // Tick thread: task objects, lists, merges
+    std::unique_ptr<TickArena[]> mTaskArenas;    // One per parallelFor task id: per-task outputs
+    int mTaskArenaCount;
+};
+
+#endif // SIMWORLD_H
@@ -0,0 +1,458 @@
+// 2dsim08/snapshotviews.cpp - One immutable render snapshot per tick, and the minimap and extra views that draw from it
+#include "snapshotviews.h"
+#include "simworld.h"
+#include "simtrace.h"
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPen>
+#include <QResizeEvent>
+#include <QWheelEvent>
+#include <cmath>
+
+static const qreal TINY_SPRITE_PIXELS = 3.0;    // Below this a creature is a filled square, like the tile renderer
+static const qreal MIN_RING_PIXELS = 0.5;
+static const int DENSITY_MIN_ALPHA = 64;        // The sparsest occupied cell still shows
+
+// Out of line: qMin and qBound bind them by reference, and C++11 does not make them inline
+constexpr qreal SnapshotView::SNAPSHOT_DENSITY_PIXELS;
+constexpr qreal SnapshotView::SNAPSHOT_MAX_SCALE;
+
+// === Render Snapshot ===
+QRectF RenderSnapshot::cellRect(int col, int row) const {
+    return QRectF(world.left() + col * cellWidth, world.top() + row * cellHeight, cellWidth, cellHeight);
+}
+
+QRect RenderSnapshot::cellsIn(const QRectF& sceneRect) const {
+    const QRectF clipped = sceneRect.intersected(world);
+    if (cols == 0 || clipped.isEmpty()) return QRect();
+    const int left = qBound(0, static_cast<int>((clipped.left() - world.left()) / cellWidth), cols - 1);
+    const int top = qBound(0, static_cast<int>((clipped.top() - world.top()) / cellHeight), rows - 1);
+    const int right = qBound(0, static_cast<int>((clipped.right() - world.left()) / cellWidth), cols - 1);
+    const int bottom = qBound(0, static_cast<int>((clipped.bottom() - world.top()) / cellHeight), rows - 1);
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+RenderSnapshot* RenderSnapshotBuilder::newSnapshot(SimWorld* world, qint64 tick) const {
+    RenderSnapshot* out = new RenderSnapshot;
+    out->tick = tick;
+    out->world = world->params().worldRect();
+    out->cols = SNAPSHOT_GRID_COLS;
+    out->rows = qMax(1, qRound(SNAPSHOT_GRID_COLS * out->world.height() / out->world.width()));
+    out->cellWidth = out->world.width() / out->cols;
+    out->cellHeight = out->world.height() / out->rows;
+    return out;
+}
+
+void RenderSnapshotBuilder::addHerds(const QVector<RenderHerd>& herds, RenderSnapshot* out) {
+    // Collapsed herds: their members join the density of the centroid's cell
+    int* density = out->cellDensity.data();
+    QRgb* colors = out->cellColor.data();
+    for (const RenderHerd& herd : herds) {
+        const int col = qBound(0, static_cast<int>((herd.x - out->world.left()) / out->cellWidth), out->cols - 1);
+        const int row = qBound(0, static_cast<int>((herd.y - out->world.top()) / out->cellHeight), out->rows - 1);
+        const int cell = row * out->cols + col;
+        const qint64 before = density[cell];
+        const qint64 after = before + herd.members;
+        if (after == 0) continue;
+        const QRgb mean = colors[cell];
+        colors[cell] = qRgb((qRed(mean) * before + qRed(herd.fill) * herd.members) / after,
+                            (qGreen(mean) * before + qGreen(herd.fill) * herd.members) / after,
+                            (qBlue(mean) * before + qBlue(herd.fill) * herd.members) / after);
+        density[cell] = static_cast<int>(after);
+    }
+    for (int inCell : out->cellDensity) {
+        out->densest = qMax(out->densest, inCell);
+    }
+}
+
+RenderSnapshotPtr RenderSnapshotBuilder::build(SimWorld* world, const QVector<RenderSprite>& sprites,
+                                               const QVector<RenderHerd>& herds, qint64 tick) {
+    TraceScope trace("render snapshot");
+    QSharedPointer<RenderSnapshot> snapshot(newSnapshot(world, tick));
+    RenderSnapshot* out = snapshot.data();
+    out->hasSprites = true;
+
+    const int cells = out->cols * out->rows;
+    const int count = sprites.size();
+    const int cols = out->cols;
+    const int rows = out->rows;
+    const qreal left = out->world.left();
+    const qreal top = out->world.top();
+    const qreal cellWidth = out->cellWidth;
+    const qreal cellHeight = out->cellHeight;
+
+    // One slice per worker; the loops run over the slices themselves, so the count and the scatter
+    // pass see exactly the same ranges
+    QThreadPool* pool = world->threadPool();
+    const int slices = qBound(1, pool ? pool->maxThreadCount() : 1, qMax(1, count));
+    const int chunkSize = (count + slices - 1) / slices;
+    mCounts.fill(0, slices * cells);
+    mCells.resize(count);
+    mLargest.fill(0, slices);
+    int* counts = mCounts.data();
+    int* cellOf = mCells.data();
+    float* largest = mLargest.data();
+    const RenderSprite* in = sprites.constData();
+
+    // === Pass 1: every slice counts its sprites per cell (by their centers) ===
+    world->parallelFor(slices, [=](int first, int last, int) {
+        for (int slice = first; slice < last; slice++) {
+            int* sliceCounts = counts + slice * cells;
+            const int end = qMin(count, (slice + 1) * chunkSize);
+            for (int i = slice * chunkSize; i < end; i++) {
+                const RenderSprite& sprite = in[i];
+                if (sprite.opacity <= 0) {
+                    cellOf[i] = -1;
+                    continue;
+                }
+                const int col = qBound(0, static_cast<int>((sprite.x + sprite.size / 2 - left) / cellWidth), cols - 1);
+                const int row = qBound(0, static_cast<int>((sprite.y + sprite.size / 2 - top) / cellHeight), rows - 1);
+                cellOf[i] = row * cols + col;
+                sliceCounts[cellOf[i]]++;
+                largest[slice] = qMax(largest[slice], sprite.size);
+            }
+        }
+    });
+
+    // === Offsets: cell-major, slices in order within a cell ===
+    out->cellStart.resize(cells + 1);
+    out->cellDensity.resize(cells);
+    int* starts = out->cellStart.data();
+    int* density = out->cellDensity.data();
+    int total = 0;
+    for (int cell = 0; cell < cells; cell++) {
+        starts[cell] = total;
+        for (int slice = 0; slice < slices; slice++) {
+            int& slot = counts[slice * cells + cell];
+            const int inSlice = slot;
+            slot = total;
+            total += inSlice;
+        }
+        density[cell] = total - starts[cell];
+    }
+    starts[cells] = total;
+    for (float size : mLargest) {
+        out->largest = qMax(out->largest, size);
+    }
+
+    // === Pass 2: every slice writes its sprites to its own positions ===
+    QVector<RenderSprite>& buffer = mGrouped[mBuffer];
+    mBuffer = 1 - mBuffer;
+    buffer.resize(total);
+    RenderSprite* grouped = buffer.data();
+    world->parallelFor(slices, [=](int first, int last, int) {
+        for (int slice = first; slice < last; slice++) {
+            int* positions = counts + slice * cells;
+            const int end = qMin(count, (slice + 1) * chunkSize);
+            for (int i = slice * chunkSize; i < end; i++) {
+                if (cellOf[i] >= 0) {
+                    grouped[positions[cellOf[i]]++] = in[i];
+                }
+            }
+        }
+    });
+    out->sprites = buffer;   // Shared, not copied
+
+    // === Cell colors: the mean fill, for drawing density ===
+    out->cellColor.resize(cells);
+    QRgb* colors = out->cellColor.data();
+    world->parallelFor(cells, [=](int first, int last, int) {
+        for (int cell = first; cell < last; cell++) {
+            const int inCell = starts[cell + 1] - starts[cell];
+            if (inCell == 0) {
+                colors[cell] = 0;
+                continue;
+            }
+            qint64 red = 0;
+            qint64 green = 0;
+            qint64 blue = 0;
+            for (int i = starts[cell]; i < starts[cell + 1]; i++) {
+                red += qRed(grouped[i].fill);
+                green += qGreen(grouped[i].fill);
+                blue += qBlue(grouped[i].fill);
+            }
+            colors[cell] = qRgb(red / inCell, green / inCell, blue / inCell);
+        }
+    });
+
+    addHerds(herds, out);
+    return snapshot;
+}
+
+RenderSnapshotPtr RenderSnapshotBuilder::buildDensity(SimWorld* world, const QVector<RenderHerd>& herds, qint64 tick) {
+    TraceScope trace("render density");
+    QSharedPointer<RenderSnapshot> snapshot(newSnapshot(world, tick));
+    RenderSnapshot* out = snapshot.data();
+
+    const QVector<SimpleCreature*>& creatures = world->creatures();
+    const int cells = out->cols * out->rows;
+    const int count = creatures.size();
+    const int cols = out->cols;
+    const int rows = out->rows;
+    const qreal left = out->world.left();
+    const qreal top = out->world.top();
+    const qreal cellWidth = out->cellWidth;
+    const qreal cellHeight = out->cellHeight;
+
+    QThreadPool* pool = world->threadPool();
+    const int slices = qBound(1, pool ? pool->maxThreadCount() : 1, qMax(1, count));
+    const int chunkSize = (count + slices - 1) / slices;
+    mCounts.fill(0, slices * cells);
+    mSums.fill(0, slices * cells * 3);
+    mLargest.fill(0, slices);
+    int* counts = mCounts.data();
+    quint32* sums = mSums.data();   // 255 per creature: fits any world that still ticks
+    float* largest = mLargest.data();
+    SimpleCreature* const* in = creatures.constData();
+
+    // === One pass: every slice counts and sums the colors of its creatures per cell ===
+    world->parallelFor(slices, [=](int first, int last, int) {
+        for (int slice = first; slice < last; slice++) {
+            int* sliceCounts = counts + slice * cells;
+            quint32* sliceSums = sums + slice * cells * 3;
+            const int end = qMin(count, (slice + 1) * chunkSize);
+            for (int i = slice * chunkSize; i < end; i++) {
+                const SimpleCreature* creature = in[i];
+                if (!creature->exists || creature->collapsed) continue;   // Collapsed: a stale position
+                const int col = qBound(0, static_cast<int>((creature->posX + creature->size / 2 - left) / cellWidth), cols - 1);
+                const int row = qBound(0, static_cast<int>((creature->posY + creature->size / 2 - top) / cellHeight), rows - 1);
+                const int cell = row * cols + col;
+                const QRgb fill = creature->color.rgb();
+                sliceCounts[cell]++;
+                sliceSums[cell * 3] += qRed(fill);
+                sliceSums[cell * 3 + 1] += qGreen(fill);
+                sliceSums[cell * 3 + 2] += qBlue(fill);
+                largest[slice] = qMax(largest[slice], static_cast<float>(creature->size));
+            }
+        }
+    });
+
+    // === Merge the slices ===
+    out->cellDensity.resize(cells);
+    out->cellColor.resize(cells);
+    for (int cell = 0; cell < cells; cell++) {
+        int inCell = 0;
+        quint64 red = 0;
+        quint64 green = 0;
+        quint64 blue = 0;
+        for (int slice = 0; slice < slices; slice++) {
+            inCell += counts[slice * cells + cell];
+            const quint32* sum = sums + (slice * cells + cell) * 3;
+            red += sum[0];
+            green += sum[1];
+            blue += sum[2];
+        }
+        out->cellDensity[cell] = inCell;
+        out->cellColor[cell] = inCell > 0 ? qRgb(red / inCell, green / inCell, blue / inCell) : 0;
+    }
+    for (float size : mLargest) {
+        out->largest = qMax(out->largest, size);
+    }
+    addHerds(herds, out);
+    return snapshot;
+}
+
+// === Snapshot View ===
+SnapshotView::SnapshotView(const TerrainChunks* terrain, const QRectF& world, QWidget* parent, Qt::WindowFlags flags)
+    : QWidget(parent, flags)
+    , mTerrain(terrain)
+    , mWorld(world)
+    , mCenter(world.center())
+    , mScale(0)
+    , mDensityOnly(false)
+    , mRingWidth(0)
+{
+}
+
+void SnapshotView::setSnapshot(const RenderSnapshotPtr& snapshot) {
+    mSnapshot = snapshot;
+    update();   // Painted at most once per event loop pass, and not at all while hidden
+}
+
+qreal SnapshotView::minimumScale() const {
+    if (width() <= 0 || height() <= 0) return SNAPSHOT_MAX_SCALE;
+    return qMin(SNAPSHOT_MAX_SCALE, qMin(width() / mWorld.width(), height() / mWorld.height()));
+}
+
+void SnapshotView::setView(const QPointF& center, qreal pixelsPerUnit) {
+    mScale = qBound(minimumScale(), pixelsPerUnit, SNAPSHOT_MAX_SCALE);
+    mCenter = QPointF(qBound(mWorld.left(), center.x(), mWorld.right()),
+                      qBound(mWorld.top(), center.y(), mWorld.bottom()));
+    update();
+    emit viewChanged();
+}
+
+QTransform SnapshotView::sceneToView() const {
+    return QTransform(mScale, 0, 0, mScale, width() / 2.0 - mCenter.x() * mScale, height() / 2.0 - mCenter.y() * mScale);
+}
+
+QRectF SnapshotView::visibleScene() const {
+    if (mScale <= 0) return QRectF();
+    const qreal sceneWidth = width() / mScale;
+    const qreal sceneHeight = height() / mScale;
+    return QRectF(mCenter.x() - sceneWidth / 2, mCenter.y() - sceneHeight / 2, sceneWidth, sceneHeight);
+}
+
+void SnapshotView::resizeEvent(QResizeEvent* event) {
+    QWidget::resizeEvent(event);
+    setView(mCenter, mScale);   // Still within bounds for the new size
+}
+
+void SnapshotView::mousePressEvent(QMouseEvent* event) {
+    mDragFrom = event->pos();
+}
+
+void SnapshotView::mouseMoveEvent(QMouseEvent* event) {
+    if (!(event->buttons() & Qt::LeftButton) || mScale <= 0) return;
+    const QPoint delta = event->pos() - mDragFrom;
+    mDragFrom = event->pos();
+    setView(QPointF(mCenter.x() - delta.x() / mScale, mCenter.y() - delta.y() / mScale), mScale);
+}
+
+void SnapshotView::wheelEvent(QWheelEvent* event) {
+    if (mScale <= 0) return;
+    // Keep the scene point under the mouse where it is
+    const QPointF mouse = event->pos();
+    const QPointF anchor = sceneToView().inverted().map(mouse);
+    const qreal scale = qBound(minimumScale(), mScale * std::pow(1.125, event->delta() < 0 ? -1 : 1), SNAPSHOT_MAX_SCALE);
+    setView(QPointF(anchor.x() - (mouse.x() - width() / 2.0) / scale,
+                    anchor.y() - (mouse.y() - height() / 2.0) / scale), scale);
+}
+
+void SnapshotView::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event);
+    TraceScope trace("snapshot view");
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().color(QPalette::Base));
+    const QRectF visible = visibleScene();
+    if (visible.isEmpty()) return;
+
+    if (mTerrain) {
+        const qreal cellPixels = mTerrain->cellSize() * mScale;
+        mTerrain->prefetchView(visible, cellPixels);
+        painter.save();
+        painter.setTransform(sceneToView());
+        mTerrain->draw(&painter, visible, cellPixels);
+        painter.restore();
+    }
+
+    if (mSnapshot) {
+        // This view's own level of detail: the cells themselves once creatures would be specks
+        if (mDensityOnly || !mSnapshot->hasSprites || mSnapshot->largest * mScale < SNAPSHOT_DENSITY_PIXELS) {
+            drawDensity(&painter, mSnapshot->cellsIn(visible));
+        } else {
+            // A creature is filed under the cell of its center, so look one creature beyond the edges
+            const qreal reach = mSnapshot->largest + mRingWidth;
+            drawSprites(&painter, mSnapshot->cellsIn(visible.adjusted(-reach, -reach, reach, reach)));
+        }
+    }
+    drawOverlay(&painter);
+}
+
+void SnapshotView::drawDensity(QPainter* painter, const QRect& cells) const {
+    if (cells.isEmpty() || mSnapshot->densest == 0) return;
+    const QTransform transform = sceneToView();
+    const double scale = std::log1p(static_cast<double>(mSnapshot->densest));
+    for (int row = cells.top(); row <= cells.bottom(); row++) {
+        for (int col = cells.left(); col <= cells.right(); col++) {
+            const int cell = row * mSnapshot->cols + col;
+            const int inCell = mSnapshot->cellDensity[cell];
+            if (inCell == 0) continue;
+            QColor color(mSnapshot->cellColor[cell]);
+            color.setAlpha(DENSITY_MIN_ALPHA + qRound((255 - DENSITY_MIN_ALPHA) * std::log1p(static_cast<double>(inCell)) / scale));
+            painter->fillRect(transform.mapRect(mSnapshot->cellRect(col, row)), color);
+        }
+    }
+}
+
+void SnapshotView::drawSprites(QPainter* painter, const QRect& cells) const {
+    if (cells.isEmpty()) return;
+    const qreal s = mScale;
+    const qreal dx = width() / 2.0 - mCenter.x() * s;
+    const qreal dy = height() / 2.0 - mCenter.y() * s;
+    const QRectF bounds(rect());
+    const RenderSprite* sprites = mSnapshot->sprites.constData();
+    const int* starts = mSnapshot->cellStart.constData();
+    const qreal ringPixels = mRingWidth * s;
+
+    // Members, then alphas on top (same order as the scene's z-values)
+    qreal opacity = 1.0;
+    for (int pass = 0; pass < 2; pass++) {
+        const bool alphas = (pass == 1);
+        if (ringPixels >= MIN_RING_PIXELS) {
+            painter->setPen(QPen(alphas ? Qt::black : Qt::white, ringPixels));
+        } else {
+            painter->setPen(Qt::NoPen);
+        }
+
+        for (int row = cells.top(); row <= cells.bottom(); row++) {
+            // Cells of one row are contiguous in the sprite list
+            const int first = starts[row * mSnapshot->cols + cells.left()];
+            const int last = starts[row * mSnapshot->cols + cells.right() + 1];
+            for (int i = first; i < last; i++) {
+                const RenderSprite& sprite = sprites[i];
+                if (sprite.isAlpha != alphas) continue;
+                const QRectF rect(sprite.x * s + dx, sprite.y * s + dy, sprite.size * s, sprite.size * s);
+                if (!bounds.intersects(rect.adjusted(-ringPixels, -ringPixels, ringPixels, ringPixels))) continue;
+
+                if (sprite.opacity != opacity) {
+                    opacity = sprite.opacity;
+                    painter->setOpacity(opacity);
+                }
+                if (rect.width() < TINY_SPRITE_PIXELS) {
+                    painter->fillRect(QRectF(rect.topLeft(), QSizeF(qMax<qreal>(1, rect.width()), qMax<qreal>(1, rect.height()))),
+                                      QColor(sprite.fill));
+                } else {
+                    painter->setBrush(QColor(sprite.fill));
+                    painter->drawEllipse(rect);
+                }
+            }
+        }
+    }
+    painter->setOpacity(1.0);
+}
+
+// === Minimap ===
+MiniMap::MiniMap(const TerrainChunks* terrain, const QRectF& world, QWidget* parent)
+    : SnapshotView(terrain, world, parent)
+{
+    mDensityOnly = true;
+    setCursor(Qt::CrossCursor);
+}
+
+void MiniMap::setViewOutlines(const QVector<QRectF>& outlines) {
+    mOutlines = outlines;
+    update();
+}
+
+void MiniMap::resizeEvent(QResizeEvent* event) {
+    QWidget::resizeEvent(event);
+    setView(mWorld.center(), minimumScale());   // Always the whole world
+}
+
+void MiniMap::mousePressEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton) {
+        emit centerRequested(sceneToView().inverted().map(QPointF(event->pos())));
+    }
+}
+
+void MiniMap::mouseMoveEvent(QMouseEvent* event) {
+    if (event->buttons() & Qt::LeftButton) {
+        emit centerRequested(sceneToView().inverted().map(QPointF(event->pos())));
+    }
+}
+
+void MiniMap::wheelEvent(QWheelEvent* event) {
+    event->ignore();   // Fixed zoom
+}
+
+void MiniMap::drawOverlay(QPainter* painter) {
+    const QTransform transform = sceneToView();
+    painter->setBrush(Qt::NoBrush);
+    for (int i = 0; i < mOutlines.size(); i++) {
+        painter->setPen(QPen(i == 0 ? Qt::white : Qt::yellow, i == 0 ? 2 : 1));
+        painter->drawRect(transform.mapRect(mOutlines[i].intersected(mWorld)));
+    }
+    painter->setPen(QPen(Qt::darkGray, 1));
+    painter->drawRect(QRectF(0, 0, width() - 1, height() - 1));
+}
@@ -0,0 +1,157 @@
+// 2dsim08/snapshotviews.h - One immutable render snapshot per tick, and the minimap and extra views that draw from it
+#ifndef SNAPSHOTVIEWS_H
+#define SNAPSHOTVIEWS_H
+
+#include <QWidget>
+#include <QSharedPointer>
+#include <QTransform>
+#include <QVector>
+#include "tilerenderer.h"
+
+class SimWorld;
+
+// A herd collapsed by level of detail: its members have no positions of their own, so they are
+// counted at the herd's centroid in the density and never drawn as sprites
+struct RenderHerd {
+    float x;             // Centroid
+    float y;
+    int members;
+    QRgb fill;
+};
+
+// === Render Snapshot ===
+// What every view draws for one tick: the drawn creatures as flat sprites, grouped by the cell of
+// a coarse grid over the world, plus each cell's creature count and mean color. Built once per tick and never
+// changed afterwards, so any number of views (and the tile renderer) share it without copying;
+// a view culls by walking only the cells under it, and far out it draws the cells themselves.
+struct RenderSnapshot {
+    qint64 tick;
+    QRectF world;
+    int cols;
+    int rows;
+    qreal cellWidth;
+    qreal cellHeight;
+    bool hasSprites;                 // False: density only (RenderSnapshotBuilder::buildDensity)
+    QVector<RenderSprite> sprites;   // Drawn creatures only, cell by cell
+    QVector<int> cellStart;          // cols * rows + 1 offsets into sprites
+    QVector<int> cellDensity;        // Creatures per cell: its sprites plus collapsed herd members
+    QVector<QRgb> cellColor;         // Mean fill of each cell's creatures
+    int densest;                     // Most creatures in one cell
+    float largest;                   // Biggest sprite, scene units (how far one reaches past its cell)
+
+    RenderSnapshot() : tick(0), cols(0), rows(0), cellWidth(1), cellHeight(1), hasSprites(false), densest(0), largest(0) {}
+    QRectF cellRect(int col, int row) const;
+    QRect cellsIn(const QRectF& sceneRect) const;   // Cell coordinates overlapping, clipped; empty if none
+};
+
+typedef QSharedPointer<const RenderSnapshot> RenderSnapshotPtr;
+
+// Groups sprites by cell with a counting sort: every slice counts its own sprites per cell, the
+// counts become write offsets (cell-major, slices in order), then every slice scatters its sprites.
+// The grouped sprites alternate between two buffers the snapshots share implicitly: by the time a
+// buffer comes round again its snapshot has been replaced everywhere, so it is refilled in place.
+// Runs on the world's pool; GUI thread, between ticks.
+class RenderSnapshotBuilder
+{
+public:
+    static const int SNAPSHOT_GRID_COLS = 128;   // Cells across the world; rows follow its aspect
+
+    RenderSnapshotPtr build(SimWorld* world, const QVector<RenderSprite>& sprites, const QVector<RenderHerd>& herds,
+                            qint64 tick);
+
+    // Counts and mean colors only, read straight from the world's creatures in one pass; no sprites.
+    // Enough for the minimap, so a tick where nothing else draws creatures costs next to nothing.
+    RenderSnapshotPtr buildDensity(SimWorld* world, const QVector<RenderHerd>& herds, qint64 tick);
+
+    RenderSnapshotBuilder() : mBuffer(0) {}
+
+private:
+    RenderSnapshot* newSnapshot(SimWorld* world, qint64 tick) const;
+    static void addHerds(const QVector<RenderHerd>& herds, RenderSnapshot* out);
+
+    QVector<int> mCounts;       // [slice * cells + cell]: counts, then write positions; capacity reused
+    QVector<int> mCells;        // Cell of each input sprite (-1 = not drawn)
+    QVector<float> mLargest;    // Biggest sprite per slice
+    QVector<quint32> mSums;     // [(slice * cells + cell) * 3]: red, green, blue sums (buildDensity)
+    QVector<RenderSprite> mGrouped[2];
+    int mBuffer;                // The one the next build fills
+};
+
+// === Snapshot View ===
+// A view of the world that paints the current snapshot through its own scene-to-pixel mapping:
+// terrain first (its own chunks-or-overview choice), then creatures. Only the cells under the view
+// are walked, and when creatures would be smaller than SNAPSHOT_DENSITY_PIXELS the cells are drawn
+// as density instead of the sprites in them. Wheel zooms over the mouse, left drag pans.
+class SnapshotView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr qreal SNAPSHOT_DENSITY_PIXELS = 2.0;   // Creature diameter below which cells are drawn
+    static constexpr qreal SNAPSHOT_MAX_SCALE = 1.0;        // Pixels per scene unit, zoomed all the way in
+
+    SnapshotView(const TerrainChunks* terrain, const QRectF& world, QWidget* parent = nullptr,
+                 Qt::WindowFlags flags = Qt::Widget);
+
+    void setSnapshot(const RenderSnapshotPtr& snapshot);   // Shares it; repaints
+    void setRingWidth(qreal sceneUnits) { mRingWidth = sceneUnits; }
+    void setView(const QPointF& center, qreal pixelsPerUnit);
+    QRectF visibleScene() const;
+    QTransform sceneToView() const;
+
+signals:
+    void viewChanged();   // Panned, zoomed or resized
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+
+    // Drawn last, in view pixels
+    virtual void drawOverlay(QPainter* painter) { Q_UNUSED(painter); }
+    qreal minimumScale() const;   // The whole world fits
+
+    const TerrainChunks* mTerrain;
+    QRectF mWorld;
+    RenderSnapshotPtr mSnapshot;
+    QPointF mCenter;      // Scene units
+    qreal mScale;         // Pixels per scene unit
+    bool mDensityOnly;    // Never draw individual sprites
+
+private:
+    void drawDensity(QPainter* painter, const QRect& cells) const;
+    void drawSprites(QPainter* painter, const QRect& cells) const;
+
+    qreal mRingWidth;
+    QPoint mDragFrom;
+};
+
+// === Minimap ===
+// The whole world at a glance: terrain overview and creature density only, with the outline of
+// every other view. Clicking or dragging asks for the main view to be centered there.
+class MiniMap : public SnapshotView
+{
+    Q_OBJECT
+
+public:
+    MiniMap(const TerrainChunks* terrain, const QRectF& world, QWidget* parent = nullptr);
+
+    void setViewOutlines(const QVector<QRectF>& outlines);   // Scene units; the first is the main view
+
+signals:
+    void centerRequested(const QPointF& scenePos);
+
+protected:
+    void resizeEvent(QResizeEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void drawOverlay(QPainter* painter) override;
+
+private:
+    QVector<QRectF> mOutlines;
+};
+
+#endif // SNAPSHOTVIEWS_H
@@ -0,0 +1,270 @@
+// 2dsim08/soaktest.cpp - Long-running soak: tick time, memory and herd drift against an early baseline
+#include "soaktest.h"
+#include "mainwindow.h"
+#include "memorystats.h"
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstdio>
+
+// Nearest-rank percentile; reorders values
+template <typename T>
+static T percentile(QVector<T>& values, double fraction) {
+    if (values.isEmpty()) return T();
+    const int rank = qMin(values.size() - 1, static_cast<int>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+static double driftPercent(double value, double baseline) {
+    return baseline > 0 ? (value - baseline) * 100.0 / baseline : 0.0;
+}
+
+static QString formatElapsed(qint64 seconds) {
+    const QString clock = QString("%1:%2:%3").arg(seconds / 3600 % 24, 2, 10, QChar('0'))
+                          .arg(seconds / 60 % 60, 2, 10, QChar('0')).arg(seconds % 60, 2, 10, QChar('0'));
+    return seconds >= 86400 ? QString("%1d %2").arg(seconds / 86400).arg(clock) : clock;
+}
+
+SoakTest::SoakTest()
+    : mOverruns(0)
+    , mOrphansWaitingPeak(0)
+    , mLastCensuses(0)
+{
+}
+
+bool SoakTest::parseDuration(const QString& text, qint64* seconds) {
+    QString number = text.trimmed();
+    qint64 unit = 1;
+    if (number.endsWith('s')) {
+        number.chop(1);
+    } else if (number.endsWith('m')) {
+        unit = 60;
+        number.chop(1);
+    } else if (number.endsWith('h')) {
+        unit = 3600;
+        number.chop(1);
+    } else if (number.endsWith('d')) {
+        unit = 86400;
+        number.chop(1);
+    }
+    bool ok = false;
+    const qint64 value = number.toLongLong(&ok);
+    if (!ok || value <= 0) return false;
+    *seconds = value * unit;
+    return true;
+}
+
+// === Run ===
+int SoakTest::run(const SoakConfig& config) {
+    if (config.durationSeconds <= 0) {
+        std::fprintf(stderr, "Soak: the duration must be positive, e.g. 30m or 3d\n");
+        return 2;
+    }
+    const qint64 sampleSeconds = config.sampleSeconds > 0 ? config.sampleSeconds : SOAK_DEFAULT_SAMPLE_SECONDS;
+    const int threads = qMax(1, config.threads);
+    std::printf("Soak: %d creatures, %d threads, seed %u, tick interval %d ms, %s in samples of %lld s\n",
+                config.creatures, threads, config.seed, config.tickIntervalMs,
+                qPrintable(formatElapsed(config.durationSeconds)), static_cast<long long>(sampleSeconds));
+    if (config.durationSeconds < (SOAK_WARMUP_SAMPLES + 1 + SOAK_CONFIRM_SAMPLES) * sampleSeconds) {
+        std::fprintf(stderr, "Soak: drift needs %d samples of %lld s; this run is too short to fail on it\n",
+                     SOAK_WARMUP_SAMPLES + 1 + SOAK_CONFIRM_SAMPLES, static_cast<long long>(sampleSeconds));
+    }
+    if (MemoryStats::residentBytes() == 0) {
+        std::fprintf(stderr, "Soak: resident size is only known on Linux; resident drift is not checked\n");
+    }
+    std::fflush(stdout);
+
+    QScopedPointer<QThreadPool> pool(threads > 1 ? new QThreadPool : nullptr);
+    if (pool) {
+        pool->setMaxThreadCount(threads);
+    }
+    SimWorld world(pool.data());
+    world.setParams(config.params);
+    world.setTickBudget(config.tickIntervalMs * 1000);
+    world.setAutoTune(config.autoTune);
+    world.setupTerrain(config.seed);
+    world.setupCreatures(config.creatures, config.seed);
+
+    mTickMicros.resize(0);
+    mHousekeepingMicros.resize(0);
+    mOverruns = 0;
+    mOrphansWaitingPeak = 0;
+    mLastCensuses = world.housekeepingStats().passes;
+
+    const qint64 durationMs = config.durationSeconds * 1000;
+    const qint64 intervalNanos = config.tickIntervalMs * 1000000LL;
+    qint64 nextSampleMs = qMin(sampleSeconds * 1000, durationMs);
+    qint64 nextTickNanos = 0;
+    int samples = 0;
+    int driftedInRow = 0;
+    SoakSample baseline;
+    SoakSample sample;
+    QElapsedTimer clock;
+    clock.start();
+
+    for (;;) {
+        world.tick();
+        const TickTimings& timings = world.lastTickTimings();
+        mTickMicros.push_back(timings.totalMicros);
+        mHousekeepingMicros.push_back(timings.housekeepingMicros);
+        if (world.tickBudget() > 0 && timings.totalMicros > world.tickBudget()) {
+            mOverruns++;
+        }
+        mOrphansWaitingPeak = qMax(mOrphansWaitingPeak, world.housekeepingStats().pendingOrphans);
+
+        const qint64 elapsedMs = clock.elapsed();
+        if (elapsedMs >= nextSampleMs) {
+            sample = SoakSample();
+            sample.elapsedSeconds = elapsedMs / 1000;
+            takeSample(world, &sample);
+            samples++;
+
+            if (samples <= SOAK_WARMUP_SAMPLES) {
+                printSample(sample, "warm-up", nullptr);
+            } else if (samples == SOAK_WARMUP_SAMPLES + 1) {
+                baseline = sample;
+                printSample(sample, "baseline", nullptr);
+            } else {
+                printSample(sample, "", &baseline);
+                QStringList crossed;
+                driftedInRow = checkDrift(config, sample, baseline, &crossed) ? driftedInRow + 1 : 0;
+                if (driftedInRow >= SOAK_CONFIRM_SAMPLES) {
+                    for (const QString& line : crossed) {
+                        std::printf("Soak: FAIL - %s\n", qPrintable(line));
+                    }
+                    std::printf("Soak: FAIL after %s, %lld ticks (%d samples in a row past a threshold)\n",
+                                qPrintable(formatElapsed(sample.elapsedSeconds)), static_cast<long long>(sample.tick),
+                                driftedInRow);
+                    std::fflush(stdout);
+                    return 1;
+                }
+            }
+            std::fflush(stdout);
+
+            if (elapsedMs >= durationMs) break;
+            nextSampleMs = qMin(nextSampleMs + sampleSeconds * 1000, durationMs);
+        }
+
+        // Pace like a shard; after an overrun start over from now instead of bursting to catch up
+        if (intervalNanos > 0) {
+            nextTickNanos += intervalNanos;
+            const qint64 waitNanos = nextTickNanos - clock.nsecsElapsed();
+            if (waitNanos > 0) {
+                QThread::usleep(static_cast<unsigned long>(waitNanos / 1000));
+            } else {
+                nextTickNanos = clock.nsecsElapsed();
+            }
+        }
+    }
+
+    if (samples <= SOAK_WARMUP_SAMPLES + 1) {
+        std::printf("Soak: PASS - %lld ticks, too short to measure drift\n", static_cast<long long>(sample.tick));
+    } else {
+        std::printf("Soak: PASS - %lld ticks; at the end tick p99 %+.1f%%, resident %+.1f%%, herd p95 %+.1f%% over the baseline\n",
+                    static_cast<long long>(sample.tick),
+                    driftPercent(sample.tickP99Micros, baseline.tickP99Micros),
+                    driftPercent(sample.residentBytes, baseline.residentBytes),
+                    driftPercent(sample.herdP95, baseline.herdP95));
+    }
+    std::fflush(stdout);
+    return 0;
+}
+
+// === Sampling ===
+void SoakTest::takeSample(const SimWorld& world, SoakSample* sample) {
+    sample->tick = world.tickCount();
+    sample->ticks = mTickMicros.size();
+    sample->tickP50Micros = percentile(mTickMicros, 0.50);
+    sample->tickP95Micros = percentile(mTickMicros, 0.95);
+    sample->tickP99Micros = percentile(mTickMicros, 0.99);
+    sample->tickMaxMicros = mTickMicros.isEmpty() ? 0 : *std::max_element(mTickMicros.constBegin(), mTickMicros.constEnd());
+    sample->housekeepingP99Micros = percentile(mHousekeepingMicros, 0.99);
+    sample->overruns = mOverruns;
+
+    sample->residentBytes = MemoryStats::residentBytes();
+    for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        const MemoryUsage usage = MemoryStats::usage(static_cast<MemoryTag>(i));
+        sample->accountedBytes += usage.bytes;
+    }
+    sample->queueBytes = MemoryStats::usage(MEMORY_QUEUES).bytes;
+
+    // Herd sizes from the last complete census, kept current by rehoming
+    sample->creatures = world.creatures().size();
+    mHerdSizes.resize(0);
+    for (const SimpleCreature* herd : world.herds()) {
+        mHerdSizes.push_back(herd->herdSize);
+        if (herd->herdSize >= world.params().herdMaxSize) {
+            sample->fullHerds++;
+        }
+    }
+    sample->herds = mHerdSizes.size();
+    sample->herdP50 = percentile(mHerdSizes, 0.50);
+    sample->herdP95 = percentile(mHerdSizes, 0.95);
+    sample->herdLargest = mHerdSizes.isEmpty() ? 0 : *std::max_element(mHerdSizes.constBegin(), mHerdSizes.constEnd());
+
+    const HousekeepingStats& housekeeping = world.housekeepingStats();
+    sample->orphansWaiting = housekeeping.pendingOrphans;
+    sample->orphansWaitingPeak = mOrphansWaitingPeak;
+    sample->censusTicks = housekeeping.lastPassTicks;
+    sample->censuses = housekeeping.passes - mLastCensuses;
+
+    // Next interval
+    mTickMicros.resize(0);
+    mHousekeepingMicros.resize(0);
+    mOverruns = 0;
+    mOrphansWaitingPeak = housekeeping.pendingOrphans;
+    mLastCensuses = housekeeping.passes;
+}
+
+void SoakTest::printSample(const SoakSample& sample, const char* note, const SoakSample* baseline) const {
+    std::printf("Soak %s tick %lld %s\n", qPrintable(formatElapsed(sample.elapsedSeconds)),
+                static_cast<long long>(sample.tick), note);
+    std::printf("  ticks %lld: p50 %.2f p95 %.2f p99 %.2f max %.2f ms, housekeeping p99 %.2f ms, %lld overruns\n",
+                static_cast<long long>(sample.ticks), sample.tickP50Micros / 1000.0, sample.tickP95Micros / 1000.0,
+                sample.tickP99Micros / 1000.0, sample.tickMaxMicros / 1000.0, sample.housekeepingP99Micros / 1000.0,
+                static_cast<long long>(sample.overruns));
+    std::printf("  memory: resident %s, accounted %s, queues %s\n",
+                qPrintable(MemoryStats::formatBytes(sample.residentBytes)),
+                qPrintable(MemoryStats::formatBytes(sample.accountedBytes)),
+                qPrintable(MemoryStats::formatBytes(sample.queueBytes)));
+    std::printf("  herds: %d creatures in %d herds, p50 %d p95 %d largest %d, %d full; orphans waiting %d (peak %d); "
+                "%d censuses, last %d ticks\n",
+                sample.creatures, sample.herds, sample.herdP50, sample.herdP95, sample.herdLargest, sample.fullHerds,
+                sample.orphansWaiting, sample.orphansWaitingPeak, sample.censuses, sample.censusTicks);
+    if (baseline) {
+        std::printf("  drift: tick p50 %+.1f%% p99 %+.1f%%, housekeeping p99 %+.1f%%, resident %+.1f%%, accounted %+.1f%%, "
+                    "herd p95 %+.1f%%, full herds %+d\n",
+                    driftPercent(sample.tickP50Micros, baseline->tickP50Micros),
+                    driftPercent(sample.tickP99Micros, baseline->tickP99Micros),
+                    driftPercent(sample.housekeepingP99Micros, baseline->housekeepingP99Micros),
+                    driftPercent(sample.residentBytes, baseline->residentBytes),
+                    driftPercent(sample.accountedBytes, baseline->accountedBytes),
+                    driftPercent(sample.herdP95, baseline->herdP95),
+                    sample.fullHerds - baseline->fullHerds);
+    }
+}
+
+bool SoakTest::checkDrift(const SoakConfig& config, const SoakSample& sample, const SoakSample& baseline,
+                          QStringList* crossed) const {
+    const double tickDrift = driftPercent(sample.tickP99Micros, baseline.tickP99Micros);
+    if (config.maxTickDrift > 0 && tickDrift > config.maxTickDrift) {
+        *crossed << QString("tick p99 %1 ms, %2% over the baseline %3 ms (limit %4%)")
+                    .arg(sample.tickP99Micros / 1000.0, 0, 'f', 2).arg(tickDrift, 0, 'f', 1)
+                    .arg(baseline.tickP99Micros / 1000.0, 0, 'f', 2).arg(config.maxTickDrift);
+    }
+    const double residentDrift = driftPercent(sample.residentBytes, baseline.residentBytes);
+    if (config.maxResidentDrift > 0 && residentDrift > config.maxResidentDrift) {
+        *crossed << QString("resident %1, %2% over the baseline %3 (limit %4%)")
+                    .arg(MemoryStats::formatBytes(sample.residentBytes)).arg(residentDrift, 0, 'f', 1)
+                    .arg(MemoryStats::formatBytes(baseline.residentBytes)).arg(config.maxResidentDrift);
+    }
+    const double herdDrift = driftPercent(sample.herdP95, baseline.herdP95);
+    if (config.maxHerdDrift > 0 && herdDrift > config.maxHerdDrift) {
+        *crossed << QString("herd p95 %1 creatures, %2% over the baseline %3 (limit %4%)")
+                    .arg(sample.herdP95).arg(herdDrift, 0, 'f', 1).arg(baseline.herdP95).arg(config.maxHerdDrift);
+    }
+    return !crossed->isEmpty();
+}
@@ -0,0 +1,92 @@
+// 2dsim08/soaktest.h - Long-running soak: tick time, memory and herd drift against an early baseline
+#ifndef SOAKTEST_H
+#define SOAKTEST_H
+
+#include "simworld.h"
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+struct SoakConfig {
+    int creatures;
+    quint32 seed;
+    qint64 durationSeconds;       // Wall clock
+    qint64 sampleSeconds;
+    int tickIntervalMs;           // 0 = unthrottled
+    int threads;
+    bool autoTune;
+    SimParams params;             // Scenario
+    // Allowed growth over the baseline, in percent; 0 = report only
+    int maxTickDrift;             // p99 tick time
+    int maxResidentDrift;         // Process RSS
+    int maxHerdDrift;             // p95 herd size
+
+    SoakConfig() : creatures(0), seed(1), durationSeconds(0), sampleSeconds(0), tickIntervalMs(20), threads(1),
+                   autoTune(true), maxTickDrift(0), maxResidentDrift(0), maxHerdDrift(0) {}
+};
+
+// One sample interval: tick percentiles over its ticks, everything else as it stood at its end
+struct SoakSample {
+    qint64 elapsedSeconds;
+    qint64 tick;
+    qint64 ticks;                 // In this interval
+    qint64 tickP50Micros;
+    qint64 tickP95Micros;
+    qint64 tickP99Micros;
+    qint64 tickMaxMicros;
+    qint64 housekeepingP99Micros;
+    qint64 overruns;              // Ticks longer than the tick interval
+    qint64 residentBytes;
+    qint64 accountedBytes;        // All memory tags
+    qint64 queueBytes;            // MEMORY_QUEUES
+    int creatures;
+    int herds;
+    int herdP50;
+    int herdP95;
+    int herdLargest;
+    int fullHerds;                // At HERD_MAX_SIZE: closed to orphans
+    int orphansWaiting;
+    int orphansWaitingPeak;       // Over the interval
+    int censusTicks;              // Ticks the last complete census took
+    int censuses;                 // Completed in this interval
+
+    SoakSample() : elapsedSeconds(0), tick(0), ticks(0), tickP50Micros(0), tickP95Micros(0), tickP99Micros(0),
+                   tickMaxMicros(0), housekeepingP99Micros(0), overruns(0), residentBytes(0), accountedBytes(0),
+                   queueBytes(0), creatures(0), herds(0), herdP50(0), herdP95(0), herdLargest(0), fullHerds(0),
+                   orphansWaiting(0), orphansWaitingPeak(0), censusTicks(0), censuses(0) {}
+};
+
+// Runs one world the way a shard does (time-budgeted housekeeping, paced ticks, auto-tuning) for
+// a wall-clock duration and samples it every interval. The first SOAK_WARMUP_SAMPLES intervals
+// only warm up (auto-tuning, terrain cache, arenas); the next one is the baseline, and every
+// later sample is printed with its drift from it. A threshold crossed in SOAK_CONFIRM_SAMPLES
+// samples in a row fails the run right away, so one noisy interval does not.
+class SoakTest
+{
+public:
+    static const int SOAK_DEFAULT_SAMPLE_SECONDS = 60;
+    static const int SOAK_WARMUP_SAMPLES = 1;
+    static const int SOAK_CONFIRM_SAMPLES = 2;
+
+    SoakTest();
+
+    int run(const SoakConfig& config);   // 0 = no drift past the thresholds, 1 = drifted, 2 = bad config
+
+    // "90", "90s", "45m", "12h" or "3d"; false if unreadable or not positive
+    static bool parseDuration(const QString& text, qint64* seconds);
+
+private:
+    void takeSample(const SimWorld& world, SoakSample* sample);
+    void printSample(const SoakSample& sample, const char* note, const SoakSample* baseline) const;
+    bool checkDrift(const SoakConfig& config, const SoakSample& sample, const SoakSample& baseline, QStringList* crossed) const;
+
+    QVector<qint64> mTickMicros;           // This interval's ticks; capacity reused
+    QVector<qint64> mHousekeepingMicros;
+    QVector<int> mHerdSizes;
+    qint64 mOverruns;
+    int mOrphansWaitingPeak;
+    int mLastCensuses;
+};
+
+#endif // SOAKTEST_H
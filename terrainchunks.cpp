@@ -0,0 +1,634 @@
+// 2dsim08/terrainchunks.cpp - Procedural terrain generated in chunks on demand, held in a capped LRU cache
+#include "terrainchunks.h"
+#include "simtrace.h"
+#include "memorystats.h"
+#include <QColor>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QSet>
+#include <cmath>
+
+const int TerrainChunks::CHUNK_CELLS;   // Out of line: qMin binds it by reference
+
+// === Chunk Generation Task ===
+class TerrainChunkTask : public QRunnable {
+private:
+    std::function<void(int)> mGenerate;
+    int mIndex;
+    QSemaphore* mDone;
+
+public:
+    TerrainChunkTask(const std::function<void(int)>& generate, int index, QSemaphore* done)
+        : mGenerate(generate), mIndex(index), mDone(done) {
+        setAutoDelete(true);
+    }
+
+    void run() override {
+        TraceScope trace("terrain chunk", mIndex);
+        mGenerate(mIndex);
+        mDone->release();
+    }
+};
+
+// Lattice value in [0, 1) for one octave; a pure function of its inputs
+static inline double latticeValue(quint32 seed, int octave, int x, int y) {
+    quint64 h = (static_cast<quint64>(static_cast<quint32>(x)) << 32) ^ static_cast<quint32>(y);
+    h ^= (static_cast<quint64>(seed) << 16) ^ (static_cast<quint64>(octave) * 0x9E3779B97F4A7C15ULL);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return static_cast<double>(h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline int floorDiv(int value, int divisor) {
+    return (value >= 0) ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+TerrainChunks::TerrainChunks()
+    : mSeed(0)
+    , mCellSize(1.0)
+    , mCols(0)
+    , mRows(0)
+    , mThreadPool(nullptr)
+    , mCacheLimit(static_cast<qint64>(TERRAIN_CACHE_MB) * 1024 * 1024)
+    , mNewest(nullptr)
+    , mOldest(nullptr)
+    , mOverviewStride(1)
+    , mHasLastStroke(false)
+    , mRevision(0)
+{
+}
+
+TerrainChunks::~TerrainChunks() {
+    clear();
+    clearPainted();
+}
+
+void TerrainChunks::setup(quint32 seed, qreal cellSize, int cols, int rows, QThreadPool* threadPool) {
+    QMutexLocker locker(&mMutex);
+    clear();
+    mSeed = seed;
+    mCellSize = cellSize;
+    mCols = cols;
+    mRows = rows;
+    mThreadPool = threadPool;
+    clearPainted();
+    mRevision++;
+}
+
+void TerrainChunks::setCacheLimit(qint64 bytes) {
+    QMutexLocker locker(&mMutex);
+    mCacheLimit = bytes;
+    evictOverLimit(nullptr);
+}
+
+void TerrainChunks::reserveChunks(int chunks) {
+    const qint64 chunkTypeBytes = static_cast<qint64>(sizeof(Chunk)) + CHUNK_CELLS * CHUNK_CELLS;
+    const qint64 worldChunks = static_cast<qint64>(chunkCols()) * chunkRows();
+    setCacheLimit(static_cast<qint64>(TERRAIN_CACHE_MB) * 1024 * 1024 + qMin<qint64>(chunks, worldChunks) * chunkTypeBytes);
+}
+
+void TerrainChunks::clear() {
+    for (auto* chunk : mChunks) {
+        MemoryStats::freed(MEMORY_TERRAIN, chunkBytes(chunk));
+        delete chunk;
+    }
+    mChunks.clear();
+    mNewest = nullptr;
+    mOldest = nullptr;
+    mStats = TerrainCacheStats();
+    if (!mOverview.isNull()) {
+        MemoryStats::freed(MEMORY_TERRAIN, mOverview.sizeInBytes());
+        mOverview = QImage();
+    }
+}
+
+// === Generator ===
+double TerrainChunks::noise(int col, int row) const {
+    double sum = 0;
+    double amplitude = 1.0;
+    double norm = 0;
+    int period = TERRAIN_NOISE_PERIOD;
+    for (int octave = 0; octave < TERRAIN_NOISE_OCTAVES; octave++) {
+        int x0 = floorDiv(col, period);
+        int y0 = floorDiv(row, period);
+        double fx = (col - x0 * period + 0.5) / period;
+        double fy = (row - y0 * period + 0.5) / period;
+        fx = fx * fx * (3 - 2 * fx);
+        fy = fy * fy * (3 - 2 * fy);
+
+        double top = latticeValue(mSeed, octave, x0, y0) * (1 - fx) + latticeValue(mSeed, octave, x0 + 1, y0) * fx;
+        double bottom = latticeValue(mSeed, octave, x0, y0 + 1) * (1 - fx) + latticeValue(mSeed, octave, x0 + 1, y0 + 1) * fx;
+        sum += amplitude * (top * (1 - fy) + bottom * fy);
+        norm += amplitude;
+        amplitude *= 0.5;
+        period = qMax(1, period / 2);
+    }
+    return sum / norm;
+}
+
+TerrainType TerrainChunks::cellType(int col, int row) const {
+    double value = noise(col, row);
+    if (value < TERRAIN_WATER_LEVEL) return TERRAIN_WATER;
+    if (value < TERRAIN_SAND_LEVEL) return TERRAIN_SAND;
+    return TERRAIN_FOLIAGE;
+}
+
+QColor TerrainChunks::color(TerrainType type) {
+    switch (type) {
+        case TERRAIN_FOLIAGE:
+            return QColor(180, 230, 180); // Light green
+        case TERRAIN_SAND:
+            return QColor(180, 153, 102); // Sandy brown
+        case TERRAIN_WATER:
+            return QColor(51, 153, 255);  // Blue
+        default:
+            return QColor(100, 100, 100); // Gray
+    }
+}
+
+void TerrainChunks::generate(Chunk* chunk, const PaintedCells& painted) const {
+    const int col0 = chunk->x * CHUNK_CELLS;
+    const int row0 = chunk->y * CHUNK_CELLS;
+    chunk->types.resize(CHUNK_CELLS * CHUNK_CELLS);
+    uchar* types = chunk->types.data();
+    for (int row = 0; row < CHUNK_CELLS; row++) {
+        for (int col = 0; col < CHUNK_CELLS; col++) {
+            types[row * CHUNK_CELLS + col] = static_cast<uchar>(cellType(col0 + col, row0 + row));
+        }
+    }
+    const QByteArray cells = painted.value(chunkKey(chunk->x, chunk->y));
+    if (!cells.isEmpty()) {
+        applyPainted(cells, chunk);
+    }
+}
+
+// Calls visit(x, y) for every grid point whose cell lies within the stroke. Grid point (x, y)
+// samples cell (col0 + x * stride, row0 + y * stride). Returns whether any point was visited.
+template <typename Visit>
+bool TerrainChunks::forEditCells(const TerrainEdit& edit, int col0, int row0, int width, int height, int stride, Visit visit) {
+    const int x0 = qMax(0, floorDiv(edit.col - edit.radius - col0 + stride - 1, stride));
+    const int y0 = qMax(0, floorDiv(edit.row - edit.radius - row0 + stride - 1, stride));
+    const int x1 = qMin(width - 1, floorDiv(edit.col + edit.radius - col0, stride));
+    const int y1 = qMin(height - 1, floorDiv(edit.row + edit.radius - row0, stride));
+    const int radiusSquared = edit.radius * edit.radius;
+    bool visited = false;
+    for (int y = y0; y <= y1; y++) {
+        const int dy = row0 + y * stride - edit.row;
+        for (int x = x0; x <= x1; x++) {
+            const int dx = col0 + x * stride - edit.col;
+            if (dx * dx + dy * dy <= radiusSquared) {
+                visit(x, y);
+                visited = true;
+            }
+        }
+    }
+    return visited;
+}
+
+bool TerrainChunks::applyEdit(const TerrainEdit& edit, Chunk* chunk) const {
+    uchar* types = chunk->types.data();
+    return forEditCells(edit, chunk->x * CHUNK_CELLS, chunk->y * CHUNK_CELLS, CHUNK_CELLS, CHUNK_CELLS, 1,
+                        [types, &edit](int x, int y) { types[y * CHUNK_CELLS + x] = edit.type; });
+}
+
+bool TerrainChunks::applyPainted(const QByteArray& painted, Chunk* chunk) {
+    const uchar* cells = reinterpret_cast<const uchar*>(painted.constData());
+    uchar* types = chunk->types.data();
+    bool changed = false;
+    for (int i = 0; i < CHUNK_CELLS * CHUNK_CELLS; i++) {
+        if (cells[i] != TERRAIN_NONE && types[i] != cells[i]) {
+            types[i] = cells[i];
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void TerrainChunks::buildImage(Chunk* chunk) const {
+    // Edge chunks are cropped to the world, so every pixel is one real cell
+    const int width = qMin(CHUNK_CELLS, mCols - chunk->x * CHUNK_CELLS);
+    const int height = qMin(CHUNK_CELLS, mRows - chunk->y * CHUNK_CELLS);
+    QRgb palette[4];
+    for (int type = 0; type < 4; type++) {
+        palette[type] = color(static_cast<TerrainType>(type)).rgb();
+    }
+
+    QImage image(width, height, QImage::Format_RGB32);
+    const uchar* types = chunk->types.constData();
+    for (int row = 0; row < height; row++) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(row));
+        for (int col = 0; col < width; col++) {
+            line[col] = palette[types[row * CHUNK_CELLS + col]];
+        }
+    }
+    chunk->image = image;
+}
+
+qint64 TerrainChunks::chunkBytes(const Chunk* chunk) {
+    qint64 bytes = sizeof(Chunk) + chunk->types.size();
+    if (!chunk->image.isNull()) {
+        bytes += static_cast<qint64>(chunk->image.bytesPerLine()) * chunk->image.height();
+    }
+    return bytes;
+}
+
+// === LRU Cache (under mMutex) ===
+void TerrainChunks::unlink(Chunk* chunk) const {
+    if (chunk->newer) chunk->newer->older = chunk->older; else mNewest = chunk->older;
+    if (chunk->older) chunk->older->newer = chunk->newer; else mOldest = chunk->newer;
+    chunk->newer = nullptr;
+    chunk->older = nullptr;
+}
+
+void TerrainChunks::touch(Chunk* chunk) const {
+    if (chunk == mNewest) return;
+    unlink(chunk);
+    chunk->older = mNewest;
+    if (mNewest) mNewest->newer = chunk;
+    mNewest = chunk;
+    if (!mOldest) mOldest = chunk;
+}
+
+void TerrainChunks::insert(Chunk* chunk) const {
+    chunk->newer = nullptr;
+    chunk->older = mNewest;
+    if (mNewest) mNewest->newer = chunk;
+    mNewest = chunk;
+    if (!mOldest) mOldest = chunk;
+    mChunks.insert(chunkKey(chunk->x, chunk->y), chunk);
+    mStats.residentChunks++;
+    mStats.residentBytes += chunkBytes(chunk);
+    MemoryStats::allocated(MEMORY_TERRAIN, chunkBytes(chunk));
+}
+
+void TerrainChunks::evictOverLimit(const Chunk* keep) const {
+    while (mStats.residentBytes > mCacheLimit && mOldest && mOldest != keep) {
+        Chunk* victim = mOldest;
+        unlink(victim);
+        mChunks.remove(chunkKey(victim->x, victim->y));
+        mStats.residentChunks--;
+        mStats.residentBytes -= chunkBytes(victim);
+        mStats.evictions++;
+        MemoryStats::freed(MEMORY_TERRAIN, chunkBytes(victim));
+        delete victim;
+    }
+}
+
+TerrainChunks::Chunk* TerrainChunks::acquire(int chunkX, int chunkY) const {
+    Chunk* chunk = mChunks.value(chunkKey(chunkX, chunkY), nullptr);
+    if (chunk) {
+        mStats.hits++;
+        touch(chunk);
+        return chunk;
+    }
+
+    mStats.misses++;
+    chunk = new Chunk;
+    chunk->x = chunkX;
+    chunk->y = chunkY;
+    generate(chunk, mPainted);
+    insert(chunk);
+    evictOverLimit(chunk);
+    return chunk;
+}
+
+// === Lookups ===
+TerrainType TerrainChunks::typeAt(qreal x, qreal y) const {
+    int col = static_cast<int>(std::floor(x / mCellSize));
+    int row = static_cast<int>(std::floor(y / mCellSize));
+    if (col < 0 || col >= mCols || row < 0 || row >= mRows) {
+        return TERRAIN_FOLIAGE; // Default
+    }
+
+    QMutexLocker locker(&mMutex);
+    const Chunk* chunk = acquire(col / CHUNK_CELLS, row / CHUNK_CELLS);
+    return static_cast<TerrainType>(chunk->types[(row % CHUNK_CELLS) * CHUNK_CELLS + col % CHUNK_CELLS]);
+}
+
+void TerrainChunks::typesAt(const QVector<QPointF>& points, QVector<uchar>* types) const {
+    types->resize(points.size());
+    uchar* out = types->data();
+
+    // Runs of points on one chunk (herd mates) look it up once
+    QMutexLocker locker(&mMutex);
+    const Chunk* chunk = nullptr;
+    for (int i = 0; i < points.size(); i++) {
+        const int col = static_cast<int>(std::floor(points[i].x() / mCellSize));
+        const int row = static_cast<int>(std::floor(points[i].y() / mCellSize));
+        if (col < 0 || col >= mCols || row < 0 || row >= mRows) {
+            out[i] = TERRAIN_FOLIAGE;
+            continue;
+        }
+        const int chunkX = col / CHUNK_CELLS;
+        const int chunkY = row / CHUNK_CELLS;
+        if (!chunk || chunk->x != chunkX || chunk->y != chunkY) {
+            chunk = acquire(chunkX, chunkY);   // Only ever evicts others
+        }
+        out[i] = chunk->types[(row % CHUNK_CELLS) * CHUNK_CELLS + col % CHUNK_CELLS];
+    }
+}
+
+int TerrainChunks::chunkIndexAt(qreal x, qreal y) const {
+    int col = static_cast<int>(std::floor(x / mCellSize));
+    int row = static_cast<int>(std::floor(y / mCellSize));
+    if (col < 0 || col >= mCols || row < 0 || row >= mRows) return -1;
+    return (row / CHUNK_CELLS) * chunkCols() + col / CHUNK_CELLS;
+}
+
+QImage TerrainChunks::chunkImage(int chunkX, int chunkY) const {
+    QMutexLocker locker(&mMutex);
+    Chunk* chunk = acquire(chunkX, chunkY);
+    if (chunk->image.isNull()) {
+        const qint64 before = chunkBytes(chunk);
+        buildImage(chunk);
+        mStats.residentBytes += chunkBytes(chunk) - before;
+        MemoryStats::resized(MEMORY_TERRAIN, chunkBytes(chunk) - before);
+        evictOverLimit(chunk);
+    }
+    return chunk->image;   // Shared copy; stays valid if the chunk is evicted meanwhile
+}
+
+QRectF TerrainChunks::chunkRect(int chunkX, int chunkY) const {
+    const int col0 = chunkX * CHUNK_CELLS;
+    const int row0 = chunkY * CHUNK_CELLS;
+    const int width = qMin(CHUNK_CELLS, mCols - col0);
+    const int height = qMin(CHUNK_CELLS, mRows - row0);
+    return QRectF(col0 * mCellSize, row0 * mCellSize, width * mCellSize, height * mCellSize);
+}
+
+QRect TerrainChunks::chunksIn(const QRectF& sceneRect) const {
+    const qreal chunkSize = CHUNK_CELLS * mCellSize;
+    int x0 = qMax(0, static_cast<int>(std::floor(sceneRect.left() / chunkSize)));
+    int y0 = qMax(0, static_cast<int>(std::floor(sceneRect.top() / chunkSize)));
+    int x1 = qMin(chunkCols() - 1, static_cast<int>(std::floor(sceneRect.right() / chunkSize)));
+    int y1 = qMin(chunkRows() - 1, static_cast<int>(std::floor(sceneRect.bottom() / chunkSize)));
+    if (x1 < x0 || y1 < y0) return QRect();
+    return QRect(QPoint(x0, y0), QPoint(x1, y1));
+}
+
+void TerrainChunks::prefetch(const QRect& chunks, bool images) const {
+    if (chunks.isEmpty()) return;
+
+    // Collect what is missing, generate it unlocked on the pool, then insert under the lock
+    QVector<Chunk*> fresh;
+    PaintedCells painted;         // Shared snapshot; cells painted meanwhile are applied on insert
+    quint64 revision = 0;
+    {
+        QMutexLocker locker(&mMutex);
+        painted = mPainted;
+        revision = mRevision;
+        for (int y = chunks.top(); y <= chunks.bottom(); y++) {
+            for (int x = chunks.left(); x <= chunks.right(); x++) {
+                Chunk* resident = mChunks.value(chunkKey(x, y), nullptr);
+                if (resident && (!images || !resident->image.isNull())) continue;
+                Chunk* chunk = new Chunk;
+                chunk->x = x;
+                chunk->y = y;
+                fresh.push_back(chunk);
+            }
+        }
+    }
+    generateMissing(fresh, painted, revision, images);
+}
+
+void TerrainChunks::prefetchChunks(const QVector<int>& chunkIndices) const {
+    if (chunkIndices.isEmpty()) return;
+
+    QVector<Chunk*> fresh;
+    QSet<quint64> listed;         // The list may repeat a chunk; only misses are added (and allocate)
+    PaintedCells painted;
+    quint64 revision = 0;
+    {
+        QMutexLocker locker(&mMutex);
+        const int chunkColumns = chunkCols();
+        for (int index : chunkIndices) {
+            const int x = index % chunkColumns;
+            const int y = index / chunkColumns;
+            const quint64 key = chunkKey(x, y);
+            if (mChunks.contains(key) || listed.contains(key)) continue;
+            listed.insert(key);
+            Chunk* chunk = new Chunk;
+            chunk->x = x;
+            chunk->y = y;
+            fresh.push_back(chunk);
+        }
+        painted = mPainted;
+        revision = mRevision;
+    }
+    generateMissing(fresh, painted, revision, false);
+}
+
+// Generates fresh (unlocked, on the pool), then inserts it under the lock
+void TerrainChunks::generateMissing(const QVector<Chunk*>& fresh, const PaintedCells& painted, quint64 revision,
+                                    bool images) const {
+    if (fresh.isEmpty()) return;
+    TraceScope trace("terrain prefetch", fresh.size());
+
+    Chunk* const* pending = fresh.constData();
+    const PaintedCells* cells = &painted;
+    std::function<void(int)> build = [this, pending, cells, images](int index) {
+        generate(pending[index], *cells);
+        if (images) buildImage(pending[index]);
+    };
+    // Waits on its own tasks only, like TileRenderer, so it is safe inside paint events
+    if (!mThreadPool || mThreadPool->maxThreadCount() <= 1 || fresh.size() == 1) {
+        for (int i = 0; i < fresh.size(); i++) {
+            build(i);
+        }
+    } else {
+        QSemaphore done;
+        for (int i = 0; i < fresh.size(); i++) {
+            mThreadPool->start(new TerrainChunkTask(build, i, &done));
+        }
+        done.acquire(fresh.size());
+    }
+
+    QMutexLocker locker(&mMutex);
+    for (Chunk* chunk : fresh) {
+        // Cells painted while we generated unlocked
+        bool repainted = false;
+        if (mRevision != revision) {
+            const QByteArray cells = mPainted.value(chunkKey(chunk->x, chunk->y));
+            repainted = !cells.isEmpty() && applyPainted(cells, chunk);
+        }
+        if (repainted && !chunk->image.isNull()) {
+            buildImage(chunk);
+        }
+
+        Chunk* resident = mChunks.value(chunkKey(chunk->x, chunk->y), nullptr);
+        if (resident) {
+            // Generated meanwhile by a lookup; identical content, so keep the image and drop ours
+            if (resident->image.isNull() && !chunk->image.isNull()) {
+                const qint64 before = chunkBytes(resident);
+                resident->image = chunk->image;
+                mStats.residentBytes += chunkBytes(resident) - before;
+                MemoryStats::resized(MEMORY_TERRAIN, chunkBytes(resident) - before);
+            }
+            touch(resident);
+            delete chunk;
+            continue;
+        }
+        mStats.misses++;
+        insert(chunk);
+    }
+    evictOverLimit(mNewest);
+}
+
+QImage TerrainChunks::overview() const {
+    QMutexLocker locker(&mMutex);
+    if (!mOverview.isNull() || mCols <= 0 || mRows <= 0) {
+        return mOverview;
+    }
+
+    // Sampled straight from the generator (no chunks), so its cost is bounded by its size
+    const int stride = qMax(1, (qMax(mCols, mRows) + TERRAIN_OVERVIEW_PIXELS - 1) / TERRAIN_OVERVIEW_PIXELS);
+    const int width = (mCols + stride - 1) / stride;
+    const int height = (mRows + stride - 1) / stride;
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; y++) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; x++) {
+            line[x] = color(cellType(x * stride + stride / 2, y * stride + stride / 2)).rgb();
+        }
+    }
+    mOverview = image;
+    mOverviewStride = stride;
+    MemoryStats::allocated(MEMORY_TERRAIN, mOverview.sizeInBytes());
+    for (auto it = mPainted.constBegin(); it != mPainted.constEnd(); ++it) {
+        paintOverview(it.key(), it.value());
+    }
+    return mOverview;
+}
+
+// === Editing ===
+void TerrainChunks::paintOverview(const TerrainEdit& edit) const {
+    QImage& image = mOverview;
+    const QRgb rgb = color(static_cast<TerrainType>(edit.type)).rgb();
+    forEditCells(edit, mOverviewStride / 2, mOverviewStride / 2, image.width(), image.height(), mOverviewStride,
+                 [&image, rgb](int x, int y) { reinterpret_cast<QRgb*>(image.scanLine(y))[x] = rgb; });
+}
+
+void TerrainChunks::paint(qreal x, qreal y, qreal radius, TerrainType type) {
+    TerrainEdit edit;
+    edit.col = static_cast<int>(std::floor(x / mCellSize));
+    edit.row = static_cast<int>(std::floor(y / mCellSize));
+    edit.radius = qMax(0, qRound(radius / mCellSize));
+    edit.type = static_cast<uchar>(type);
+
+    QMutexLocker locker(&mMutex);
+    if (mHasLastStroke && edit == mLastStroke) return;   // Painting is idempotent
+    mLastStroke = edit;
+    mHasLastStroke = true;
+    mRevision++;
+
+    // Record the cells in every chunk the stroke touches, and patch what is resident
+    const QRect chunks = chunksIn(QRectF((edit.col - edit.radius) * mCellSize, (edit.row - edit.radius) * mCellSize,
+                                         (2 * edit.radius + 1) * mCellSize, (2 * edit.radius + 1) * mCellSize));
+    if (!chunks.isEmpty()) {
+        for (int chunkY = chunks.top(); chunkY <= chunks.bottom(); chunkY++) {
+            for (int chunkX = chunks.left(); chunkX <= chunks.right(); chunkX++) {
+                const quint64 key = chunkKey(chunkX, chunkY);
+                QByteArray cells = mPainted.value(key);
+                const bool fresh = cells.isEmpty();
+                if (fresh) {
+                    cells = QByteArray(CHUNK_CELLS * CHUNK_CELLS, static_cast<char>(TERRAIN_NONE));
+                }
+                char* data = cells.data();
+                if (!forEditCells(edit, chunkX * CHUNK_CELLS, chunkY * CHUNK_CELLS, CHUNK_CELLS, CHUNK_CELLS, 1,
+                                  [data, &edit](int x, int y) { data[y * CHUNK_CELLS + x] = static_cast<char>(edit.type); })) {
+                    continue;
+                }
+                if (fresh) {
+                    MemoryStats::allocated(MEMORY_TERRAIN, cells.size());
+                }
+                mPainted.insert(key, cells);
+
+                Chunk* chunk = mChunks.value(key, nullptr);
+                if (chunk && applyEdit(edit, chunk) && !chunk->image.isNull()) {
+                    buildImage(chunk);
+                }
+            }
+        }
+    }
+    if (!mOverview.isNull()) {
+        paintOverview(edit);
+    }
+}
+
+void TerrainChunks::paintOverview(quint64 key, const QByteArray& painted) const {
+    // Overview pixel (x, y) samples cell (x * stride + stride / 2, y * stride + stride / 2)
+    const int stride = mOverviewStride;
+    const int col0 = static_cast<int>(key >> 32) * CHUNK_CELLS;
+    const int row0 = static_cast<int>(static_cast<quint32>(key)) * CHUNK_CELLS;
+    const int x0 = qMax(0, floorDiv(col0 - stride / 2 + stride - 1, stride));
+    const int y0 = qMax(0, floorDiv(row0 - stride / 2 + stride - 1, stride));
+    const int x1 = qMin(mOverview.width() - 1, floorDiv(col0 + CHUNK_CELLS - 1 - stride / 2, stride));
+    const int y1 = qMin(mOverview.height() - 1, floorDiv(row0 + CHUNK_CELLS - 1 - stride / 2, stride));
+    const uchar* cells = reinterpret_cast<const uchar*>(painted.constData());
+    for (int y = y0; y <= y1; y++) {
+        QRgb* line = reinterpret_cast<QRgb*>(mOverview.scanLine(y));
+        const int row = y * stride + stride / 2 - row0;
+        for (int x = x0; x <= x1; x++) {
+            const uchar type = cells[row * CHUNK_CELLS + x * stride + stride / 2 - col0];
+            if (type != TERRAIN_NONE) {
+                line[x] = color(static_cast<TerrainType>(type)).rgb();
+            }
+        }
+    }
+}
+
+void TerrainChunks::clearPainted() {
+    for (const QByteArray& cells : mPainted) {
+        MemoryStats::freed(MEMORY_TERRAIN, cells.size());
+    }
+    mPainted.clear();
+    mHasLastStroke = false;
+}
+
+quint64 TerrainChunks::revision() const {
+    QMutexLocker locker(&mMutex);
+    return mRevision;
+}
+
+int TerrainChunks::paintedChunks() const {
+    QMutexLocker locker(&mMutex);
+    return mPainted.size();
+}
+
+// === Drawing ===
+void TerrainChunks::prefetchView(const QRectF& sceneRect, qreal cellPixels) const {
+    if (cellPixels < TERRAIN_OVERVIEW_CELL_PIXELS) {
+        overview();
+    } else {
+        prefetch(chunksIn(sceneRect), true);
+    }
+}
+
+void TerrainChunks::draw(QPainter* painter, const QRectF& sceneRect, qreal cellPixels) const {
+    if (cellPixels < TERRAIN_OVERVIEW_CELL_PIXELS) {
+        QImage image = overview();
+        int stride;
+        {
+            QMutexLocker locker(&mMutex);
+            stride = mOverviewStride;
+        }
+        painter->drawImage(QRectF(0, 0, image.width() * stride * mCellSize, image.height() * stride * mCellSize), image);
+        return;
+    }
+
+    const QRect chunks = chunksIn(sceneRect);
+    if (chunks.isEmpty()) return;
+    for (int y = chunks.top(); y <= chunks.bottom(); y++) {
+        for (int x = chunks.left(); x <= chunks.right(); x++) {
+            painter->drawImage(chunkRect(x, y), chunkImage(x, y));
+        }
+    }
+}
+
+TerrainCacheStats TerrainChunks::stats() const {
+    QMutexLocker locker(&mMutex);
+    return mStats;
+}
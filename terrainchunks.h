@@ -0,0 +1,168 @@
+// 2dsim08/terrainchunks.h - Procedural terrain generated in chunks on demand, held in a capped LRU cache
+#ifndef TERRAINCHUNKS_H
+#define TERRAINCHUNKS_H
+
+#include <QByteArray>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QRectF>
+#include <QThreadPool>
+#include <QVector>
+#include <QtGlobal>
+
+enum TerrainType {
+    TERRAIN_NONE = 0,
+    TERRAIN_FOLIAGE = 1,
+    TERRAIN_SAND = 2,
+    TERRAIN_WATER = 3
+};
+
+struct TerrainCacheStats {
+    int residentChunks;
+    qint64 residentBytes;
+    qint64 hits;
+    qint64 misses;           // Chunks generated (first time or after eviction)
+    qint64 evictions;
+
+    TerrainCacheStats() : residentChunks(0), residentBytes(0), hits(0), misses(0), evictions(0) {}
+};
+
+// === Chunked Terrain ===
+// A cell's type is a pure function of (seed, col, row): a few octaves of value noise cut into
+// water / sand / foliage bands. Nothing is generated up front. A chunk of CHUNK_CELLS x
+// CHUNK_CELLS cells is generated the first time it is looked up - or in parallel by prefetch()
+// for a whole view - and kept in an LRU cache of at most TERRAIN_CACHE_MB. An evicted chunk
+// regenerates bit-identically, so eviction never changes the world, and memory and setup time
+// do not grow with the world. Painted cells are kept per chunk, apart from the cache, and laid
+// over the noise by every generation, so they survive eviction too. Every lookup is thread-safe.
+class QPainter;
+
+class TerrainChunks
+{
+public:
+    static const int CHUNK_CELLS = 64;
+    static const int TERRAIN_CACHE_MB = 64;
+    static const int TERRAIN_NOISE_PERIOD = 32;       // Cells per lattice step of the coarsest octave
+    static const int TERRAIN_NOISE_OCTAVES = 3;
+    static const int TERRAIN_OVERVIEW_PIXELS = 1024;  // Longest side of the whole-world overview image
+    static constexpr qreal TERRAIN_OVERVIEW_CELL_PIXELS = 0.5;
+    static constexpr double TERRAIN_WATER_LEVEL = 0.21;   // Noise below this is water...
+    static constexpr double TERRAIN_SAND_LEVEL = 0.26;    // ...then a sand shore, then foliage
+
+    TerrainChunks();
+    ~TerrainChunks();
+
+    // Forgets every chunk; O(1). The pool (may be null) generates prefetched chunks.
+    void setup(quint32 seed, qreal cellSize, int cols, int rows, QThreadPool* threadPool);
+    void setCacheLimit(qint64 bytes);
+    // Cache limit: TERRAIN_CACHE_MB for the renderers plus the cell types of this many chunks
+    // (capped at the whole world) - one per creature keeps every creature's chunk resident
+    void reserveChunks(int chunks);
+
+    int cols() const { return mCols; }
+    int rows() const { return mRows; }
+    qreal cellSize() const { return mCellSize; }
+    int chunkCols() const { return (mCols + CHUNK_CELLS - 1) / CHUNK_CELLS; }
+    int chunkRows() const { return (mRows + CHUNK_CELLS - 1) / CHUNK_CELLS; }
+
+    // === Lookups (the simulation and both renderers go through these) ===
+    TerrainType typeAt(qreal x, qreal y) const;            // Scene units; outside the world = foliage
+    void typesAt(const QVector<QPointF>& points, QVector<uchar>* types) const;   // Same, one lock for all
+    QImage chunkImage(int chunkX, int chunkY) const;       // One pixel per cell
+    QRectF chunkRect(int chunkX, int chunkY) const;        // Scene units
+    QRect chunksIn(const QRectF& sceneRect) const;         // Chunk coordinates overlapping, clipped
+    void prefetch(const QRect& chunks, bool images) const; // Generates what is missing, in parallel
+    int chunkIndexAt(qreal x, qreal y) const;              // row * chunkCols() + col; -1 outside the world
+    void prefetchChunks(const QVector<int>& chunkIndices) const;   // Same, for a list (repeats allowed); no images
+    QImage overview() const;                               // Whole world, sampled; for far zoom levels
+
+    // === Drawing (shared by the scene view and the tile renderer) ===
+    // cellPixels: on-screen size of one cell. Below TERRAIN_OVERVIEW_CELL_PIXELS the overview is
+    // drawn instead of chunks. prefetchView() may fan out on the pool; call it from the GUI
+    // thread first, then draw() from any thread (the painter maps scene units to pixels).
+    void prefetchView(const QRectF& sceneRect, qreal cellPixels) const;
+    void draw(QPainter* painter, const QRectF& sceneRect, qreal cellPixels) const;
+
+    // === Editing ===
+    // Cells within radius of (x, y) become type: written into the painted cells of every chunk the
+    // stroke touches, and patched into resident chunks and the overview. A stroke on the same cell
+    // as the previous one (a drag that has not left the cell) changes nothing and is dropped.
+    void paint(qreal x, qreal y, qreal radius, TerrainType type);
+    quint64 revision() const;                              // Bumped by every paint that is kept
+    int paintedChunks() const;
+
+    TerrainType cellType(int col, int row) const;          // The generator itself; no cache, no edits
+    static QColor color(TerrainType type);
+    TerrainCacheStats stats() const;
+
+private:
+    struct Chunk {
+        int x;
+        int y;
+        QVector<uchar> types;    // Row-major TerrainType per cell
+        QImage image;            // Built on first chunkImage()
+        Chunk* newer;            // LRU list
+        Chunk* older;
+    };
+
+    static quint64 chunkKey(int chunkX, int chunkY) {
+        return (static_cast<quint64>(static_cast<quint32>(chunkX)) << 32) | static_cast<quint32>(chunkY);
+    }
+    struct TerrainEdit {         // One brush stroke, in cells
+        int col;
+        int row;
+        int radius;
+        uchar type;
+
+        bool operator==(const TerrainEdit& other) const {
+            return col == other.col && row == other.row && radius == other.radius && type == other.type;
+        }
+    };
+    // Per painted chunk: CHUNK_CELLS x CHUNK_CELLS TerrainTypes, row-major; TERRAIN_NONE = not painted
+    typedef QHash<quint64, QByteArray> PaintedCells;
+    template <typename Visit>
+    static bool forEditCells(const TerrainEdit& edit, int col0, int row0, int width, int height, int stride, Visit visit);
+    bool applyEdit(const TerrainEdit& edit, Chunk* chunk) const;
+    static bool applyPainted(const QByteArray& painted, Chunk* chunk);
+    void paintOverview(const TerrainEdit& edit) const;    // Under mMutex, overview built
+    void paintOverview(quint64 key, const QByteArray& painted) const;
+    void clearPainted();
+
+    double noise(int col, int row) const;
+    void generate(Chunk* chunk, const PaintedCells& painted) const;
+    void generateMissing(const QVector<Chunk*>& fresh, const PaintedCells& painted, quint64 revision, bool images) const;
+    void buildImage(Chunk* chunk) const;
+    static qint64 chunkBytes(const Chunk* chunk);
+
+    // Under mMutex
+    Chunk* acquire(int chunkX, int chunkY) const;
+    void insert(Chunk* chunk) const;
+    void touch(Chunk* chunk) const;
+    void unlink(Chunk* chunk) const;
+    void evictOverLimit(const Chunk* keep) const;
+    void clear();
+
+    quint32 mSeed;
+    qreal mCellSize;
+    int mCols;
+    int mRows;
+    QThreadPool* mThreadPool;
+    qint64 mCacheLimit;
+
+    mutable QMutex mMutex;
+    mutable QHash<quint64, Chunk*> mChunks;
+    mutable Chunk* mNewest;
+    mutable Chunk* mOldest;
+    mutable TerrainCacheStats mStats;
+    mutable QImage mOverview;
+    mutable int mOverviewStride;   // Cells per overview pixel
+    PaintedCells mPainted;         // Kept through eviction; bounded by the world's chunks
+    TerrainEdit mLastStroke;
+    bool mHasLastStroke;
+    quint64 mRevision;
+};
+
+#endif // TERRAINCHUNKS_H
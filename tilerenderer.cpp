@@ -0,0 +1,237 @@
+// 2dsim08/tilerenderer.cpp - Multithreaded tile rasterizer for the terrain and creature layers
+#include "tilerenderer.h"
+#include "simtrace.h"
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QPen>
+#include <QRunnable>
+#include <QSemaphore>
+#include <cmath>
+
+const int TileRenderer::TILE_SIZE;   // Out of line: qMin binds it by reference
+
+static const qreal TINY_SPRITE_PIXELS = 3.0;   // Below this a creature is a filled square, not an ellipse
+static const qreal MIN_RING_PIXELS = 0.5;      // Thinner rings are skipped (the scene would draw them sub-pixel)
+
+// === Render Range Task ===
+class RenderRangeTask : public QRunnable {
+private:
+    std::function<void(int, int, int)> mBody;
+    int mStartIndex;
+    int mEndIndex;
+    int mSlice;
+    QSemaphore* mDone;
+
+public:
+    RenderRangeTask(const std::function<void(int, int, int)>& body, int start, int end, int slice, QSemaphore* done)
+        : mBody(body), mStartIndex(start), mEndIndex(end), mSlice(slice), mDone(done) {
+        setAutoDelete(true);
+    }
+
+    void run() override {
+        TraceScope trace("render task", mSlice);
+        mBody(mStartIndex, mEndIndex, mSlice);
+        mDone->release();
+    }
+};
+
+TileRenderer::TileRenderer(QThreadPool* threadPool)
+    : mThreadPool(threadPool)
+    , mTerrain(nullptr)
+    , mRingWidth(0)
+    , mBackground(qRgb(255, 255, 255))
+    , mGeneration(1)
+    , mTilesX(0)
+    , mTilesY(0)
+    , mRenderedGeneration(0)
+{
+}
+
+void TileRenderer::setTerrain(const TerrainChunks* terrain) {
+    mTerrain = terrain;
+    mGeneration++;
+}
+
+void TileRenderer::setSprites(QVector<RenderSprite>&& sprites) {
+    mSprites.swap(sprites);
+    mGeneration++;
+}
+
+void TileRenderer::parallelFor(int count, const std::function<void(int start, int end, int slice)>& body) {
+    // Waits on its own tasks only (never processEvents), so it is safe inside paint events
+    // even while simulation tasks are still queued on the same pool
+    int slices = mThreadPool ? qMin(count, qMax(1, mThreadPool->maxThreadCount())) : 1;
+    if (slices <= 1) {
+        body(0, count, 0);
+        return;
+    }
+
+    QSemaphore done;
+    int chunkSize = (count + slices - 1) / slices;
+    int started = 0;
+    for (int slice = 0; slice < slices; slice++) {
+        int start = slice * chunkSize;
+        int end = qMin(count, start + chunkSize);
+        if (start >= end) break;
+        mThreadPool->start(new RenderRangeTask(body, start, end, slice, &done));
+        started++;
+    }
+    done.acquire(started);
+}
+
+const QImage& TileRenderer::render(const QTransform& sceneToViewport, const QSize& size) {
+    if (mFrame.size() == size && mRenderedGeneration == mGeneration && mRenderedTransform == sceneToViewport) {
+        return mFrame;
+    }
+    if (size.isEmpty()) {
+        mFrame = QImage();
+        return mFrame;
+    }
+    TraceScope trace("tile render");
+
+    if (mFrame.size() != size) {
+        mFrame = QImage(size, QImage::Format_RGB32);
+    }
+    mTilesX = (size.width() + TILE_SIZE - 1) / TILE_SIZE;
+    mTilesY = (size.height() + TILE_SIZE - 1) / TILE_SIZE;
+    const int tiles = mTilesX * mTilesY;
+
+    const qreal sx = sceneToViewport.m11();
+    const qreal sy = sceneToViewport.m22();
+    const qreal dx = sceneToViewport.dx();
+    const qreal dy = sceneToViewport.dy();
+    const qreal halfRing = mRingWidth / 2;
+    const int width = size.width();
+    const int height = size.height();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Chunks under the view are generated here, so raster workers only ever hit the cache
+    if (mTerrain && sx > 0 && sy > 0) {
+        mTerrain->prefetchView(sceneToViewport.inverted().mapRect(QRectF(0, 0, width, height)), mTerrain->cellSize() * sx);
+    }
+
+    // === Binning: each slice sorts its sprites into its own per-tile lists ===
+    int binSlices = mThreadPool ? qMax(1, mThreadPool->maxThreadCount()) : 1;
+    mBins.resize(binSlices);
+    QVector<int> binned(binSlices, 0);
+    int* binnedCounts = binned.data();
+    QVector<QVector<int>>* bins = mBins.data();
+    const RenderSprite* sprites = mSprites.constData();
+
+    for (int slice = 0; slice < binSlices; slice++) {
+        bins[slice].resize(tiles);
+        for (auto& bin : bins[slice]) {
+            bin.clear();
+        }
+    }
+
+    parallelFor(mSprites.size(), [=](int start, int end, int slice) {
+        QVector<int>* tileBins = bins[slice].data();
+        for (int i = start; i < end; i++) {
+            const RenderSprite& sprite = sprites[i];
+            if (sprite.opacity <= 0) continue;
+            qreal x0 = (sprite.x - halfRing) * sx + dx;
+            qreal y0 = (sprite.y - halfRing) * sy + dy;
+            qreal x1 = (sprite.x + sprite.size + halfRing) * sx + dx;
+            qreal y1 = (sprite.y + sprite.size + halfRing) * sy + dy;
+            if (x1 < 0 || y1 < 0 || x0 >= width || y0 >= height) continue;
+
+            int tx0 = qMax(0, static_cast<int>(x0) / TILE_SIZE);
+            int ty0 = qMax(0, static_cast<int>(y0) / TILE_SIZE);
+            int tx1 = qMin(mTilesX - 1, static_cast<int>(x1) / TILE_SIZE);
+            int ty1 = qMin(mTilesY - 1, static_cast<int>(y1) / TILE_SIZE);
+            for (int ty = ty0; ty <= ty1; ty++) {
+                for (int tx = tx0; tx <= tx1; tx++) {
+                    tileBins[ty * mTilesX + tx].push_back(i);
+                }
+            }
+            binnedCounts[slice]++;
+        }
+    });
+    mStats.binMicros = timer.nsecsElapsed() / 1000;
+
+    // === Raster: one tile at a time per worker, straight into the frame buffer ===
+    timer.restart();
+    uchar* frameBits = mFrame.bits();   // Detach here, on the GUI thread, before workers wrap its memory
+    parallelFor(tiles, [this, frameBits, &sceneToViewport](int start, int end, int) {
+        for (int tile = start; tile < end; tile++) {
+            rasterTile(tile, frameBits, sceneToViewport);
+        }
+    });
+    mStats.rasterMicros = timer.nsecsElapsed() / 1000;
+
+    mStats.tiles = tiles;
+    mStats.sprites = 0;
+    for (int count : binned) {
+        mStats.sprites += count;
+    }
+    mRenderedGeneration = mGeneration;
+    mRenderedTransform = sceneToViewport;
+    return mFrame;
+}
+
+void TileRenderer::rasterTile(int tile, uchar* frameBits, const QTransform& sceneToViewport) {
+    const int tileX = (tile % mTilesX) * TILE_SIZE;
+    const int tileY = (tile / mTilesX) * TILE_SIZE;
+    const int tileWidth = qMin(TILE_SIZE, mFrame.width() - tileX);
+    const int tileHeight = qMin(TILE_SIZE, mFrame.height() - tileY);
+
+    // This worker's own tile image: a window onto the frame, so no copy-back is needed
+    uchar* bits = frameBits + tileY * mFrame.bytesPerLine() + tileX * 4;
+    QImage tileImage(bits, tileWidth, tileHeight, mFrame.bytesPerLine(), QImage::Format_RGB32);
+    tileImage.fill(mBackground);
+
+    QPainter painter(&tileImage);
+    painter.translate(-tileX, -tileY);
+
+    const qreal sx = sceneToViewport.m11();
+    const qreal sy = sceneToViewport.m22();
+    const qreal dx = sceneToViewport.dx();
+    const qreal dy = sceneToViewport.dy();
+
+    // === Terrain layer: only the chunks under this tile ===
+    if (mTerrain && sx > 0 && sy > 0) {
+        QRectF tileScene((tileX - dx) / sx, (tileY - dy) / sy, tileWidth / sx, tileHeight / sy);
+        painter.save();
+        painter.translate(dx, dy);
+        painter.scale(sx, sy);
+        mTerrain->draw(&painter, tileScene, mTerrain->cellSize() * sx);
+        painter.restore();
+    }
+
+    // === Creature layer: members, then alphas on top (same order as the scene's z-values) ===
+    const qreal ringPixels = mRingWidth * sx;
+    const RenderSprite* sprites = mSprites.constData();   // Never detach here: the list may be shared with a snapshot
+    qreal opacity = 1.0;
+    for (int pass = 0; pass < 2; pass++) {
+        const bool alphas = (pass == 1);
+        if (ringPixels >= MIN_RING_PIXELS) {
+            painter.setPen(QPen(alphas ? Qt::black : Qt::white, ringPixels));
+        } else {
+            painter.setPen(Qt::NoPen);
+        }
+
+        for (const auto& sliceBins : mBins) {
+            for (int index : sliceBins[tile]) {
+                const RenderSprite& sprite = sprites[index];
+                if (sprite.isAlpha != alphas) continue;
+
+                if (sprite.opacity != opacity) {
+                    opacity = sprite.opacity;
+                    painter.setOpacity(opacity);
+                }
+
+                QRectF rect(sprite.x * sx + dx, sprite.y * sy + dy, sprite.size * sx, sprite.size * sy);
+                if (rect.width() < TINY_SPRITE_PIXELS) {
+                    painter.fillRect(QRectF(rect.topLeft(), QSizeF(qMax<qreal>(1, rect.width()), qMax<qreal>(1, rect.height()))),
+                                     QColor(sprite.fill));
+                } else {
+                    painter.setBrush(QColor(sprite.fill));
+                    painter.drawEllipse(rect);
+                }
+            }
+        }
+    }
+}
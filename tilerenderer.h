@@ -0,0 +1,78 @@
+// 2dsim08/tilerenderer.h - Multithreaded tile rasterizer for the terrain and creature layers
+#ifndef TILERENDERER_H
+#define TILERENDERER_H
+
+#include <QImage>
+#include <QColor>
+#include <QSize>
+#include <QTransform>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+#include "terrainchunks.h"
+
+// One creature as the rasterizer sees it: a filled circle of `size` scene units at (x, y)
+// (top-left, like QGraphicsEllipseItem), ringed black for alphas and white for members
+struct RenderSprite {
+    float x;
+    float y;
+    float size;
+    float opacity;       // 0 = not drawn
+    QRgb fill;
+    bool isAlpha;        // Drawn above members, black ring
+};
+
+struct TileRenderStats {
+    int tiles;
+    int sprites;         // Sprites that landed in at least one tile
+    qint64 binMicros;
+    qint64 rasterMicros;
+
+    TileRenderStats() : tiles(0), sprites(0), binMicros(0), rasterMicros(0) {}
+};
+
+// Renders the viewport as a grid of TILE_SIZE tiles on the thread pool. Sprites are first
+// binned to the tiles they overlap (one bin list per worker slice, so binning needs no locks),
+// then every tile is painted by one worker into its own QImage - a view onto its rectangle of
+// the frame buffer, so there is nothing to stitch afterwards. GUI thread only (render() waits).
+class TileRenderer
+{
+public:
+    static const int TILE_SIZE = 128;       // Pixels; small enough to balance, big enough to amortize
+
+    explicit TileRenderer(QThreadPool* threadPool);
+
+    void setTerrain(const TerrainChunks* terrain);   // Drawn chunk by chunk; the terrain never changes
+    void setRingWidth(qreal sceneUnits) { mRingWidth = sceneUnits; mGeneration++; }
+    void setBackground(const QColor& color) { mBackground = color.rgb(); mGeneration++; }
+    void setSprites(QVector<RenderSprite>&& sprites);   // May share its data (a snapshot's); never written
+    bool hasTerrain() const { return mTerrain != nullptr; }
+
+    // Re-rasterizes only when the sprites, terrain, transform or size changed since last time
+    const QImage& render(const QTransform& sceneToViewport, const QSize& size);
+    TileRenderStats lastStats() const { return mStats; }
+
+private:
+    void parallelFor(int count, const std::function<void(int start, int end, int slice)>& body);
+    void rasterTile(int tile, uchar* frameBits, const QTransform& sceneToViewport);
+
+    QThreadPool* mThreadPool;
+
+    // === Inputs ===
+    const TerrainChunks* mTerrain;
+    QVector<RenderSprite> mSprites;
+    qreal mRingWidth;
+    QRgb mBackground;
+    quint64 mGeneration;      // Bumped by every input change
+
+    // === Frame ===
+    QImage mFrame;
+    int mTilesX;
+    int mTilesY;
+    QVector<QVector<QVector<int>>> mBins;   // [slice][tile] -> sprite indices, capacity reused
+    quint64 mRenderedGeneration;
+    QTransform mRenderedTransform;
+    TileRenderStats mStats;
+};
+
+#endif // TILERENDERER_H
@@ -0,0 +1,146 @@
+// 2dsim08/trajectoryformat.cpp - Frame encoding for trajectory recordings
+#include "trajectoryformat.h"
+#include <cstring>
+
+// === Varint Helpers ===
+static inline quint32 zigzagEncode(qint32 value) {
+    return (static_cast<quint32>(value) << 1) ^ static_cast<quint32>(value >> 31);
+}
+
+static inline qint32 zigzagDecode(quint32 value) {
+    return static_cast<qint32>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+static inline void writeVarint(QByteArray& out, quint32 value) {
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+static inline bool readVarint(const uchar*& cursor, const uchar* end, quint32* value) {
+    quint32 result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (cursor >= end) return false;
+        uchar byte = *cursor++;
+        result |= static_cast<quint32>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// === Frame Encoding ===
+// Payload layout (before compression), column by column so zlib sees long runs:
+//   u8 flags, varint tickLow, varint tickHigh, varint count,
+//   ids, x, y, alphaID (zigzag varints - deltas for non-key frames), state bytes
+QByteArray encodeTrajectoryFrame(const TrajectoryFrame& frame, const TrajectoryFrame* previous, int compressionLevel) {
+    const int count = frame.creatures.size();
+    bool isKey = (previous == nullptr || previous->creatures.size() != count);
+
+    QByteArray payload;
+    payload.reserve(16 + count * 8);
+    payload.append(static_cast<char>(isKey ? TRAJECTORY_FRAME_KEY : 0));
+    writeVarint(payload, static_cast<quint32>(frame.tick & 0xFFFFFFFF));
+    writeVarint(payload, static_cast<quint32>(static_cast<quint64>(frame.tick) >> 32));
+    writeVarint(payload, static_cast<quint32>(count));
+
+    const TrajectoryCreature* cur = frame.creatures.constData();
+    const TrajectoryCreature* prev = isKey ? nullptr : previous->creatures.constData();
+
+    for (int i = 0; i < count; i++) {
+        writeVarint(payload, zigzagEncode(prev ? cur[i].uniqueID - prev[i].uniqueID : cur[i].uniqueID));
+    }
+    for (int i = 0; i < count; i++) {
+        writeVarint(payload, zigzagEncode(prev ? cur[i].posX - prev[i].posX : cur[i].posX));
+    }
+    for (int i = 0; i < count; i++) {
+        writeVarint(payload, zigzagEncode(prev ? cur[i].posY - prev[i].posY : cur[i].posY));
+    }
+    for (int i = 0; i < count; i++) {
+        writeVarint(payload, zigzagEncode(prev ? cur[i].alphaID - prev[i].alphaID : cur[i].alphaID));
+    }
+    for (int i = 0; i < count; i++) {
+        payload.append(static_cast<char>((cur[i].state & 0x7F) | (cur[i].isAlpha ? 0x80 : 0)));
+    }
+
+    return qCompress(payload, compressionLevel);
+}
+
+bool decodeTrajectoryFrame(const char* data, int size, const TrajectoryFrame* previous, TrajectoryFrame* out) {
+    QByteArray payload = qUncompress(reinterpret_cast<const uchar*>(data), size);
+    if (payload.isEmpty()) return false;
+
+    const uchar* cursor = reinterpret_cast<const uchar*>(payload.constData());
+    const uchar* end = cursor + payload.size();
+
+    bool isKey = (*cursor++ & TRAJECTORY_FRAME_KEY) != 0;
+    quint32 tickLow = 0, tickHigh = 0, count = 0;
+    if (!readVarint(cursor, end, &tickLow) || !readVarint(cursor, end, &tickHigh) || !readVarint(cursor, end, &count)) {
+        return false;
+    }
+
+    if (!isKey && (!previous || previous->creatures.size() != static_cast<int>(count))) {
+        return false;  // Delta frame without the frame it was taken against
+    }
+
+    out->tick = static_cast<qint64>((static_cast<quint64>(tickHigh) << 32) | tickLow);
+    out->creatures.resize(count);
+    TrajectoryCreature* cur = out->creatures.data();
+    const TrajectoryCreature* prev = isKey ? nullptr : previous->creatures.constData();
+
+    quint32 value = 0;
+    for (quint32 i = 0; i < count; i++) {
+        if (!readVarint(cursor, end, &value)) return false;
+        cur[i].uniqueID = (prev ? prev[i].uniqueID : 0) + zigzagDecode(value);
+    }
+    for (quint32 i = 0; i < count; i++) {
+        if (!readVarint(cursor, end, &value)) return false;
+        cur[i].posX = (prev ? prev[i].posX : 0) + zigzagDecode(value);
+    }
+    for (quint32 i = 0; i < count; i++) {
+        if (!readVarint(cursor, end, &value)) return false;
+        cur[i].posY = (prev ? prev[i].posY : 0) + zigzagDecode(value);
+    }
+    for (quint32 i = 0; i < count; i++) {
+        if (!readVarint(cursor, end, &value)) return false;
+        cur[i].alphaID = (prev ? prev[i].alphaID : 0) + zigzagDecode(value);
+    }
+    if (end - cursor < static_cast<qptrdiff>(count)) return false;
+    for (quint32 i = 0; i < count; i++) {
+        uchar packed = *cursor++;
+        cur[i].state = packed & 0x7F;
+        cur[i].isAlpha = (packed & 0x80) ? 1 : 0;
+    }
+
+    return true;
+}
+
+QByteArray trajectoryFileHeader(const char* magic) {
+    QByteArray header(magic, TRAJECTORY_MAGIC_SIZE);
+    quint32 version = TRAJECTORY_FORMAT_VERSION;
+    quint32 reserved = 0;
+    header.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    header.append(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+    return header;
+}
+
+bool checkTrajectoryFileHeader(const uchar* data, qint64 size, const char* magic) {
+    if (!data || size < TRAJECTORY_HEADER_SIZE) return false;
+    if (std::memcmp(data, magic, TRAJECTORY_MAGIC_SIZE) != 0) return false;
+
+    quint32 version = 0;
+    std::memcpy(&version, data + TRAJECTORY_MAGIC_SIZE, sizeof(version));
+    return version == TRAJECTORY_FORMAT_VERSION;
+}
+
+QString trajectoryChunkFileName(int chunk) {
+    return QString("chunk_%1.trc").arg(chunk, 6, 10, QChar('0'));
+}
+
+QString trajectoryIndexFileName() {
+    return QStringLiteral("index.tri");
+}
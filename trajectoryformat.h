@@ -0,0 +1,71 @@
+// 2dsim08/trajectoryformat.h - On-disk format shared by the trajectory recorder and replay
+#ifndef TRAJECTORYFORMAT_H
+#define TRAJECTORYFORMAT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// === Recording Layout ===
+// A recording is a directory:
+//   index.tri          - 16-byte header, then one TrajectoryIndexEntry per written frame
+//   chunk_000000.trc   - 16-byte header, then compressed frames back to back
+// Header = 8-byte magic, u32 version, u32 reserved (keeps mapped index entries 8-byte aligned).
+// Every chunk starts with a keyframe, so any chunk can be decoded on its own.
+// Delta frames hold the difference against the previous written frame in the same chunk.
+// All binary fields are host byte order (little endian on every platform we build for).
+
+static const char TRAJECTORY_INDEX_MAGIC[] = "2DSIMIDX";
+static const char TRAJECTORY_CHUNK_MAGIC[] = "2DSIMTRC";
+static const int TRAJECTORY_MAGIC_SIZE = 8;
+static const quint32 TRAJECTORY_FORMAT_VERSION = 1;
+static const int TRAJECTORY_HEADER_SIZE = 16;
+
+enum TrajectoryFrameFlags {
+    TRAJECTORY_FRAME_KEY = 1
+};
+
+// One creature in one frame (positions rounded to whole world units)
+struct TrajectoryCreature {
+    qint32 uniqueID;
+    qint32 posX;
+    qint32 posY;
+    qint32 alphaID;      // 0 = no alpha / is an alpha
+    quint8 state;        // CreatureState
+    quint8 isAlpha;
+};
+
+struct TrajectoryFrame {
+    qint64 tick;
+    QVector<TrajectoryCreature> creatures;
+
+    TrajectoryFrame() : tick(0) {}
+};
+
+// Fixed-size index record, 24 bytes
+struct TrajectoryIndexEntry {
+    qint64 tick;
+    qint32 chunk;
+    quint32 offset;      // Byte offset of the compressed frame inside the chunk file
+    quint32 size;        // Compressed size in bytes
+    quint32 flags;       // TrajectoryFrameFlags
+};
+
+// === Encoding ===
+// Encodes a frame; when previous is non-null the frame is delta-encoded against it.
+// Payload is zigzag varints, compressed with qCompress.
+QByteArray encodeTrajectoryFrame(const TrajectoryFrame& frame, const TrajectoryFrame* previous, int compressionLevel);
+
+// Decodes a frame produced by encodeTrajectoryFrame. previous must be the frame the
+// delta was taken against (ignored for keyframes). Returns false on corrupt input.
+bool decodeTrajectoryFrame(const char* data, int size, const TrajectoryFrame* previous, TrajectoryFrame* out);
+
+// Writes / validates the 16-byte file header
+QByteArray trajectoryFileHeader(const char* magic);
+bool checkTrajectoryFileHeader(const uchar* data, qint64 size, const char* magic);
+
+QString trajectoryChunkFileName(int chunk);
+QString trajectoryIndexFileName();
+
+#endif // TRAJECTORYFORMAT_H
@@ -0,0 +1,172 @@
+// 2dsim08/trajectoryreader.cpp - Memory-mapped random-access reader for trajectory recordings
+#include "trajectoryreader.h"
+#include <QDir>
+#include <utility>
+
+TrajectoryReader::TrajectoryReader()
+    : mEntries(nullptr)
+    , mEntryCount(0)
+    , mKeyframeCount(0)
+    , mFirstTick(0)
+    , mLastTick(-1)
+    , mCurrentEntry(-1)
+    , mFramesDecodedLastSeek(0)
+{
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    close();
+}
+
+bool TrajectoryReader::open(const QString& directory) {
+    close();
+    QDir dir(directory);
+
+    // === Index ===
+    mIndexFile.setFileName(dir.filePath(trajectoryIndexFileName()));
+    if (!mIndexFile.open(QIODevice::ReadOnly)) {
+        mError = QString("Cannot open %1").arg(mIndexFile.fileName());
+        return false;
+    }
+
+    qint64 indexSize = mIndexFile.size();
+    const uchar* indexData = mIndexFile.map(0, indexSize);
+    if (!checkTrajectoryFileHeader(indexData, indexSize, TRAJECTORY_INDEX_MAGIC)) {
+        mError = "Not a 2dsim08 trajectory index (or unsupported version)";
+        close();
+        return false;
+    }
+
+    mEntries = reinterpret_cast<const TrajectoryIndexEntry*>(indexData + TRAJECTORY_HEADER_SIZE);
+    int entryCount = static_cast<int>((indexSize - TRAJECTORY_HEADER_SIZE) / sizeof(TrajectoryIndexEntry));
+    if (entryCount <= 0) {
+        mError = "Recording has no frames";
+        close();
+        return false;
+    }
+
+    // === Chunks ===
+    int lastChunk = mEntries[entryCount - 1].chunk;
+    for (int chunk = 0; chunk <= lastChunk; chunk++) {
+        QFile* file = new QFile(dir.filePath(trajectoryChunkFileName(chunk)));
+        mChunkFiles.push_back(file);
+        const uchar* data = nullptr;
+        if (file->open(QIODevice::ReadOnly)) {
+            data = file->map(0, file->size());
+        }
+        if (!checkTrajectoryFileHeader(data, file->size(), TRAJECTORY_CHUNK_MAGIC)) {
+            mError = QString("Cannot map %1").arg(file->fileName());
+            close();
+            return false;
+        }
+        mChunkData.push_back(data);
+        mChunkSizes.push_back(file->size());
+    }
+
+    // === Seek tables ===
+    mEntryCount = entryCount;
+    mFirstTick = mEntries[0].tick;
+    mLastTick = mEntries[entryCount - 1].tick;
+
+    mKeyForEntry.resize(entryCount);
+    int currentKey = -1;
+    for (int i = 0; i < entryCount; i++) {
+        if (mEntries[i].flags & TRAJECTORY_FRAME_KEY) {
+            currentKey = i;
+            mKeyframeCount++;
+        }
+        mKeyForEntry[i] = currentKey;
+    }
+    if (mKeyForEntry[0] < 0) {
+        mError = "Recording does not start with a keyframe";
+        close();
+        return false;
+    }
+
+    mEntryForTick.resize(static_cast<int>(mLastTick - mFirstTick + 1));
+    int entry = 0;
+    for (int t = 0; t < mEntryForTick.size(); t++) {
+        while (entry + 1 < entryCount && mEntries[entry + 1].tick <= mFirstTick + t) {
+            entry++;
+        }
+        mEntryForTick[t] = entry;
+    }
+
+    return true;
+}
+
+void TrajectoryReader::close() {
+    for (int i = 0; i < mChunkFiles.size(); i++) {
+        delete mChunkFiles[i];  // Unmaps
+    }
+    mChunkFiles.clear();
+    mChunkData.clear();
+    mChunkSizes.clear();
+
+    mIndexFile.close();
+    mEntries = nullptr;
+    mEntryCount = 0;
+    mKeyframeCount = 0;
+    mFirstTick = 0;
+    mLastTick = -1;
+    mEntryForTick.clear();
+    mKeyForEntry.clear();
+    mCurrentEntry = -1;
+    mFramesDecodedLastSeek = 0;
+}
+
+int TrajectoryReader::entryForTick(qint64 tick) const {
+    if (tick <= mFirstTick) return 0;
+    if (tick >= mLastTick) return mEntryCount - 1;
+    return mEntryForTick[static_cast<int>(tick - mFirstTick)];
+}
+
+qint64 TrajectoryReader::stepTick(qint64 tick, int frames) const {
+    if (!isOpen()) return tick;
+    int entry = qBound(0, entryForTick(tick) + frames, mEntryCount - 1);
+    return mEntries[entry].tick;
+}
+
+bool TrajectoryReader::decodeEntry(int entry, const TrajectoryFrame* previous, TrajectoryFrame* out) {
+    const TrajectoryIndexEntry& e = mEntries[entry];
+    if (e.chunk < 0 || e.chunk >= mChunkData.size() ||
+        static_cast<qint64>(e.offset) + e.size > mChunkSizes[e.chunk]) {
+        return false;
+    }
+
+    mFramesDecodedLastSeek++;
+    return decodeTrajectoryFrame(reinterpret_cast<const char*>(mChunkData[e.chunk]) + e.offset,
+                                 static_cast<int>(e.size), previous, out);
+}
+
+const TrajectoryFrame* TrajectoryReader::frameAt(qint64 tick) {
+    if (!isOpen()) return nullptr;
+
+    int target = entryForTick(tick);
+    int key = mKeyForEntry[target];
+    mFramesDecodedLastSeek = 0;
+
+    if (mCurrentEntry == target) return &mCurrentFrame;
+
+    // Step forward from the cached frame when it sits between the keyframe and the target,
+    // otherwise restart from the keyframe
+    int from = (mCurrentEntry >= key && mCurrentEntry < target) ? mCurrentEntry : -1;
+    if (from < 0) {
+        if (!decodeEntry(key, nullptr, &mCurrentFrame)) {
+            mCurrentEntry = -1;
+            return nullptr;
+        }
+        from = key;
+    }
+
+    for (int i = from + 1; i <= target; i++) {
+        if (!decodeEntry(i, &mCurrentFrame, &mScratchFrame)) {
+            mCurrentEntry = -1;
+            return nullptr;
+        }
+        std::swap(mCurrentFrame, mScratchFrame);
+    }
+
+    mCurrentEntry = target;
+    return &mCurrentFrame;
+}
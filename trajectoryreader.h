@@ -0,0 +1,63 @@
+// 2dsim08/trajectoryreader.h - Memory-mapped random-access reader for trajectory recordings
+#ifndef TRAJECTORYREADER_H
+#define TRAJECTORYREADER_H
+
+#include "trajectoryformat.h"
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+// Maps the index and every chunk read-only. Seeking uses two tables built at open():
+// tick -> index entry and entry -> its keyframe, so locating any tick is O(1) and
+// decoding it costs at most one keyframe plus the deltas up to the target.
+class TrajectoryReader
+{
+public:
+    TrajectoryReader();
+    ~TrajectoryReader();
+
+    bool open(const QString& directory);
+    void close();
+    bool isOpen() const { return mEntryCount > 0; }
+    QString errorString() const { return mError; }
+
+    qint64 firstTick() const { return mFirstTick; }
+    qint64 lastTick() const { return mLastTick; }
+    int frameCount() const { return mEntryCount; }
+    int keyframeCount() const { return mKeyframeCount; }
+
+    // Frame at or just before tick (recordings can have dropped/downsampled ticks)
+    const TrajectoryFrame* frameAt(qint64 tick);
+    // Tick of the recorded frame `frames` away from the one shown at tick (for frame stepping)
+    qint64 stepTick(qint64 tick, int frames) const;
+    int framesDecodedLastSeek() const { return mFramesDecodedLastSeek; }
+
+private:
+    int entryForTick(qint64 tick) const;
+    bool decodeEntry(int entry, const TrajectoryFrame* previous, TrajectoryFrame* out);
+
+    QString mError;
+
+    // === Mapped files ===
+    QFile mIndexFile;
+    QVector<QFile*> mChunkFiles;
+    QVector<const uchar*> mChunkData;
+    QVector<qint64> mChunkSizes;
+    const TrajectoryIndexEntry* mEntries;
+    int mEntryCount;
+    int mKeyframeCount;
+
+    // === Seek tables ===
+    qint64 mFirstTick;
+    qint64 mLastTick;
+    QVector<qint32> mEntryForTick;     // [tick - firstTick] -> last entry with entry.tick <= tick
+    QVector<qint32> mKeyForEntry;      // [entry] -> keyframe entry it depends on
+
+    // === Decode cache ===
+    TrajectoryFrame mCurrentFrame;
+    TrajectoryFrame mScratchFrame;
+    int mCurrentEntry;
+    int mFramesDecodedLastSeek;
+};
+
+#endif // TRAJECTORYREADER_H
@@ -0,0 +1,241 @@
+// 2dsim08/trajectoryrecorder.cpp - Asynchronous compressed trajectory recorder
+#include "trajectoryrecorder.h"
+#include "memorystats.h"
+#include <QDir>
+#include <QMutexLocker>
+
+static const int RECORDER_MAX_DOWNSAMPLE_STRIDE = 64;
+
+// Held by the queue until the writer takes it (counted under MEMORY_QUEUES)
+static qint64 queuedFrameBytes(const TrajectoryFrame& frame) {
+    return sizeof(TrajectoryFrame) + static_cast<qint64>(frame.creatures.capacity()) * sizeof(TrajectoryCreature);
+}
+
+TrajectoryRecorder::TrajectoryRecorder(QObject* parent)
+    : QThread(parent)
+    , mKeyframeInterval(50)
+    , mQueueCapacity(64)
+    , mChunkBytes(64 * 1024 * 1024)
+    , mDropPolicy(RECORDER_DOWNSAMPLE)
+    , mCompressionLevel(3)
+    , mStopRequested(false)
+    , mDownsampleStride(1)
+    , mChunkIndex(0)
+    , mLastKeyTick(0)
+    , mHasPrevious(false)
+    , mFailed(false)
+    , mRecording(false)
+    , mFramesSubmitted(0)
+    , mFramesWritten(0)
+    , mFramesDropped(0)
+    , mFramesDownsampled(0)
+    , mFramesFailed(0)
+    , mKeyframesWritten(0)
+    , mBytesWritten(0)
+{
+}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+    stopRecording();
+}
+
+bool TrajectoryRecorder::startRecording(const QString& directory) {
+    if (isRunning()) return false;
+
+    if (!QDir().mkpath(directory)) return false;
+    mDirectory = directory;
+
+    mIndexFile.setFileName(QDir(directory).filePath(trajectoryIndexFileName()));
+    if (!mIndexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    mIndexFile.write(trajectoryFileHeader(TRAJECTORY_INDEX_MAGIC));
+
+    if (!openChunk(0)) {
+        mIndexFile.close();
+        return false;
+    }
+
+    while (!mQueue.isEmpty()) {
+        MemoryStats::freed(MEMORY_QUEUES, queuedFrameBytes(mQueue.dequeue()));
+    }
+    mStopRequested = false;
+    mWriteError.clear();
+    mDownsampleStride = 1;
+    mHasPrevious = false;
+    mFailed = false;
+    mLastKeyTick = 0;
+    mFramesSubmitted = 0;
+    mFramesWritten = 0;
+    mFramesDropped = 0;
+    mFramesDownsampled = 0;
+    mFramesFailed = 0;
+    mKeyframesWritten = 0;
+    mBytesWritten = 0;
+
+    mRecording.store(true, std::memory_order_release);
+    start(QThread::LowPriority);
+    return true;
+}
+
+void TrajectoryRecorder::stopRecording() {
+    if (!isRunning()) return;
+
+    mRecording.store(false, std::memory_order_release);
+    {
+        QMutexLocker locker(&mQueueMutex);
+        mStopRequested = true;
+        mQueueNotEmpty.wakeAll();
+    }
+    wait();
+
+    mChunkFile.close();
+    mIndexFile.close();
+}
+
+bool TrajectoryRecorder::wantsFrame(qint64 tick) {
+    if (!isRecording()) return false;
+
+    int stride = mDownsampleStride.load(std::memory_order_relaxed);
+    if (stride > 1 && tick % stride != 0) {
+        mFramesDownsampled++;
+        return false;
+    }
+    return true;
+}
+
+bool TrajectoryRecorder::submitFrame(TrajectoryFrame&& frame) {
+    if (!isRecording()) return false;
+    mFramesSubmitted++;
+
+    QMutexLocker locker(&mQueueMutex);
+    int depth = mQueue.size();
+
+    if (mDropPolicy == RECORDER_DOWNSAMPLE) {
+        // Widen the stride while the writer is behind, narrow it again once it catches up
+        int stride = mDownsampleStride.load(std::memory_order_relaxed);
+        if (depth * 4 >= mQueueCapacity * 3 && stride < RECORDER_MAX_DOWNSAMPLE_STRIDE) {
+            mDownsampleStride.store(stride * 2, std::memory_order_relaxed);
+        } else if (depth * 4 < mQueueCapacity && stride > 1) {
+            mDownsampleStride.store(stride / 2, std::memory_order_relaxed);
+        }
+    }
+
+    if (depth >= mQueueCapacity) {
+        if (mDropPolicy == RECORDER_DROP_OLDEST) {
+            MemoryStats::freed(MEMORY_QUEUES, queuedFrameBytes(mQueue.dequeue()));
+            mFramesDropped++;
+        } else {
+            mFramesDropped++;
+            return false;
+        }
+    }
+
+    MemoryStats::allocated(MEMORY_QUEUES, queuedFrameBytes(frame));
+    mQueue.enqueue(std::move(frame));
+    mQueueNotEmpty.wakeOne();
+    return true;
+}
+
+RecorderStats TrajectoryRecorder::stats() const {
+    RecorderStats s;
+    s.framesSubmitted = mFramesSubmitted;
+    s.framesWritten = mFramesWritten;
+    s.framesDropped = mFramesDropped;
+    s.framesDownsampled = mFramesDownsampled;
+    s.framesFailed = mFramesFailed;
+    s.keyframesWritten = mKeyframesWritten;
+    s.bytesWritten = mBytesWritten;
+    s.downsampleStride = mDownsampleStride;
+    {
+        QMutexLocker locker(&mQueueMutex);
+        s.queueDepth = mQueue.size();
+        s.writeError = mWriteError;
+    }
+    return s;
+}
+
+// === Writer Thread ===
+void TrajectoryRecorder::run() {
+    forever {
+        TrajectoryFrame frame;
+        {
+            QMutexLocker locker(&mQueueMutex);
+            while (mQueue.isEmpty() && !mStopRequested) {
+                mQueueNotEmpty.wait(&mQueueMutex);
+            }
+            if (mQueue.isEmpty()) break;  // Stop requested and fully drained
+            frame = mQueue.dequeue();
+        }
+        MemoryStats::freed(MEMORY_QUEUES, queuedFrameBytes(frame));
+
+        writeFrame(frame);
+    }
+
+    mChunkFile.flush();
+    mIndexFile.flush();
+}
+
+bool TrajectoryRecorder::openChunk(int chunk) {
+    mChunkFile.close();
+    mChunkFile.setFileName(QDir(mDirectory).filePath(trajectoryChunkFileName(chunk)));
+    if (!mChunkFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    mChunkFile.write(trajectoryFileHeader(TRAJECTORY_CHUNK_MAGIC));
+    mChunkIndex = chunk;
+    return true;
+}
+
+// A recording with a hole in it is not worth continuing: stop taking frames, keep what made it
+// to disk, and count the rest of the queue as failed
+void TrajectoryRecorder::fail(const QFile& file) {
+    mFailed = true;
+    mFramesFailed++;
+    mRecording.store(false, std::memory_order_release);
+    QMutexLocker locker(&mQueueMutex);
+    mWriteError = QString("%1: %2").arg(file.fileName()).arg(file.errorString());
+}
+
+void TrajectoryRecorder::writeFrame(const TrajectoryFrame& frame) {
+    if (mFailed) {
+        mFramesFailed++;
+        return;
+    }
+
+    bool isKey = !mHasPrevious
+              || frame.tick - mLastKeyTick >= mKeyframeInterval
+              || frame.creatures.size() != mPreviousFrame.creatures.size();
+
+    // Roll chunks only on keyframes so every chunk decodes on its own
+    if (isKey && mHasPrevious && mChunkFile.pos() >= mChunkBytes) {
+        if (!openChunk(mChunkIndex + 1)) {
+            fail(mChunkFile);
+            return;
+        }
+    }
+
+    QByteArray encoded = encodeTrajectoryFrame(frame, isKey ? nullptr : &mPreviousFrame, mCompressionLevel);
+
+    TrajectoryIndexEntry entry;
+    entry.tick = frame.tick;
+    entry.chunk = mChunkIndex;
+    entry.offset = static_cast<quint32>(mChunkFile.pos());
+    entry.size = static_cast<quint32>(encoded.size());
+    entry.flags = isKey ? TRAJECTORY_FRAME_KEY : 0;
+
+    if (mChunkFile.write(encoded) != encoded.size()) {
+        fail(mChunkFile);
+        return;
+    }
+    if (mIndexFile.write(reinterpret_cast<const char*>(&entry), sizeof(entry)) != sizeof(entry)) {
+        fail(mIndexFile);
+        return;
+    }
+
+    if (isKey) {
+        mLastKeyTick = frame.tick;
+        mKeyframesWritten++;
+    }
+    mPreviousFrame = frame;
+    mHasPrevious = true;
+    mFramesWritten++;
+    mBytesWritten += encoded.size() + sizeof(entry);
+}
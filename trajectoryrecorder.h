@@ -0,0 +1,108 @@
+// 2dsim08/trajectoryrecorder.h - Asynchronous compressed trajectory recorder
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+
+#include "trajectoryformat.h"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QFile>
+#include <QString>
+#include <atomic>
+
+// What to do when the writer thread falls behind and the queue is full
+enum RecorderDropPolicy {
+    RECORDER_DROP_NEWEST,    // Discard the frame being submitted
+    RECORDER_DROP_OLDEST,    // Discard the oldest queued frame to make room
+    RECORDER_DOWNSAMPLE      // Record every Nth tick, N grows while the queue is backed up
+};
+
+struct RecorderStats {
+    qint64 framesSubmitted;
+    qint64 framesWritten;
+    qint64 framesDropped;        // Lost because the queue was full
+    qint64 framesDownsampled;    // Skipped by the downsampling stride
+    qint64 framesFailed;         // Lost to a write error; recording stops at the first
+    qint64 keyframesWritten;
+    qint64 bytesWritten;
+    int queueDepth;
+    int downsampleStride;
+    QString writeError;          // The first write error, empty if none
+};
+
+// Sim thread: wantsFrame(tick) -> build snapshot -> submitFrame(). Neither call touches disk;
+// the only lock is a short queue mutex. The writer thread encodes and appends to chunk files.
+class TrajectoryRecorder : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit TrajectoryRecorder(QObject* parent = nullptr);
+    ~TrajectoryRecorder();
+
+    // Configure before startRecording()
+    void setKeyframeInterval(int ticks) { mKeyframeInterval = qMax(1, ticks); }
+    void setQueueCapacity(int frames) { mQueueCapacity = qMax(1, frames); }
+    void setChunkBytes(qint64 bytes) { mChunkBytes = qMax<qint64>(1024, bytes); }
+    void setDropPolicy(RecorderDropPolicy policy) { mDropPolicy = policy; }
+    void setCompressionLevel(int level) { mCompressionLevel = qBound(-1, level, 9); }
+
+    bool startRecording(const QString& directory);
+    void stopRecording();    // Drains the queue, then joins the writer thread
+    bool isRecording() const { return mRecording.load(std::memory_order_acquire); }
+    bool hasFailed() const { return isRunning() && !isRecording(); }   // A write error stopped it; call stopRecording()
+    QString directory() const { return mDirectory; }
+
+    // Cheap check so the caller can skip building snapshots that would be thrown away
+    bool wantsFrame(qint64 tick);
+    // Never blocks on disk. Returns false if the frame was dropped.
+    bool submitFrame(TrajectoryFrame&& frame);
+
+    RecorderStats stats() const;
+
+protected:
+    void run() override;
+
+private:
+    bool openChunk(int chunk);
+    void writeFrame(const TrajectoryFrame& frame);
+    void fail(const QFile& file);
+
+    // === Configuration ===
+    int mKeyframeInterval;
+    int mQueueCapacity;
+    qint64 mChunkBytes;
+    RecorderDropPolicy mDropPolicy;
+    int mCompressionLevel;
+    QString mDirectory;
+
+    // === Queue (shared between sim and writer) ===
+    mutable QMutex mQueueMutex;
+    QWaitCondition mQueueNotEmpty;
+    QQueue<TrajectoryFrame> mQueue;
+    bool mStopRequested;
+    QString mWriteError;
+    std::atomic<int> mDownsampleStride;
+
+    // === Writer state (writer thread only) ===
+    QFile mIndexFile;
+    QFile mChunkFile;
+    int mChunkIndex;
+    qint64 mLastKeyTick;
+    TrajectoryFrame mPreviousFrame;
+    bool mHasPrevious;
+    bool mFailed;                // Every frame after a write error is counted as failed
+
+    // === Counters ===
+    std::atomic<bool> mRecording;
+    std::atomic<qint64> mFramesSubmitted;
+    std::atomic<qint64> mFramesWritten;
+    std::atomic<qint64> mFramesDropped;
+    std::atomic<qint64> mFramesDownsampled;
+    std::atomic<qint64> mFramesFailed;
+    std::atomic<qint64> mKeyframesWritten;
+    std::atomic<qint64> mBytesWritten;
+};
+
+#endif // TRAJECTORYRECORDER_H
@@ -0,0 +1,103 @@
+// 2dsim08/worldcommands.cpp - Edit commands for a running world and the lock-free queue that carries them
+#include "worldcommands.h"
+#include "memorystats.h"
+
+static_assert((WorldCommandQueue::COMMAND_QUEUE_CAPACITY & (WorldCommandQueue::COMMAND_QUEUE_CAPACITY - 1)) == 0,
+              "the command queue capacity must be a power of two");
+
+// === Commands ===
+static WorldCommand makeCommand(WorldCommandType type, double x, double y) {
+    WorldCommand command;
+    command.type = type;
+    command.x = x;
+    command.y = y;
+    command.radius = 0;
+    command.count = 0;
+    command.alphaID = 0;
+    command.terrain = TERRAIN_NONE;
+    return command;
+}
+
+WorldCommand WorldCommand::spawnHerd(double x, double y, int count, double radius) {
+    WorldCommand command = makeCommand(COMMAND_SPAWN_HERD, x, y);
+    command.count = count;
+    command.radius = radius;
+    return command;
+}
+
+WorldCommand WorldCommand::moveAlpha(int alphaID, double x, double y) {
+    WorldCommand command = makeCommand(COMMAND_MOVE_ALPHA, x, y);
+    command.alphaID = alphaID;
+    return command;
+}
+
+WorldCommand WorldCommand::retargetHerd(int alphaID, double x, double y) {
+    WorldCommand command = makeCommand(COMMAND_RETARGET_HERD, x, y);
+    command.alphaID = alphaID;
+    return command;
+}
+
+WorldCommand WorldCommand::paintTerrain(double x, double y, double radius, TerrainType terrain) {
+    WorldCommand command = makeCommand(COMMAND_PAINT_TERRAIN, x, y);
+    command.radius = radius;
+    command.terrain = terrain;
+    return command;
+}
+
+// === Command Queue ===
+WorldCommandQueue::WorldCommandQueue()
+    : mCells(new Cell[COMMAND_QUEUE_CAPACITY])
+    , mTail(0)
+    , mHead(0)
+    , mRejected(0)
+{
+    for (int i = 0; i < COMMAND_QUEUE_CAPACITY; i++) {
+        mCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    MemoryStats::allocated(MEMORY_QUEUES, sizeof(Cell) * COMMAND_QUEUE_CAPACITY);
+}
+
+WorldCommandQueue::~WorldCommandQueue() {
+    delete[] mCells;
+    MemoryStats::freed(MEMORY_QUEUES, sizeof(Cell) * COMMAND_QUEUE_CAPACITY);
+}
+
+bool WorldCommandQueue::push(const WorldCommand& command) {
+    quint64 position = mTail.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &mCells[position & (COMMAND_QUEUE_CAPACITY - 1)];
+        const quint64 sequence = cell->sequence.load(std::memory_order_acquire);
+        const qint64 lag = static_cast<qint64>(sequence - position);
+        if (lag == 0) {
+            // The cell is free for this position; claim it unless another producer got there first
+            if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+        } else if (lag < 0) {
+            // Still holds the command from one lap ago: the consumer is a full ring behind
+            mRejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = mTail.load(std::memory_order_relaxed);
+        }
+    }
+    cell->command = command;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool WorldCommandQueue::hasPending() const {
+    return mCells[mHead & (COMMAND_QUEUE_CAPACITY - 1)].sequence.load(std::memory_order_acquire) == mHead + 1;
+}
+
+int WorldCommandQueue::drain(WorldCommand* out, int max) {
+    int drained = 0;
+    while (drained < max) {
+        Cell* cell = &mCells[mHead & (COMMAND_QUEUE_CAPACITY - 1)];
+        // Not yet filled, or claimed by a producer still copying: the rest waits for the next drain
+        if (cell->sequence.load(std::memory_order_acquire) != mHead + 1) break;
+        out[drained++] = cell->command;
+        cell->sequence.store(mHead + COMMAND_QUEUE_CAPACITY, std::memory_order_release);
+        mHead++;
+    }
+    return drained;
+}
@@ -0,0 +1,67 @@
+// 2dsim08/worldcommands.h - Edit commands for a running world and the lock-free queue that carries them
+#ifndef WORLDCOMMANDS_H
+#define WORLDCOMMANDS_H
+
+#include "terrainchunks.h"
+#include <QtGlobal>
+#include <atomic>
+
+// === Commands ===
+// One interactive edit, by value (no pointers into the world, so any thread can build one).
+// Alphas are named by unique ID; a command for an alpha this world no longer has is dropped.
+enum WorldCommandType {
+    COMMAND_SPAWN_HERD,       // count creatures around (x, y) within radius; the first is their alpha
+    COMMAND_MOVE_ALPHA,       // Puts the alpha down at (x, y); its herd follows as usual
+    COMMAND_RETARGET_HERD,    // Sends the alpha (and so its herd) travelling to (x, y)
+    COMMAND_PAINT_TERRAIN     // Cells within radius of (x, y) become terrain
+};
+
+struct WorldCommand {
+    WorldCommandType type;
+    double x;                 // Scene units
+    double y;
+    double radius;            // Spawn scatter / paint brush
+    int count;                // Spawn: creatures including the alpha
+    int alphaID;              // Move / retarget
+    TerrainType terrain;      // Paint
+
+    static WorldCommand spawnHerd(double x, double y, int count, double radius);
+    static WorldCommand moveAlpha(int alphaID, double x, double y);
+    static WorldCommand retargetHerd(int alphaID, double x, double y);
+    static WorldCommand paintTerrain(double x, double y, double radius, TerrainType terrain);
+};
+
+// === Command Queue ===
+// Bounded multi-producer / single-consumer ring (Vyukov's, with a sequence number per cell).
+// Producers - the GUI thread, a control socket's thread, anything - claim a cell with one
+// compare-and-swap and never block or allocate: when the ring is full push() returns false
+// and the command is counted as rejected. The world drains it on the tick thread between
+// ticks; an empty queue costs that thread one atomic load.
+class WorldCommandQueue
+{
+public:
+    static const int COMMAND_QUEUE_CAPACITY = 1024;   // Power of two
+
+    WorldCommandQueue();
+    ~WorldCommandQueue();
+
+    bool push(const WorldCommand& command);           // Any thread; false = full, dropped
+    bool hasPending() const;                          // Consumer only; one atomic load
+    int drain(WorldCommand* out, int max);            // Consumer only; oldest first
+    quint64 rejected() const { return mRejected.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<quint64> sequence;   // == position: free for that push; position + 1: filled
+        WorldCommand command;
+    };
+
+    Cell* mCells;                                     // Heap: worlds also live on worker stacks
+    std::atomic<quint64> mTail;                       // Next position producers claim
+    quint64 mHead;                                    // Next position the consumer reads
+    std::atomic<quint64> mRejected;
+
+    Q_DISABLE_COPY(WorldCommandQueue)
+};
+
+#endif // WORLDCOMMANDS_H
@@ -0,0 +1,345 @@
+// 2dsim08/worldfeed.cpp - Publishes every completed tick into a shared-memory ring for external readers
+#include "worldfeed.h"
+#include "worldfeedreader.h"
+#include "simworld.h"
+#include "simtrace.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+WorldFeed::WorldFeed()
+    : mHeader(nullptr)
+    , mBase(nullptr)
+    , mSize(0)
+    , mPublished(0)
+    , mTruncated(0)
+    , mShard(-1)
+    , mTruncating(false)
+{
+}
+
+WorldFeed::~WorldFeed() {
+    close();
+}
+
+bool WorldFeed::create(const QString& name, int capacity, const QRectF& region, int shard, QString* error) {
+    close();
+    mPublished = 0;
+    mTruncated = 0;
+    mTruncating = false;
+    return map(name, capacity, region, shard, error);
+}
+
+int WorldFeed::capacity() const {
+    return mHeader ? static_cast<int>(mHeader->capacity) : 0;
+}
+
+// Creates and maps a fresh segment, then retires the current one (if any) as replaced. A
+// replacement is built under a temporary name and renamed over the live one only once complete,
+// so readers opening the name never see it missing or half-written. On failure the current
+// segment stays mapped, named and in use.
+bool WorldFeed::map(const QString& name, int capacity, const QRectF& region, int shard, QString* error) {
+#ifdef Q_OS_UNIX
+    const std::string target = worldFeedSegmentName(name.toStdString());
+    const bool replacing = mHeader != nullptr;
+    const std::string segment = replacing ? target + ".grow" : target;
+    const uint64_t creatures = qMax(1, capacity);
+
+    // Slot layout: header, then one array per field, each on its own cache lines
+    uint64_t offset = worldFeedAlign(sizeof(WorldFeedSlot));
+    const uint64_t xOffset = offset;
+    offset = worldFeedAlign(offset + creatures * sizeof(float));
+    const uint64_t yOffset = offset;
+    offset = worldFeedAlign(offset + creatures * sizeof(float));
+    const uint64_t idOffset = offset;
+    offset = worldFeedAlign(offset + creatures * sizeof(int32_t));
+    const uint64_t alphaOffset = offset;
+    offset = worldFeedAlign(offset + creatures * sizeof(int32_t));
+    const uint64_t stateOffset = offset;
+    offset = worldFeedAlign(offset + creatures);
+    const uint64_t flagsOffset = offset;
+    const uint64_t slotBytes = worldFeedAlign(offset + creatures);
+    const uint64_t firstSlotOffset = worldFeedAlign(sizeof(WorldFeedHeader));
+    const size_t size = firstSlotOffset + FEED_SLOTS * slotBytes;
+
+    // A segment left by a crashed run is unlinked, not reused: its readers keep their mapping.
+    // Only ever the name about to be created - never the live one, while it is still ours.
+    shm_unlink(segment.c_str());
+    int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        if (error) *error = QString("Cannot create %1: %2").arg(QString::fromStdString(segment), std::strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd, size) != 0) {
+        if (error) *error = QString("Cannot size %1: %2").arg(QString::fromStdString(segment), std::strerror(errno));
+        ::close(fd);
+        shm_unlink(segment.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        if (error) *error = QString("Cannot map %1: %2").arg(QString::fromStdString(segment), std::strerror(errno));
+        shm_unlink(segment.c_str());
+        return false;
+    }
+
+    WorldFeedHeader* header = new (memory) WorldFeedHeader;
+    header->version = WORLD_FEED_VERSION;
+    header->slotCount = FEED_SLOTS;
+    header->capacity = static_cast<uint32_t>(creatures);
+    header->firstSlotOffset = firstSlotOffset;
+    header->slotBytes = slotBytes;
+    header->xOffset = xOffset;
+    header->yOffset = yOffset;
+    header->idOffset = idOffset;
+    header->alphaOffset = alphaOffset;
+    header->stateOffset = stateOffset;
+    header->flagsOffset = flagsOffset;
+    header->regionX = region.x();
+    header->regionY = region.y();
+    header->regionWidth = region.width();
+    header->regionHeight = region.height();
+    header->shard = shard;
+    header->reserved = 0;
+    header->published.store(mPublished, std::memory_order_relaxed);   // Frame numbers carry on across growth
+    header->closed.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < FEED_SLOTS; i++) {
+        WorldFeedSlot* slot = new (static_cast<uchar*>(memory) + firstSlotOffset + i * slotBytes) WorldFeedSlot;
+        slot->sequence.store(0, std::memory_order_relaxed);
+    }
+    header->magic.store(WORLD_FEED_MAGIC, std::memory_order_release);
+
+    if (replacing) {
+#ifdef Q_OS_LINUX
+        // POSIX has no shm rename; Linux keeps the objects in /dev/shm, where rename is atomic
+        const std::string from = "/dev/shm" + segment;
+        const std::string to = "/dev/shm" + target;
+        const bool renamed = std::rename(from.c_str(), to.c_str()) == 0;
+        const QString reason = renamed ? QString() : QString(std::strerror(errno));
+#else
+        const bool renamed = false;
+        const QString reason = "needs /dev/shm (Linux)";
+#endif
+        if (!renamed) {
+            if (error) *error = QString("Cannot move %1 into place: %2").arg(QString::fromStdString(segment), reason);
+            munmap(memory, size);
+            shm_unlink(segment.c_str());
+            return false;
+        }
+    }
+
+    release(WORLD_FEED_REPLACED, false);   // The name is the new segment's now
+    mBase = static_cast<uchar*>(memory);
+    mSize = size;
+    mName = name;
+    mRegion = region;
+    mShard = shard;
+    mHeader = header;
+    return true;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(capacity);
+    Q_UNUSED(region);
+    Q_UNUSED(shard);
+    if (error) *error = "World feeds need POSIX shared memory";
+    return false;
+#endif
+}
+
+void WorldFeed::close() {
+    release(WORLD_FEED_CLOSED, true);
+}
+
+void WorldFeed::release(uint32_t closed, bool unlink) {
+    if (!mHeader) return;
+#ifdef Q_OS_UNIX
+    mHeader->closed.store(closed, std::memory_order_release);
+    munmap(mBase, mSize);
+    if (unlink) {
+        shm_unlink(worldFeedSegmentName(mName.toStdString()).c_str());
+    }
+#else
+    Q_UNUSED(closed);
+    Q_UNUSED(unlink);
+#endif
+    mHeader = nullptr;
+    mBase = nullptr;
+    mSize = 0;
+}
+
+// Where one frame's arrays live; the copy lambda captures only this, so it needs no heap
+struct WorldFeedArrays {
+    const SimpleCreature* const* creatures;
+    float* x;
+    float* y;
+    int32_t* id;
+    int32_t* alphaId;
+    uint8_t* state;
+    uint8_t* flags;
+};
+
+void WorldFeed::publish(SimWorld& world) {
+    if (!mHeader) return;
+    TraceScope trace("feed publish");
+
+    const QVector<SimpleCreature*>& creatures = world.creatures();
+    if (creatures.size() > static_cast<int>(mHeader->capacity) && !mTruncating) {
+        // Spawns or migrations outgrew the segment: move to a larger one (tried once per truncation run)
+        const int capacity = capacityFor(creatures.size());
+        QString error;
+        if (map(mName, capacity, mRegion, mShard, &error)) {
+            log(QString("Feed: %1 grew to %2 creatures per frame").arg(mName).arg(capacity));
+        } else {
+            log(QString("Feed: cannot grow %1 to %2 creatures (%3); frames are truncated").arg(mName).arg(capacity).arg(error));
+        }
+    }
+    const int count = qMin(creatures.size(), static_cast<int>(mHeader->capacity));
+    const quint64 number = mPublished;
+    uchar* slotBase = mBase + mHeader->firstSlotOffset + (number % mHeader->slotCount) * mHeader->slotBytes;
+    WorldFeedSlot* slot = reinterpret_cast<WorldFeedSlot*>(slotBase);
+
+    // Sequence lock: odd while the slot is rewritten, so a reader still on the frame it held
+    // before sees that its view went stale
+    slot->sequence.store(2 * number + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    WorldFeedArrays arrays = {
+        creatures.constData(),
+        reinterpret_cast<float*>(slotBase + mHeader->xOffset),
+        reinterpret_cast<float*>(slotBase + mHeader->yOffset),
+        reinterpret_cast<int32_t*>(slotBase + mHeader->idOffset),
+        reinterpret_cast<int32_t*>(slotBase + mHeader->alphaOffset),
+        slotBase + mHeader->stateOffset,
+        slotBase + mHeader->flagsOffset
+    };
+    world.parallelFor(count, [&arrays](int start, int end, int) {
+        for (int i = start; i < end; i++) {
+            const SimpleCreature* creature = arrays.creatures[i];
+            arrays.x[i] = static_cast<float>(creature->posX);
+            arrays.y[i] = static_cast<float>(creature->posY);
+            arrays.id[i] = creature->uniqueID;
+            arrays.alphaId[i] = creature->myAlpha ? creature->myAlpha->uniqueID : 0;
+            arrays.state[i] = static_cast<uint8_t>(creature->state);
+            arrays.flags[i] = (creature->isAlpha ? WORLD_FEED_ALPHA : 0) | (creature->collapsed ? WORLD_FEED_COLLAPSED : 0);
+        }
+    });
+
+    slot->tick = world.tickCount();
+    slot->count = static_cast<uint32_t>(count);
+    slot->total = static_cast<uint32_t>(creatures.size());
+    slot->sequence.store(2 * number + 2, std::memory_order_release);
+    mHeader->published.store(number + 1, std::memory_order_release);
+
+    mPublished++;
+    const bool truncated = count < creatures.size();
+    if (truncated) {
+        mTruncated++;
+    }
+    if (truncated != mTruncating) {
+        mTruncating = truncated;
+        if (!truncated) {
+            log(QString("Feed: %1 frames whole again after %2 truncated").arg(mName).arg(mTruncated));
+        }
+    }
+}
+
+// === Sample Consumer ===
+// Waits up to FEED_OPEN_TIMEOUT_MS for the publisher
+static bool openFeed(WorldFeedReader* reader, const QString& name) {
+    std::string error;
+    QElapsedTimer openTimer;
+    openTimer.start();
+    while (!reader->open(name.toStdString(), &error)) {
+        if (openTimer.elapsed() > WorldFeed::FEED_OPEN_TIMEOUT_MS) {
+            std::fprintf(stderr, "Feed: %s\n", error.c_str());
+            return false;
+        }
+        QThread::msleep(100);
+    }
+    return true;
+}
+
+int WorldFeed::monitor(const QString& name, qint64 frames) {
+    WorldFeedReader reader;
+    if (!openFeed(&reader, name)) return 1;
+
+    const WorldFeedHeader* header = reader.header();
+    std::printf("Feed: %s, %s, region (%.0f,%.0f) %.0fx%.0f, %u creatures per frame, %u slots\n",
+                qPrintable(name), header->shard < 0 ? "whole world" : qPrintable(QString("shard %1").arg(header->shard)),
+                header->regionX, header->regionY, header->regionWidth, header->regionHeight,
+                header->capacity, header->slotCount);
+    std::fflush(stdout);
+
+    qint64 read = 0;
+    qint64 torn = 0;
+    qint64 lastTick = 0;
+    uint32_t lastCount = 0;
+    int lastAlphas = 0;
+    double centroidX = 0;
+    double centroidY = 0;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 nextReport = FEED_MONITOR_MS;
+
+    while (frames <= 0 || read < frames) {
+        // Closed is stored after the last frame, so once seen, next() has every frame there is
+        const bool closed = reader.isClosed();
+        WorldFeedFrame frame;
+        if (!reader.next(&frame)) {
+            if (closed && reader.isReplaced()) {
+                if (!openFeed(&reader, name)) return 1;
+                std::printf("Feed: publisher moved to a larger segment, %u creatures per frame\n", reader.header()->capacity);
+                std::fflush(stdout);
+                continue;
+            }
+            if (closed) break;
+            QThread::msleep(1);   // Only while idle; reading a frame takes no syscall
+        } else {
+            // Read the arrays in place, as an analytics consumer would
+            double sumX = 0;
+            double sumY = 0;
+            int alphas = 0;
+            for (uint32_t i = 0; i < frame.count; i++) {
+                sumX += frame.x[i];
+                sumY += frame.y[i];
+                alphas += (frame.flags[i] & WORLD_FEED_ALPHA) ? 1 : 0;
+            }
+            if (!frame.stillValid()) {
+                torn++;   // Reused under us: discard
+                continue;
+            }
+            read++;
+            lastTick = frame.tick;
+            lastCount = frame.count;
+            lastAlphas = alphas;
+            centroidX = frame.count ? sumX / frame.count : 0;
+            centroidY = frame.count ? sumY / frame.count : 0;
+        }
+
+        if (timer.elapsed() >= nextReport) {
+            nextReport += FEED_MONITOR_MS;
+            std::printf("Feed: %lld frames (%.1f/s), tick %lld, %u creatures, %d alphas, centroid (%.0f,%.0f), "
+                        "%llu skipped, %lld torn\n",
+                        static_cast<long long>(read), read * 1000.0 / qMax<qint64>(1, timer.elapsed()),
+                        static_cast<long long>(lastTick), lastCount, lastAlphas, centroidX, centroidY,
+                        static_cast<unsigned long long>(reader.skipped()), static_cast<long long>(torn));
+            std::fflush(stdout);
+        }
+    }
+
+    std::printf("Feed: done - %lld frames read, %llu skipped, %lld torn, last tick %lld\n",
+                static_cast<long long>(read), static_cast<unsigned long long>(reader.skipped()),
+                static_cast<long long>(torn), static_cast<long long>(lastTick));
+    return 0;
+}
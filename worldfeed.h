@@ -0,0 +1,62 @@
+// 2dsim08/worldfeed.h - Publishes every completed tick into a shared-memory ring for external readers
+#ifndef WORLDFEED_H
+#define WORLDFEED_H
+
+#include "worldfeedformat.h"
+#include <QRectF>
+#include <QString>
+#include <functional>
+
+class SimWorld;
+
+// Writes each completed tick's creature arrays into the next slot of a POSIX shared-memory
+// ring (layout in worldfeedformat.h; readers use WorldFeedReader, which needs no Qt). The tick
+// thread pays for one parallel copy per tick and never waits: there is no handshake with
+// readers, who only ever map the segment read-only. A world that outgrows the segment moves to
+// a larger one, renamed over the same name on Linux (readers see WORLD_FEED_REPLACED and open it
+// again); only if that fails are frames truncated to the capacity.
+class WorldFeed
+{
+public:
+    static const int FEED_SLOTS = 8;               // A reader may lag this many frames minus one
+    static const int FEED_HEADROOM_PERCENT = 25;   // Capacity above the creature count, at creation and on growth
+    static const int FEED_MONITOR_MS = 5000;       // Between --read-feed progress lines
+    static const int FEED_OPEN_TIMEOUT_MS = 10000; // --read-feed waits this long for the publisher
+
+    WorldFeed();
+    ~WorldFeed();
+
+    // Replaces a segment a crashed publisher left behind; readers still mapping the old one keep it
+    bool create(const QString& name, int capacity, const QRectF& region, int shard, QString* error);
+    void close();                                  // Marks the feed closed and unlinks the name
+    bool isOpen() const { return mHeader != nullptr; }
+    QString name() const { return mName; }
+    int capacity() const;
+    void setLogger(const std::function<void(const QString&)>& logger) { mLogger = logger; }
+    static int capacityFor(int creatures) { return creatures * (100 + FEED_HEADROOM_PERCENT) / 100; }
+
+    void publish(SimWorld& world);                 // Tick thread, between ticks
+    quint64 published() const { return mPublished; }
+    quint64 truncated() const { return mTruncated; }   // Frames with more creatures than capacity
+
+    // --read-feed: a sample consumer that follows a feed and reports what it sees
+    static int monitor(const QString& name, qint64 frames);
+
+private:
+    bool map(const QString& name, int capacity, const QRectF& region, int shard, QString* error);
+    void release(uint32_t closed, bool unlink);
+    void log(const QString& text) { if (mLogger) mLogger(text); }
+
+    WorldFeedHeader* mHeader;
+    uchar* mBase;
+    size_t mSize;
+    QString mName;
+    quint64 mPublished;
+    quint64 mTruncated;
+    QRectF mRegion;
+    int mShard;
+    bool mTruncating;                              // The last frame was truncated
+    std::function<void(const QString&)> mLogger;
+};
+
+#endif // WORLDFEED_H
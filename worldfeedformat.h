@@ -0,0 +1,80 @@
+// 2dsim08/worldfeedformat.h - Shared-memory layout of the live world feed (plain C++, no Qt)
+#ifndef WORLDFEEDFORMAT_H
+#define WORLDFEEDFORMAT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// === Segment Layout ===
+// One POSIX shared-memory object per publishing world (see WorldFeed and WorldFeedReader):
+//   WorldFeedHeader | slot 0 | slot 1 | ... | slot slotCount-1
+// A slot is a WorldFeedSlot followed by the frame's creature arrays (structure of arrays, each
+// 64-byte aligned) at the offsets the header gives. Frame f is written into slot f % slotCount
+// under that slot's sequence lock, so readers never block the publisher: a reader that falls
+// more than slotCount - 1 frames behind loses frames instead.
+static const uint32_t WORLD_FEED_MAGIC = 0x44454657;   // "WFED"
+static const uint32_t WORLD_FEED_VERSION = 1;
+static const uint32_t WORLD_FEED_ALIGNMENT = 64;
+
+// Values of WorldFeedHeader::closed
+enum WorldFeedClosed {
+    WORLD_FEED_OPEN = 0,
+    WORLD_FEED_CLOSED = 1,         // The publisher stopped
+    WORLD_FEED_REPLACED = 2        // Moved to a larger segment under the same name; open it again
+};
+
+// Bits of the flags array
+enum WorldFeedCreatureFlag {
+    WORLD_FEED_ALPHA = 1,
+    WORLD_FEED_COLLAPSED = 2       // Carried by a level-of-detail aggregate; position is stale
+};
+
+struct WorldFeedHeader {
+    std::atomic<uint32_t> magic;   // Stored last, once the rest is valid
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t capacity;             // Creatures per slot
+    uint64_t firstSlotOffset;      // From the start of the segment
+    uint64_t slotBytes;            // Stride between slots
+
+    // Array offsets within a slot
+    uint64_t xOffset;              // float[capacity], committed position
+    uint64_t yOffset;              // float[capacity]
+    uint64_t idOffset;             // int32_t[capacity], unique ID
+    uint64_t alphaOffset;          // int32_t[capacity], alpha's unique ID (0 = none)
+    uint64_t stateOffset;          // uint8_t[capacity], CreatureState
+    uint64_t flagsOffset;          // uint8_t[capacity], WorldFeedCreatureFlag bits
+
+    double regionX;                // Area the publishing world simulates
+    double regionY;
+    double regionWidth;
+    double regionHeight;
+    int32_t shard;                 // -1 = the whole world
+    uint32_t reserved;
+
+    alignas(64) std::atomic<uint64_t> published;   // Frames completed; the newest is published - 1
+    std::atomic<uint32_t> closed;  // WorldFeedClosed; once set, no more frames will come here
+};
+
+struct WorldFeedSlot {
+    std::atomic<uint64_t> sequence;   // 2f+1 while frame f is written, 2f+2 once complete
+    int64_t tick;
+    uint32_t count;                   // Creatures in this frame (at most capacity)
+    uint32_t total;                   // Creatures in the world (above count = truncated)
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "the feed's atomics are shared between processes and must be lock-free");
+
+// Feed names are POSIX shared-memory names: "herds" is /dev/shm/herds on Linux
+inline std::string worldFeedSegmentName(const std::string& name) {
+    return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+inline uint64_t worldFeedAlign(uint64_t bytes) {
+    return (bytes + WORLD_FEED_ALIGNMENT - 1) / WORLD_FEED_ALIGNMENT * WORLD_FEED_ALIGNMENT;
+}
+
+#endif // WORLDFEEDFORMAT_H
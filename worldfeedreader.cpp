@@ -0,0 +1,140 @@
+// 2dsim08/worldfeedreader.cpp - Reader library for the live world feed (plain C++, no Qt)
+#include "worldfeedreader.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WORLD_FEED_POSIX 1
+#endif
+
+WorldFeedReader::WorldFeedReader()
+    : mHeader(nullptr)
+    , mBase(nullptr)
+    , mSize(0)
+    , mNext(0)
+    , mSkipped(0)
+{
+}
+
+WorldFeedReader::~WorldFeedReader() {
+    close();
+}
+
+bool WorldFeedReader::open(const std::string& name, std::string* error) {
+    close();
+#ifdef WORLD_FEED_POSIX
+    const std::string segment = worldFeedSegmentName(name);
+    int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        if (error) *error = "No world is publishing " + segment + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(WorldFeedHeader)) {
+        ::close(fd);
+        if (error) *error = segment + " is not ready yet";
+        return false;
+    }
+
+    // Read-only: the mapping is the only way in, so a reader cannot disturb the publisher
+    void* memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        if (error) *error = "Cannot map " + segment + ": " + std::strerror(errno);
+        return false;
+    }
+
+    const WorldFeedHeader* header = static_cast<const WorldFeedHeader*>(memory);
+    const uint64_t end = header->firstSlotOffset + uint64_t(header->slotCount) * header->slotBytes;
+    if (header->magic.load(std::memory_order_acquire) != WORLD_FEED_MAGIC || header->version != WORLD_FEED_VERSION ||
+        header->slotCount < 2 || end > static_cast<uint64_t>(info.st_size)) {
+        munmap(memory, info.st_size);
+        if (error) *error = segment + " is not a world feed of this version";
+        return false;
+    }
+
+    mHeader = header;
+    mBase = static_cast<const unsigned char*>(memory);
+    mSize = info.st_size;
+    mNext = published();   // Start with the next frame, not the history
+    mSkipped = 0;
+    return true;
+#else
+    if (error) *error = "World feeds need POSIX shared memory";
+    (void)name;
+    return false;
+#endif
+}
+
+void WorldFeedReader::close() {
+#ifdef WORLD_FEED_POSIX
+    if (mBase) {
+        munmap(const_cast<unsigned char*>(mBase), mSize);
+    }
+#endif
+    mHeader = nullptr;
+    mBase = nullptr;
+    mSize = 0;
+}
+
+uint64_t WorldFeedReader::published() const {
+    return mHeader ? mHeader->published.load(std::memory_order_acquire) : 0;
+}
+
+bool WorldFeedReader::isClosed() const {
+    return !mHeader || mHeader->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool WorldFeedReader::isReplaced() const {
+    return mHeader && mHeader->closed.load(std::memory_order_acquire) == WORLD_FEED_REPLACED;
+}
+
+bool WorldFeedReader::latest(WorldFeedFrame* frame) const {
+    const uint64_t count = published();
+    return count > 0 && this->frame(count - 1, frame);
+}
+
+bool WorldFeedReader::frame(uint64_t number, WorldFeedFrame* frame) const {
+    if (!mHeader) return false;
+
+    const unsigned char* slotBase = mBase + mHeader->firstSlotOffset + (number % mHeader->slotCount) * mHeader->slotBytes;
+    const WorldFeedSlot* slot = reinterpret_cast<const WorldFeedSlot*>(slotBase);
+    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence != 2 * number + 2) return false;   // Still being written, or already reused
+
+    frame->number = number;
+    frame->tick = slot->tick;
+    frame->count = slot->count < mHeader->capacity ? slot->count : mHeader->capacity;
+    frame->total = slot->total;
+    frame->x = reinterpret_cast<const float*>(slotBase + mHeader->xOffset);
+    frame->y = reinterpret_cast<const float*>(slotBase + mHeader->yOffset);
+    frame->id = reinterpret_cast<const int32_t*>(slotBase + mHeader->idOffset);
+    frame->alphaId = reinterpret_cast<const int32_t*>(slotBase + mHeader->alphaOffset);
+    frame->state = slotBase + mHeader->stateOffset;
+    frame->flags = slotBase + mHeader->flagsOffset;
+    frame->slot = slot;
+    frame->sequence = sequence;
+    return frame->stillValid();   // The header fields above were not torn
+}
+
+bool WorldFeedReader::next(WorldFeedFrame* frame) {
+    if (!mHeader) return false;
+    const uint64_t count = published();
+    // The slot of frame `count` is the one the publisher writes next; older frames than the
+    // slotCount - 1 before it are gone or about to be
+    const uint64_t oldest = count >= mHeader->slotCount - 1 ? count - (mHeader->slotCount - 1) : 0;
+    if (mNext < oldest) {
+        mSkipped += oldest - mNext;
+        mNext = oldest;
+    }
+    while (mNext < count) {
+        if (this->frame(mNext++, frame)) return true;
+        mSkipped++;
+    }
+    return false;
+}
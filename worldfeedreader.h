@@ -0,0 +1,65 @@
+// 2dsim08/worldfeedreader.h - Reader library for the live world feed (plain C++, no Qt)
+#ifndef WORLDFEEDREADER_H
+#define WORLDFEEDREADER_H
+
+#include "worldfeedformat.h"
+#include <string>
+
+// One frame as views into the shared mapping - nothing is copied. The publisher reuses the
+// slot slotCount frames later, possibly while it is still being read, so check stillValid()
+// after reading and discard what was read if it returns false.
+struct WorldFeedFrame {
+    uint64_t number;
+    int64_t tick;
+    uint32_t count;
+    uint32_t total;              // Creatures in the world (above count = truncated)
+    const float* x;
+    const float* y;
+    const int32_t* id;
+    const int32_t* alphaId;      // 0 = none
+    const uint8_t* state;        // CreatureState
+    const uint8_t* flags;        // WorldFeedCreatureFlag bits
+
+    const WorldFeedSlot* slot;
+    uint64_t sequence;
+
+    WorldFeedFrame() : number(0), tick(0), count(0), total(0), x(nullptr), y(nullptr), id(nullptr), alphaId(nullptr),
+                       state(nullptr), flags(nullptr), slot(nullptr), sequence(0) {}
+    bool stillValid() const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot && slot->sequence.load(std::memory_order_relaxed) == sequence;
+    }
+};
+
+// Maps a feed read-only. After open() every call is plain loads from the mapping: no
+// syscalls, no locks, and nothing a slow reader does can hold up the publisher.
+class WorldFeedReader
+{
+public:
+    WorldFeedReader();
+    ~WorldFeedReader();
+
+    bool open(const std::string& name, std::string* error);   // Name as given to --publish
+    void close();
+    bool isOpen() const { return mHeader != nullptr; }
+    const WorldFeedHeader* header() const { return mHeader; }
+
+    uint64_t published() const;                        // Frames completed so far
+    bool isClosed() const;                             // No more frames here: stopped, or replaced
+    bool isReplaced() const;                           // The publisher outgrew this segment; open() again
+    bool latest(WorldFeedFrame* frame) const;          // Newest complete frame; false = none yet
+    bool frame(uint64_t number, WorldFeedFrame* frame) const;   // false = not yet, or already reused
+    // Frames in order: the one after the last next() returned, jumping ahead over frames the
+    // publisher already reused (counted by skipped()). false = nothing new yet.
+    bool next(WorldFeedFrame* frame);
+    uint64_t skipped() const { return mSkipped; }
+
+private:
+    const WorldFeedHeader* mHeader;
+    const unsigned char* mBase;
+    size_t mSize;
+    uint64_t mNext;
+    uint64_t mSkipped;
+};
+
+#endif // WORLDFEEDREADER_H